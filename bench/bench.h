@@ -0,0 +1,37 @@
+#pragma once
+
+// Self-registering cases for color_bench. BENCH(Name) defines one; each
+// case times its own loops and prints its figures through Report, one
+// "case: value unit" line each, so runs can be diffed or grepped.
+
+#include <chrono>
+#include <cstdint>
+
+typedef void (*BenchFunction)();
+
+int RegisterBench(const char* name, BenchFunction run);
+
+#define BENCH(name)                                                         \
+    static void Bench##name();                                              \
+    static const int g_bench##name = RegisterBench(#name, Bench##name);     \
+    static void Bench##name()
+
+void Report(const char* label, double value, const char* unit);
+
+// Folds a result into a global so the compiler cannot drop the work
+void Consume(uint64_t value);
+
+// Best wall time of `rounds` calls, in seconds. Timings on shared machines
+// only ever get slower than the code allows, so the minimum is the figure
+// least disturbed by everything else running.
+template <typename Fn>
+double BestSeconds(int rounds, Fn fn) {
+    double best = 0;
+    for (int i = 0; i < rounds; i++) {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        best = i == 0 || s < best ? s : best;
+    }
+    return best;
+}
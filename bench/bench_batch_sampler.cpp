@@ -0,0 +1,73 @@
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "core/batch_sampler.h"
+#include "core/image_io.h"
+
+namespace {
+
+// `files` 1280x720 screenshots on disk, `points` spread over each
+std::vector<BatchJob> WriteJobs(int files, int points) {
+    Image image;
+    image.Allocate(1280, 720, PixelFormat::RGB24);
+    for (size_t i = 0; i < image.pixels.size(); i++) {
+        image.pixels[i] = (uint8_t)(i * 2654435761u >> 24);
+    }
+    std::vector<BatchJob> jobs;
+    for (int k = 0; k < files; k++) {
+        char path[64];
+        snprintf(path, sizeof(path), "batch_bench_%d.ppm", k);
+        std::string error;
+        WritePPM(path, image.View(), error);
+        BatchJob job;
+        job.image = path;
+        for (int i = 0; i < points; i++) {
+            job.points.push_back({(i * 389 + k) % 1280, (i * 197) % 720});
+        }
+        jobs.push_back(job);
+    }
+    return jobs;
+}
+
+} // namespace
+
+// Many files with a few points each, where opening and mapping dominate,
+// and fewer files with many points, at each radius, on one worker and all
+BENCH(BatchSampling) {
+    FILE* out = tmpfile();
+    FILE* errors = tmpfile();
+    if (!out || !errors) return;
+    const int shapes[2][2] = {{256, 10}, {16, 4000}};
+    for (const auto& shape : shapes) {
+        std::vector<BatchJob> jobs = WriteJobs(shape[0], shape[1]);
+        const int radii[2] = {0, 2};
+        for (int radius : radii) {
+            for (BatchJob& job : jobs) {
+                job.radius = radius;
+            }
+            const int threads[2] = {1, 0};
+            for (int t : threads) {
+                BatchStats stats;
+                double seconds = BestSeconds(5, [&] {
+                    rewind(out);
+                    RunBatch(jobs, BatchFormat::CSV, t, out, errors, stats);
+                    Consume(stats.samples);
+                });
+                char label[96];
+                snprintf(label, sizeof(label), "%d files x %d points, radius %d, %s", shape[0], shape[1], radius,
+                         t == 1 ? "1 thread" : "all cores");
+                std::string files = std::string(label) + " files";
+                std::string samples = std::string(label) + " samples";
+                Report(files.c_str(), stats.files / seconds, "files/s");
+                Report(samples.c_str(), stats.samples / seconds, "samples/s");
+            }
+        }
+        for (const BatchJob& job : jobs) {
+            remove(job.image.c_str());
+        }
+    }
+    fclose(out);
+    fclose(errors);
+}
@@ -0,0 +1,76 @@
+#include <string>
+#include <thread>
+
+#include "bench.h"
+#include "core/capture_worker.h"
+#include "core/image_io.h"
+#include "core/sample_ring.h"
+
+// Samples handed across threads through the ring, the consumer popping
+// each one as the UI's drain loop would. Each carries a full loupe patch,
+// as in the GUI. Both sides yield when blocked, so on a single core this
+// measures the handoff through the scheduler.
+BENCH(SampleRing) {
+    static SampleRing<ColorSample, 64> ring;
+    const uint32_t count = 1 << 16;
+    double seconds = BestSeconds(3, [&] {
+        std::thread producer([&] {
+            ColorSample sample = {};
+            sample.patch.width = sample.patch.height = kMaxPatchCells;
+            for (uint32_t i = 0; i < count;) {
+                sample.sequence = i;
+                sample.x = (int)i;
+                if (ring.TryPush(sample)) {
+                    i++;
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+        uint64_t total = 0;
+        ColorSample sample;
+        for (uint32_t received = 0; received < count;) {
+            if (ring.TryPop(sample)) {
+                total += sample.sequence;
+                received++;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+        producer.join();
+        Consume(total);
+    });
+    Report("cross-thread push+pop", seconds * 1e9 / count, "ns/sample");
+}
+
+// The worker's per-tick cost without the waits: a moving cursor captures,
+// hashes and reduces every tick; a still one mostly skips
+BENCH(TrackingStep) {
+    Image image;
+    image.Allocate(1920, 1080, PixelFormat::BGRA32);
+    uint32_t state = 3;
+    for (uint8_t& v : image.pixels) {
+        state = state * 1664525u + 1013904223u;
+        v = (uint8_t)(state >> 24);
+    }
+    ImageScreenSource source(image);
+    const int ticks = 20000;
+    const int radii[2] = {2, 7};
+    for (int radius : radii) {
+        for (int moving = 0; moving < 2; moving++) {
+            double seconds = BestSeconds(3, [&] {
+                ChangeTracker tracker;
+                Color color = MakeColor(0, 0, 0);
+                uint64_t shown = 0;
+                for (int t = 0; t < ticks; t++) {
+                    int x = moving ? 100 + t % 1700 : 960;
+                    shown += TrackingStep(source, tracker, x, 540, (uint32_t)t * kFastIntervalMs, radius,
+                                          SampleReducer::Median, color);
+                }
+                Consume(shown);
+            });
+            std::string label = std::string(moving ? "moving" : "still") + " radius " + std::to_string(radius);
+            Report(label.c_str(), seconds * 1e9 / ticks, "ns/tick");
+        }
+    }
+}
@@ -0,0 +1,135 @@
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "core/color_core.h"
+
+namespace {
+
+// The same pseudo-random colors every run
+std::vector<Color> TestColors(size_t count) {
+    std::vector<Color> colors(count);
+    uint32_t state = 12345;
+    for (Color& c : colors) {
+        state = state * 1664525u + 1013904223u;
+        c = MakeColor(state >> 24, (state >> 16) & 255, (state >> 8) & 255);
+    }
+    return colors;
+}
+
+// RGBtoHSL as it was before the fixed-point version: doubles, truncated
+void RGBtoHSLDouble(int r, int g, int b, int& h, int& s, int& l) {
+    double dr = r / 255.0;
+    double dg = g / 255.0;
+    double db = b / 255.0;
+    double maxVal = std::max(std::max(dr, dg), db);
+    double minVal = std::min(std::min(dr, dg), db);
+    double delta = maxVal - minVal;
+    l = (int)((maxVal + minVal) / 2.0 * 100);
+    if (delta == 0) {
+        h = s = 0;
+        return;
+    }
+    s = l < 50 ? (int)(delta / (maxVal + minVal) * 100) : (int)(delta / (2.0 - maxVal - minVal) * 100);
+    if (maxVal == dr) {
+        h = (int)(((dg - db) / delta + (dg < db ? 6 : 0)) * 60);
+    } else if (maxVal == dg) {
+        h = (int)(((db - dr) / delta + 2) * 60);
+    } else {
+        h = (int)(((dr - dg) / delta + 4) * 60);
+    }
+}
+
+} // namespace
+
+// The std::string conversions every caller used before the formatters
+BENCH(ColorStrings) {
+    std::vector<Color> colors = TestColors(1 << 16);
+    double seconds = BestSeconds(5, [&] {
+        size_t total = 0;
+        for (Color c : colors) {
+            total += ColorToHex(c).size() + ColorToRGB(c).size() + ColorToHSL(c).size();
+        }
+        Consume(total);
+    });
+    Report("hex+rgb+hsl strings", seconds * 1e9 / colors.size(), "ns/color");
+}
+
+BENCH(PixelAt) {
+    const int width = 1920;
+    const int height = 1080;
+    std::vector<uint8_t> pixels((size_t)width * height * 4, 128);
+    PixelView view = {pixels.data(), width, height, (size_t)width * 4, PixelFormat::BGRA32};
+    double seconds = BestSeconds(5, [&] {
+        uint64_t total = 0;
+        for (int y = 0; y < height; y += 4) {
+            for (int x = 0; x < width; x++) {
+                total += PixelAt(view, x, y).g;
+            }
+        }
+        Consume(total);
+    });
+    Report("clamped reads", seconds * 1e9 / (width * (height / 4)), "ns/pixel");
+}
+
+// One color at a time, as the display path converts: the old truncating
+// double code against the exact fixed-point version at both precisions
+BENCH(HSLSingle) {
+    std::vector<Color> colors = TestColors(1 << 20);
+    typedef void (*Convert)(int, int, int, int&, int&, int&);
+    const Convert converts[3] = {RGBtoHSLDouble, RGBtoHSLFixed<kHSLWhole>, RGBtoHSLFixed<kHSLTenths>};
+    const char* labels[3] = {"double (before)", "fixed whole", "fixed tenths"};
+    for (int i = 0; i < 3; i++) {
+        Convert convert = converts[i];
+        double seconds = BestSeconds(5, [&] {
+            uint64_t total = 0;
+            for (Color c : colors) {
+                int h, s, l;
+                convert(c.r, c.g, c.b, h, s, l);
+                total += h + s + l;
+            }
+            Consume(total);
+        });
+        Report(labels[i], seconds * 1e9 / colors.size(), "ns/color");
+    }
+}
+
+// A 1080p frame of varied colors through each batch kernel and through the
+// single-color function in a loop
+BENCH(HSLBatch) {
+    const size_t count = 1920 * 1080;
+    std::vector<Color> colors = TestColors(count);
+    std::vector<uint8_t> bgra(count * 4);
+    for (size_t i = 0; i < count; i++) {
+        bgra[i * 4] = colors[i].b;
+        bgra[i * 4 + 1] = colors[i].g;
+        bgra[i * 4 + 2] = colors[i].r;
+        bgra[i * 4 + 3] = 255;
+    }
+    std::vector<HSLValue> out(count);
+    
+    double seconds = BestSeconds(5, [&] {
+        uint64_t total = 0;
+        for (size_t i = 0; i < count; i++) {
+            int h, s, l;
+            RGBtoHSL(colors[i].r, colors[i].g, colors[i].b, h, s, l);
+            total += h + s + l;
+        }
+        Consume(total);
+    });
+    Report("RGBtoHSL loop", count / seconds / 1e6, "Mpixels/s");
+    
+    SimdLevel original = GetSimdLevel();
+    const SimdLevel levels[3] = {SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2};
+    for (SimdLevel requested : levels) {
+        if (ForceSimdLevel(requested) != requested) continue;
+        seconds = BestSeconds(5, [&] {
+            RGBtoHSLBatch(bgra.data(), count, PixelFormat::BGRA32, out.data());
+            Consume(out[count / 2].h);
+        });
+        std::string label = std::string(SimdLevelName(requested)) + " batch";
+        Report(label.c_str(), count / seconds / 1e6, "Mpixels/s");
+    }
+    ForceSimdLevel(original);
+}
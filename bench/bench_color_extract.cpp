@@ -0,0 +1,51 @@
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "core/color_extract.h"
+#include "core/image_io.h"
+
+// Whole frames at common resolutions, one thread against several. The
+// histogram pass dominates; clustering cost is fixed by the bin count.
+BENCH(ExtractDominant) {
+    struct Size {
+        const char* name;
+        int width, height;
+    };
+    const Size sizes[3] = {{"720p", 1280, 720}, {"1080p", 1920, 1080}, {"4K", 3840, 2160}};
+    const int threadCounts[3] = {1, 2, 4};
+    const ExtractMethod methods[2] = {ExtractMethod::MedianCut, ExtractMethod::KMeans};
+    
+    for (const Size& size : sizes) {
+        Image image;
+        image.Allocate(size.width, size.height, PixelFormat::BGRA32);
+        uint32_t state = 17;
+        for (size_t i = 0; i < image.pixels.size(); i += 4) {
+            // Gradients plus a little noise: many occupied bins, like a photo
+            state = state * 1664525u + 1013904223u;
+            size_t pixel = i / 4;
+            int x = (int)(pixel % size.width);
+            int y = (int)(pixel / size.width);
+            image.pixels[i] = (uint8_t)(x * 255 / size.width + (state >> 29));
+            image.pixels[i + 1] = (uint8_t)(y * 255 / size.height + (state >> 30));
+            image.pixels[i + 2] = (uint8_t)((x + y) / 16);
+            image.pixels[i + 3] = 255;
+        }
+        
+        for (ExtractMethod method : methods) {
+            for (int threads : threadCounts) {
+                ExtractOptions options;
+                options.method = method;
+                options.threads = threads;
+                std::vector<DominantColor> out;
+                double seconds = BestSeconds(3, [&] {
+                    ExtractDominantColors(image.View(), options, out);
+                    Consume(out.size());
+                });
+                std::string label = std::string(size.name) + " " + ExtractMethodName(method) + " " +
+                                    std::to_string(threads) + (threads == 1 ? " thread" : " threads");
+                Report(label.c_str(), seconds * 1e3, "ms");
+            }
+        }
+    }
+}
@@ -0,0 +1,61 @@
+#include <cstdio>
+#include <string>
+
+#include "bench.h"
+#include "core/color_parse.h"
+
+namespace {
+
+// About 4 MB of rules: selectors with pseudo-classes and ids, @media
+// blocks, and declarations mixing hex and function colors with lengths
+std::string SyntheticStylesheet() {
+    std::string sheet;
+    char rule[256];
+    for (int i = 0; sheet.size() < (4u << 20); i++) {
+        unsigned v = (unsigned)i * 2654435761u;
+        if (i % 50 == 0) sheet += "@media (min-width: 600px) {\n";
+        snprintf(rule, sizeof(rule),
+                 ".card-%d:hover #item%d > .icon {\n"
+                 "    color: #%06X;\n"
+                 "    background: rgb(%u %u %u / 0.5);\n"
+                 "    border: 1px solid hsl(%u 60%% 40%%);\n"
+                 "    margin: 0 auto 12px;\n"
+                 "}\n",
+                 i, i, v >> 8, v >> 24, (v >> 16) & 255, (v >> 8) & 255, v % 360);
+        sheet += rule;
+        if (i % 50 == 49) sheet += "}\n";
+    }
+    return sheet;
+}
+
+} // namespace
+
+// Scanning alone, and scanning plus formatting into each syntax
+BENCH(CssColors) {
+    std::string sheet = SyntheticStylesheet();
+    const char* begin = sheet.data();
+    const char* end = begin + sheet.size();
+    size_t count = ConvertCssColors(begin, end, CssSyntax::Hex, NULL);
+    
+    double seconds = BestSeconds(5, [&] {
+        Consume(ConvertCssColors(begin, end, CssSyntax::Hex, NULL));
+    });
+    Report("scan", count / seconds / 1e6, "M colors/s");
+    Report("scan", sheet.size() / seconds / 1e6, "MB/s");
+    
+    for (int s = 0; s < kCssSyntaxCount; s++) {
+        CssSyntax syntax = (CssSyntax)s;
+        seconds = BestSeconds(5, [&] {
+            CssColorScanner scanner(begin, end);
+            CssMatch match;
+            char buffer[kCssBufferSize];
+            uint64_t total = 0;
+            while (scanner.Next(match)) {
+                total += FormatCssColor(match.color, syntax, buffer);
+            }
+            Consume(total);
+        });
+        std::string label = std::string("scan+format ") + CssSyntaxName(syntax);
+        Report(label.c_str(), count / seconds / 1e6, "M colors/s");
+    }
+}
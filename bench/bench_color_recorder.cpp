@@ -0,0 +1,82 @@
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+
+#include "bench.h"
+#include "core/color_recorder.h"
+#include "core/image_io.h"
+
+// Recording flat out from an image-backed source, so the figure is the
+// recorder's own ceiling: capture thread, block hand-over and the writer
+// streaming to disk. Bytes per million samples covers the file on disk and
+// the columns once read back.
+BENCH(ColorRecorder) {
+    const char* path = "color_recorder_bench.bin";
+    Image image;
+    image.Allocate(64, 64, PixelFormat::BGRA32);
+    for (size_t i = 0; i < image.pixels.size(); i++) {
+        image.pixels[i] = (uint8_t)(i * 2654435761u >> 24);
+    }
+    ImageScreenSource source(image);
+    ColorRecorder recorder(&source);
+    
+    const int radii[2] = {0, 2};
+    for (int radius : radii) {
+        RecordOptions options;
+        options.x = 32;
+        options.y = 32;
+        options.radius = radius;
+        options.intervalUs = 0;
+        double best = 0;
+        RecordCounters counters = {};
+        for (int round = 0; round < 3; round++) {
+            std::string error;
+            if (!recorder.Start(path, options, error)) {
+                fprintf(stderr, "%s\n", error.c_str());
+                return;
+            }
+            auto start = std::chrono::steady_clock::now();
+            std::this_thread::sleep_for(std::chrono::milliseconds(500));
+            recorder.Stop();
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            const RecordCounters& c = recorder.Counters();
+            double rate = c.samples / seconds;
+            if (rate > best) {
+                best = rate;
+                counters = c;
+            }
+        }
+        char label[96];
+        snprintf(label, sizeof(label), "radius %d, unthrottled", radius);
+        Report(label, best / 1e6, "M samples/s");
+        snprintf(label, sizeof(label), "radius %d, dropped while the disk fell behind", radius);
+        Report(label, counters.samples + counters.dropped > 0 ?
+                   100.0 * counters.dropped / (counters.samples + counters.dropped) : 0.0, "%");
+    }
+    
+    std::string error;
+    Recording recording;
+    if (!ReadRecording(path, recording, error) || recording.Size() == 0) {
+        remove(path);
+        return;
+    }
+    FILE* f = fopen(path, "rb");
+    long fileBytes = 0;
+    if (f) {
+        fseek(f, 0, SEEK_END);
+        fileBytes = ftell(f);
+        fclose(f);
+    }
+    double perMillion = 1e6 / recording.Size();
+    size_t columnBytes = recording.Size() * (sizeof(uint64_t) + 2 * sizeof(int32_t) + 3);
+    Report("bytes per 1M samples on disk", fileBytes * perMillion / 1e6, "MB");
+    Report("bytes per 1M samples read back", columnBytes * perMillion / 1e6, "MB");
+    
+    double read = BestSeconds(5, [&] {
+        ReadRecording(path, recording, error);
+        Consume(recording.Size());
+    });
+    Report("read back", recording.Size() / read / 1e6, "M samples/s");
+    remove(path);
+}
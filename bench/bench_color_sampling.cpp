@@ -0,0 +1,70 @@
+#include <string>
+
+#include "bench.h"
+#include "core/color_sampling.h"
+#include "core/image_io.h"
+#include "core/integral_image.h"
+
+// One pick per radius and reducer, over windows of anti-aliased-looking
+// noise so the median and mode histograms are not trivially one color
+BENCH(ReduceRegion) {
+    Image image;
+    image.Allocate(256, 256, PixelFormat::BGRA32);
+    uint32_t state = 7;
+    for (uint8_t& v : image.pixels) {
+        state = state * 1664525u + 1013904223u;
+        v = (uint8_t)(96 + (state >> 27));
+    }
+    
+    const SampleReducer reducers[3] = {SampleReducer::Mean, SampleReducer::Median, SampleReducer::Mode};
+    const int radii[4] = {1, 2, 7, 15};
+    const int picks = 2000;
+    for (int radius : radii) {
+        int side = radius * 2 + 1;
+        for (SampleReducer reducer : reducers) {
+            double seconds = BestSeconds(3, [&] {
+                uint64_t total = 0;
+                for (int i = 0; i < picks; i++) {
+                    PixelView view = image.View();
+                    view.data += (size_t)(i % 200) * view.stride + (size_t)(i % 190) * 4;
+                    view.width = side;
+                    view.height = side;
+                    total += ReduceRegion(view, reducer).g;
+                }
+                Consume(total);
+            });
+            std::string label = std::to_string(side) + "x" + std::to_string(side) + " " + SampleReducerName(reducer);
+            Report(label.c_str(), seconds * 1e6 / picks, "us/pick");
+        }
+    }
+}
+
+// The summed-area path: one build per frame, then four lookups per mean
+// whatever the radius
+BENCH(IntegralMean) {
+    Image image;
+    image.Allocate(1920, 1080, PixelFormat::BGRA32);
+    uint32_t state = 7;
+    for (uint8_t& v : image.pixels) {
+        state = state * 1664525u + 1013904223u;
+        v = (uint8_t)(state >> 24);
+    }
+    IntegralImage table;
+    double seconds = BestSeconds(3, [&] {
+        table.Build(image.View());
+        Consume(table.Width());
+    });
+    Report("1080p build", seconds * 1e3, "ms");
+    
+    const int picks = 1 << 20;
+    seconds = BestSeconds(3, [&] {
+        uint64_t total = 0;
+        for (int i = 0; i < picks; i++) {
+            Color mean;
+            table.Mean((i * 37) % 1890, (i * 11) % 1050, 31, 31, mean);
+            total += mean.g;
+        }
+        Consume(total);
+    });
+    Report("31x31 mean", seconds * 1e9 / picks, "ns/pick");
+}
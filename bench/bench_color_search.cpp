@@ -0,0 +1,83 @@
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "core/color_search.h"
+#include "core/image_io.h"
+
+namespace {
+
+// A UI-like frame: flat panels, rows of small colored badges and lines of
+// anti-aliased text, so most pixels match nothing and a few thousand do
+Image SyntheticFrame(int width, int height) {
+    Image image;
+    image.Allocate(width, height, PixelFormat::BGRA32);
+    uint32_t state = 77;
+    for (int y = 0; y < height; y++) {
+        uint8_t* p = image.pixels.data() + (size_t)y * image.Stride();
+        for (int x = 0; x < width; x++, p += 4) {
+            Color c = x < width / 5 ? MakeColor(31, 41, 55) : MakeColor(249, 250, 251);
+            if (y % 40 < 14 && x % 160 < 100 && x > width / 5) {
+                state = state * 1664525u + 1013904223u;
+                int shade = 40 + (int)(state >> 25);
+                c = MakeColor(shade, shade, shade + 10);
+            }
+            if (y % 120 > 100 && y % 120 < 112 && x % 300 < 24) {
+                c = MakeColor(16 + (x / 300) % 8, 185, 129);
+            }
+            p[0] = c.b;
+            p[1] = c.g;
+            p[2] = c.r;
+            p[3] = 255;
+        }
+    }
+    return image;
+}
+
+} // namespace
+
+// Exact searches for one badge color and for 256 colors, over 1080p and 4K
+// frames, at each SIMD level
+BENCH(SearchColors) {
+    struct Size {
+        const char* name;
+        int width, height;
+    };
+    const Size sizes[2] = {{"1080p", 1920, 1080}, {"4K", 3840, 2160}};
+    std::vector<Color> one = {MakeColor(16, 185, 129)};
+    std::vector<Color> many;
+    for (int i = 0; i < 256; i++) many.push_back(MakeColor(16 + i % 8, 185 - i / 8, 129));
+    
+    for (const Size& size : sizes) {
+        Image image = SyntheticFrame(size.width, size.height);
+        SimdLevel original = GetSimdLevel();
+        const SimdLevel levels[3] = {SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2};
+        for (SimdLevel requested : levels) {
+            if (ForceSimdLevel(requested) != requested) continue;
+            for (int set = 0; set < 2; set++) {
+                const std::vector<Color>& targets = set ? many : one;
+                SearchOptions options;
+                options.threads = 1;
+                std::vector<ColorMatch> matches;
+                double seconds = BestSeconds(3, [&] {
+                    SearchColors(image.View(), targets, options, matches);
+                    Consume(matches.size());
+                });
+                std::string label = std::string(size.name) + " " + std::to_string(targets.size()) +
+                                    (set ? " targets " : " target ") + SimdLevelName(requested);
+                Report(label.c_str(), seconds * 1e3, "ms");
+            }
+        }
+        ForceSimdLevel(original);
+        
+        SearchOptions options;
+        options.threads = 1;
+        options.tolerance = 2.0f;
+        std::vector<ColorMatch> matches;
+        double seconds = BestSeconds(3, [&] {
+            SearchColors(image.View(), one, options, matches);
+            Consume(matches.size());
+        });
+        Report((std::string(size.name) + " 1 target within 2 dE00").c_str(), seconds * 1e3, "ms");
+    }
+}
@@ -0,0 +1,92 @@
+#include <cmath>
+#include <vector>
+
+#include "bench.h"
+#include "core/color_spaces.h"
+
+namespace {
+
+// The transfer function as it was written before the tables
+float PowDecode(uint8_t code) {
+    float v = code / 255.0f;
+    return v <= 0.04045f ? v / 12.92f : std::pow((v + 0.055f) / 1.055f, 2.4f);
+}
+
+uint8_t PowEncode(float linear) {
+    float v = linear <= 0.0031308f ? linear * 12.92f : 1.055f * std::pow(linear, 1 / 2.4f) - 0.055f;
+    v = v < 0 ? 0 : (v > 1 ? 1 : v);
+    return (uint8_t)(v * 255 + 0.5f);
+}
+
+} // namespace
+
+BENCH(SrgbTransfer) {
+    const int count = 1 << 20;
+    std::vector<uint8_t> codes(count);
+    std::vector<float> linear(count);
+    uint32_t state = 1;
+    for (int i = 0; i < count; i++) {
+        state = state * 1664525u + 1013904223u;
+        codes[i] = (uint8_t)(state >> 24);
+        linear[i] = (state >> 8) / 16777216.0f;
+    }
+    
+    double seconds = BestSeconds(5, [&] {
+        float total = 0;
+        for (uint8_t code : codes) total += PowDecode(code);
+        Consume((uint64_t)total);
+    });
+    Report("decode pow", seconds * 1e9 / count, "ns/value");
+    seconds = BestSeconds(5, [&] {
+        float total = 0;
+        for (uint8_t code : codes) total += SrgbToLinear(code);
+        Consume((uint64_t)total);
+    });
+    Report("decode table", seconds * 1e9 / count, "ns/value");
+    
+    seconds = BestSeconds(5, [&] {
+        uint64_t total = 0;
+        for (float v : linear) total += PowEncode(v);
+        Consume(total);
+    });
+    Report("encode pow", seconds * 1e9 / count, "ns/value");
+    seconds = BestSeconds(5, [&] {
+        uint64_t total = 0;
+        for (float v : linear) total += LinearToSrgb(v);
+        Consume(total);
+    });
+    Report("encode thresholds", seconds * 1e9 / count, "ns/value");
+}
+
+// A 1080p frame converted for the perceptual search and extraction paths
+BENCH(ViewConversion) {
+    const int width = 1920;
+    const int height = 1080;
+    std::vector<uint8_t> pixels((size_t)width * height * 4);
+    uint32_t state = 5;
+    for (uint8_t& v : pixels) {
+        state = state * 1664525u + 1013904223u;
+        v = (uint8_t)(state >> 24);
+    }
+    PixelView view = {pixels.data(), width, height, (size_t)width * 4, PixelFormat::BGRA32};
+    std::vector<LabValue> lab((size_t)width * height);
+    std::vector<OKLabValue> ok((size_t)width * height);
+    
+    double seconds = BestSeconds(3, [&] {
+        ViewToLab(view, lab.data());
+        Consume((uint64_t)lab[width].l);
+    });
+    Report("Lab", width * height / seconds / 1e6, "Mpixels/s");
+    seconds = BestSeconds(3, [&] {
+        ViewToOKLab(view, ok.data());
+        Consume((uint64_t)(ok[width].l * 100));
+    });
+    Report("OKLab", width * height / seconds / 1e6, "Mpixels/s");
+    
+    std::vector<Color> back((size_t)width * height);
+    seconds = BestSeconds(3, [&] {
+        for (size_t i = 0; i < back.size(); i++) back[i] = LabToColor(lab[i]);
+        Consume(back[width].g);
+    });
+    Report("Lab to sRGB", width * height / seconds / 1e6, "Mpixels/s");
+}
@@ -0,0 +1,58 @@
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "core/color_vision.h"
+
+// A 1080p frame of flat panels and text-like stripes, where the run and
+// cache shortcuts do most of the work, and one of noise, where every pixel
+// goes through the kernel; each kernel against SimulateColor per pixel
+BENCH(SimulateView) {
+    const int width = 1920;
+    const int height = 1080;
+    std::vector<uint8_t> screen((size_t)width * height * 4);
+    std::vector<uint8_t> noise(screen.size());
+    uint32_t state = 23;
+    for (size_t i = 0; i < screen.size(); i += 4) {
+        size_t x = (i / 4) % width;
+        size_t y = (i / 4) / width;
+        bool ink = y % 24 < 12 && x % 9 < 3;
+        screen[i] = ink ? 55 : (uint8_t)(240 - (x / 480) * 40);
+        screen[i + 1] = ink ? 41 : 240;
+        screen[i + 2] = ink ? 31 : (uint8_t)(200 + (y / 540) * 40);
+        screen[i + 3] = 255;
+        for (int c = 0; c < 4; c++) {
+            state = state * 1664525u + 1013904223u;
+            noise[i + c] = (uint8_t)(state >> 24);
+        }
+    }
+    std::vector<uint8_t> out(screen.size());
+    VisionMatrix matrix = SimulationMatrix(VisionType::Deuteranopia);
+    
+    const char* names[2] = {"screen", "noise"};
+    std::vector<uint8_t>* frames[2] = {&screen, &noise};
+    for (int f = 0; f < 2; f++) {
+        PixelView view = {frames[f]->data(), width, height, (size_t)width * 4, PixelFormat::BGRA32};
+        double seconds = BestSeconds(2, [&] {
+            uint64_t total = 0;
+            for (int y = 0; y < height; y++) {
+                for (int x = 0; x < width; x++) total += SimulateColor(PixelAt(view, x, y), matrix).g;
+            }
+            Consume(total);
+        });
+        Report((std::string(names[f]) + " SimulateColor loop").c_str(), width * height / seconds / 1e6, "Mpixels/s");
+        
+        SimdLevel original = GetSimdLevel();
+        const SimdLevel levels[3] = {SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2};
+        for (SimdLevel requested : levels) {
+            if (ForceSimdLevel(requested) != requested) continue;
+            seconds = BestSeconds(3, [&] {
+                SimulateView(view, matrix, out.data(), (size_t)width * 4, 1);
+                Consume(out[width * 4 + 1]);
+            });
+            std::string label = std::string(names[f]) + " " + SimdLevelName(requested);
+            Report(label.c_str(), width * height / seconds / 1e6, "Mpixels/s");
+        }
+        ForceSimdLevel(original);
+    }
+}
@@ -0,0 +1,61 @@
+#include <cstdio>
+#include <vector>
+
+#include "bench.h"
+#include "core/contrast_audit.h"
+#include "core/image_io.h"
+
+namespace {
+
+// A page of panels, solid buttons and lines of one-pixel-stroke glyphs,
+// some of them low contrast, so every stage of the tile analysis runs
+Image SyntheticPage(int width, int height) {
+    Image image;
+    image.Allocate(width, height, PixelFormat::BGRA32);
+    uint32_t state = 15;
+    for (int y = 0; y < height; y++) {
+        uint8_t* p = image.pixels.data() + (size_t)y * image.Stride();
+        for (int x = 0; x < width; x++, p += 4) {
+            bool banner = y % 300 >= 200 && y % 300 < 260;
+            Color c = banner ? MakeColor(239, 68, 68) : MakeColor(255, 255, 255);
+            if (x % 400 > 300 && x % 400 < 380 && y % 300 < 40) c = MakeColor(59, 130, 246);
+            int gx = x % 9;
+            int gy = y % 18;
+            if (x % 400 < 280 && gy < 12 && y % 300 < 180) {
+                state = state * 1664525u + 1013904223u;
+                bool stroke = gx == 1 || gx == 6 || ((gy == 0 || gy == 6) && gx > 0 && gx < 7);
+                if (stroke && (state >> 30) != 0) c = y % 600 < 300 ? MakeColor(51, 51, 51) : MakeColor(156, 163, 175);
+            }
+            if (banner && x % 400 < 280 && (gx == 1 || gx == 6) && y % 18 < 12) c = MakeColor(255, 255, 255);
+            p[0] = c.b;
+            p[1] = c.g;
+            p[2] = c.r;
+            p[3] = 255;
+        }
+    }
+    return image;
+}
+
+} // namespace
+
+// Whole 1080p and 4K pages, single-threaded and on every core
+BENCH(AuditContrast) {
+    const int sizes[2][2] = {{1920, 1080}, {3840, 2160}};
+    for (const auto& size : sizes) {
+        Image image = SyntheticPage(size[0], size[1]);
+        double megapixels = size[0] * (double)size[1] / 1e6;
+        const int threads[2] = {1, 0};
+        for (int t : threads) {
+            AuditOptions options;
+            options.threads = t;
+            std::vector<ContrastIssue> issues;
+            double seconds = BestSeconds(5, [&] {
+                AuditContrast(image.View(), options, issues);
+                Consume(issues.size());
+            });
+            char label[64];
+            snprintf(label, sizeof(label), "%dp %s", size[1], t == 1 ? "1 thread" : "all cores");
+            Report(label, seconds * 1e3 / megapixels, "ms/MP");
+        }
+    }
+}
@@ -0,0 +1,43 @@
+#include <iomanip>
+#include <sstream>
+#include <string>
+
+#include "bench.h"
+#include "core/color_core.h"
+
+// One display update's worth of text, formatted the way UpdateColorDisplay
+// did with ostringstream and the way it does now
+BENCH(FormatUpdate) {
+    const int count = 100000;
+    double seconds = BestSeconds(5, [&] {
+        size_t total = 0;
+        for (int i = 0; i < count; i++) {
+            Color c = MakeColor(i * 7, i * 13, i * 29);
+            int h, s, l;
+            RGBtoHSL(c.r, c.g, c.b, h, s, l);
+            std::ostringstream hex, rgb, hsl, coords;
+            hex << "#" << std::hex << std::uppercase << std::setfill('0') << std::setw(2) << (int)c.r
+                << std::setw(2) << (int)c.g << std::setw(2) << (int)c.b;
+            rgb << (int)c.r << ", " << (int)c.g << ", " << (int)c.b;
+            hsl << h << " deg, " << s << "%, " << l << "%";
+            coords << "(" << i << ", " << -i << ")";
+            total += hex.str().size() + rgb.str().size() + hsl.str().size() + coords.str().size();
+        }
+        Consume(total);
+    });
+    Report("ostringstream", seconds * 1e9 / count, "ns/update");
+    
+    seconds = BestSeconds(5, [&] {
+        char hex[kHexBufferSize];
+        char rgb[kRGBBufferSize];
+        char hsl[kHSLBufferSize];
+        char coords[kCoordBufferSize];
+        size_t total = 0;
+        for (int i = 0; i < count; i++) {
+            Color c = MakeColor(i * 7, i * 13, i * 29);
+            total += FormatHex(c, hex) + FormatRGB(c, rgb) + FormatHSL(c, hsl) + FormatCoords(i, -i, coords);
+        }
+        Consume(total);
+    });
+    Report("fixed buffers", seconds * 1e9 / count, "ns/update");
+}
@@ -0,0 +1,50 @@
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "core/magnifier.h"
+
+namespace {
+
+// One write per output pixel, the way a SetPixel-style loop renders it
+void RenderPerPixel(const PixelView& src, int scale, uint8_t* dst, size_t stride) {
+    for (int y = 0; y < src.height * scale; y++) {
+        uint32_t* row = (uint32_t*)(dst + stride * y);
+        for (int x = 0; x < src.width * scale; x++) {
+            Color c = PixelAt(src, x / scale, y / scale);
+            if (x % scale == 0 || y % scale == 0) c = MakeColor(c.r * 3 / 4, c.g * 3 / 4, c.b * 3 / 4);
+            row[x] = 0xFF000000u | ((uint32_t)c.r << 16) | ((uint32_t)c.g << 8) | c.b;
+        }
+    }
+}
+
+} // namespace
+
+// The loupe sizes the GUI offers, redrawn once per tracking tick
+BENCH(RenderLoupe) {
+    const int sides[3] = {11, 15, 31};
+    const int scale = 8;
+    for (int side : sides) {
+        std::vector<uint8_t> source(side * side * 4);
+        for (size_t i = 0; i < source.size(); i++) source[i] = (uint8_t)(i * 29);
+        PixelView src = {source.data(), side, side, (size_t)side * 4, PixelFormat::BGRA32};
+        size_t stride = (size_t)side * scale * 4;
+        std::vector<uint8_t> out(stride * side * scale);
+        
+        const int frames = 200;
+        LoupeStyle style;
+        style.scale = scale;
+        double seconds = BestSeconds(3, [&] {
+            for (int i = 0; i < frames; i++) RenderLoupe(src, style, out.data(), stride);
+            Consume(out[stride]);
+        });
+        std::string label = std::to_string(side) + "x" + std::to_string(side) + " x" + std::to_string(scale);
+        Report((label + " row fill").c_str(), seconds * 1e6 / frames, "us/frame");
+        
+        seconds = BestSeconds(3, [&] {
+            for (int i = 0; i < frames; i++) RenderPerPixel(src, scale, out.data(), stride);
+            Consume(out[stride]);
+        });
+        Report((label + " per pixel").c_str(), seconds * 1e6 / frames, "us/frame");
+    }
+}
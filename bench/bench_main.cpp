@@ -0,0 +1,51 @@
+// color_bench: runs every registered case, or those whose name contains
+// the first argument. Build in Release; figures are best-of-N wall times.
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "bench.h"
+#include "core/color_core.h"
+
+namespace {
+
+struct BenchCase {
+    const char* name;
+    BenchFunction run;
+};
+
+std::vector<BenchCase>& Registry() {
+    static std::vector<BenchCase> cases;
+    return cases;
+}
+
+const char* g_current = "";
+volatile uint64_t g_sink = 0;
+
+} // namespace
+
+int RegisterBench(const char* name, BenchFunction run) {
+    Registry().push_back({name, run});
+    return (int)Registry().size();
+}
+
+void Report(const char* label, double value, const char* unit) {
+    printf("%s %s: %.2f %s\n", g_current, label, value, unit);
+    fflush(stdout);
+}
+
+void Consume(uint64_t value) {
+    g_sink = g_sink + value;
+}
+
+int main(int argc, char** argv) {
+    const char* filter = argc > 1 ? argv[1] : NULL;
+    printf("simd %s\n", SimdLevelName(GetSimdLevel()));
+    for (const BenchCase& bench : Registry()) {
+        if (filter && !strstr(bench.name, filter)) continue;
+        g_current = bench.name;
+        bench.run();
+    }
+    return 0;
+}
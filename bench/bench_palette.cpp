@@ -0,0 +1,55 @@
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "core/palette.h"
+
+// Closest-entry queries against design-token sized and very large
+// palettes, through the index and through the brute-force scan it replaced
+BENCH(PaletteNearest) {
+    const int sizes[2] = {10000, 100000};
+    std::vector<Color> queries(4096);
+    uint32_t state = 99;
+    for (Color& c : queries) {
+        state = state * 1664525u + 1013904223u;
+        c = MakeColor(state >> 24, (state >> 16) & 255, (state >> 8) & 255);
+    }
+    
+    for (int size : sizes) {
+        Palette palette;
+        for (int i = 0; i < size; i++) {
+            state = state * 1664525u + 1013904223u;
+            palette.Add("", MakeColor(state >> 24, (state >> 16) & 255, (state >> 8) & 255));
+        }
+        double seconds = BestSeconds(3, [&] { palette.BuildIndex(); });
+        std::string prefix = std::to_string(size / 1000) + "k ";
+        Report((prefix + "build").c_str(), seconds * 1e3, "ms");
+        
+        const PaletteMetric metrics[2] = {PaletteMetric::OKLab, PaletteMetric::DeltaE2000};
+        for (PaletteMetric metric : metrics) {
+            std::string label = prefix + PaletteMetricName(metric);
+            seconds = BestSeconds(3, [&] {
+                uint64_t total = 0;
+                for (Color c : queries) total += palette.Nearest(c, metric);
+                Consume(total);
+            });
+            Report((label + " indexed").c_str(), seconds * 1e6 / queries.size(), "us/query");
+            
+            // The scan is slow enough that a slice of the queries suffices
+            const size_t scanned = size >= 100000 ? 64 : 256;
+            seconds = BestSeconds(1, [&] {
+                uint64_t total = 0;
+                for (size_t i = 0; i < scanned; i++) total += palette.NearestLinear(queries[i], metric);
+                Consume(total);
+            });
+            Report((label + " linear").c_str(), seconds * 1e6 / scanned, "us/query");
+        }
+        
+        seconds = BestSeconds(3, [&] {
+            uint64_t total = 0;
+            for (Color c : queries) total += palette.NearestWithin(c, PaletteMetric::DeltaE2000, 2.0f) + 1;
+            Consume(total);
+        });
+        Report((prefix + "within 2 dE00").c_str(), seconds * 1e6 / queries.size(), "us/query");
+    }
+}
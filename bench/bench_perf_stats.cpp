@@ -0,0 +1,39 @@
+#include <thread>
+#include <vector>
+
+#include "bench.h"
+#include "core/perf_stats.h"
+
+// What instrumentation adds to each timed stage: a bare Record, a whole
+// PerfScope with its two clock reads, and Record from two threads sharing
+// one histogram's cache lines
+BENCH(PerfOverhead) {
+    LatencyHistogram histogram;
+    const int count = 1 << 20;
+    double seconds = BestSeconds(5, [&] {
+        for (int i = 0; i < count; i++) histogram.Record((uint64_t)i * 37 % 100000);
+    });
+    Report("Record", seconds * 1e9 / count, "ns");
+    
+    seconds = BestSeconds(5, [&] {
+        for (int i = 0; i < count; i++) {
+            PerfScope scope(PerfStage::Paint);
+        }
+    });
+    Report("PerfScope", seconds * 1e9 / count, "ns");
+    
+    seconds = BestSeconds(3, [&] {
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 2; t++) {
+            threads.emplace_back([&histogram] {
+                for (int i = 0; i < count / 2; i++) histogram.Record(1000 + i % 64);
+            });
+        }
+        for (std::thread& thread : threads) thread.join();
+    });
+    Report("Record from 2 threads", seconds * 1e9 / count, "ns");
+    
+    seconds = BestSeconds(5, [&] { Consume(PerfStatsJSON().size()); });
+    Report("PerfStatsJSON", seconds * 1e6, "us");
+    ResetPerfStats();
+}
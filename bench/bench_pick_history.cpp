@@ -0,0 +1,68 @@
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "core/pick_history.h"
+
+// A million-record history written straight to disk, then the costs the
+// GUI pays at startup and on its first queries
+BENCH(PickHistory) {
+    const char* path = "pick_history_bench.bin";
+    const size_t count = 1000000;
+    FILE* f = fopen(path, "wb");
+    if (!f) return;
+    const uint32_t header[4] = {0x48504358u, 1, 64, 0};     // "XCPH", version 1, 64-byte records
+    fwrite(header, sizeof(header), 1, f);
+    std::vector<PickRecord> records(count);
+    uint32_t state = 21;
+    for (size_t i = 0; i < count; i++) {
+        state = state * 1664525u + 1013904223u;
+        memset(&records[i], 0, sizeof(PickRecord));
+        records[i].timestampUs = 1000000 + i * 50;
+        records[i].r = (uint8_t)(state >> 24);
+        records[i].g = (uint8_t)(state >> 16);
+        records[i].b = (uint8_t)(state >> 8);
+    }
+    fwrite(records.data(), sizeof(PickRecord), count, f);
+    fclose(f);
+    
+    std::string error;
+    double seconds = BestSeconds(5, [&] {
+        PickHistory history;
+        history.Open(path, error);
+        Consume(history.Size());
+    });
+    Report("1M open", seconds * 1e3, "ms");
+    
+    PickHistory history;
+    history.Open(path, error);
+    seconds = BestSeconds(5, [&] {
+        size_t begin, end;
+        history.TimeRange(20000000, 21000000, begin, end);
+        Consume(end - begin);
+    });
+    Report("1M time range", seconds * 1e6, "us");
+    
+    size_t indices[8];
+    seconds = BestSeconds(1, [&] { Consume(history.NearestColors(MakeColor(1, 2, 3), 8, indices, NULL)); });
+    Report("1M first nearest (index build)", seconds * 1e3, "ms");
+    seconds = BestSeconds(5, [&] {
+        for (int i = 0; i < 1000; i++) {
+            history.NearestColors(MakeColor(i & 255, (i * 7) & 255, 40), 8, indices, NULL);
+        }
+        Consume(indices[0]);
+    });
+    Report("1M nearest", seconds * 1e6 / 1000, "us/query");
+    
+    std::vector<size_t> distinct;
+    seconds = BestSeconds(3, [&] {
+        history.DistinctColors(0.05f, 64, distinct);
+        Consume(distinct.size());
+    });
+    Report("1M distinct 64", seconds * 1e3, "ms");
+    
+    history.Close();
+    remove(path);
+}
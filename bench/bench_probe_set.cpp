@@ -0,0 +1,44 @@
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "core/image_io.h"
+#include "core/probe_set.h"
+
+// Ticks over a 1080p screen with growing numbers of probes spread across
+// it, reported as probes evaluated per millisecond including the capture
+BENCH(ProbeTick) {
+    Image image;
+    image.Allocate(1920, 1080, PixelFormat::BGRA32);
+    uint32_t state = 31;
+    for (uint8_t& v : image.pixels) {
+        state = state * 1664525u + 1013904223u;
+        v = (uint8_t)(state >> 24);
+    }
+    ImageScreenSource source(image);
+    
+    const int counts[4] = {1, 16, 256, 4096};
+    const char* kinds[3] = {"points", "8x8 rects", "overlapping 64x64"};
+    for (int kind = 0; kind < 3; kind++) {
+        for (int count : counts) {
+            ProbeSet probes;
+            for (int i = 0; i < count; i++) {
+                int x = (i * 97) % 1800;
+                int y = (i * 61) % 1000;
+                int size = kind == 0 ? 1 : (kind == 1 ? 8 : 64);
+                probes.Add("p", {x, y, size, size});
+            }
+            std::vector<ProbeEvent> events;
+            const int ticks = 20;
+            double seconds = BestSeconds(3, [&] {
+                for (int t = 0; t < ticks; t++) {
+                    events.clear();
+                    probes.Tick(source, t, events);
+                }
+                Consume(events.size());
+            });
+            std::string label = std::to_string(count) + " " + kinds[kind];
+            Report(label.c_str(), count * ticks / (seconds * 1e3), "probes/ms");
+        }
+    }
+}
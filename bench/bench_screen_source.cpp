@@ -0,0 +1,54 @@
+#include <string>
+
+#include "bench.h"
+#include "core/screen_source.h"
+
+// The cost of gathering an NxN sample pixel by pixel, as GetPixel did,
+// against one region capture. On Windows each GetPixel is also a round trip
+// to the display driver, which this leaves out; the figures here are the
+// floor of the per-pixel approach, not its real cost.
+BENCH(RegionCapture) {
+    Image image;
+    image.Allocate(1920, 1080, PixelFormat::BGRA32);
+    for (size_t i = 0; i < image.pixels.size(); i++) {
+        image.pixels[i] = (uint8_t)(i * 31);
+    }
+    ImageScreenSource source(image);
+    
+    const int radii[4] = {0, 2, 7, 15};
+    const int samples = 20000;
+    for (int radius : radii) {
+        int side = 2 * radius + 1;
+        double perPixel = BestSeconds(3, [&] {
+            uint64_t total = 0;
+            for (int i = 0; i < samples; i++) {
+                int cx = 100 + (i * 37) % 1700;
+                int cy = 100 + (i * 17) % 880;
+                for (int y = 0; y < side; y++) {
+                    for (int x = 0; x < side; x++) {
+                        PixelView view;
+                        source.Capture({cx - radius + x, cy - radius + y, 1, 1}, view);
+                        total += view.data[1];
+                    }
+                }
+            }
+            Consume(total);
+        });
+        double region = BestSeconds(3, [&] {
+            uint64_t total = 0;
+            for (int i = 0; i < samples; i++) {
+                PixelView view;
+                source.Capture(RectAround(100 + (i * 37) % 1700, 100 + (i * 17) % 880, radius), view);
+                for (int y = 0; y < side; y++) {
+                    for (int x = 0; x < side; x++) {
+                        total += view.data[y * view.stride + x * 4 + 1];
+                    }
+                }
+            }
+            Consume(total);
+        });
+        std::string label = std::to_string(side) + "x" + std::to_string(side);
+        Report((label + " per pixel").c_str(), perPixel * 1e9 / samples, "ns/sample");
+        Report((label + " region").c_str(), region * 1e9 / samples, "ns/sample");
+    }
+}
@@ -0,0 +1,396 @@
+#include "batch_sampler.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+
+#include "image_io.h"
+#include "mapped_file.h"
+#include "parallel.h"
+#include "screen_source.h"
+
+namespace {
+
+// Just enough JSON for job files: objects, arrays, strings and integers,
+// with unknown keys skipped
+class JsonReader {
+public:
+    JsonReader(const char* begin, const char* end) : m_p(begin), m_end(end) {}
+    
+    void SkipSpace() {
+        while (m_p < m_end && (*m_p == ' ' || *m_p == '\t' || *m_p == '\r' || *m_p == '\n')) m_p++;
+    }
+    
+    bool Peek(char c) {
+        SkipSpace();
+        return m_p < m_end && *m_p == c;
+    }
+    
+    bool Consume(char c) {
+        if (!Peek(c)) return false;
+        m_p++;
+        return true;
+    }
+    
+    bool AtEnd() {
+        SkipSpace();
+        return m_p >= m_end;
+    }
+    
+    bool String(std::string& out) {
+        if (!Consume('"')) return false;
+        out.clear();
+        while (m_p < m_end && *m_p != '"') {
+            char c = *m_p++;
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+            if (m_p >= m_end) return false;
+            char e = *m_p++;
+            switch (e) {
+                case 'n': out += '\n'; break;
+                case 't': out += '\t'; break;
+                case 'r': out += '\r'; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'u': {
+                    if (m_end - m_p < 4) return false;
+                    char hex[5] = {m_p[0], m_p[1], m_p[2], m_p[3], 0};
+                    char* stop = NULL;
+                    unsigned long cp = strtoul(hex, &stop, 16);
+                    if (stop != hex + 4) return false;
+                    m_p += 4;
+                    // Basic multilingual plane only, encoded as UTF-8
+                    if (cp < 0x80) {
+                        out += (char)cp;
+                    } else if (cp < 0x800) {
+                        out += (char)(0xC0 | (cp >> 6));
+                        out += (char)(0x80 | (cp & 0x3F));
+                    } else {
+                        out += (char)(0xE0 | (cp >> 12));
+                        out += (char)(0x80 | ((cp >> 6) & 0x3F));
+                        out += (char)(0x80 | (cp & 0x3F));
+                    }
+                    break;
+                }
+                default: out += e; break;   // \" \\ \/
+            }
+        }
+        if (m_p >= m_end) return false;
+        m_p++;
+        return true;
+    }
+    
+    bool Int(int& value) {
+        SkipSpace();
+        const char* start = m_p;
+        if (m_p < m_end && *m_p == '-') m_p++;
+        const char* digits = m_p;
+        while (m_p < m_end && *m_p >= '0' && *m_p <= '9') m_p++;
+        if (m_p == digits || m_p - start > 11) return false;
+        long long v = strtoll(std::string(start, m_p).c_str(), NULL, 10);
+        if (v < -1000000000LL || v > 1000000000LL) return false;
+        value = (int)v;
+        return true;
+    }
+    
+    bool SkipValue() {
+        SkipSpace();
+        if (m_p >= m_end) return false;
+        std::string ignored;
+        if (*m_p == '"') return String(ignored);
+        if (*m_p == '{' || *m_p == '[') {
+            char close = *m_p == '{' ? '}' : ']';
+            m_p++;
+            if (Consume(close)) return true;
+            do {
+                if (close == '}' && (!String(ignored) || !Consume(':'))) return false;
+                if (!SkipValue()) return false;
+            } while (Consume(','));
+            return Consume(close);
+        }
+        // Number, true, false or null
+        const char* start = m_p;
+        while (m_p < m_end && strchr(",]} \t\r\n", *m_p) == NULL) m_p++;
+        return m_p > start;
+    }
+    
+    size_t Offset(const char* begin) const { return (size_t)(m_p - begin); }
+
+private:
+    const char* m_p;
+    const char* m_end;
+};
+
+bool ParseJsonJob(JsonReader& json, const BatchJob& defaults, BatchJob& job) {
+    job = defaults;
+    if (!json.Consume('{')) return false;
+    if (json.Consume('}')) return false;     // no image
+    
+    bool haveImage = false;
+    do {
+        std::string key;
+        if (!json.String(key) || !json.Consume(':')) return false;
+        if (key == "image") {
+            if (!json.String(job.image)) return false;
+            haveImage = true;
+        } else if (key == "points") {
+            if (!json.Consume('[')) return false;
+            if (!json.Consume(']')) {
+                do {
+                    SamplePoint pt;
+                    if (!json.Consume('[') || !json.Int(pt.x) || !json.Consume(',') ||
+                        !json.Int(pt.y) || !json.Consume(']')) {
+                        return false;
+                    }
+                    job.points.push_back(pt);
+                } while (json.Consume(','));
+                if (!json.Consume(']')) return false;
+            }
+        } else if (key == "radius") {
+            if (!json.Int(job.radius) || job.radius < 0 || job.radius > kMaxSampleRadius) return false;
+        } else if (key == "reducer") {
+            std::string name;
+            if (!json.String(name) || !ParseSampleReducer(name.c_str(), job.reducer)) return false;
+        } else if (!json.SkipValue()) {
+            return false;
+        }
+    } while (json.Consume(','));
+    return json.Consume('}') && haveImage;
+}
+
+bool ParseJsonJobs(const char* begin, const char* end, const BatchJob& defaults,
+                   std::vector<BatchJob>& jobs, size_t& errorOffset) {
+    JsonReader json(begin, end);
+    bool array = json.Consume('[');
+    if (!array || !json.Peek(']')) {
+        do {
+            BatchJob job;
+            if (!ParseJsonJob(json, defaults, job)) {
+                errorOffset = json.Offset(begin);
+                return false;
+            }
+            jobs.push_back(job);
+        } while (array && json.Consume(','));
+    }
+    if ((array && !json.Consume(']')) || !json.AtEnd()) {
+        errorOffset = json.Offset(begin);
+        return false;
+    }
+    return true;
+}
+
+// "IMAGE X Y" per line; the path is everything before the last two fields,
+// so it may contain spaces. Blank lines and # comments are skipped.
+bool ParseCoordinateList(const char* begin, const char* end, const BatchJob& defaults,
+                         std::vector<BatchJob>& jobs, int& errorLine) {
+    int lineNumber = 0;
+    for (const char* line = begin; line < end;) {
+        const char* eol = (const char*)memchr(line, '\n', end - line);
+        if (!eol) eol = end;
+        std::string text(line, eol);
+        line = eol + 1;
+        lineNumber++;
+        
+        size_t last = text.find_last_not_of(" \t\r");
+        size_t first = text.find_first_not_of(" \t");
+        if (first == std::string::npos || text[first] == '#') continue;
+        text = text.substr(first, last + 1 - first);
+        
+        size_t ySep = text.find_last_of(" \t");
+        size_t xEnd = ySep == std::string::npos ? ySep : text.find_last_not_of(" \t", ySep);
+        size_t xSep = xEnd == std::string::npos ? xEnd : text.find_last_of(" \t", xEnd);
+        size_t pathEnd = xSep == std::string::npos ? xSep : text.find_last_not_of(" \t", xSep);
+        
+        SamplePoint pt;
+        char* stop = NULL;
+        bool ok = pathEnd != std::string::npos;
+        if (ok) {
+            std::string xs = text.substr(xSep + 1, xEnd - xSep);
+            std::string ys = text.substr(ySep + 1);
+            long x = strtol(xs.c_str(), &stop, 10);
+            ok = *stop == '\0';
+            long y = strtol(ys.c_str(), &stop, 10);
+            ok = ok && *stop == '\0' && labs(x) <= 1000000000L && labs(y) <= 1000000000L;
+            pt.x = (int)x;
+            pt.y = (int)y;
+        }
+        if (!ok) {
+            errorLine = lineNumber;
+            return false;
+        }
+        
+        std::string image = text.substr(0, pathEnd + 1);
+        if (jobs.empty() || jobs.back().image != image) {
+            jobs.push_back(defaults);
+            jobs.back().image = image;
+            jobs.back().points.clear();
+        }
+        jobs.back().points.push_back(pt);
+    }
+    return true;
+}
+
+// Quote a path for a CSV field when it holds separators or quotes
+std::string CsvField(const std::string& text) {
+    if (text.find_first_of(",\"\r\n") == std::string::npos) return text;
+    std::string out = "\"";
+    for (char c : text) {
+        if (c == '"') out += '"';
+        out += c;
+    }
+    return out + "\"";
+}
+
+std::string JsonString(const std::string& text) {
+    std::string out = "\"";
+    for (unsigned char c : text) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += (char)c;
+        } else if (c < 0x20) {
+            char esc[8];
+            snprintf(esc, sizeof(esc), "\\u%04x", c);
+            out += esc;
+        } else {
+            out += (char)c;
+        }
+    }
+    return out + "\"";
+}
+
+// Samples one job into formatted rows. Returns false if the image failed.
+// Points outside the image are skipped with a line each in `error`: the
+// clamped edge color would be printed under coordinates it does not have.
+bool SampleJob(const BatchJob& job, BatchFormat format, std::string& rows, size_t& samples,
+               size_t& outside, std::string& error) {
+    MappedImage image;
+    if (!image.Open(job.image.c_str(), error)) return false;
+    const int width = image.View().width;
+    const int height = image.View().height;
+    
+    ViewScreenSource source(image.View());
+    std::string name = format == BatchFormat::CSV ? CsvField(job.image) : JsonString(job.image);
+    rows.reserve(job.points.size() * (name.size() + 64));
+    
+    char hexStr[kHexBufferSize];
+    char line[160];
+    for (const SamplePoint& pt : job.points) {
+        if (pt.x < 0 || pt.y < 0 || pt.x >= width || pt.y >= height) {
+            snprintf(line, sizeof(line), ": (%d, %d) is outside the %dx%d image", pt.x, pt.y, width, height);
+            error += (error.empty() ? "" : "\n") + job.image + line;
+            outside++;
+            continue;
+        }
+        Color color;
+        PixelView view;
+        if (job.radius == 0) {
+            color = PixelAt(image.View(), pt.x, pt.y);
+        } else if (source.Capture(RectAround(pt.x, pt.y, job.radius), view)) {
+            color = ReduceRegion(view, job.reducer);
+        } else {
+            continue;
+        }
+        
+        int h, s, l;
+        RGBtoHSL(color.r, color.g, color.b, h, s, l);
+        FormatHex(color, hexStr);
+        if (format == BatchFormat::CSV) {
+            snprintf(line, sizeof(line), ",%d,%d,%s,%d,%d,%d,%d,%d,%d\n",
+                     pt.x, pt.y, hexStr, color.r, color.g, color.b, h, s, l);
+            rows += name;
+        } else {
+            snprintf(line, sizeof(line), ",\"x\":%d,\"y\":%d,\"hex\":\"%s\",\"rgb\":[%d,%d,%d],\"hsl\":[%d,%d,%d]}\n",
+                     pt.x, pt.y, hexStr, color.r, color.g, color.b, h, s, l);
+            rows += "{\"image\":";
+            rows += name;
+        }
+        rows += line;
+        samples++;
+    }
+    return true;
+}
+
+} // namespace
+
+bool LoadBatchJobs(const char* path, const BatchJob& defaults, std::vector<BatchJob>& jobs,
+                   std::string& error) {
+    MappedFile file;
+    if (!file.Open(path, error)) return false;
+    
+    const char* begin = (const char*)file.Data();
+    const char* end = begin + file.Size();
+    const char* first = begin;
+    while (first < end && strchr(" \t\r\n", *first)) first++;
+    
+    if (first < end && (*first == '[' || *first == '{')) {
+        size_t offset = 0;
+        if (!ParseJsonJobs(begin, end, defaults, jobs, offset)) {
+            error = std::string(path) + ": invalid JSON job near byte " + std::to_string(offset);
+            return false;
+        }
+    } else {
+        int line = 0;
+        if (!ParseCoordinateList(begin, end, defaults, jobs, line)) {
+            error = std::string(path) + ":" + std::to_string(line) + ": expected IMAGE X Y";
+            return false;
+        }
+    }
+    return true;
+}
+
+void RunBatch(const std::vector<BatchJob>& jobs, BatchFormat format, int threads,
+              FILE* out, FILE* errors, BatchStats& stats) {
+    auto start = std::chrono::steady_clock::now();
+    if (format == BatchFormat::CSV) {
+        fputs("image,x,y,hex,r,g,b,h,s,l\n", out);
+    }
+    
+    // Workers finish out of order; whoever completes the next job in
+    // sequence flushes every finished job after it, so rows stream in order
+    // without holding the whole result set
+    std::vector<std::string> rows(jobs.size());
+    std::vector<std::string> messages(jobs.size());
+    std::vector<size_t> samples(jobs.size(), 0);
+    std::vector<size_t> outside(jobs.size(), 0);
+    std::vector<char> done(jobs.size(), 0);
+    size_t nextToWrite = 0;
+    std::mutex writeLock;
+    
+    stats = BatchStats();
+    stats.files = jobs.size();
+    ParallelForEach((int)jobs.size(), threads, [&](int i, int) {
+        bool ok = SampleJob(jobs[i], format, rows[i], samples[i], outside[i], messages[i]);
+        
+        std::lock_guard<std::mutex> guard(writeLock);
+        done[i] = 1;
+        if (!ok) stats.failedFiles++;
+        while (nextToWrite < jobs.size() && done[nextToWrite]) {
+            std::string& text = rows[nextToWrite];
+            if (!messages[nextToWrite].empty()) {
+                fprintf(errors, "%s\n", messages[nextToWrite].c_str());
+            }
+            fwrite(text.data(), 1, text.size(), out);
+            std::string().swap(text);
+            stats.samples += samples[nextToWrite];
+            stats.outsidePoints += outside[nextToWrite];
+            nextToWrite++;
+        }
+    });
+    fflush(out);
+    
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool ParseBatchFormat(const char* name, BatchFormat& format) {
+    if (strcmp(name, "csv") == 0) {
+        format = BatchFormat::CSV;
+    } else if (strcmp(name, "jsonl") == 0) {
+        format = BatchFormat::JSONLines;
+    } else {
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+// Headless batch sampling: lists of points over many image files, with
+// results streamed as CSV or JSON Lines in job order.
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "color_sampling.h"
+
+struct SamplePoint {
+    int x;
+    int y;
+};
+
+struct BatchJob {
+    std::string image;
+    std::vector<SamplePoint> points;
+    int radius = 0;
+    SampleReducer reducer = SampleReducer::Mean;
+};
+
+// Loads jobs from a file. JSON job files hold one object or an array of
+// objects: {"image": "a.ppm", "points": [[x, y], ...], "radius": 2,
+// "reducer": "median"}. Anything else is a coordinate list with one
+// "IMAGE X Y" per line; consecutive lines for the same image form one job.
+// Radius and reducer default to the values already set in `defaults`.
+bool LoadBatchJobs(const char* path, const BatchJob& defaults, std::vector<BatchJob>& jobs,
+                   std::string& error);
+
+enum class BatchFormat {
+    CSV,
+    JSONLines
+};
+
+struct BatchStats {
+    size_t files = 0;
+    size_t failedFiles = 0;
+    size_t samples = 0;
+    size_t outsidePoints = 0;       // skipped, not clamped to the edge
+    double seconds = 0;
+};
+
+// Samples every job on a pool of `threads` workers (0 = one per core).
+// Output rows follow job order; files that fail to load and points outside
+// their image are reported on `errors` and skipped.
+void RunBatch(const std::vector<BatchJob>& jobs, BatchFormat format, int threads,
+              FILE* out, FILE* errors, BatchStats& stats);
+
+bool ParseBatchFormat(const char* name, BatchFormat& format);
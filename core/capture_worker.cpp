@@ -0,0 +1,168 @@
+#include "capture_worker.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <system_error>
+
+#include "perf_stats.h"
+
+uint64_t NowMicros() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+PixelView SamplePatch::View() const {
+    PixelView view = {pixels, width, height, (size_t)width * (format == PixelFormat::RGB24 ? 3 : 4), format};
+    return view;
+}
+
+namespace {
+
+// The centred (2 * radius + 1) square of a capture made at a larger radius.
+// Captures keep their full size at screen edges, so the centre is fixed.
+PixelView CentreOf(const PixelView& view, int captureRadius, int radius) {
+    int offset = captureRadius - radius;
+    size_t bpp = view.format == PixelFormat::RGB24 ? 3 : 4;
+    PixelView inner = {view.data + view.stride * offset + bpp * offset, radius * 2 + 1, radius * 2 + 1,
+                       view.stride, view.format};
+    return inner;
+}
+
+} // namespace
+
+bool TrackingStep(ScreenSource& source, ChangeTracker& tracker, int x, int y, uint32_t nowMs,
+                  int radius, SampleReducer reducer, Color& color, int patchRadius, SamplePatch* patch) {
+    if (!tracker.BeginTick(x, y, nowMs)) return false;
+    
+    patchRadius = patch ? std::min(std::max(patchRadius, 0), kMaxPatchRadius) : 0;
+    const int captureRadius = std::max(radius, patchRadius);
+    PixelView view;
+    bool captured;
+    {
+        PERF_SCOPE(PerfStage::Capture);
+        captured = source.Capture(RectAround(x, y, captureRadius), view);
+    }
+    if (!captured || view.width != captureRadius * 2 + 1 || view.height != captureRadius * 2 + 1) return false;
+    
+    uint64_t hash;
+    {
+        PERF_SCOPE(PerfStage::Hash);
+        hash = HashRegion(view);
+    }
+    // Identical pixels reduce to the same color; only the position may differ
+    bool changed = tracker.EndCapture(hash);
+    if (changed) {
+        PERF_SCOPE(PerfStage::Reduce);
+        color = ReduceRegion(CentreOf(view, captureRadius, radius), reducer);
+    }
+    bool update = tracker.NeedsDisplayUpdate(color, x, y);
+    if (!patch) return update;
+    
+    patch->width = patch->height = patchRadius > 0 ? patchRadius * 2 + 1 : 0;
+    patch->format = view.format;
+    if (patchRadius > 0) {
+        PERF_SCOPE(PerfStage::Loupe);
+        PixelView cells = CentreOf(view, captureRadius, patchRadius);
+        size_t row = (size_t)cells.width * (cells.format == PixelFormat::RGB24 ? 3 : 4);
+        for (int r = 0; r < cells.height; r++) {
+            memcpy(patch->pixels + row * r, cells.data + cells.stride * r, row);
+        }
+    }
+    // The loupe shows pixels the sampled color does not depend on
+    return update || (changed && patchRadius > 0);
+}
+
+CaptureWorker::CaptureWorker(ScreenSource* source, CursorFn cursor, NotifyFn notify, void* context)
+    : m_source(source), m_cursor(cursor), m_notify(notify), m_context(context), m_stop(false),
+      m_radius(0), m_reducer((int)SampleReducer::Mean), m_patchRadius(0), m_settingsVersion(0),
+      m_notifyPending(false), m_dropped(0) {
+}
+
+CaptureWorker::~CaptureWorker() {
+    Stop();
+}
+
+bool CaptureWorker::Start() {
+    if (m_thread.joinable()) return true;
+    
+    m_stop = false;
+    m_tracker.Reset();
+    m_dropped = 0;
+    try {
+        m_thread = std::thread(&CaptureWorker::Run, this);
+    } catch (const std::system_error&) {
+        return false;
+    }
+    return true;
+}
+
+void CaptureWorker::Stop() {
+    if (!m_thread.joinable()) return;
+    
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_stop = true;
+    }
+    m_wake.notify_one();
+    m_thread.join();
+}
+
+void CaptureWorker::SetSampling(int radius, SampleReducer reducer) {
+    m_radius = radius;
+    m_reducer = (int)reducer;
+    m_settingsVersion++;
+}
+
+void CaptureWorker::SetPatchRadius(int radius) {
+    m_patchRadius = std::min(std::max(radius, 0), kMaxPatchRadius);
+    m_settingsVersion++;
+}
+
+bool CaptureWorker::LatestSample(ColorSample& sample) {
+    // Clear first so a push racing with the drain still notifies again
+    m_notifyPending = false;
+    return m_ring.DrainLatest(sample);
+}
+
+void CaptureWorker::Run() {
+    uint32_t seenVersion = m_settingsVersion.load();
+    uint32_t sequence = 0;
+    uint64_t start = NowMicros();
+    Color color = MakeColor(0, 0, 0);
+    ColorSample sample;
+    
+    for (;;) {
+        uint32_t version = m_settingsVersion.load();
+        if (version != seenVersion) {
+            seenVersion = version;
+            m_tracker.Invalidate();
+        }
+        
+        int x, y;
+        uint64_t now = NowMicros();
+        if (m_cursor(m_context, x, y) &&
+            TrackingStep(*m_source, m_tracker, x, y, (uint32_t)((now - start) / 1000), m_radius.load(),
+                         (SampleReducer)m_reducer.load(), color, m_patchRadius.load(), &sample.patch)) {
+            sample.timestampUs = NowMicros();
+            sample.sequence = sequence++;
+            sample.x = x;
+            sample.y = y;
+            sample.color = color;
+            if (!m_ring.TryPush(sample)) {
+                // UI is stalled; make sure the newest color is sent again later
+                m_dropped++;
+                m_tracker.Invalidate();
+            }
+            if (!m_notifyPending.exchange(true) && m_notify) {
+                m_notify(m_context);
+            }
+        }
+        
+        std::unique_lock<std::mutex> lock(m_wakeMutex);
+        if (m_wake.wait_for(lock, std::chrono::milliseconds(m_tracker.NextIntervalMs()),
+                            [this] { return m_stop; })) {
+            break;
+        }
+    }
+}
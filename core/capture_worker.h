@@ -0,0 +1,99 @@
+#pragma once
+
+// Background capture loop. The worker owns all screen access while it runs
+// and hands finished samples to the UI thread through a lock-free ring.
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "change_tracker.h"
+#include "color_sampling.h"
+#include "sample_ring.h"
+#include "screen_source.h"
+
+// Screen pixels around a sample, copied out of the worker's capture for
+// the loupe so the UI thread never touches the screen
+const int kMaxPatchRadius = 7;
+const int kMaxPatchCells = kMaxPatchRadius * 2 + 1;
+
+struct SamplePatch {
+    int width;              // 0 when the sample carries no pixels
+    int height;
+    PixelFormat format;
+    uint8_t pixels[kMaxPatchCells * kMaxPatchCells * 4];
+    
+    PixelView View() const;
+};
+
+struct ColorSample {
+    uint64_t timestampUs;   // steady clock, microseconds
+    uint32_t sequence;
+    int x;
+    int y;
+    Color color;
+    SamplePatch patch;
+};
+
+class CaptureWorker {
+public:
+    // Cursor query, called on the worker thread. Returns false to skip a tick.
+    typedef bool (*CursorFn)(void* context, int& x, int& y);
+    // Called on the worker thread when the ring goes from empty to non-empty
+    typedef void (*NotifyFn)(void* context);
+    
+    CaptureWorker(ScreenSource* source, CursorFn cursor, NotifyFn notify, void* context);
+    ~CaptureWorker();
+    
+    bool Start();
+    void Stop();
+    bool IsRunning() const { return m_thread.joinable(); }
+    
+    // Safe to call from any thread; takes effect on the next tick
+    void SetSampling(int radius, SampleReducer reducer);
+    // Radius of the patch copied into every sample, 0-kMaxPatchRadius; 0 = none
+    void SetPatchRadius(int radius);
+    
+    // UI thread: newest sample since the last call, if any
+    bool LatestSample(ColorSample& sample);
+    
+    // Valid once Stop has returned
+    const TrackingCounters& Counters() const { return m_tracker.Counters(); }
+    uint64_t DroppedSamples() const { return m_dropped.load(); }
+
+private:
+    void Run();
+    
+    ScreenSource* m_source;
+    CursorFn m_cursor;
+    NotifyFn m_notify;
+    void* m_context;
+    
+    std::thread m_thread;
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wake;
+    bool m_stop;
+    
+    std::atomic<int> m_radius;
+    std::atomic<int> m_reducer;
+    std::atomic<int> m_patchRadius;
+    std::atomic<uint32_t> m_settingsVersion;
+    std::atomic<bool> m_notifyPending;
+    std::atomic<uint64_t> m_dropped;
+    
+    ChangeTracker m_tracker;
+    SampleRing<ColorSample, 64> m_ring;
+};
+
+// Steady clock in microseconds, shared with anything that timestamps samples
+uint64_t NowMicros();
+
+// One tracking tick at (x, y): capture when due, reduce again only when the
+// pixels changed. Returns true when the display needs `color` at this
+// position. Shared by the worker and the headless replay benchmark.
+// With a patch, one capture covers both the sampling window and the patch,
+// and a change anywhere in it counts as a display update.
+bool TrackingStep(ScreenSource& source, ChangeTracker& tracker, int x, int y, uint32_t nowMs,
+                  int radius, SampleReducer reducer, Color& color, int patchRadius = 0,
+                  SamplePatch* patch = NULL);
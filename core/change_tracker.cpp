@@ -0,0 +1,105 @@
+#include "change_tracker.h"
+
+#include <cstring>
+
+void ChangeTracker::Reset() {
+    memset(&m_counters, 0, sizeof(m_counters));
+    m_now = 0;
+    m_interval = kFastIntervalMs;
+    m_lastActivity = 0;
+    m_lastCapture = 0;
+    m_lastHash = 0;
+    m_x = m_y = 0;
+    m_shownX = m_shownY = 0;
+    m_shownColor = MakeColor(0, 0, 0);
+    m_hasCapture = false;
+    m_hasShown = false;
+}
+
+void ChangeTracker::Invalidate() {
+    m_hasCapture = false;
+    m_hasShown = false;
+}
+
+void ChangeTracker::MarkActive() {
+    m_lastActivity = m_now;
+    m_interval = kFastIntervalMs;
+}
+
+bool ChangeTracker::BeginTick(int x, int y, uint32_t nowMs) {
+    m_counters.ticks++;
+    m_now = nowMs;
+    
+    bool moved = x != m_x || y != m_y;
+    m_x = x;
+    m_y = y;
+    
+    if (moved || m_counters.ticks == 1) {
+        MarkActive();
+    } else if (nowMs - m_lastActivity >= kIdleAfterMs) {
+        // Back off geometrically so a brief pause does not drop straight to 4 Hz
+        m_interval = m_interval * 2 < kIdleIntervalMs ? m_interval * 2 : kIdleIntervalMs;
+    }
+    
+    if (moved || !m_hasCapture || nowMs - m_lastCapture >= kStillRefreshMs) {
+        m_counters.captures++;
+        m_lastCapture = nowMs;
+        return true;
+    }
+    
+    m_counters.capturesSkipped++;
+    return false;
+}
+
+bool ChangeTracker::EndCapture(uint64_t regionHash) {
+    if (m_hasCapture && regionHash == m_lastHash) {
+        m_counters.reductionsSkipped++;
+        return false;
+    }
+    
+    // Screen content under a still cursor changed: react quickly again
+    if (m_hasCapture) {
+        MarkActive();
+    }
+    m_hasCapture = true;
+    m_lastHash = regionHash;
+    return true;
+}
+
+bool ChangeTracker::NeedsDisplayUpdate(Color color, int x, int y) {
+    if (m_hasShown && color == m_shownColor && x == m_shownX && y == m_shownY) {
+        m_counters.uiUpdatesSkipped++;
+        return false;
+    }
+    
+    m_hasShown = true;
+    m_shownColor = color;
+    m_shownX = x;
+    m_shownY = y;
+    m_counters.uiUpdates++;
+    return true;
+}
+
+uint64_t HashRegion(const PixelView& view) {
+    const uint64_t kPrime = 0x100000001B3ULL;
+    uint64_t h = 0xCBF29CE484222325ULL;
+    h = (h ^ (uint64_t)view.width) * kPrime;
+    h = (h ^ (uint64_t)view.height) * kPrime;
+    
+    size_t rowBytes = (size_t)view.width * (view.format == PixelFormat::RGB24 ? 3 : 4);
+    for (int y = 0; y < view.height; y++) {
+        const uint8_t* p = view.data + (size_t)y * view.stride;
+        size_t i = 0;
+        // FNV-style mixing a word at a time rather than a byte at a time
+        for (; i + 8 <= rowBytes; i += 8) {
+            uint64_t w;
+            memcpy(&w, p + i, 8);
+            h = (h ^ w) * kPrime;
+            h ^= h >> 29;
+        }
+        for (; i < rowBytes; i++) {
+            h = (h ^ p[i]) * kPrime;
+        }
+    }
+    return h;
+}
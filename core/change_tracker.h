@@ -0,0 +1,65 @@
+#pragma once
+
+// Change detection and adaptive pacing for the tracking loop. The GUI asks
+// the tracker at each tick whether a capture is due, whether the captured
+// pixels changed, and whether the display needs touching at all.
+
+#include "color_core.h"
+
+struct TrackingCounters {
+    uint64_t ticks;
+    uint64_t captures;
+    uint64_t capturesSkipped;       // cursor still and refresh not yet due
+    uint64_t reductionsSkipped;     // captured pixels identical to last time
+    uint64_t uiUpdates;
+    uint64_t uiUpdatesSkipped;      // same color at the same position
+};
+
+// Tick intervals. Waits round up to the OS scheduler tick, so the fast
+// rate is a request rather than a guarantee.
+const uint32_t kFastIntervalMs = 8;         // ~120 Hz while the cursor moves
+const uint32_t kIdleIntervalMs = 250;       // 4 Hz after the desktop settles
+const uint32_t kIdleAfterMs = 500;          // quiet time before backing off
+const uint32_t kStillRefreshMs = 100;       // recapture rate for a still cursor
+
+class ChangeTracker {
+public:
+    ChangeTracker() { Reset(); }
+    
+    void Reset();
+    
+    // Forget the last capture so the next tick recaptures and redraws, e.g.
+    // after the reducer changes
+    void Invalidate();
+    
+    // Start of a tick. Returns true when a capture is due.
+    bool BeginTick(int x, int y, uint32_t nowMs);
+    
+    // After a capture. Returns true when the pixels differ from the previous
+    // capture and must be reduced again.
+    bool EndCapture(uint64_t regionHash);
+    
+    // Returns true when the displayed color or coordinates must change
+    bool NeedsDisplayUpdate(Color color, int x, int y);
+    
+    uint32_t NextIntervalMs() const { return m_interval; }
+    const TrackingCounters& Counters() const { return m_counters; }
+
+private:
+    void MarkActive();
+    
+    TrackingCounters m_counters;
+    uint32_t m_now;
+    uint32_t m_interval;
+    uint32_t m_lastActivity;
+    uint32_t m_lastCapture;
+    uint64_t m_lastHash;
+    int m_x, m_y;
+    int m_shownX, m_shownY;
+    Color m_shownColor;
+    bool m_hasCapture;
+    bool m_hasShown;
+};
+
+// Fast non-cryptographic hash of a view's pixels and dimensions
+uint64_t HashRegion(const PixelView& view);
@@ -0,0 +1,473 @@
+#include "color_core.h"
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define COLOR_CORE_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// GCC and Clang need per-function target attributes so the AVX2 kernel can
+// live in a translation unit compiled for baseline x86; MSVC does not.
+#if defined(__GNUC__) || defined(__clang__)
+#define COLOR_CORE_TARGET(x) __attribute__((target(x)))
+#else
+#define COLOR_CORE_TARGET(x)
+#endif
+
+namespace {
+
+// ceil(2^31 / d) = ceil(2^32 / 2d). Multiplying by it and keeping the high
+// 32 bits of the product divides by 2d exactly for every numerator below
+// 2^32 / 510, which covers every quotient RGBtoHSLFixed takes.
+struct HalfReciprocals {
+    uint32_t v[256];
+};
+
+constexpr HalfReciprocals MakeHalfReciprocals() {
+    HalfReciprocals t = {};
+    for (uint32_t d = 1; d < 256; d++) {
+        t.v[d] = (uint32_t)(((1ull << 31) + d - 1) / d);
+    }
+    return t;
+}
+
+constexpr HalfReciprocals g_halfReciprocal = MakeHalfReciprocals();
+
+// floor(n / 2d) for 1 <= d <= 255
+inline int DivideByTwice(uint32_t n, int d) {
+    return (int)(((uint64_t)n * g_halfReciprocal.v[d]) >> 32);
+}
+
+} // namespace
+
+template <int kScale>
+void RGBtoHSLFixed(int r, int g, int b, int& h, int& s, int& l) {
+    static_assert(kScale == kHSLWhole || kScale == kHSLTenths, "unsupported HSL precision");
+    int maxVal = std::max(std::max(r, g), b);
+    int minVal = std::min(std::min(r, g), b);
+    int delta = maxVal - minVal;
+    int sum = maxVal + minVal;
+    
+    // round(x / y) = floor((2x + y) / 2y), so every value below is one
+    // reciprocal multiply: L = sum / 510, S = delta / d, H = 60 n / delta
+    l = DivideByTwice(sum * 100 * kScale + 255, 255);
+    
+    if (delta == 0) {
+        h = s = 0; // achromatic
+        return;
+    }
+    
+    // Saturation; both formulas agree at sum == 255
+    int d = sum <= 255 ? sum : 510 - sum;
+    s = DivideByTwice(2 * delta * 100 * kScale + d, d);
+    
+    // Hue in sixths of the circle, n / delta with n in [0, 6 delta). Masks
+    // rather than branches, because which channel is largest is as good as
+    // random across an image and compilers turn the ternaries into jumps.
+    int isR = -(int)(maxVal == r);
+    int isG = ~isR & -(int)(maxVal == g);
+    int isB = ~(isR | isG);
+    int nr = g - b + (6 * delta & -(int)(g < b));
+    int ng = 2 * delta + b - r;
+    int nb = 4 * delta + r - g;
+    int n = (nr & isR) | (ng & isG) | (nb & isB);
+    h = DivideByTwice(120 * kScale * n + delta, delta);
+    if (h == 360 * kScale) h = 0;
+}
+
+template void RGBtoHSLFixed<kHSLWhole>(int r, int g, int b, int& h, int& s, int& l);
+template void RGBtoHSLFixed<kHSLTenths>(int r, int g, int b, int& h, int& s, int& l);
+
+void RGBtoHSL(int r, int g, int b, int& h, int& s, int& l) {
+    RGBtoHSLFixed<kHSLWhole>(r, g, b, h, s, l);
+}
+
+namespace {
+
+const char g_hexDigits[] = "0123456789ABCDEF";
+
+// Append a decimal integer; to_chars never allocates or touches the locale
+inline char* PutInt(char* p, int value) {
+    return std::to_chars(p, p + 11, value).ptr;
+}
+
+inline char* PutText(char* p, const char* text) {
+    while (*text) {
+        *p++ = *text++;
+    }
+    return p;
+}
+
+} // namespace
+
+size_t FormatHex(Color color, char* out) {
+    out[0] = '#';
+    out[1] = g_hexDigits[color.r >> 4];
+    out[2] = g_hexDigits[color.r & 15];
+    out[3] = g_hexDigits[color.g >> 4];
+    out[4] = g_hexDigits[color.g & 15];
+    out[5] = g_hexDigits[color.b >> 4];
+    out[6] = g_hexDigits[color.b & 15];
+    out[7] = '\0';
+    return 7;
+}
+
+size_t FormatRGB(Color color, char* out) {
+    char* p = PutInt(out, color.r);
+    p = PutText(p, ", ");
+    p = PutInt(p, color.g);
+    p = PutText(p, ", ");
+    p = PutInt(p, color.b);
+    *p = '\0';
+    return p - out;
+}
+
+size_t FormatHSL(Color color, char* out) {
+    int h, s, l;
+    
+    RGBtoHSL(color.r, color.g, color.b, h, s, l);
+    
+    char* p = PutInt(out, h);
+    p = PutText(p, " deg, ");
+    p = PutInt(p, s);
+    p = PutText(p, "%, ");
+    p = PutInt(p, l);
+    p = PutText(p, "%");
+    *p = '\0';
+    return p - out;
+}
+
+size_t FormatCoords(int x, int y, char* out) {
+    char* p = PutText(out, "(");
+    p = PutInt(p, x);
+    p = PutText(p, ", ");
+    p = PutInt(p, y);
+    p = PutText(p, ")");
+    *p = '\0';
+    return p - out;
+}
+
+std::string ColorToHex(Color color) {
+    char buffer[kHexBufferSize];
+    return std::string(buffer, FormatHex(color, buffer));
+}
+
+std::string ColorToRGB(Color color) {
+    char buffer[kRGBBufferSize];
+    return std::string(buffer, FormatRGB(color, buffer));
+}
+
+std::string ColorToHSL(Color color) {
+    char buffer[kHSLBufferSize];
+    return std::string(buffer, FormatHSL(color, buffer));
+}
+
+Color PixelAt(const PixelView& view, int x, int y) {
+    x = std::min(std::max(x, 0), view.width - 1);
+    y = std::min(std::max(y, 0), view.height - 1);
+    
+    const uint8_t* row = view.data + (size_t)y * view.stride;
+    if (view.format == PixelFormat::RGB24) {
+        const uint8_t* p = row + (size_t)x * 3;
+        return MakeColor(p[0], p[1], p[2]);
+    }
+    const uint8_t* p = row + (size_t)x * 4;
+    return MakeColor(p[2], p[1], p[0]);
+}
+
+namespace {
+
+// Channel values as doubles. The vector kernels load each lane from here
+// rather than converting the block with one wide load, which would stall
+// on the narrow stores LoadBlock just made.
+struct ChannelTable {
+    double v[256];
+    ChannelTable() {
+        for (int i = 0; i < 256; i++) {
+            v[i] = i;
+        }
+    }
+};
+
+const ChannelTable g_channel;
+
+// Pixels are converted in fixed blocks: deinterleave, convert, write out.
+const size_t kBlockSize = 8;
+
+struct Block {
+    int32_t r[kBlockSize];
+    int32_t g[kBlockSize];
+    int32_t b[kBlockSize];
+    int32_t h[kBlockSize];
+    int32_t s[kBlockSize];
+    int32_t l[kBlockSize];
+};
+
+typedef void (*BlockKernel)(Block& blk);
+
+void LoadBlock(const uint8_t* px, size_t n, PixelFormat format, Block& blk) {
+    size_t i = 0;
+    if (format == PixelFormat::RGB24) {
+        for (; i < n; i++) {
+            blk.r[i] = px[i * 3];
+            blk.g[i] = px[i * 3 + 1];
+            blk.b[i] = px[i * 3 + 2];
+        }
+    } else {
+        for (; i < n; i++) {
+            blk.b[i] = px[i * 4];
+            blk.g[i] = px[i * 4 + 1];
+            blk.r[i] = px[i * 4 + 2];
+        }
+    }
+    for (; i < kBlockSize; i++) {
+        blk.r[i] = blk.g[i] = blk.b[i] = 0;
+    }
+}
+
+void KernelScalar(Block& blk) {
+    for (size_t i = 0; i < kBlockSize; i++) {
+        int h, s, l;
+        RGBtoHSL(blk.r[i], blk.g[i], blk.b[i], h, s, l);
+        blk.h[i] = h;
+        blk.s[i] = s;
+        blk.l[i] = l;
+    }
+}
+
+#if COLOR_CORE_X86
+
+// The vector kernels evaluate every branch of RGBtoHSLFixed and select per
+// lane. Channels and numerators are small integers, exact in a double, and
+// no quotient is within 1/510 of the integer above it, so one correctly
+// rounded divide truncates to exactly the floor the scalar code takes.
+// Lightness divides by a constant: half a step added to the numerator
+// keeps its product with 1/510 clear of every integer, so it multiplies.
+
+COLOR_CORE_TARGET("sse2")
+inline __m128d Select(__m128d mask, __m128d a, __m128d b) {
+    return _mm_or_pd(_mm_and_pd(mask, a), _mm_andnot_pd(mask, b));
+}
+
+COLOR_CORE_TARGET("sse2")
+void KernelSSE2(Block& blk) {
+    const __m128d zero = _mm_setzero_pd();
+    const __m128d two = _mm_set1_pd(2.0);
+    const __m128d four = _mm_set1_pd(4.0);
+    const __m128d six = _mm_set1_pd(6.0);
+    const __m128d hundred = _mm_set1_pd(100.0);
+    const __m128d v120 = _mm_set1_pd(120.0);
+    const __m128d v200 = _mm_set1_pd(200.0);
+    const __m128d v255 = _mm_set1_pd(255.0);
+    const __m128d v510 = _mm_set1_pd(510.0);
+    const __m128d lightBias = _mm_set1_pd(255.5);
+    const __m128d inv510 = _mm_set1_pd(1.0 / 510.0);
+    const __m128i fullTurn = _mm_set1_epi32(360);
+    
+    for (size_t o = 0; o < kBlockSize; o += 2) {
+        __m128d dr = _mm_set_pd(g_channel.v[blk.r[o + 1]], g_channel.v[blk.r[o]]);
+        __m128d dg = _mm_set_pd(g_channel.v[blk.g[o + 1]], g_channel.v[blk.g[o]]);
+        __m128d db = _mm_set_pd(g_channel.v[blk.b[o + 1]], g_channel.v[blk.b[o]]);
+        
+        __m128d maxVal = _mm_max_pd(_mm_max_pd(dr, dg), db);
+        __m128d minVal = _mm_min_pd(_mm_min_pd(dr, dg), db);
+        __m128d sum = _mm_add_pd(maxVal, minVal);
+        __m128d delta = _mm_sub_pd(maxVal, minVal);
+        __m128d chromatic = _mm_cmpneq_pd(delta, zero);
+        
+        // Lightness
+        __m128d lD = _mm_mul_pd(_mm_add_pd(_mm_mul_pd(sum, hundred), lightBias), inv510);
+        
+        // Saturation
+        __m128d d = Select(_mm_cmple_pd(sum, v255), sum, _mm_sub_pd(v510, sum));
+        __m128d sD = _mm_div_pd(_mm_add_pd(_mm_mul_pd(delta, v200), d), _mm_add_pd(d, d));
+        
+        // Hue
+        __m128d isR = _mm_cmpeq_pd(maxVal, dr);
+        __m128d isG = _mm_andnot_pd(isR, _mm_cmpeq_pd(maxVal, dg));
+        __m128d num = Select(isR, _mm_sub_pd(dg, db),
+                             Select(isG, _mm_sub_pd(db, dr), _mm_sub_pd(dr, dg)));
+        __m128d offset = Select(isR, _mm_and_pd(_mm_cmplt_pd(dg, db), six),
+                                Select(isG, two, four));
+        num = _mm_add_pd(num, _mm_mul_pd(offset, delta));
+        __m128d hD = _mm_div_pd(_mm_add_pd(_mm_mul_pd(num, v120), delta), _mm_add_pd(delta, delta));
+        
+        hD = _mm_and_pd(chromatic, hD);
+        sD = _mm_and_pd(chromatic, sD);
+        
+        // A hue that rounds up to 360 wraps to 0
+        __m128i h = _mm_cvttpd_epi32(hD);
+        h = _mm_sub_epi32(h, _mm_and_si128(_mm_cmpeq_epi32(h, fullTurn), fullTurn));
+        _mm_storel_epi64((__m128i*)(blk.h + o), h);
+        _mm_storel_epi64((__m128i*)(blk.s + o), _mm_cvttpd_epi32(sD));
+        _mm_storel_epi64((__m128i*)(blk.l + o), _mm_cvttpd_epi32(lD));
+    }
+}
+
+COLOR_CORE_TARGET("avx2")
+void KernelAVX2(Block& blk) {
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d two = _mm256_set1_pd(2.0);
+    const __m256d four = _mm256_set1_pd(4.0);
+    const __m256d six = _mm256_set1_pd(6.0);
+    const __m256d hundred = _mm256_set1_pd(100.0);
+    const __m256d v120 = _mm256_set1_pd(120.0);
+    const __m256d v200 = _mm256_set1_pd(200.0);
+    const __m256d v255 = _mm256_set1_pd(255.0);
+    const __m256d v510 = _mm256_set1_pd(510.0);
+    const __m256d lightBias = _mm256_set1_pd(255.5);
+    const __m256d inv510 = _mm256_set1_pd(1.0 / 510.0);
+    const __m128i fullTurn = _mm_set1_epi32(360);
+    
+    for (size_t o = 0; o < kBlockSize; o += 4) {
+        // Plain loads beat vgatherdpd on most cores for a 2 KB table
+        __m256d dr = _mm256_set_pd(g_channel.v[blk.r[o + 3]], g_channel.v[blk.r[o + 2]],
+                                   g_channel.v[blk.r[o + 1]], g_channel.v[blk.r[o]]);
+        __m256d dg = _mm256_set_pd(g_channel.v[blk.g[o + 3]], g_channel.v[blk.g[o + 2]],
+                                   g_channel.v[blk.g[o + 1]], g_channel.v[blk.g[o]]);
+        __m256d db = _mm256_set_pd(g_channel.v[blk.b[o + 3]], g_channel.v[blk.b[o + 2]],
+                                   g_channel.v[blk.b[o + 1]], g_channel.v[blk.b[o]]);
+        
+        __m256d maxVal = _mm256_max_pd(_mm256_max_pd(dr, dg), db);
+        __m256d minVal = _mm256_min_pd(_mm256_min_pd(dr, dg), db);
+        __m256d sum = _mm256_add_pd(maxVal, minVal);
+        __m256d delta = _mm256_sub_pd(maxVal, minVal);
+        __m256d chromatic = _mm256_cmp_pd(delta, zero, _CMP_NEQ_UQ);
+        
+        // Lightness
+        __m256d lD = _mm256_mul_pd(_mm256_add_pd(_mm256_mul_pd(sum, hundred), lightBias), inv510);
+        
+        // Saturation
+        __m256d d = _mm256_blendv_pd(_mm256_sub_pd(v510, sum), sum, _mm256_cmp_pd(sum, v255, _CMP_LE_OQ));
+        __m256d sD = _mm256_div_pd(_mm256_add_pd(_mm256_mul_pd(delta, v200), d), _mm256_add_pd(d, d));
+        
+        // Hue
+        __m256d isR = _mm256_cmp_pd(maxVal, dr, _CMP_EQ_OQ);
+        __m256d isG = _mm256_andnot_pd(isR, _mm256_cmp_pd(maxVal, dg, _CMP_EQ_OQ));
+        __m256d num = _mm256_blendv_pd(_mm256_sub_pd(dr, dg), _mm256_sub_pd(db, dr), isG);
+        num = _mm256_blendv_pd(num, _mm256_sub_pd(dg, db), isR);
+        __m256d offset = _mm256_blendv_pd(four, two, isG);
+        offset = _mm256_blendv_pd(offset, _mm256_and_pd(_mm256_cmp_pd(dg, db, _CMP_LT_OQ), six), isR);
+        num = _mm256_add_pd(num, _mm256_mul_pd(offset, delta));
+        __m256d hD = _mm256_div_pd(_mm256_add_pd(_mm256_mul_pd(num, v120), delta), _mm256_add_pd(delta, delta));
+        
+        hD = _mm256_and_pd(chromatic, hD);
+        sD = _mm256_and_pd(chromatic, sD);
+        
+        // A hue that rounds up to 360 wraps to 0
+        __m128i h = _mm256_cvttpd_epi32(hD);
+        h = _mm_sub_epi32(h, _mm_and_si128(_mm_cmpeq_epi32(h, fullTurn), fullTurn));
+        _mm_storeu_si128((__m128i*)(blk.h + o), h);
+        _mm_storeu_si128((__m128i*)(blk.s + o), _mm256_cvttpd_epi32(sD));
+        _mm_storeu_si128((__m128i*)(blk.l + o), _mm256_cvttpd_epi32(lD));
+    }
+}
+
+#endif
+
+std::atomic<int> g_simdLevel(-1);
+
+BlockKernel ActiveKernel() {
+    switch (GetSimdLevel()) {
+#if COLOR_CORE_X86
+        case SimdLevel::AVX2: return KernelAVX2;
+        case SimdLevel::SSE2: return KernelSSE2;
+#endif
+        default: return KernelScalar;
+    }
+}
+
+template <typename Sink>
+void RunBatch(const uint8_t* pixels, size_t count, PixelFormat format, Sink sink) {
+    BlockKernel kernel = ActiveKernel();
+    size_t stride = format == PixelFormat::RGB24 ? 3 : 4;
+    Block blk;
+    
+    for (size_t i = 0; i < count; i += kBlockSize) {
+        size_t n = std::min(kBlockSize, count - i);
+        LoadBlock(pixels + i * stride, n, format, blk);
+        kernel(blk);
+        sink(i, blk, n);
+    }
+}
+
+} // namespace
+
+void RGBtoHSLBatch(const uint8_t* pixels, size_t count, PixelFormat format, HSLValue* out) {
+    RunBatch(pixels, count, format, [out](size_t base, const Block& blk, size_t n) {
+        for (size_t i = 0; i < n; i++) {
+            out[base + i].h = (uint16_t)blk.h[i];
+            out[base + i].s = (uint8_t)blk.s[i];
+            out[base + i].l = (uint8_t)blk.l[i];
+        }
+    });
+}
+
+void RGBtoHSLBatchPlanar(const uint8_t* pixels, size_t count, PixelFormat format,
+                         uint16_t* h, uint8_t* s, uint8_t* l) {
+    RunBatch(pixels, count, format, [h, s, l](size_t base, const Block& blk, size_t n) {
+        for (size_t i = 0; i < n; i++) {
+            h[base + i] = (uint16_t)blk.h[i];
+            s[base + i] = (uint8_t)blk.s[i];
+            l[base + i] = (uint8_t)blk.l[i];
+        }
+    });
+}
+
+SimdLevel DetectSimdLevel() {
+#if COLOR_CORE_X86
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    int maxLeaf = info[0];
+    __cpuid(info, 1);
+    bool sse2 = (info[3] & (1 << 26)) != 0;
+    bool osAvx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 &&
+                 (_xgetbv(0) & 6) == 6;
+    bool avx2 = false;
+    if (maxLeaf >= 7 && osAvx) {
+        __cpuidex(info, 7, 0);
+        avx2 = (info[1] & (1 << 5)) != 0;
+    }
+#else
+    __builtin_cpu_init();
+    bool sse2 = __builtin_cpu_supports("sse2");
+    bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+    if (avx2) return SimdLevel::AVX2;
+    if (sse2) return SimdLevel::SSE2;
+#endif
+    return SimdLevel::Scalar;
+}
+
+SimdLevel GetSimdLevel() {
+    int level = g_simdLevel.load(std::memory_order_relaxed);
+    if (level < 0) {
+        level = (int)DetectSimdLevel();
+        g_simdLevel.store(level, std::memory_order_relaxed);
+    }
+    return (SimdLevel)level;
+}
+
+SimdLevel ForceSimdLevel(SimdLevel level) {
+    SimdLevel supported = DetectSimdLevel();
+    if ((int)level > (int)supported) {
+        level = supported;
+    }
+    g_simdLevel.store((int)level, std::memory_order_relaxed);
+    return level;
+}
+
+const char* SimdLevelName(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::AVX2: return "AVX2";
+        case SimdLevel::SSE2: return "SSE2";
+        default: return "Scalar";
+    }
+}
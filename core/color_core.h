@@ -0,0 +1,105 @@
+#pragma once
+
+// Portable color conversion routines shared by the GUI and headless tools.
+// Nothing in here may depend on <windows.h>.
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// 8-bit sRGB color, independent of COLORREF and its byte order
+struct Color {
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+};
+
+inline Color MakeColor(int r, int g, int b) {
+    Color c = {(uint8_t)r, (uint8_t)g, (uint8_t)b};
+    return c;
+}
+
+inline bool operator==(Color a, Color b) {
+    return a.r == b.r && a.g == b.g && a.b == b.b;
+}
+
+inline bool operator!=(Color a, Color b) {
+    return !(a == b);
+}
+
+// Pixel layouts accepted by the batch converters and pixel views
+enum class PixelFormat {
+    RGB24,      // r, g, b bytes
+    BGRA32      // b, g, r, a bytes (Win32 DIB section / BitBlt layout)
+};
+
+// Non-owning view of a top-down pixel buffer
+struct PixelView {
+    const uint8_t* data;
+    int width;
+    int height;
+    size_t stride;          // bytes per row
+    PixelFormat format;
+};
+
+// Instruction sets the batch converters can dispatch to
+enum class SimdLevel {
+    Scalar,
+    SSE2,
+    AVX2
+};
+
+// Packed HSL triple: hue in degrees, saturation and lightness in percent
+struct HSLValue {
+    uint16_t h;
+    uint8_t s;
+    uint8_t l;
+};
+
+// HSL precision for RGBtoHSLFixed
+const int kHSLWhole = 1;        // degrees and percent
+const int kHSLTenths = 10;      // tenths of a degree and of a percent
+
+// Exact HSL in integer arithmetic, with every quotient a multiply by a
+// constexpr reciprocal. Each value is the exact one rounded to nearest,
+// halves up: h in [0, 360 * kScale) with 360 wrapping to 0, s and l in
+// [0, 100 * kScale]. Saturation uses the exact lightness, never a rounded
+// one. kScale is kHSLWhole or kHSLTenths.
+template <int kScale>
+void RGBtoHSLFixed(int r, int g, int b, int& h, int& s, int& l);
+
+// Single color conversion, RGBtoHSLFixed<kHSLWhole>
+void RGBtoHSL(int r, int g, int b, int& h, int& s, int& l);
+
+// Display formatting into caller-provided buffers. These never allocate and
+// return the length written, excluding the terminating NUL. Buffer sizes
+// below cover the longest possible output.
+const size_t kHexBufferSize = 8;        // "#RRGGBB"
+const size_t kRGBBufferSize = 14;       // "255, 255, 255"
+const size_t kHSLBufferSize = 20;       // "360 deg, 100%, 100%"
+const size_t kCoordBufferSize = 27;     // "(-2147483648, -2147483648)"
+
+size_t FormatHex(Color color, char* out);
+size_t FormatRGB(Color color, char* out);
+size_t FormatHSL(Color color, char* out);
+size_t FormatCoords(int x, int y, char* out);
+
+// Convenience wrappers for callers that need a std::string
+std::string ColorToHex(Color color);
+std::string ColorToRGB(Color color);
+std::string ColorToHSL(Color color);
+
+// Sampling. Coordinates outside the view are clamped to the nearest edge.
+Color PixelAt(const PixelView& view, int x, int y);
+
+// Batch conversion. Results are bit-identical to RGBtoHSL for every input.
+void RGBtoHSLBatch(const uint8_t* pixels, size_t count, PixelFormat format, HSLValue* out);
+void RGBtoHSLBatchPlanar(const uint8_t* pixels, size_t count, PixelFormat format,
+                         uint16_t* h, uint8_t* s, uint8_t* l);
+
+// Runtime CPU dispatch. ForceSimdLevel clamps to what the CPU supports and
+// is intended for tests and benchmarks.
+SimdLevel DetectSimdLevel();
+SimdLevel GetSimdLevel();
+SimdLevel ForceSimdLevel(SimdLevel level);
+const char* SimdLevelName(SimdLevel level);
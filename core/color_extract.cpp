@@ -0,0 +1,303 @@
+#include "color_extract.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "color_spaces.h"
+#include "parallel.h"
+
+namespace {
+
+struct Bin {
+    uint64_t count;
+    uint64_t r, g, b;
+};
+
+// Histogram of rows [y0, y1); channel offsets and pixel size come from the format
+template <int RI, int GI, int BI, int Step>
+void AccumulateRows(const PixelView& view, int y0, int y1, int bits, Bin* bins) {
+    const int shift = 8 - bits;
+    for (int y = y0; y < y1; y++) {
+        const uint8_t* p = view.data + view.stride * y;
+        for (int x = 0; x < view.width; x++, p += Step) {
+            uint32_t r = p[RI];
+            uint32_t g = p[GI];
+            uint32_t b = p[BI];
+            Bin& bin = bins[((r >> shift) << (2 * bits)) | ((g >> shift) << bits) | (b >> shift)];
+            bin.count++;
+            bin.r += r;
+            bin.g += g;
+            bin.b += b;
+        }
+    }
+}
+
+// Each slice fills a private histogram over a band of rows; the bands are
+// then summed, also in parallel, over ranges of bins
+void BuildHistogram(const PixelView& view, int bits, int threads, std::vector<Bin>& histogram) {
+    const int binCount = 1 << (3 * bits);
+    const int kMinRowsPerSlice = 32;
+    int slices = std::min(ResolveThreadCount(threads), std::max(1, view.height / kMinRowsPerSlice));
+    
+    std::vector<std::vector<Bin>> partial(slices);
+    slices = ParallelFor(view.height, slices, [&](int y0, int y1, int slice) {
+        partial[slice].assign(binCount, Bin());
+        if (view.format == PixelFormat::BGRA32) {
+            AccumulateRows<2, 1, 0, 4>(view, y0, y1, bits, partial[slice].data());
+        } else {
+            AccumulateRows<0, 1, 2, 3>(view, y0, y1, bits, partial[slice].data());
+        }
+    });
+    
+    if (slices > 1) {
+        ParallelFor(binCount, slices, [&](int begin, int end, int) {
+            for (int s = 1; s < slices; s++) {
+                const Bin* src = partial[s].data();
+                Bin* dst = partial[0].data();
+                for (int i = begin; i < end; i++) {
+                    dst[i].count += src[i].count;
+                    dst[i].r += src[i].r;
+                    dst[i].g += src[i].g;
+                    dst[i].b += src[i].b;
+                }
+            }
+        });
+    }
+    histogram.swap(partial[0]);
+}
+
+struct WeightedPoint {
+    float v[3];     // OKLab
+    double weight;
+};
+
+struct Cluster {
+    double sum[3];
+    double weight;
+};
+
+void ClusterMean(const Cluster& c, float* mean) {
+    for (int a = 0; a < 3; a++) {
+        mean[a] = c.weight > 0 ? (float)(c.sum[a] / c.weight) : 0.0f;
+    }
+}
+
+struct Box {
+    int lo, hi;
+    double error;   // weighted squared deviation from the box mean
+    int axis;       // axis of largest spread
+};
+
+void MeasureBox(const std::vector<WeightedPoint>& points, Box& box) {
+    double w = 0, sum[3] = {0, 0, 0}, sq[3] = {0, 0, 0};
+    for (int i = box.lo; i < box.hi; i++) {
+        const WeightedPoint& p = points[i];
+        w += p.weight;
+        for (int a = 0; a < 3; a++) {
+            sum[a] += p.weight * p.v[a];
+            sq[a] += p.weight * p.v[a] * p.v[a];
+        }
+    }
+    box.error = 0;
+    box.axis = 0;
+    double best = -1;
+    for (int a = 0; a < 3; a++) {
+        double var = sq[a] - sum[a] * sum[a] / w;
+        box.error += var;
+        if (var > best) {
+            best = var;
+            box.axis = a;
+        }
+    }
+}
+
+// Splits the box with the largest error at the weighted median of its
+// widest axis until there are `count` boxes or nothing left to split
+void MedianCut(std::vector<WeightedPoint>& points, int count, std::vector<Cluster>& clusters) {
+    std::vector<Box> boxes;
+    Box all = {0, (int)points.size(), 0, 0};
+    MeasureBox(points, all);
+    boxes.push_back(all);
+    
+    while ((int)boxes.size() < count) {
+        int pick = -1;
+        for (int i = 0; i < (int)boxes.size(); i++) {
+            if (boxes[i].hi - boxes[i].lo >= 2 && boxes[i].error > 0 &&
+                (pick < 0 || boxes[i].error > boxes[pick].error)) {
+                pick = i;
+            }
+        }
+        if (pick < 0) break;
+        
+        Box box = boxes[pick];
+        int axis = box.axis;
+        std::sort(points.begin() + box.lo, points.begin() + box.hi,
+                  [axis](const WeightedPoint& x, const WeightedPoint& y) { return x.v[axis] < y.v[axis]; });
+        
+        double total = 0;
+        for (int i = box.lo; i < box.hi; i++) total += points[i].weight;
+        double running = 0;
+        int mid = box.lo + 1;
+        for (int i = box.lo; i < box.hi - 1; i++) {
+            running += points[i].weight;
+            mid = i + 1;
+            if (running * 2 >= total) break;
+        }
+        
+        Box left = {box.lo, mid, 0, 0};
+        Box right = {mid, box.hi, 0, 0};
+        MeasureBox(points, left);
+        MeasureBox(points, right);
+        boxes[pick] = left;
+        boxes.push_back(right);
+    }
+    
+    clusters.assign(boxes.size(), Cluster());
+    for (size_t b = 0; b < boxes.size(); b++) {
+        for (int i = boxes[b].lo; i < boxes[b].hi; i++) {
+            for (int a = 0; a < 3; a++) clusters[b].sum[a] += points[i].weight * points[i].v[a];
+            clusters[b].weight += points[i].weight;
+        }
+    }
+}
+
+// Weighted Lloyd iterations starting from the given clusters. The
+// assignment step runs in parallel with per-slice accumulators.
+void KMeans(const std::vector<WeightedPoint>& points, int iterations, int threads,
+            std::vector<Cluster>& clusters) {
+    const int k = (int)clusters.size();
+    const int kMinPointsPerSlice = 2048;
+    int slices = std::min(ResolveThreadCount(threads), std::max(1, (int)points.size() / kMinPointsPerSlice));
+    
+    std::vector<int> assignment(points.size(), -1);
+    std::vector<std::vector<Cluster>> partial(slices);
+    std::vector<int> changed(slices);
+    float centers[kMaxExtractColors][3];
+    for (int c = 0; c < k; c++) ClusterMean(clusters[c], centers[c]);
+    
+    for (int iter = 0; iter < iterations; iter++) {
+        int used = ParallelFor((int)points.size(), slices, [&](int begin, int end, int slice) {
+            std::vector<Cluster>& acc = partial[slice];
+            acc.assign(k, Cluster());
+            int moves = 0;
+            for (int i = begin; i < end; i++) {
+                const WeightedPoint& p = points[i];
+                int best = 0;
+                float bestDist = 0;
+                for (int c = 0; c < k; c++) {
+                    float d0 = p.v[0] - centers[c][0];
+                    float d1 = p.v[1] - centers[c][1];
+                    float d2 = p.v[2] - centers[c][2];
+                    float d = d0 * d0 + d1 * d1 + d2 * d2;
+                    if (c == 0 || d < bestDist) {
+                        bestDist = d;
+                        best = c;
+                    }
+                }
+                if (assignment[i] != best) {
+                    assignment[i] = best;
+                    moves++;
+                }
+                for (int a = 0; a < 3; a++) acc[best].sum[a] += p.weight * p.v[a];
+                acc[best].weight += p.weight;
+            }
+            changed[slice] = moves;
+        });
+        
+        int moves = 0;
+        for (int s = 0; s < used; s++) moves += changed[s];
+        for (int c = 0; c < k; c++) {
+            Cluster merged = Cluster();
+            for (int s = 0; s < used; s++) {
+                for (int a = 0; a < 3; a++) merged.sum[a] += partial[s][c].sum[a];
+                merged.weight += partial[s][c].weight;
+            }
+            // An emptied cluster keeps its previous center
+            clusters[c] = merged;
+            if (merged.weight > 0) ClusterMean(merged, centers[c]);
+        }
+        if (moves == 0) break;
+    }
+    
+    // Drop clusters that ended up empty
+    clusters.erase(std::remove_if(clusters.begin(), clusters.end(),
+                                  [](const Cluster& c) { return c.weight <= 0; }),
+                   clusters.end());
+}
+
+} // namespace
+
+void ExtractDominantColors(const PixelView& view, const ExtractOptions& options,
+                           std::vector<DominantColor>& out) {
+    out.clear();
+    if (view.width <= 0 || view.height <= 0) return;
+    
+    int bits = options.bits >= 6 ? 6 : 5;
+    int count = std::max(1, std::min(options.count, kMaxExtractColors));
+    
+    std::vector<Bin> histogram;
+    BuildHistogram(view, bits, options.threads, histogram);
+    
+    // One OKLab point per occupied bin, at the mean color of its pixels
+    std::vector<WeightedPoint> points;
+    double total = 0;
+    for (const Bin& bin : histogram) {
+        if (bin.count == 0) continue;
+        uint64_t half = bin.count / 2;
+        Color mean = MakeColor((int)((bin.r + half) / bin.count), (int)((bin.g + half) / bin.count),
+                               (int)((bin.b + half) / bin.count));
+        OKLabValue lab = ColorToOKLab(mean);
+        WeightedPoint p = {{lab.l, lab.a, lab.b}, (double)bin.count};
+        points.push_back(p);
+        total += (double)bin.count;
+    }
+    
+    std::vector<Cluster> clusters;
+    MedianCut(points, count, clusters);
+    if (options.method == ExtractMethod::KMeans) {
+        KMeans(points, options.iterations, options.threads, clusters);
+    }
+    
+    // Clusters can land on the same 8-bit color; merge those
+    for (const Cluster& c : clusters) {
+        float mean[3];
+        ClusterMean(c, mean);
+        OKLabValue lab = {mean[0], mean[1], mean[2]};
+        Color color = OKLabToColor(lab);
+        float share = (float)(c.weight / total);
+        
+        bool merged = false;
+        for (DominantColor& d : out) {
+            if (d.color == color) {
+                d.share += share;
+                merged = true;
+                break;
+            }
+        }
+        if (!merged) {
+            DominantColor d = {color, share};
+            out.push_back(d);
+        }
+    }
+    std::sort(out.begin(), out.end(),
+              [](const DominantColor& x, const DominantColor& y) { return x.share > y.share; });
+}
+
+const char* ExtractMethodName(ExtractMethod method) {
+    switch (method) {
+        case ExtractMethod::MedianCut:  return "mediancut";
+        case ExtractMethod::KMeans:     return "kmeans";
+    }
+    return "";
+}
+
+bool ParseExtractMethod(const char* name, ExtractMethod& method) {
+    if (strcmp(name, "mediancut") == 0) {
+        method = ExtractMethod::MedianCut;
+    } else if (strcmp(name, "kmeans") == 0) {
+        method = ExtractMethod::KMeans;
+    } else {
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+// Dominant-color extraction for screen regions and image files. Pixels are
+// first reduced to a 15- or 18-bit histogram (built in parallel), so the
+// clustering itself only ever sees a few thousand weighted OKLab points.
+
+#include <vector>
+
+#include "color_core.h"
+
+enum class ExtractMethod {
+    MedianCut,      // recursive weighted-median splits, deterministic
+    KMeans          // median cut refined by weighted Lloyd iterations
+};
+
+struct ExtractOptions {
+    int count = 8;                  // colors wanted, 1-64
+    ExtractMethod method = ExtractMethod::KMeans;
+    int bits = 5;                   // histogram bits per channel, 5 or 6
+    int iterations = 16;            // k-means passes at most
+    int threads = 0;                // 0 = one per core
+};
+
+struct DominantColor {
+    Color color;
+    float share;                    // fraction of the pixels, 0-1
+};
+
+const int kMaxExtractColors = 64;
+
+// Fills `out` with up to options.count colors, most common first. Fewer are
+// returned when the region holds fewer distinct histogram bins.
+void ExtractDominantColors(const PixelView& view, const ExtractOptions& options,
+                           std::vector<DominantColor>& out);
+
+const char* ExtractMethodName(ExtractMethod method);
+bool ParseExtractMethod(const char* name, ExtractMethod& method);
@@ -0,0 +1,620 @@
+#include "color_parse.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "color_spaces.h"
+
+// SSE2 is part of every x86-64 CPU, so the scanner uses it without runtime
+// dispatch; 32-bit builds get it when the compiler targets SSE2.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define COLOR_PARSE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+const double kPi = 3.14159265358979323846;
+
+// Character classes for the scanner and the number parser
+enum : uint8_t {
+    kIdent = 1,     // letter, digit, '-' or '_': continues a name or number
+    kSpace = 2,
+    kStop = 4       // the scanner has to look closer: # ( : ; { }
+};
+
+struct CharTable {
+    uint8_t cls[256];
+    int8_t hex[256];        // digit value, -1 if not a hex digit
+};
+
+constexpr CharTable MakeCharTable() {
+    CharTable t = {};
+    for (int c = 0; c < 256; c++) {
+        bool digit = c >= '0' && c <= '9';
+        bool lower = c >= 'a' && c <= 'z';
+        bool upper = c >= 'A' && c <= 'Z';
+        if (digit || lower || upper || c == '-' || c == '_') t.cls[c] |= kIdent;
+        if (c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f') t.cls[c] |= kSpace;
+        if (c == '#' || c == '(' || c == ':' || c == ';' || c == '{' || c == '}') t.cls[c] |= kStop;
+        t.hex[c] = (int8_t)(digit ? c - '0' : lower && c <= 'f' ? c - 'a' + 10 : upper && c <= 'F' ? c - 'A' + 10 : -1);
+    }
+    return t;
+}
+
+constexpr CharTable g_chars = MakeCharTable();
+
+inline bool IsIdent(char c) {
+    return (g_chars.cls[(uint8_t)c] & kIdent) != 0;
+}
+
+inline bool IsSpace(char c) {
+    return (g_chars.cls[(uint8_t)c] & kSpace) != 0;
+}
+
+inline bool IsDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+inline int HexDigit(char c) {
+    return g_chars.hex[(uint8_t)c];
+}
+
+inline char Lower(char c) {
+    return c >= 'A' && c <= 'Z' ? (char)(c - 'A' + 'a') : c;
+}
+
+const char* SkipSpace(const char* p, const char* end) {
+    while (p < end && IsSpace(*p)) p++;
+    return p;
+}
+
+// Length of `word` if it starts at p, case-insensitively, as a whole name
+size_t MatchWord(const char* p, const char* end, const char* word) {
+    size_t n = strlen(word);
+    if ((size_t)(end - p) < n) return 0;
+    for (size_t i = 0; i < n; i++) {
+        if (Lower(p[i]) != word[i]) return 0;
+    }
+    return p + n < end && IsIdent(p[n]) ? 0 : n;
+}
+
+const double kPow10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// CSS <number>: sign, digits with an optional fraction, optional exponent.
+// Without strtod, so the locale never matters. Digits past the 18th only
+// scale the value, far below what an 8-bit channel can tell apart.
+size_t ParseNumber(const char* p, const char* end, double& value) {
+    const char* start = p;
+    bool negative = false;
+    if (p < end && (*p == '+' || *p == '-')) {
+        negative = *p == '-';
+        p++;
+    }
+    
+    const uint64_t kMantissaLimit = 100000000000000000ull;
+    uint64_t mantissa = 0;
+    int exponent = 0;
+    int digits = 0;
+    for (; p < end && IsDigit(*p); p++, digits++) {
+        if (mantissa < kMantissaLimit) {
+            mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+        } else {
+            exponent++;
+        }
+    }
+    if (p + 1 < end && *p == '.' && IsDigit(p[1])) {
+        for (p++; p < end && IsDigit(*p); p++, digits++) {
+            if (mantissa < kMantissaLimit) {
+                mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+                exponent--;
+            }
+        }
+    }
+    if (digits == 0) return 0;
+    
+    // An 'e' only starts an exponent when digits follow; "1em" is a unit
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        const char* q = p + 1;
+        bool negativeExponent = false;
+        if (q < end && (*q == '+' || *q == '-')) {
+            negativeExponent = *q == '-';
+            q++;
+        }
+        if (q < end && IsDigit(*q)) {
+            int e = 0;
+            for (; q < end && IsDigit(*q); q++) {
+                if (e < 10000) e = e * 10 + (*q - '0');
+            }
+            exponent += negativeExponent ? -e : e;
+            p = q;
+        }
+    }
+    
+    double v = (double)mantissa;
+    if (exponent < 0) {
+        v = exponent >= -22 ? v / kPow10[-exponent] : v * std::pow(10.0, exponent);
+    } else if (exponent > 0) {
+        v = exponent <= 22 ? v * kPow10[exponent] : v * std::pow(10.0, exponent);
+    }
+    value = negative ? -v : v;
+    return (size_t)(p - start);
+}
+
+enum class Unit {
+    Number,
+    Percent,
+    Angle,      // converted to degrees
+    None        // the "none" keyword, read as zero
+};
+
+struct Component {
+    double value;
+    Unit unit;
+};
+
+struct AngleUnit {
+    const char* name;
+    double degrees;
+};
+
+const AngleUnit kAngleUnits[] = {
+    {"deg", 1.0}, {"grad", 0.9}, {"rad", 180.0 / kPi}, {"turn", 360.0}
+};
+
+size_t ParseComponent(const char* p, const char* end, Component& c) {
+    if (p < end && Lower(*p) == 'n' && MatchWord(p, end, "none")) {
+        c.value = 0;
+        c.unit = Unit::None;
+        return 4;
+    }
+    
+    size_t n = ParseNumber(p, end, c.value);
+    if (n == 0) return 0;
+    const char* q = p + n;
+    c.unit = Unit::Number;
+    if (q < end && *q == '%') {
+        c.unit = Unit::Percent;
+        return n + 1;
+    }
+    
+    // The GUI shows "239 deg", so a space may come before an angle unit
+    const char* u = SkipSpace(q, end);
+    if (u == end || !IsIdent(*u) || IsDigit(*u)) return n;
+    for (const AngleUnit& angle : kAngleUnits) {
+        if (size_t len = MatchWord(u, end, angle.name)) {
+            c.value *= angle.degrees;
+            c.unit = Unit::Angle;
+            return (size_t)(u + len - p);
+        }
+    }
+    return q < end && IsIdent(*q) ? 0 : n;
+}
+
+// Three or four components up to and including the closing ')', or up to
+// the end of the text for a bare field. Commas between all of them is the
+// legacy syntax; otherwise whitespace, with '/' before the alpha.
+size_t ParseArguments(const char* p, const char* end, bool bare, Component* c, int& count) {
+    const char* start = p;
+    p = SkipSpace(p, end);
+    size_t n = ParseComponent(p, end, c[0]);
+    if (n == 0) return 0;
+    p = SkipSpace(p + n, end);
+    bool legacy = p < end && *p == ',';
+    
+    count = 1;
+    for (;;) {
+        p = SkipSpace(p, end);
+        if (bare ? p == end : p < end && *p == ')') break;
+        if (p == end || count == 4) return 0;
+        if (legacy) {
+            if (*p != ',') return 0;
+            p++;
+        } else if (*p == '/') {
+            if (count != 3) return 0;
+            p++;
+        } else if (count == 3 || *p == ',') {
+            return 0;
+        }
+        p = SkipSpace(p, end);
+        n = ParseComponent(p, end, c[count]);
+        if (n == 0) return 0;
+        p += n;
+        count++;
+    }
+    if (count < 3) return 0;
+    return (size_t)(p + (bare ? 0 : 1) - start);
+}
+
+enum class Function {
+    RGB,
+    HSL,
+    OKLCh
+};
+
+// "rgb(" and the others; returns the length through the '('
+size_t ParseFunctionName(const char* p, const char* end, Function& fn) {
+    char name[8];
+    size_t n = 0;
+    while (p + n < end && n < sizeof(name) - 1 && IsIdent(p[n])) {
+        name[n] = Lower(p[n]);
+        n++;
+    }
+    if (p + n >= end || p[n] != '(') return 0;
+    name[n] = '\0';
+    
+    if (strcmp(name, "rgb") == 0 || strcmp(name, "rgba") == 0) {
+        fn = Function::RGB;
+    } else if (strcmp(name, "hsl") == 0 || strcmp(name, "hsla") == 0) {
+        fn = Function::HSL;
+    } else if (strcmp(name, "oklch") == 0) {
+        fn = Function::OKLCh;
+    } else {
+        return 0;
+    }
+    return n + 1;
+}
+
+inline double Clamp(double v, double lo, double hi) {
+    return v < lo ? lo : v > hi ? hi : v;
+}
+
+// Degrees in [0, 360); fmod is slow and rarely needed
+inline double WrapHue(double h) {
+    if (h >= 0 && h < 360.0) return h;
+    h = std::fmod(h, 360.0);
+    return h < 0 ? h + 360.0 : h;
+}
+
+inline int RoundByte(double v) {
+    return (int)(Clamp(v, 0.0, 255.0) + 0.5);
+}
+
+// Components to a color, clamping as CSS does. Percentages and angles are
+// rejected where the function has no use for them.
+bool Resolve(Function fn, const Component* c, int count, ParsedColor& color) {
+    for (int i = 0; i < count; i++) {
+        if (!std::isfinite(c[i].value)) return false;
+    }
+    
+    double alpha = 1.0;
+    if (count == 4) {
+        if (c[3].unit == Unit::Angle) return false;
+        alpha = c[3].unit == Unit::Percent ? c[3].value / 100.0 : c[3].value;
+    }
+    color.alpha = (uint8_t)RoundByte(alpha * 255.0);
+    
+    switch (fn) {
+        case Function::RGB: {
+            int v[3];
+            for (int i = 0; i < 3; i++) {
+                if (c[i].unit == Unit::Angle) return false;
+                v[i] = RoundByte(c[i].unit == Unit::Percent ? c[i].value * 255.0 / 100.0 : c[i].value);
+            }
+            color.color = MakeColor(v[0], v[1], v[2]);
+            return true;
+        }
+        case Function::HSL: {
+            // Saturation and lightness as bare numbers are percentages too
+            if (c[0].unit == Unit::Percent || c[1].unit == Unit::Angle || c[2].unit == Unit::Angle) return false;
+            color.color = HSLToColor((float)WrapHue(c[0].value),
+                                     (float)(Clamp(c[1].value, 0.0, 100.0) / 100.0),
+                                     (float)(Clamp(c[2].value, 0.0, 100.0) / 100.0));
+            return true;
+        }
+        case Function::OKLCh: {
+            // 100% is L = 1 and C = 0.4; chroma past 1 is far outside sRGB
+            if (c[0].unit == Unit::Angle || c[1].unit == Unit::Angle || c[2].unit == Unit::Percent) return false;
+            double l = c[0].unit == Unit::Percent ? c[0].value / 100.0 : c[0].value;
+            double chroma = c[1].unit == Unit::Percent ? c[1].value * 0.004 : c[1].value;
+            LChValue lch = {(float)Clamp(l, 0.0, 1.0), (float)Clamp(chroma, 0.0, 1.0),
+                            (float)WrapHue(c[2].value)};
+            color.color = OKLChToColor(lch);
+            return true;
+        }
+    }
+    return false;
+}
+
+// 3, 4, 6 or 8 hex digits, not followed by anything a name could continue
+// with; returns the digits consumed
+size_t ParseHexDigits(const char* p, const char* end, ParsedColor& color) {
+    int d[8];
+    size_t n = 0;
+    while (p + n < end && n < 8 && HexDigit(p[n]) >= 0) {
+        d[n] = HexDigit(p[n]);
+        n++;
+    }
+    if (p + n < end && IsIdent(p[n])) return 0;
+    
+    switch (n) {
+        case 3:
+        case 4:
+            color.color = MakeColor(d[0] * 17, d[1] * 17, d[2] * 17);
+            color.alpha = (uint8_t)(n == 4 ? d[3] * 17 : 255);
+            return n;
+        case 6:
+        case 8:
+            color.color = MakeColor(d[0] * 16 + d[1], d[2] * 16 + d[3], d[4] * 16 + d[5]);
+            color.alpha = (uint8_t)(n == 8 ? d[6] * 16 + d[7] : 255);
+            return n;
+    }
+    return 0;
+}
+
+// " / 0.502": alpha to three decimals, which is always enough to get the
+// same byte back
+void FormatAlpha(uint8_t alpha, char* out, size_t size) {
+    char digits[16];
+    snprintf(digits, sizeof(digits), "%.3f", alpha / 255.0);
+    size_t n = strlen(digits);
+    while (digits[n - 1] == '0') n--;
+    if (digits[n - 1] == '.') n--;
+    digits[n] = '\0';
+    snprintf(out, size, " / %s", digits);
+}
+
+// 1234 -> "123.4", 1230 -> "123"
+void FormatTenths(int v, char* out, size_t size) {
+    if (v % 10 == 0) {
+        snprintf(out, size, "%d", v / 10);
+    } else {
+        snprintf(out, size, "%d.%d", v / 10, v % 10);
+    }
+}
+
+// Index of the lowest set bit; v must not be zero
+inline int LowestBit(unsigned v) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctz(v);
+#else
+    int i = 0;
+    while (!(v & 1)) {
+        v >>= 1;
+        i++;
+    }
+    return i;
+#endif
+}
+
+// First byte at or after p the scanner has to look at, or end. Most of a
+// stylesheet is names and numbers, skipped 16 bytes per compare.
+const char* FindStop(const char* p, const char* end) {
+#if COLOR_PARSE_SSE2
+    const __m128i hash = _mm_set1_epi8('#');
+    const __m128i paren = _mm_set1_epi8('(');
+    const __m128i colon = _mm_set1_epi8(':');
+    const __m128i semicolon = _mm_set1_epi8(';');
+    const __m128i open = _mm_set1_epi8('{');
+    const __m128i close = _mm_set1_epi8('}');
+    for (; end - p >= 16; p += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)p);
+        __m128i hit = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, hash), _mm_cmpeq_epi8(v, paren)),
+                                   _mm_or_si128(_mm_cmpeq_epi8(v, colon), _mm_cmpeq_epi8(v, semicolon)));
+        hit = _mm_or_si128(hit, _mm_or_si128(_mm_cmpeq_epi8(v, open), _mm_cmpeq_epi8(v, close)));
+        unsigned mask = (unsigned)_mm_movemask_epi8(hit);
+        if (mask) return p + LowestBit(mask);
+    }
+#endif
+    while (p < end && !(g_chars.cls[(uint8_t)*p] & kStop)) p++;
+    return p;
+}
+
+// '#' only starts a value after a delimiter: not inside a name, a URL
+// fragment or an escaped string
+bool HexMayStart(const char* begin, const char* p) {
+    if (p == begin) return true;
+    char c = p[-1];
+    return IsSpace(c) || c == ':' || c == ',' || c == '(' || c == '"' || c == '\'' || c == '[' || c == '=';
+}
+
+// Whether a block prelude opens an at-rule whose block holds rules rather
+// than declarations. Comments before the at-keyword are skipped.
+bool OpensGroupRule(const char* p, const char* end) {
+    static const char* const kGroupRules[] = {"media", "supports", "layer", "container", "document", "scope"};
+    for (;;) {
+        p = SkipSpace(p, end);
+        if (end - p < 2 || p[0] != '/' || p[1] != '*') break;
+        const char* close = p + 2;
+        while (close + 1 < end && !(close[0] == '*' && close[1] == '/')) close++;
+        p = close + 2;
+    }
+    if (p >= end || *p != '@') return false;
+    p++;
+    for (const char* name : kGroupRules) {
+        size_t n = strlen(name);
+        if ((size_t)(end - p) >= n && strncmp(p, name, n) == 0 && (p + n == end || !IsIdent(p[n]))) return true;
+    }
+    return false;
+}
+
+} // namespace
+
+size_t ParseCssColor(const char* begin, const char* end, ParsedColor& color) {
+    if (begin >= end) return 0;
+    if (*begin == '#') {
+        size_t n = ParseHexDigits(begin + 1, end, color);
+        return n ? n + 1 : 0;
+    }
+    
+    Function fn;
+    size_t name = ParseFunctionName(begin, end, fn);
+    if (name == 0) return 0;
+    Component c[4];
+    int count = 0;
+    size_t args = ParseArguments(begin + name, end, false, c, count);
+    if (args == 0 || !Resolve(fn, c, count, color)) return 0;
+    return name + args;
+}
+
+bool ParseColorField(const char* text, CssSyntax syntax, ParsedColor& color) {
+    const char* end = text + strlen(text);
+    const char* begin = SkipSpace(text, end);
+    while (end > begin && IsSpace(end[-1])) end--;
+    if (begin == end) return false;
+    
+    size_t n = ParseCssColor(begin, end, color);
+    if (n) return begin + n == end;
+    
+    Component c[4];
+    int count = 0;
+    switch (syntax) {
+        case CssSyntax::Hex:
+            return ParseHexDigits(begin, end, color) == (size_t)(end - begin);
+        case CssSyntax::RGB:
+            return ParseArguments(begin, end, true, c, count) && Resolve(Function::RGB, c, count, color);
+        case CssSyntax::HSL:
+            return ParseArguments(begin, end, true, c, count) && Resolve(Function::HSL, c, count, color);
+        case CssSyntax::OKLCh:
+            return ParseArguments(begin, end, true, c, count) && Resolve(Function::OKLCh, c, count, color);
+    }
+    return false;
+}
+
+size_t FormatCssColor(const ParsedColor& color, CssSyntax syntax, char* out) {
+    char alpha[16] = "";
+    if (color.alpha < 255 && syntax != CssSyntax::Hex) {
+        FormatAlpha(color.alpha, alpha, sizeof(alpha));
+    }
+    
+    Color rgb = color.color;
+    int n = 0;
+    switch (syntax) {
+        case CssSyntax::Hex:
+            n = (int)FormatHex(rgb, out);
+            if (color.alpha < 255) {
+                n += snprintf(out + n, kCssBufferSize - n, "%02X", color.alpha);
+            }
+            break;
+        case CssSyntax::RGB:
+            n = snprintf(out, kCssBufferSize, "rgb(%d %d %d%s)", rgb.r, rgb.g, rgb.b, alpha);
+            break;
+        case CssSyntax::HSL: {
+            int h, s, l;
+            RGBtoHSLFixed<kHSLTenths>(rgb.r, rgb.g, rgb.b, h, s, l);
+            char hText[16], sText[16], lText[16];
+            FormatTenths(h, hText, sizeof(hText));
+            FormatTenths(s, sText, sizeof(sText));
+            FormatTenths(l, lText, sizeof(lText));
+            n = snprintf(out, kCssBufferSize, "hsl(%s %s%% %s%%%s)", hText, sText, lText, alpha);
+            break;
+        }
+        case CssSyntax::OKLCh: {
+            // Five decimals of chroma and two of hue are the least that
+            // bring every 8-bit color back unchanged. A gray has no hue;
+            // write 0 rather than rounding noise.
+            OKLabValue lab = ColorToOKLab(rgb);
+            LChValue lch = LabToLCh(lab.l, lab.a, lab.b);
+            bool gray = lch.c < 0.000005f;
+            float hue = gray || lch.h >= 359.995f ? 0.0f : lch.h;
+            n = snprintf(out, kCssBufferSize, "oklch(%.2f%% %.5f %.2f%s)", lch.l * 100.0f,
+                         gray ? 0.0f : lch.c, hue, alpha);
+            break;
+        }
+    }
+    return n < 0 ? 0 : (size_t)std::min(n, (int)kCssBufferSize - 1);
+}
+
+const char* CssSyntaxName(CssSyntax syntax) {
+    switch (syntax) {
+        case CssSyntax::Hex:   return "hex";
+        case CssSyntax::RGB:   return "rgb";
+        case CssSyntax::HSL:   return "hsl";
+        case CssSyntax::OKLCh: return "oklch";
+    }
+    return "unknown";
+}
+
+bool ParseCssSyntax(const char* name, CssSyntax& syntax) {
+    for (int i = 0; i < kCssSyntaxCount; i++) {
+        if (strcmp(name, CssSyntaxName((CssSyntax)i)) == 0) {
+            syntax = (CssSyntax)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+CssColorScanner::CssColorScanner(const char* begin, const char* end)
+    : m_begin(begin), m_end(end), m_pos(begin), m_prelude(begin),
+      m_flat(begin == end || !memchr(begin, '{', (size_t)(end - begin))), m_inValue(false), m_depth(0), m_groups(0) {}
+
+bool CssColorScanner::Next(CssMatch& match) {
+    for (const char* p = FindStop(m_pos, m_end); p < m_end; p = FindStop(p + 1, m_end)) {
+        const char* start = NULL;
+        switch (*p) {
+            case ':':
+                // Only in a declaration: anywhere in flat text, else in a
+                // block that is not a rule list (past depth 64, any block)
+                if (m_flat || (m_depth > 0 && (m_depth > 64 || !(m_groups >> (m_depth - 1) & 1)))) {
+                    m_inValue = true;
+                }
+                continue;
+            case '{':
+                if (m_depth < 64) {
+                    uint64_t bit = (uint64_t)1 << m_depth;
+                    m_groups = OpensGroupRule(m_prelude, p) ? m_groups | bit : m_groups & ~bit;
+                }
+                m_depth++;
+                m_inValue = false;
+                m_prelude = p + 1;
+                continue;
+            case '}':
+                m_depth = std::max(m_depth - 1, 0);
+                m_inValue = false;
+                m_prelude = p + 1;
+                continue;
+            case ';':
+                m_inValue = false;
+                m_prelude = p + 1;
+                continue;
+            case '#':
+                if (m_inValue && HexMayStart(m_begin, p)) start = p;
+                break;
+            case '(': {
+                // Back up over the function name, which must start a name
+                const char* q = p;
+                while (q > m_pos && p - q < 6 && IsIdent(q[-1])) q--;
+                if (q < p && (q == m_begin || !IsIdent(q[-1]))) start = q;
+                break;
+            }
+        }
+        if (!start) continue;
+        
+        size_t n = ParseCssColor(start, m_end, match.color);
+        if (n == 0) continue;
+        const char* after = start + n;
+        if (*start == '#') {
+            const char* next = SkipSpace(after, m_end);
+            if (next < m_end && *next == '{') continue;
+        }
+        match.begin = start;
+        match.end = after;
+        m_pos = after;
+        return true;
+    }
+    m_pos = m_end;
+    return false;
+}
+
+size_t ConvertCssColors(const char* begin, const char* end, CssSyntax syntax, FILE* out) {
+    CssColorScanner scanner(begin, end);
+    CssMatch match;
+    const char* copied = begin;
+    size_t count = 0;
+    char buffer[kCssBufferSize];
+    while (scanner.Next(match)) {
+        count++;
+        if (!out) continue;
+        size_t n = FormatCssColor(match.color, syntax, buffer);
+        fwrite(copied, 1, (size_t)(match.begin - copied), out);
+        fwrite(buffer, 1, n, out);
+        copied = match.end;
+    }
+    if (out) fwrite(copied, 1, (size_t)(end - copied), out);
+    return count;
+}
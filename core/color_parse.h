@@ -0,0 +1,82 @@
+#pragma once
+
+// CSS color syntax: parsing hex, rgb(), hsl() and oklch() literals and
+// formatting colors back into them. Parsing works in place on a
+// [begin, end) range and never allocates, so a whole stylesheet can be
+// mapped and scanned without a copy.
+
+#include <cstdio>
+
+#include "color_core.h"
+
+struct ParsedColor {
+    Color color;
+    uint8_t alpha;      // 255 when the literal gives none
+};
+
+enum class CssSyntax {
+    Hex,        // #6366F1, #6366F180 with alpha
+    RGB,        // rgb(99 102 241), rgb(99 102 241 / 0.502)
+    HSL,        // hsl(238.7 83.5% 66.7%), tenths so every 8-bit color round-trips
+    OKLCh       // oklch(58.54% 0.20406 277.12)
+};
+
+const int kCssSyntaxCount = 4;
+const size_t kCssBufferSize = 40;       // "oklch(100.00% 0.32250 359.99 / 0.502)"
+
+// Parses one literal at begin: #RGB, #RGBA, #RRGGBB, #RRGGBBAA, rgb() and
+// rgba(), hsl() and hsla() in both the comma and the space separated form,
+// and oklch(). Function names are case-insensitive; hues take deg, rad,
+// grad or turn; "none" reads as zero. Out of range values are clamped as
+// CSS clamps them. Returns the characters consumed, 0 if there is no valid
+// literal at begin.
+size_t ParseCssColor(const char* begin, const char* end, ParsedColor& color);
+
+// Text typed into a GUI field: a CSS literal, or the bare form the field
+// displays for `syntax` ("6366F1", "99, 102, 241", "239 deg, 84%, 67%").
+// Surrounding whitespace is ignored and anything else left over fails.
+bool ParseColorField(const char* text, CssSyntax syntax, ParsedColor& color);
+
+// Returns the length written, excluding the terminating NUL; out must hold
+// kCssBufferSize bytes. Alpha is written only when it is below 255.
+size_t FormatCssColor(const ParsedColor& color, CssSyntax syntax, char* out);
+
+// "hex", "rgb", "hsl", "oklch"
+const char* CssSyntaxName(CssSyntax syntax);
+bool ParseCssSyntax(const char* name, CssSyntax& syntax);
+
+struct CssMatch {
+    const char* begin;
+    const char* end;
+    ParsedColor color;
+};
+
+// Walks a stylesheet or token file literal by literal. Functions match
+// wherever a name can start. A hex literal only counts as a value: after a
+// ':' in the current declaration, after a delimiter, and not just before a
+// '{', so id selectors such as #add or #bed survive. In text with braces a
+// ':' only starts a value inside a declaration block, never in a selector
+// (.btn:hover #add) or in the prelude or rule list of @media and the like;
+// text without braces is a flat token list where every ':' does.
+class CssColorScanner {
+public:
+    CssColorScanner(const char* begin, const char* end);
+    
+    // False once the text is exhausted
+    bool Next(CssMatch& match);
+
+private:
+    const char* m_begin;
+    const char* m_end;
+    const char* m_pos;
+    const char* m_prelude;  // just after the last ';', '{' or '}'
+    bool m_flat;            // no '{' anywhere
+    bool m_inValue;         // a ':' seen in a declaration since the last ';', '{' or '}'
+    int m_depth;            // open blocks
+    uint64_t m_groups;      // bit d: the block at depth d + 1 holds rules, not declarations
+};
+
+// Copies [begin, end) to out with every literal the scanner finds
+// rewritten in `syntax`; returns how many were rewritten. out may be NULL
+// to only count them.
+size_t ConvertCssColors(const char* begin, const char* end, CssSyntax syntax, FILE* out);
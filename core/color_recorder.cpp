@@ -0,0 +1,350 @@
+#include "color_recorder.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <system_error>
+
+#include "capture_worker.h"
+#include "mapped_file.h"
+
+namespace {
+
+const char kFileMagic[4] = {'X', 'C', 'P', 'R'};
+const char kBlockMagic[4] = {'X', 'C', 'P', 'B'};
+const uint32_t kFileVersion = 1;
+const size_t kFileHeaderSize = 32;
+const size_t kBlockHeaderSize = 16;
+const size_t kBytesPerSample = 4 + 4 + 4 + 3;
+
+// Sleeps shorter than this are spun out instead, so sub-millisecond
+// intervals hold even where the system timer ticks every 15.6 ms
+const uint64_t kSpinUs = 2000;
+
+uint64_t WallClockMicros() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+std::chrono::steady_clock::time_point SteadyTime(uint64_t us) {
+    return std::chrono::steady_clock::time_point(std::chrono::microseconds(us));
+}
+
+template <typename T>
+T ReadAt(const uint8_t* p) {
+    T value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+} // namespace
+
+ColorRecorder::ColorRecorder(ScreenSource* source)
+    : m_source(source), m_file(NULL), m_startUs(0), m_stopCapture(false), m_stopWriter(false),
+      m_counters() {
+}
+
+ColorRecorder::~ColorRecorder() {
+    Stop();
+}
+
+bool ColorRecorder::Start(const char* path, const RecordOptions& options, std::string& error) {
+    if (IsRecording()) {
+        error = "already recording";
+        return false;
+    }
+    
+    m_file = fopen(path, "wb");
+    if (!m_file) {
+        error = std::string("cannot create ") + path;
+        return false;
+    }
+    
+    uint8_t header[kFileHeaderSize] = {};
+    uint32_t blockSamples = kRecordBlockSamples;
+    uint64_t startUnixUs = WallClockMicros();
+    memcpy(header, kFileMagic, 4);
+    memcpy(header + 4, &kFileVersion, 4);
+    memcpy(header + 8, &blockSamples, 4);
+    memcpy(header + 16, &startUnixUs, 8);
+    if (fwrite(header, 1, sizeof(header), m_file) != sizeof(header)) {
+        fclose(m_file);
+        m_file = NULL;
+        error = std::string("cannot write ") + path;
+        return false;
+    }
+    
+    // Every block starts out free; the full queue is empty after Stop
+    m_arena.resize(kRecordArenaBlocks);
+    int block;
+    while (m_free.TryPop(block)) {
+    }
+    for (int i = 0; i < kRecordArenaBlocks; i++) {
+        m_arena[i].count = 0;
+        m_free.TryPush(i);
+    }
+    
+    m_options = options;
+    m_counters = RecordCounters();
+    m_counters.bytes = sizeof(header);
+    m_stopCapture = false;
+    m_stopWriter = false;
+    m_startUs = NowMicros();
+    try {
+        m_writerThread = std::thread(&ColorRecorder::Write, this);
+        m_captureThread = std::thread(&ColorRecorder::Capture, this);
+    } catch (const std::system_error&) {
+        if (m_writerThread.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stopWriter = true;
+            }
+            m_writerWake.notify_one();
+            m_writerThread.join();
+        }
+        fclose(m_file);
+        m_file = NULL;
+        error = "cannot start the recording threads";
+        return false;
+    }
+    return true;
+}
+
+void ColorRecorder::Stop() {
+    if (!IsRecording()) return;
+    
+    // The capture thread hands over its partial block before it exits
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopCapture = true;
+    }
+    m_captureWake.notify_one();
+    m_captureThread.join();
+    
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopWriter = true;
+    }
+    m_writerWake.notify_one();
+    m_writerThread.join();
+    
+    fclose(m_file);
+    m_file = NULL;
+}
+
+void ColorRecorder::Submit(int block) {
+    // The arena has no more blocks than the queue holds, so this cannot fail
+    m_full.TryPush(block);
+    // Taking the lock orders the push before a waiting writer's predicate check
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+    }
+    m_writerWake.notify_one();
+}
+
+void ColorRecorder::Capture() {
+    const CaptureRect rect = RectAround(m_options.x, m_options.y, m_options.radius);
+    const uint64_t flushUs = (uint64_t)m_options.flushMs * 1000;
+    uint64_t next = NowMicros();
+    uint64_t lastSubmit = next;
+    int current = -1;
+    
+    while (!m_stopCapture) {
+        if (current < 0) m_free.TryPop(current);
+        
+        uint64_t now = NowMicros();
+        uint64_t elapsed = now - m_startUs;
+        // Offsets are 32-bit; a block spanning more than about 71 minutes
+        // goes out early rather than wrap
+        if (current >= 0 && m_arena[current].count > 0 && elapsed - m_arena[current].baseUs > UINT32_MAX) {
+            Submit(current);
+            current = -1;
+            lastSubmit = now;
+            m_free.TryPop(current);
+        }
+        
+        PixelView view;
+        if (!m_source->Capture(rect, view)) {
+            m_counters.failedCaptures++;
+        } else if (current < 0) {
+            m_counters.dropped++;
+        } else {
+            Block& block = m_arena[current];
+            if (block.count == 0) block.baseUs = elapsed;
+            
+            Color color = ReduceRegion(view, m_options.reducer);
+            int i = block.count++;
+            block.offsetUs[i] = (uint32_t)(elapsed - block.baseUs);
+            block.x[i] = m_options.x;
+            block.y[i] = m_options.y;
+            block.r[i] = color.r;
+            block.g[i] = color.g;
+            block.b[i] = color.b;
+            m_counters.samples++;
+        }
+        
+        // Hand over full blocks, and partial ones often enough to bound data loss
+        if (current >= 0 && (m_arena[current].count == kRecordBlockSamples ||
+                             (m_arena[current].count > 0 && now - lastSubmit >= flushUs))) {
+            Submit(current);
+            current = -1;
+            lastSubmit = now;
+        }
+        
+        // Fixed rate; after a stall, carry on from now rather than burst to catch up
+        next += m_options.intervalUs;
+        if (next < now) next = now;
+        if (next > now + kSpinUs) {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_captureWake.wait_until(lock, SteadyTime(next - kSpinUs), [this] { return m_stopCapture.load(); });
+        }
+        while (!m_stopCapture && NowMicros() < next) {
+            std::this_thread::yield();
+        }
+    }
+    
+    if (current >= 0 && m_arena[current].count > 0) {
+        Submit(current);
+    }
+}
+
+bool ColorRecorder::WriteBlock(const Block& block) {
+    uint8_t header[kBlockHeaderSize];
+    uint32_t count = (uint32_t)block.count;
+    memcpy(header, kBlockMagic, 4);
+    memcpy(header + 4, &count, 4);
+    memcpy(header + 8, &block.baseUs, 8);
+    
+    size_t n = (size_t)block.count;
+    bool ok = fwrite(header, 1, sizeof(header), m_file) == sizeof(header) &&
+              fwrite(block.offsetUs, sizeof(uint32_t), n, m_file) == n &&
+              fwrite(block.x, sizeof(int32_t), n, m_file) == n &&
+              fwrite(block.y, sizeof(int32_t), n, m_file) == n &&
+              fwrite(block.r, 1, n, m_file) == n &&
+              fwrite(block.g, 1, n, m_file) == n &&
+              fwrite(block.b, 1, n, m_file) == n;
+    if (ok) {
+        m_counters.blocks++;
+        m_counters.bytes += sizeof(header) + n * kBytesPerSample;
+    } else {
+        m_counters.writeErrors++;
+    }
+    return ok;
+}
+
+void ColorRecorder::Write() {
+    for (;;) {
+        int block;
+        bool wrote = false;
+        while (m_full.TryPop(block)) {
+            WriteBlock(m_arena[block]);
+            m_arena[block].count = 0;
+            m_free.TryPush(block);
+            wrote = true;
+        }
+        if (wrote) fflush(m_file);
+        
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_writerWake.wait(lock, [this] { return m_stopWriter || !m_full.Empty(); });
+        if (m_stopWriter && m_full.Empty()) break;
+    }
+}
+
+bool ReadRecording(const char* path, Recording& recording, std::string& error) {
+    MappedFile file;
+    if (!file.Open(path, error)) return false;
+    
+    const uint8_t* data = file.Data();
+    size_t size = file.Size();
+    if (size < kFileHeaderSize || memcmp(data, kFileMagic, 4) != 0) {
+        error = std::string(path) + ": not a color recording";
+        return false;
+    }
+    uint32_t version = ReadAt<uint32_t>(data + 4);
+    uint32_t blockSamples = ReadAt<uint32_t>(data + 8);
+    if (version != kFileVersion || blockSamples == 0) {
+        error = std::string(path) + ": unsupported recording version";
+        return false;
+    }
+    
+    recording = Recording();
+    recording.startUnixUs = ReadAt<uint64_t>(data + 16);
+    size_t expected = (size - kFileHeaderSize) / kBytesPerSample;
+    recording.timeUs.reserve(expected);
+    recording.x.reserve(expected);
+    recording.y.reserve(expected);
+    recording.r.reserve(expected);
+    recording.g.reserve(expected);
+    recording.b.reserve(expected);
+    
+    size_t offset = kFileHeaderSize;
+    while (size - offset >= kBlockHeaderSize) {
+        const uint8_t* p = data + offset;
+        uint32_t count = ReadAt<uint32_t>(p + 4);
+        if (memcmp(p, kBlockMagic, 4) != 0 || count == 0 || count > blockSamples ||
+            (size - offset - kBlockHeaderSize) / kBytesPerSample < count) {
+            break;
+        }
+        uint64_t base = ReadAt<uint64_t>(p + 8);
+        p += kBlockHeaderSize;
+        
+        for (uint32_t i = 0; i < count; i++) {
+            recording.timeUs.push_back(base + ReadAt<uint32_t>(p + i * 4));
+        }
+        p += count * 4;
+        size_t first = recording.x.size();
+        recording.x.resize(first + count);
+        recording.y.resize(first + count);
+        memcpy(&recording.x[first], p, count * 4);
+        memcpy(&recording.y[first], p + count * 4, count * 4);
+        p += count * 8;
+        recording.r.insert(recording.r.end(), p, p + count);
+        recording.g.insert(recording.g.end(), p + count, p + 2 * count);
+        recording.b.insert(recording.b.end(), p + 2 * count, p + 3 * count);
+        
+        offset += kBlockHeaderSize + count * kBytesPerSample;
+    }
+    return true;
+}
+
+void SummariseRecording(const Recording& recording, int threshold, RecordingStats& stats,
+                        std::vector<ColorChange>* changes, size_t maxChanges) {
+    stats = RecordingStats();
+    size_t n = recording.Size();
+    stats.samples = n;
+    if (n == 0) return;
+    
+    const std::vector<uint8_t>* channels[3] = {&recording.r, &recording.g, &recording.b};
+    ChannelStats* out[3] = {&stats.r, &stats.g, &stats.b};
+    for (int c = 0; c < 3; c++) {
+        const uint8_t* v = channels[c]->data();
+        uint8_t lo = 255;
+        uint8_t hi = 0;
+        uint64_t sum = 0;
+        for (size_t i = 0; i < n; i++) {
+            lo = v[i] < lo ? v[i] : lo;
+            hi = v[i] > hi ? v[i] : hi;
+            sum += v[i];
+        }
+        out[c]->min = lo;
+        out[c]->max = hi;
+        out[c]->mean = (float)((double)sum / n);
+    }
+    
+    stats.durationUs = recording.timeUs[n - 1] - recording.timeUs[0];
+    stats.rateHz = stats.durationUs > 0 ? (n - 1) * 1e6 / stats.durationUs : 0.0;
+    
+    for (size_t i = 1; i < n; i++) {
+        int dr = recording.r[i] - recording.r[i - 1];
+        int dg = recording.g[i] - recording.g[i - 1];
+        int db = recording.b[i] - recording.b[i - 1];
+        if (dr > threshold || -dr > threshold || dg > threshold || -dg > threshold ||
+            db > threshold || -db > threshold) {
+            if (changes && changes->size() < maxChanges) {
+                ColorChange change = {i, recording.timeUs[i], recording.ColorAt(i - 1), recording.ColorAt(i)};
+                changes->push_back(change);
+            }
+            stats.changes++;
+        }
+    }
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+// Time-series recording of one point (or a small region around it) for
+// checking animation easing and video color drift. A capture thread samples
+// at a fixed rate into a preallocated arena of column blocks; a writer
+// thread streams full blocks to disk, so no allocation or file I/O happens
+// between samples. Files are read back through a memory map.
+//
+// File layout: a 32-byte header, then blocks of up to kRecordBlockSamples
+// samples. Each block is a 16-byte header (magic, count, base timestamp)
+// followed by its columns: uint32 microseconds since the base, int32 x,
+// int32 y, then one byte per sample for each of r, g and b. A block is
+// closed early rather than span more than 2^32 microseconds.
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "color_sampling.h"
+#include "sample_ring.h"
+#include "screen_source.h"
+
+const int kRecordBlockSamples = 4096;
+const int kRecordArenaBlocks = 16;
+
+struct RecordOptions {
+    int x = 0;
+    int y = 0;
+    int radius = 0;                 // 0 = single pixel
+    SampleReducer reducer = SampleReducer::Mean;
+    int intervalUs = 1000;          // 1 kHz; 0 = as fast as capture allows
+    int flushMs = 250;              // partial blocks reach the disk at least this often
+};
+
+struct RecordCounters {
+    uint64_t samples;
+    uint64_t dropped;               // arena full because the disk fell behind
+    uint64_t failedCaptures;
+    uint64_t blocks;
+    uint64_t bytes;
+    uint64_t writeErrors;           // blocks that could not be written
+};
+
+class ColorRecorder {
+public:
+    // The source is only used by the capture thread while recording
+    explicit ColorRecorder(ScreenSource* source);
+    ~ColorRecorder();
+    
+    ColorRecorder(const ColorRecorder&) = delete;
+    ColorRecorder& operator=(const ColorRecorder&) = delete;
+    
+    // Creates (or truncates) the file and starts both threads
+    bool Start(const char* path, const RecordOptions& options, std::string& error);
+    // Writes the last partial block and closes the file
+    void Stop();
+    bool IsRecording() const { return m_captureThread.joinable(); }
+    
+    // Valid once Stop has returned
+    const RecordCounters& Counters() const { return m_counters; }
+
+private:
+    struct Block {
+        int count;
+        uint64_t baseUs;
+        uint32_t offsetUs[kRecordBlockSamples];
+        int32_t x[kRecordBlockSamples];
+        int32_t y[kRecordBlockSamples];
+        uint8_t r[kRecordBlockSamples];
+        uint8_t g[kRecordBlockSamples];
+        uint8_t b[kRecordBlockSamples];
+    };
+    
+    void Capture();
+    void Write();
+    void Submit(int block);
+    bool WriteBlock(const Block& block);
+    
+    ScreenSource* m_source;
+    RecordOptions m_options;
+    FILE* m_file;
+    uint64_t m_startUs;             // steady clock at Start
+    
+    std::vector<Block> m_arena;
+    SampleRing<int, kRecordArenaBlocks> m_full;     // capture -> writer
+    SampleRing<int, kRecordArenaBlocks> m_free;     // writer -> capture
+    
+    std::thread m_captureThread;
+    std::thread m_writerThread;
+    std::mutex m_mutex;
+    std::condition_variable m_captureWake;
+    std::condition_variable m_writerWake;
+    std::atomic<bool> m_stopCapture;
+    bool m_stopWriter;
+    
+    RecordCounters m_counters;
+};
+
+// A whole recording, one vector per column
+struct Recording {
+    uint64_t startUnixUs;           // wall clock when recording started
+    std::vector<uint64_t> timeUs;   // since the start
+    std::vector<int32_t> x;
+    std::vector<int32_t> y;
+    std::vector<uint8_t> r;
+    std::vector<uint8_t> g;
+    std::vector<uint8_t> b;
+    
+    size_t Size() const { return timeUs.size(); }
+    Color ColorAt(size_t i) const { return MakeColor(r[i], g[i], b[i]); }
+};
+
+// Reads every complete block; a block torn by a crash is dropped
+bool ReadRecording(const char* path, Recording& recording, std::string& error);
+
+struct ChannelStats {
+    uint8_t min;
+    uint8_t max;
+    float mean;
+};
+
+// A sample whose color differs from the previous one by more than the
+// threshold in any channel
+struct ColorChange {
+    size_t index;
+    uint64_t timeUs;
+    Color from;
+    Color to;
+};
+
+struct RecordingStats {
+    size_t samples;
+    uint64_t durationUs;
+    double rateHz;
+    ChannelStats r, g, b;
+    size_t changes;
+};
+
+// Summary over the whole recording. Change events are appended to `changes`
+// when it is not NULL, at most `maxChanges` of them; the count is exact.
+void SummariseRecording(const Recording& recording, int threshold, RecordingStats& stats,
+                        std::vector<ColorChange>* changes = NULL, size_t maxChanges = (size_t)-1);
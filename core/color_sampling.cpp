@@ -0,0 +1,146 @@
+#include "color_sampling.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+const int kMaxWindowPixels = (kMaxSampleRadius * 2 + 1) * (kMaxSampleRadius * 2 + 1);
+
+inline uint32_t Pack(Color c) {
+    return ((uint32_t)c.r << 16) | ((uint32_t)c.g << 8) | c.b;
+}
+
+inline Color Unpack(uint32_t v) {
+    return MakeColor((v >> 16) & 255, (v >> 8) & 255, v & 255);
+}
+
+// Visit every pixel row by row; rows are contiguous so this streams
+template <typename F>
+void ForEachPixel(const PixelView& view, F f) {
+    for (int y = 0; y < view.height; y++) {
+        const uint8_t* p = view.data + (size_t)y * view.stride;
+        if (view.format == PixelFormat::RGB24) {
+            for (int x = 0; x < view.width; x++, p += 3) f(p[0], p[1], p[2]);
+        } else {
+            for (int x = 0; x < view.width; x++, p += 4) f(p[2], p[1], p[0]);
+        }
+    }
+}
+
+Color ReduceMean(const PixelView& view) {
+    uint64_t sr = 0, sg = 0, sb = 0;
+    ForEachPixel(view, [&](uint8_t r, uint8_t g, uint8_t b) {
+        sr += r;
+        sg += g;
+        sb += b;
+    });
+    
+    uint64_t n = (uint64_t)view.width * view.height;
+    return MakeColor((int)((sr + n / 2) / n), (int)((sg + n / 2) / n), (int)((sb + n / 2) / n));
+}
+
+// Rank selection over 256-bin histograms: O(n + 256), no sorting
+Color ReduceMedian(const PixelView& view) {
+    uint32_t hr[256], hg[256], hb[256];
+    memset(hr, 0, sizeof(hr));
+    memset(hg, 0, sizeof(hg));
+    memset(hb, 0, sizeof(hb));
+    
+    ForEachPixel(view, [&](uint8_t r, uint8_t g, uint8_t b) {
+        hr[r]++;
+        hg[g]++;
+        hb[b]++;
+    });
+    
+    uint32_t rank = ((uint32_t)view.width * view.height - 1) / 2;
+    int result[3];
+    const uint32_t* hist[3] = {hr, hg, hb};
+    for (int c = 0; c < 3; c++) {
+        uint32_t seen = 0;
+        int v = 0;
+        while (seen + hist[c][v] <= rank) {
+            seen += hist[c][v];
+            v++;
+        }
+        result[c] = v;
+    }
+    return MakeColor(result[0], result[1], result[2]);
+}
+
+Color ReduceMode(const PixelView& view) {
+    size_t n = (size_t)view.width * view.height;
+    uint32_t local[kMaxWindowPixels];
+    std::vector<uint32_t> heap;
+    uint32_t* values = local;
+    if (n > (size_t)kMaxWindowPixels) {
+        heap.resize(n);
+        values = heap.data();
+    }
+    
+    size_t i = 0;
+    ForEachPixel(view, [&](uint8_t r, uint8_t g, uint8_t b) {
+        values[i++] = Pack(MakeColor(r, g, b));
+    });
+    uint32_t center = Pack(PixelAt(view, view.width / 2, view.height / 2));
+    
+    std::sort(values, values + n);
+    
+    uint32_t best = values[0];
+    size_t bestCount = 0;
+    size_t centerCount = 0;
+    for (size_t start = 0; start < n;) {
+        size_t end = start + 1;
+        while (end < n && values[end] == values[start]) end++;
+        size_t count = end - start;
+        if (count > bestCount) {
+            best = values[start];
+            bestCount = count;
+        }
+        if (values[start] == center) {
+            centerCount = count;
+        }
+        start = end;
+    }
+    
+    return Unpack(centerCount == bestCount ? center : best);
+}
+
+} // namespace
+
+Color ReduceRegion(const PixelView& view, SampleReducer reducer) {
+    if (view.width <= 0 || view.height <= 0) {
+        return MakeColor(0, 0, 0);
+    }
+    if (view.width == 1 && view.height == 1) {
+        return PixelAt(view, 0, 0);
+    }
+    
+    switch (reducer) {
+        case SampleReducer::Median: return ReduceMedian(view);
+        case SampleReducer::Mode: return ReduceMode(view);
+        default: return ReduceMean(view);
+    }
+}
+
+const char* SampleReducerName(SampleReducer reducer) {
+    switch (reducer) {
+        case SampleReducer::Median: return "median";
+        case SampleReducer::Mode: return "mode";
+        default: return "mean";
+    }
+}
+
+bool ParseSampleReducer(const char* name, SampleReducer& reducer) {
+    if (strcmp(name, "mean") == 0) {
+        reducer = SampleReducer::Mean;
+    } else if (strcmp(name, "median") == 0) {
+        reducer = SampleReducer::Median;
+    } else if (strcmp(name, "mode") == 0) {
+        reducer = SampleReducer::Mode;
+    } else {
+        return false;
+    }
+    return true;
+}
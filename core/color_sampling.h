@@ -0,0 +1,19 @@
+#pragma once
+
+// Reducers that turn a captured neighbourhood into one picked color
+
+#include "color_core.h"
+
+enum class SampleReducer {
+    Mean,       // per-channel average, rounded
+    Median,     // per-channel median (lower median for even counts)
+    Mode        // most frequent exact color; ties prefer the centre pixel
+};
+
+// Pick radius 0 is a single pixel, 15 is a 31x31 window
+const int kMaxSampleRadius = 15;
+
+Color ReduceRegion(const PixelView& view, SampleReducer reducer);
+
+const char* SampleReducerName(SampleReducer reducer);
+bool ParseSampleReducer(const char* name, SampleReducer& reducer);
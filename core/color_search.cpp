@@ -0,0 +1,474 @@
+#include "color_search.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "parallel.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define COLOR_SEARCH_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define COLOR_SEARCH_TARGET(x) __attribute__((target(x)))
+#else
+#define COLOR_SEARCH_TARGET(x)
+#endif
+
+namespace {
+
+// Rows per unit of parallel work; small enough to balance uneven bands
+const int kBandRows = 64;
+
+// Up to this many distinct targets are compared directly
+const int kCompareTargets = 8;
+
+const int kCacheSize = 4096;
+
+// Pixels are compared as 0xRRGGBB keys: the low three bytes of a BGRA32
+// pixel read little-endian, or built from RGB24 bytes one row at a time
+const uint32_t kKeyMask = 0x00FFFFFF;
+
+inline uint32_t LoadKey(const uint8_t* p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v & kKeyMask;
+}
+
+inline uint32_t ColorKey(Color c) {
+    return ((uint32_t)c.r << 16) | ((uint32_t)c.g << 8) | c.b;
+}
+
+inline uint32_t HashKey(uint32_t key) {
+    return key * 2654435761u;
+}
+
+// A horizontal run of pixels with the same label, [x0, x1)
+struct Run {
+    int x0;
+    int x1;
+    int label;      // target + 1
+};
+
+// What the label kernels read, built once per search
+struct SearchTables {
+    // Exact, few targets: the distinct keys and their labels
+    int compareCount = 0;
+    uint32_t compareKeys[kCompareTargets];
+    uint32_t compareLabels[kCompareTargets];
+    
+    // Exact, many targets: one bit per 24-bit key, then an open-addressed
+    // table from key to label that every set bit is guaranteed to be in
+    std::vector<uint32_t> bits;
+    std::vector<uint32_t> hashKeys;
+    std::vector<uint16_t> hashLabels;
+    int hashShift = 0;
+    uint32_t hashMask = 0;
+    
+    // Tolerance: the distinct targets as a palette, and their labels
+    Palette palette;
+    std::vector<uint16_t> paletteLabels;
+    float tolerance = 0.0f;
+    PaletteMetric metric = PaletteMetric::DeltaE2000;
+};
+
+// Per-worker buffers, reused from band to band
+struct Scratch {
+    std::vector<uint32_t> keys;         // RGB24 rows as keys
+    std::vector<uint16_t> labels;
+    std::vector<uint32_t> cacheKeys;    // tolerance searches only
+    std::vector<uint16_t> cacheLabels;
+};
+
+inline int TableLabel(const SearchTables& t, uint32_t key) {
+    if (!((t.bits[key >> 5] >> (key & 31)) & 1)) return 0;
+    uint32_t slot = HashKey(key) >> t.hashShift;
+    while (t.hashKeys[slot] != key) {
+        slot = (slot + 1) & t.hashMask;
+    }
+    return t.hashLabels[slot];
+}
+
+// Kernels label one row of 4-byte keys and return whether any matched
+typedef bool (*LabelKernel)(const uint8_t* row, int width, const SearchTables& t, uint16_t* labels);
+
+bool LabelCompareScalar(const uint8_t* row, int width, const SearchTables& t, uint16_t* labels) {
+    bool any = false;
+    for (int x = 0; x < width; x++) {
+        uint32_t key = LoadKey(row + x * 4);
+        uint32_t label = 0;
+        for (int i = 0; i < t.compareCount; i++) {
+            if (key == t.compareKeys[i]) label = t.compareLabels[i];
+        }
+        labels[x] = (uint16_t)label;
+        any |= label != 0;
+    }
+    return any;
+}
+
+// Neighbouring pixels mostly repeat a color, so the last lookup is kept
+bool LabelTableScalar(const uint8_t* row, int width, const SearchTables& t, uint16_t* labels) {
+    bool any = false;
+    uint32_t lastKey = 0xFFFFFFFFu;
+    int lastLabel = 0;
+    for (int x = 0; x < width; x++) {
+        uint32_t key = LoadKey(row + x * 4);
+        if (key != lastKey) {
+            lastKey = key;
+            lastLabel = TableLabel(t, key);
+        }
+        labels[x] = (uint16_t)lastLabel;
+        any |= lastLabel != 0;
+    }
+    return any;
+}
+
+#if COLOR_SEARCH_X86
+
+// Targets are distinct, so at most one compare per lane is true and OR-ing
+// the masked labels selects it. Labels fit a signed 16-bit pack.
+
+COLOR_SEARCH_TARGET("sse2")
+bool LabelCompareSSE2(const uint8_t* row, int width, const SearchTables& t, uint16_t* labels) {
+    const __m128i mask = _mm_set1_epi32((int)kKeyMask);
+    const __m128i zero = _mm_setzero_si128();
+    __m128i keys[kCompareTargets];
+    __m128i values[kCompareTargets];
+    for (int i = 0; i < t.compareCount; i++) {
+        keys[i] = _mm_set1_epi32((int)t.compareKeys[i]);
+        values[i] = _mm_set1_epi32((int)t.compareLabels[i]);
+    }
+    
+    __m128i any = zero;
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m128i k0 = _mm_and_si128(_mm_loadu_si128((const __m128i*)(row + x * 4)), mask);
+        __m128i k1 = _mm_and_si128(_mm_loadu_si128((const __m128i*)(row + x * 4 + 16)), mask);
+        __m128i l0 = zero;
+        __m128i l1 = zero;
+        for (int i = 0; i < t.compareCount; i++) {
+            l0 = _mm_or_si128(l0, _mm_and_si128(_mm_cmpeq_epi32(k0, keys[i]), values[i]));
+            l1 = _mm_or_si128(l1, _mm_and_si128(_mm_cmpeq_epi32(k1, keys[i]), values[i]));
+        }
+        __m128i packed = _mm_packs_epi32(l0, l1);
+        _mm_storeu_si128((__m128i*)(labels + x), packed);
+        any = _mm_or_si128(any, packed);
+    }
+    bool tail = LabelCompareScalar(row + x * 4, width - x, t, labels + x);
+    return tail || _mm_movemask_epi8(_mm_cmpeq_epi16(any, zero)) != 0xFFFF;
+}
+
+COLOR_SEARCH_TARGET("avx2")
+bool LabelCompareAVX2(const uint8_t* row, int width, const SearchTables& t, uint16_t* labels) {
+    const __m256i mask = _mm256_set1_epi32((int)kKeyMask);
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i keys[kCompareTargets];
+    __m256i values[kCompareTargets];
+    for (int i = 0; i < t.compareCount; i++) {
+        keys[i] = _mm256_set1_epi32((int)t.compareKeys[i]);
+        values[i] = _mm256_set1_epi32((int)t.compareLabels[i]);
+    }
+    
+    __m256i any = zero;
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m256i k = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)(row + x * 4)), mask);
+        __m256i l = zero;
+        for (int i = 0; i < t.compareCount; i++) {
+            l = _mm256_or_si256(l, _mm256_and_si256(_mm256_cmpeq_epi32(k, keys[i]), values[i]));
+        }
+        __m128i packed = _mm_packs_epi32(_mm256_castsi256_si128(l), _mm256_extracti128_si256(l, 1));
+        _mm_storeu_si128((__m128i*)(labels + x), packed);
+        any = _mm256_or_si256(any, l);
+    }
+    bool tail = LabelCompareScalar(row + x * 4, width - x, t, labels + x);
+    return tail || !_mm256_testz_si256(any, any);
+}
+
+// Eight bit tests per gather; most blocks match nothing and are done there
+COLOR_SEARCH_TARGET("avx2")
+bool LabelTableAVX2(const uint8_t* row, int width, const SearchTables& t, uint16_t* labels) {
+    const __m256i mask = _mm256_set1_epi32((int)kKeyMask);
+    const __m256i low5 = _mm256_set1_epi32(31);
+    const __m256i one = _mm256_set1_epi32(1);
+    const int* bits = (const int*)t.bits.data();
+    
+    bool any = false;
+    uint32_t lastKey = 0xFFFFFFFFu;
+    int lastLabel = 0;
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m256i k = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)(row + x * 4)), mask);
+        __m256i word = _mm256_i32gather_epi32(bits, _mm256_srli_epi32(k, 5), 4);
+        __m256i bit = _mm256_sllv_epi32(one, _mm256_and_si256(k, low5));
+        __m256i hit = _mm256_cmpeq_epi32(_mm256_and_si256(word, bit), bit);
+        int lanes = _mm256_movemask_ps(_mm256_castsi256_ps(hit));
+        if (lanes == 0) {
+            _mm_storeu_si128((__m128i*)(labels + x), _mm_setzero_si128());
+            continue;
+        }
+        
+        // Inside a flat area every hit repeats the last color found
+        any = true;
+        __m256i same = _mm256_cmpeq_epi32(k, _mm256_set1_epi32((int)lastKey));
+        if ((lanes & ~_mm256_movemask_ps(_mm256_castsi256_ps(same))) == 0) {
+            __m256i l = _mm256_and_si256(same, _mm256_set1_epi32(lastLabel));
+            _mm_storeu_si128((__m128i*)(labels + x),
+                             _mm_packs_epi32(_mm256_castsi256_si128(l), _mm256_extracti128_si256(l, 1)));
+            continue;
+        }
+        _mm_storeu_si128((__m128i*)(labels + x), _mm_setzero_si128());
+        for (int j = 0; j < 8; j++) {
+            if (!(lanes & (1 << j))) continue;
+            uint32_t key = LoadKey(row + (x + j) * 4);
+            if (key != lastKey) {
+                lastKey = key;
+                lastLabel = TableLabel(t, key);
+            }
+            labels[x + j] = (uint16_t)lastLabel;
+        }
+    }
+    bool tail = LabelTableScalar(row + x * 4, width - x, t, labels + x);
+    return tail || any;
+}
+
+#endif
+
+LabelKernel ExactKernel(bool compare) {
+    switch (GetSimdLevel()) {
+#if COLOR_SEARCH_X86
+        case SimdLevel::AVX2: return compare ? LabelCompareAVX2 : LabelTableAVX2;
+        case SimdLevel::SSE2: return compare ? LabelCompareSSE2 : LabelTableScalar;
+#endif
+        default: return compare ? LabelCompareScalar : LabelTableScalar;
+    }
+}
+
+uint16_t ToleranceLabel(const SearchTables& t, uint32_t key) {
+    Color c = MakeColor(key >> 16, (key >> 8) & 255, key & 255);
+    int index = t.palette.NearestWithin(c, t.metric, t.tolerance);
+    return index >= 0 ? t.paletteLabels[index] : 0;
+}
+
+// Runs of one color share a lookup, and a direct-mapped cache absorbs the
+// colors a screen repeats, so the palette index sees each color about once
+bool LabelTolerance(const uint8_t* row, int width, const SearchTables& t, Scratch& s, uint16_t* labels) {
+    bool any = false;
+    uint32_t lastKey = 0xFFFFFFFFu;
+    uint16_t lastLabel = 0;
+    for (int x = 0; x < width; x++) {
+        uint32_t key = LoadKey(row + x * 4);
+        if (key != lastKey) {
+            uint32_t slot = HashKey(key) >> 20;
+            if (s.cacheKeys[slot] != key) {
+                s.cacheKeys[slot] = key;
+                s.cacheLabels[slot] = ToleranceLabel(t, key);
+            }
+            lastKey = key;
+            lastLabel = s.cacheLabels[slot];
+        }
+        labels[x] = lastLabel;
+        any |= lastLabel != 0;
+    }
+    return any;
+}
+
+// Appends the row's runs and returns how many; both gaps and runs are
+// walked four labels per compare
+int AppendRuns(const uint16_t* labels, int width, std::vector<Run>& runs) {
+    size_t before = runs.size();
+    int x = 0;
+    while (x < width) {
+        uint64_t four;
+        if (x + 4 <= width && (memcpy(&four, labels + x, 8), four == 0)) {
+            x += 4;
+            continue;
+        }
+        int label = labels[x];
+        if (label == 0) {
+            x++;
+            continue;
+        }
+        uint64_t repeated = label * 0x0001000100010001ull;
+        int x0 = x;
+        while (x + 4 <= width && (memcpy(&four, labels + x, 8), four == repeated)) x += 4;
+        while (x < width && labels[x] == label) x++;
+        runs.push_back({x0, x, label});
+    }
+    return (int)(runs.size() - before);
+}
+
+int FindRoot(std::vector<int>& parent, int i) {
+    while (parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+void BuildTables(const std::vector<Color>& targets, const SearchOptions& options, SearchTables& t) {
+    // Distinct keys, each labelled with the first target that has it
+    std::vector<std::pair<uint32_t, int>> keyed(targets.size());
+    for (size_t i = 0; i < targets.size(); i++) {
+        keyed[i] = {ColorKey(targets[i]), (int)i};
+    }
+    std::sort(keyed.begin(), keyed.end());
+    keyed.erase(std::unique(keyed.begin(), keyed.end(),
+                            [](const std::pair<uint32_t, int>& a, const std::pair<uint32_t, int>& b) {
+                                return a.first == b.first;
+                            }), keyed.end());
+    
+    if (options.tolerance > 0) {
+        for (const std::pair<uint32_t, int>& k : keyed) {
+            t.palette.Add("", targets[k.second]);
+            t.paletteLabels.push_back((uint16_t)(k.second + 1));
+        }
+        t.palette.BuildIndex();
+        t.tolerance = options.tolerance;
+        t.metric = options.metric;
+        return;
+    }
+    
+    if (keyed.size() <= (size_t)kCompareTargets) {
+        t.compareCount = (int)keyed.size();
+        for (size_t i = 0; i < keyed.size(); i++) {
+            t.compareKeys[i] = keyed[i].first;
+            t.compareLabels[i] = (uint32_t)(keyed[i].second + 1);
+        }
+        return;
+    }
+    
+    t.bits.assign((size_t)1 << 19, 0);
+    int logSize = 1;
+    while (((size_t)1 << logSize) < keyed.size() * 2) logSize++;
+    t.hashShift = 32 - logSize;
+    t.hashMask = ((uint32_t)1 << logSize) - 1;
+    t.hashKeys.assign((size_t)1 << logSize, 0);
+    t.hashLabels.assign((size_t)1 << logSize, 0);
+    for (const std::pair<uint32_t, int>& k : keyed) {
+        uint32_t key = k.first;
+        t.bits[key >> 5] |= 1u << (key & 31);
+        uint32_t slot = HashKey(key) >> t.hashShift;
+        while (t.hashLabels[slot] != 0) {
+            slot = (slot + 1) & t.hashMask;
+        }
+        t.hashKeys[slot] = key;
+        t.hashLabels[slot] = (uint16_t)(k.second + 1);
+    }
+}
+
+} // namespace
+
+bool SearchColors(const PixelView& view, const std::vector<Color>& targets, const SearchOptions& options,
+                  std::vector<ColorMatch>& matches, SearchSummary* summary) {
+    matches.clear();
+    if (summary) *summary = SearchSummary();
+    if (targets.size() > (size_t)kMaxSearchTargets) return false;
+    if (targets.empty() || view.width <= 0 || view.height <= 0) return true;
+    
+    SearchTables tables;
+    BuildTables(targets, options, tables);
+    LabelKernel kernel = ExactKernel(tables.compareCount > 0);
+    bool tolerance = options.tolerance > 0;
+    
+    // Label bands of rows in parallel; each band keeps only its runs
+    const int width = view.width;
+    const int bands = (view.height + kBandRows - 1) / kBandRows;
+    std::vector<std::vector<Run>> bandRuns(bands);
+    std::vector<int> rowRuns(view.height, 0);
+    std::vector<Scratch> scratch(ResolveThreadCount(options.threads));
+    for (Scratch& s : scratch) {
+        s.labels.resize(width);
+        if (view.format == PixelFormat::RGB24) s.keys.resize(width);
+        if (tolerance) {
+            s.cacheKeys.assign(kCacheSize, 0xFFFFFFFFu);
+            s.cacheLabels.assign(kCacheSize, 0);
+        }
+    }
+    ParallelForEach(bands, options.threads, [&](int band, int worker) {
+        Scratch& s = scratch[worker];
+        int y1 = std::min((band + 1) * kBandRows, view.height);
+        for (int y = band * kBandRows; y < y1; y++) {
+            const uint8_t* row = view.data + (size_t)y * view.stride;
+            if (view.format == PixelFormat::RGB24) {
+                for (int x = 0; x < width; x++) {
+                    const uint8_t* px = row + x * 3;
+                    s.keys[x] = ((uint32_t)px[0] << 16) | ((uint32_t)px[1] << 8) | px[2];
+                }
+                row = (const uint8_t*)s.keys.data();
+            }
+            bool any = tolerance ? LabelTolerance(row, width, tables, s, s.labels.data())
+                                 : kernel(row, width, tables, s.labels.data());
+            if (any) rowRuns[y] = AppendRuns(s.labels.data(), width, bandRuns[band]);
+        }
+    });
+    
+    std::vector<Run> runs;
+    std::vector<int> rowStart(view.height + 1, 0);
+    for (int y = 0; y < view.height; y++) {
+        rowStart[y + 1] = rowStart[y] + rowRuns[y];
+    }
+    runs.reserve(rowStart[view.height]);
+    for (const std::vector<Run>& b : bandRuns) {
+        runs.insert(runs.end(), b.begin(), b.end());
+    }
+    
+    // Join runs of the same label that touch, diagonals included: row y+1
+    // run b touches row y run a when b.x0 <= a.x1 and a.x0 <= b.x1
+    std::vector<int> parent(runs.size());
+    for (size_t i = 0; i < parent.size(); i++) {
+        parent[i] = (int)i;
+    }
+    for (int y = 0; y + 1 < view.height; y++) {
+        int first = rowStart[y];
+        int aEnd = rowStart[y + 1];
+        for (int b = rowStart[y + 1]; b < rowStart[y + 2]; b++) {
+            const Run& rb = runs[b];
+            while (first < aEnd && runs[first].x1 < rb.x0) first++;
+            for (int a = first; a < aEnd && runs[a].x0 <= rb.x1; a++) {
+                if (runs[a].label == rb.label) {
+                    parent[FindRoot(parent, b)] = FindRoot(parent, a);
+                }
+            }
+        }
+    }
+    
+    // One match per root, created in the order roots are first met
+    std::vector<int> matchOf(runs.size(), -1);
+    std::vector<ColorMatch> regions;
+    long long pixels = 0;
+    for (int y = 0; y < view.height; y++) {
+        for (int i = rowStart[y]; i < rowStart[y + 1]; i++) {
+            const Run& r = runs[i];
+            pixels += r.x1 - r.x0;
+            int root = FindRoot(parent, i);
+            if (matchOf[root] < 0) {
+                matchOf[root] = (int)regions.size();
+                ColorMatch m = {{r.x0, y, r.x1 - r.x0, 1}, r.label - 1, r.x1 - r.x0};
+                regions.push_back(m);
+                continue;
+            }
+            
+            ColorMatch& m = regions[matchOf[root]];
+            int right = std::max(m.rect.x + m.rect.width, r.x1);
+            m.rect.x = std::min(m.rect.x, r.x0);
+            m.rect.width = right - m.rect.x;
+            m.rect.height = y + 1 - m.rect.y;
+            m.pixels += r.x1 - r.x0;
+        }
+    }
+    
+    for (const ColorMatch& m : regions) {
+        if (m.pixels >= options.minPixels) matches.push_back(m);
+    }
+    std::stable_sort(matches.begin(), matches.end(), [](const ColorMatch& a, const ColorMatch& b) {
+        return a.rect.y != b.rect.y ? a.rect.y < b.rect.y : a.rect.x < b.rect.x;
+    });
+    if (summary) {
+        summary->pixels = pixels;
+        summary->runs = (int)runs.size();
+        summary->regions = (int)regions.size();
+    }
+    return true;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+// Locates colors in a frame. Every pixel within the tolerance of a target
+// is labelled with its closest target, and 8-connected pixels with the
+// same target form one match. The frame is labelled in bands of rows on
+// all cores, each band keeping only its runs of matching pixels; the runs
+// are joined into matches afterwards, so memory follows the matches found
+// rather than the frame size.
+//
+// Exact searches compare packed pixels against up to eight targets with an
+// SSE2 or AVX2 kernel; with more targets, a one-bit-per-color table is
+// tested instead, eight pixels per AVX2 gather. Searches with a tolerance
+// go through the palette index with a per-thread cache of colors seen.
+
+#include <vector>
+
+#include "color_core.h"
+#include "palette.h"
+#include "screen_source.h"
+
+struct SearchOptions {
+    float tolerance = 0.0f;                             // 0 = exact; else the largest distance under metric
+    PaletteMetric metric = PaletteMetric::DeltaE2000;
+    int minPixels = 1;                                  // smaller matches are dropped
+    int threads = 0;                                    // 0 = one per core
+};
+
+struct ColorMatch {
+    CaptureRect rect;       // bounding box
+    int target;             // index into the target list
+    int pixels;             // matching pixels, at most the box area
+};
+
+struct SearchSummary {
+    long long pixels;       // pixels that matched any target
+    int runs;               // horizontal runs of them
+    int regions;            // connected regions, before minPixels
+};
+
+// Labels are 16-bit and signed in the SIMD packing
+const int kMaxSearchTargets = 32767;
+
+// Fills `matches` in reading order (top, then left). With duplicate
+// targets the first one is reported. Returns false only for more than
+// kMaxSearchTargets targets.
+bool SearchColors(const PixelView& view, const std::vector<Color>& targets, const SearchOptions& options,
+                  std::vector<ColorMatch>& matches, SearchSummary* summary = NULL);
@@ -0,0 +1,489 @@
+#include "color_spaces.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+const double kPi = 3.14159265358979323846;
+
+// D65 reference white
+const float kWhiteX = 0.95047f;
+const float kWhiteY = 1.0f;
+const float kWhiteZ = 1.08883f;
+
+// a^(1/5) by Newton iteration. Only evaluated at compile time to build the
+// sRGB tables, where <cmath> is not available.
+constexpr double FifthRoot(double a) {
+    if (a <= 0) return 0;
+    double y = 1.0;
+    for (int i = 0; i < 64; i++) {
+        double next = (4 * y + a / (y * y * y * y)) / 5;
+        if (next == y) break;
+        y = next;
+    }
+    return y;
+}
+
+// IEC 61966-2-1 decoding; x^2.4 = x^2 * (x^2)^(1/5)
+constexpr double DecodeSrgb(double v) {
+    if (v <= 0.04045) return v / 12.92;
+    double x = (v + 0.055) / 1.055;
+    return x * x * FifthRoot(x * x);
+}
+
+const int kEncodeBuckets = 4096;
+
+struct SrgbTables {
+    float toLinear[256];
+    // Linear value at sRGB code (i + 0.5) / 255, i.e. where encoding
+    // switches from rounding down to i to rounding up to i + 1
+    float threshold[255];
+    // Code at the start of each 1/4096 slice of linear values. The curve is
+    // never steeper than ~13 codes per unit, so a slice spans at most one
+    // threshold and encoding is a lookup plus one comparison.
+    uint8_t bucketCode[kEncodeBuckets];
+};
+
+constexpr SrgbTables MakeSrgbTables() {
+    SrgbTables t = {};
+    for (int i = 0; i < 256; i++) {
+        t.toLinear[i] = (float)DecodeSrgb(i / 255.0);
+    }
+    for (int i = 0; i < 255; i++) {
+        t.threshold[i] = (float)DecodeSrgb((i + 0.5) / 255.0);
+    }
+    int code = 0;
+    for (int i = 0; i < kEncodeBuckets; i++) {
+        float start = (float)i / kEncodeBuckets;
+        while (code < 255 && t.threshold[code] <= start) code++;
+        t.bucketCode[i] = (uint8_t)code;
+    }
+    return t;
+}
+
+constexpr SrgbTables g_srgb = MakeSrgbTables();
+
+// Cube root for t in [0, ~1.1]: exponent-division seed plus three Newton
+// steps, within a few ulp of cbrtf at a fraction of the cost
+inline float FastCbrt(float t) {
+    if (t <= 0) return 0;
+    uint32_t bits;
+    memcpy(&bits, &t, sizeof(bits));
+    bits = bits / 3 + 709921077u;
+    float y;
+    memcpy(&y, &bits, sizeof(y));
+    y = (2.0f * y + t / (y * y)) * (1.0f / 3.0f);
+    y = (2.0f * y + t / (y * y)) * (1.0f / 3.0f);
+    y = (2.0f * y + t / (y * y)) * (1.0f / 3.0f);
+    return y;
+}
+
+inline float LabF(float t) {
+    const float kEpsilon = 216.0f / 24389.0f;   // (6/29)^3
+    const float kKappa = 24389.0f / 27.0f;
+    return t > kEpsilon ? FastCbrt(t) : (kKappa * t + 16.0f) / 116.0f;
+}
+
+inline float LabFInverse(float f) {
+    const float kKappa = 24389.0f / 27.0f;
+    float t = f * f * f;
+    return t > 216.0f / 24389.0f ? t : (116.0f * f - 16.0f) / kKappa;
+}
+
+inline float Clamp01(float v) {
+    return v < 0 ? 0 : (v > 1 ? 1 : v);
+}
+
+inline int RoundChannel(float v) {
+    return (int)(Clamp01(v) * 255.0f + 0.5f);
+}
+
+inline double Radians(double degrees) {
+    return degrees * kPi / 180.0;
+}
+
+inline double HueDegrees(double y, double x) {
+    if (x == 0 && y == 0) return 0;
+    double h = std::atan2(y, x) * 180.0 / kPi;
+    return h < 0 ? h + 360.0 : h;
+}
+
+// Snap values that would print as "-0.00" to zero
+inline double Tidy(float v, double resolution) {
+    return std::fabs(v) < resolution / 2 ? 0.0 : (double)v;
+}
+
+// The hue of a chroma too small to print is rounding noise; show grays at 0
+inline double GrayHue(const LChValue& v, double chromaResolution) {
+    return Tidy(v.c, chromaResolution) == 0 ? 0.0 : Tidy(v.h, 0.1);
+}
+
+template <typename Out, typename Convert>
+void ConvertView(const PixelView& view, Out* out, Convert convert) {
+    for (int y = 0; y < view.height; y++) {
+        const uint8_t* p = view.data + (size_t)y * view.stride;
+        Out* row = out + (size_t)y * view.width;
+        if (view.format == PixelFormat::RGB24) {
+            for (int x = 0; x < view.width; x++, p += 3) {
+                LinearRGB lin = {g_srgb.toLinear[p[0]], g_srgb.toLinear[p[1]], g_srgb.toLinear[p[2]]};
+                row[x] = convert(lin);
+            }
+        } else {
+            for (int x = 0; x < view.width; x++, p += 4) {
+                LinearRGB lin = {g_srgb.toLinear[p[2]], g_srgb.toLinear[p[1]], g_srgb.toLinear[p[0]]};
+                row[x] = convert(lin);
+            }
+        }
+    }
+}
+
+LabValue LinearToLab(const LinearRGB& lin) {
+    return XYZToLab(LinearToXYZ(lin));
+}
+
+} // namespace
+
+float SrgbToLinear(uint8_t v) {
+    return g_srgb.toLinear[v];
+}
+
+uint8_t LinearToSrgb(float v) {
+    // Count thresholds at or below v: an exact round-to-nearest in sRGB space
+    if (!(v > 0)) return 0;
+    if (v >= 1) return 255;
+    int code = g_srgb.bucketCode[(int)(v * kEncodeBuckets)];
+    while (code < 255 && g_srgb.threshold[code] <= v) code++;
+    return (uint8_t)code;
+}
+
+const float* SrgbDecodeTable() {
+    return g_srgb.toLinear;
+}
+
+const float* SrgbEncodeThresholds() {
+    return g_srgb.threshold;
+}
+
+LinearRGB ColorToLinear(Color color) {
+    LinearRGB lin = {g_srgb.toLinear[color.r], g_srgb.toLinear[color.g], g_srgb.toLinear[color.b]};
+    return lin;
+}
+
+Color LinearToColor(const LinearRGB& lin) {
+    Color c = {LinearToSrgb(lin.r), LinearToSrgb(lin.g), LinearToSrgb(lin.b)};
+    return c;
+}
+
+HSVValue ColorToHSV(Color color) {
+    float r = color.r / 255.0f;
+    float g = color.g / 255.0f;
+    float b = color.b / 255.0f;
+    float maxVal = std::max(std::max(r, g), b);
+    float delta = maxVal - std::min(std::min(r, g), b);
+    
+    HSVValue hsv = {0, maxVal > 0 ? delta / maxVal : 0, maxVal};
+    if (delta > 0) {
+        if (maxVal == r) {
+            hsv.h = 60.0f * std::fmod((g - b) / delta + 6.0f, 6.0f);
+        } else if (maxVal == g) {
+            hsv.h = 60.0f * ((b - r) / delta + 2.0f);
+        } else {
+            hsv.h = 60.0f * ((r - g) / delta + 4.0f);
+        }
+    }
+    return hsv;
+}
+
+Color HSVToColor(const HSVValue& hsv) {
+    float h = std::fmod(hsv.h, 360.0f);
+    if (h < 0) h += 360.0f;
+    float s = Clamp01(hsv.s);
+    float v = Clamp01(hsv.v);
+    
+    float c = v * s;
+    float x = c * (1.0f - std::fabs(std::fmod(h / 60.0f, 2.0f) - 1.0f));
+    float m = v - c;
+    float r, g, b;
+    switch ((int)(h / 60.0f)) {
+        case 0: r = c; g = x; b = 0; break;
+        case 1: r = x; g = c; b = 0; break;
+        case 2: r = 0; g = c; b = x; break;
+        case 3: r = 0; g = x; b = c; break;
+        case 4: r = x; g = 0; b = c; break;
+        default: r = c; g = 0; b = x; break;
+    }
+    return MakeColor(RoundChannel(r + m), RoundChannel(g + m), RoundChannel(b + m));
+}
+
+// CSS Color 4: channel n is l - a * clamp(min(k - 3, 9 - k), -1, 1) with
+// k = (n + h / 30) mod 12 and n = 0, 8, 4 for red, green, blue
+Color HSLToColor(float h, float s, float l) {
+    if (h < 0 || h >= 360.0f) {
+        h = std::fmod(h, 360.0f);
+        if (h < 0) h += 360.0f;
+    }
+    s = Clamp01(s);
+    l = Clamp01(l);
+    
+    float a = s * std::min(l, 1.0f - l);
+    const float offsets[3] = {0.0f, 8.0f, 4.0f};
+    int channel[3];
+    for (int i = 0; i < 3; i++) {
+        float k = offsets[i] + h / 30.0f;
+        if (k >= 12.0f) k -= 12.0f;
+        float ramp = std::max(-1.0f, std::min(std::min(k - 3.0f, 9.0f - k), 1.0f));
+        channel[i] = RoundChannel(l - a * ramp);
+    }
+    return MakeColor(channel[0], channel[1], channel[2]);
+}
+
+XYZValue LinearToXYZ(const LinearRGB& lin) {
+    XYZValue xyz = {
+        0.4124564f * lin.r + 0.3575761f * lin.g + 0.1804375f * lin.b,
+        0.2126729f * lin.r + 0.7151522f * lin.g + 0.0721750f * lin.b,
+        0.0193339f * lin.r + 0.1191920f * lin.g + 0.9503041f * lin.b
+    };
+    return xyz;
+}
+
+LinearRGB XYZToLinear(const XYZValue& xyz) {
+    LinearRGB lin = {
+         3.2404542f * xyz.x - 1.5371385f * xyz.y - 0.4985314f * xyz.z,
+        -0.9692660f * xyz.x + 1.8760108f * xyz.y + 0.0415560f * xyz.z,
+         0.0556434f * xyz.x - 0.2040259f * xyz.y + 1.0572252f * xyz.z
+    };
+    return lin;
+}
+
+LabValue XYZToLab(const XYZValue& xyz) {
+    float fx = LabF(xyz.x / kWhiteX);
+    float fy = LabF(xyz.y / kWhiteY);
+    float fz = LabF(xyz.z / kWhiteZ);
+    LabValue lab = {116.0f * fy - 16.0f, 500.0f * (fx - fy), 200.0f * (fy - fz)};
+    return lab;
+}
+
+XYZValue LabToXYZ(const LabValue& lab) {
+    float fy = (lab.l + 16.0f) / 116.0f;
+    float fx = fy + lab.a / 500.0f;
+    float fz = fy - lab.b / 200.0f;
+    XYZValue xyz = {kWhiteX * LabFInverse(fx), kWhiteY * LabFInverse(fy), kWhiteZ * LabFInverse(fz)};
+    return xyz;
+}
+
+LabValue ColorToLab(Color color) {
+    return LinearToLab(ColorToLinear(color));
+}
+
+Color LabToColor(const LabValue& lab) {
+    return LinearToColor(XYZToLinear(LabToXYZ(lab)));
+}
+
+// OKLab, Bjorn Ottosson 2020
+OKLabValue LinearToOKLab(const LinearRGB& lin) {
+    float l = FastCbrt(0.4122214708f * lin.r + 0.5363325363f * lin.g + 0.0514459929f * lin.b);
+    float m = FastCbrt(0.2119034982f * lin.r + 0.6806995451f * lin.g + 0.1073969566f * lin.b);
+    float s = FastCbrt(0.0883024619f * lin.r + 0.2817188376f * lin.g + 0.6299787005f * lin.b);
+    OKLabValue lab = {
+        0.2104542553f * l + 0.7936177850f * m - 0.0040720468f * s,
+        1.9779984951f * l - 2.4285922050f * m + 0.4505937099f * s,
+        0.0259040371f * l + 0.7827717662f * m - 0.8086757660f * s
+    };
+    return lab;
+}
+
+LinearRGB OKLabToLinear(const OKLabValue& lab) {
+    float l = lab.l + 0.3963377774f * lab.a + 0.2158037573f * lab.b;
+    float m = lab.l - 0.1055613458f * lab.a - 0.0638541728f * lab.b;
+    float s = lab.l - 0.0894841775f * lab.a - 1.2914855480f * lab.b;
+    l = l * l * l;
+    m = m * m * m;
+    s = s * s * s;
+    LinearRGB lin = {
+         4.0767416621f * l - 3.3077115913f * m + 0.2309699292f * s,
+        -1.2684380046f * l + 2.6097574011f * m - 0.3413193965f * s,
+        -0.0041960863f * l - 0.7034186147f * m + 1.7076147010f * s
+    };
+    return lin;
+}
+
+OKLabValue ColorToOKLab(Color color) {
+    return LinearToOKLab(ColorToLinear(color));
+}
+
+Color OKLabToColor(const OKLabValue& lab) {
+    return LinearToColor(OKLabToLinear(lab));
+}
+
+Color OKLChToColor(const LChValue& lch) {
+    OKLabValue lab;
+    LChToLab(lch, lab.l, lab.a, lab.b);
+    return OKLabToColor(lab);
+}
+
+LChValue LabToLCh(float l, float a, float b) {
+    LChValue lch = {l, std::sqrt(a * a + b * b), (float)HueDegrees(b, a)};
+    return lch;
+}
+
+void LChToLab(const LChValue& lch, float& l, float& a, float& b) {
+    double h = Radians(lch.h);
+    l = lch.l;
+    a = lch.c * (float)std::cos(h);
+    b = lch.c * (float)std::sin(h);
+}
+
+CMYKValue ColorToCMYK(Color color) {
+    float r = color.r / 255.0f;
+    float g = color.g / 255.0f;
+    float b = color.b / 255.0f;
+    float k = 1.0f - std::max(std::max(r, g), b);
+    CMYKValue cmyk = {0, 0, 0, k};
+    if (k < 1.0f) {
+        cmyk.c = (1.0f - r - k) / (1.0f - k);
+        cmyk.m = (1.0f - g - k) / (1.0f - k);
+        cmyk.y = (1.0f - b - k) / (1.0f - k);
+    }
+    return cmyk;
+}
+
+Color CMYKToColor(const CMYKValue& cmyk) {
+    float k = 1.0f - Clamp01(cmyk.k);
+    return MakeColor(RoundChannel((1.0f - Clamp01(cmyk.c)) * k),
+                     RoundChannel((1.0f - Clamp01(cmyk.m)) * k),
+                     RoundChannel((1.0f - Clamp01(cmyk.y)) * k));
+}
+
+float DeltaE76(const LabValue& x, const LabValue& y) {
+    float dl = x.l - y.l;
+    float da = x.a - y.a;
+    float db = x.b - y.b;
+    return std::sqrt(dl * dl + da * da + db * db);
+}
+
+// CIEDE2000 following Sharma, Wu and Dalal (2005)
+float DeltaE2000(const LabValue& x, const LabValue& y) {
+    const double k25to7 = 6103515625.0;    // 25^7
+    
+    double c1 = std::sqrt((double)x.a * x.a + (double)x.b * x.b);
+    double c2 = std::sqrt((double)y.a * y.a + (double)y.b * y.b);
+    double cBar7 = std::pow((c1 + c2) / 2.0, 7.0);
+    double g = 0.5 * (1.0 - std::sqrt(cBar7 / (cBar7 + k25to7)));
+    
+    double a1 = (1.0 + g) * x.a;
+    double a2 = (1.0 + g) * y.a;
+    double c1p = std::sqrt(a1 * a1 + (double)x.b * x.b);
+    double c2p = std::sqrt(a2 * a2 + (double)y.b * y.b);
+    double h1p = HueDegrees(x.b, a1);
+    double h2p = HueDegrees(y.b, a2);
+    
+    double dLp = (double)y.l - x.l;
+    double dCp = c2p - c1p;
+    double dhp = 0;
+    if (c1p * c2p != 0) {
+        dhp = h2p - h1p;
+        if (dhp > 180) dhp -= 360;
+        else if (dhp < -180) dhp += 360;
+    }
+    double dHp = 2.0 * std::sqrt(c1p * c2p) * std::sin(Radians(dhp / 2.0));
+    
+    double lBar = ((double)x.l + y.l) / 2.0;
+    double cBarP = (c1p + c2p) / 2.0;
+    double hBarP = h1p + h2p;
+    if (c1p * c2p != 0) {
+        if (std::fabs(h1p - h2p) <= 180) hBarP = (h1p + h2p) / 2.0;
+        else if (h1p + h2p < 360) hBarP = (h1p + h2p + 360) / 2.0;
+        else hBarP = (h1p + h2p - 360) / 2.0;
+    }
+    
+    double t = 1.0 - 0.17 * std::cos(Radians(hBarP - 30)) + 0.24 * std::cos(Radians(2 * hBarP))
+             + 0.32 * std::cos(Radians(3 * hBarP + 6)) - 0.20 * std::cos(Radians(4 * hBarP - 63));
+    double dTheta = 30.0 * std::exp(-((hBarP - 275) / 25) * ((hBarP - 275) / 25));
+    double cBarP7 = std::pow(cBarP, 7.0);
+    double rc = 2.0 * std::sqrt(cBarP7 / (cBarP7 + k25to7));
+    double l50 = (lBar - 50) * (lBar - 50);
+    double sl = 1.0 + 0.015 * l50 / std::sqrt(20.0 + l50);
+    double sc = 1.0 + 0.045 * cBarP;
+    double sh = 1.0 + 0.015 * cBarP * t;
+    double rt = -std::sin(Radians(2 * dTheta)) * rc;
+    
+    double tl = dLp / sl;
+    double tc = dCp / sc;
+    double th = dHp / sh;
+    return (float)std::sqrt(tl * tl + tc * tc + th * th + rt * tc * th);
+}
+
+float OKLabDistance(const OKLabValue& x, const OKLabValue& y) {
+    float dl = x.l - y.l;
+    float da = x.a - y.a;
+    float db = x.b - y.b;
+    return std::sqrt(dl * dl + da * da + db * db);
+}
+
+void ViewToLab(const PixelView& view, LabValue* out) {
+    ConvertView(view, out, LinearToLab);
+}
+
+void ViewToOKLab(const PixelView& view, OKLabValue* out) {
+    ConvertView(view, out, LinearToOKLab);
+}
+
+size_t FormatColorSpace(Color color, ColorSpace space, char* out) {
+    int n = 0;
+    switch (space) {
+        case ColorSpace::HSV: {
+            HSVValue v = ColorToHSV(color);
+            n = snprintf(out, kSpaceBufferSize, "%d deg, %d%%, %d%%",
+                         (int)(v.h + 0.5f) % 360, (int)(v.s * 100 + 0.5f), (int)(v.v * 100 + 0.5f));
+            break;
+        }
+        case ColorSpace::Lab: {
+            LabValue v = ColorToLab(color);
+            n = snprintf(out, kSpaceBufferSize, "%.2f, %.2f, %.2f",
+                         Tidy(v.l, 0.01), Tidy(v.a, 0.01), Tidy(v.b, 0.01));
+            break;
+        }
+        case ColorSpace::LCh: {
+            LabValue lab = ColorToLab(color);
+            LChValue v = LabToLCh(lab.l, lab.a, lab.b);
+            n = snprintf(out, kSpaceBufferSize, "%.2f, %.2f, %.1f deg",
+                         Tidy(v.l, 0.01), Tidy(v.c, 0.01), GrayHue(v, 0.01));
+            break;
+        }
+        case ColorSpace::OKLab: {
+            OKLabValue v = ColorToOKLab(color);
+            n = snprintf(out, kSpaceBufferSize, "%.4f, %.4f, %.4f",
+                         Tidy(v.l, 0.0001), Tidy(v.a, 0.0001), Tidy(v.b, 0.0001));
+            break;
+        }
+        case ColorSpace::OKLCh: {
+            OKLabValue lab = ColorToOKLab(color);
+            LChValue v = LabToLCh(lab.l, lab.a, lab.b);
+            n = snprintf(out, kSpaceBufferSize, "%.4f, %.4f, %.1f deg",
+                         Tidy(v.l, 0.0001), Tidy(v.c, 0.0001), GrayHue(v, 0.0001));
+            break;
+        }
+        case ColorSpace::CMYK: {
+            CMYKValue v = ColorToCMYK(color);
+            n = snprintf(out, kSpaceBufferSize, "%d%%, %d%%, %d%%, %d%%",
+                         (int)(v.c * 100 + 0.5f), (int)(v.m * 100 + 0.5f),
+                         (int)(v.y * 100 + 0.5f), (int)(v.k * 100 + 0.5f));
+            break;
+        }
+    }
+    return n > 0 ? (size_t)n : 0;
+}
+
+const char* ColorSpaceName(ColorSpace space) {
+    switch (space) {
+        case ColorSpace::HSV: return "HSV";
+        case ColorSpace::Lab: return "Lab";
+        case ColorSpace::LCh: return "LCh";
+        case ColorSpace::OKLab: return "OKLab";
+        case ColorSpace::OKLCh: return "OKLCh";
+        default: return "CMYK";
+    }
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+// Perceptual and device color spaces. 8-bit sRGB decoding goes through a
+// compile-time table and encoding through a table of rounding thresholds,
+// so per-pixel work is a lookup plus a few multiply-adds.
+
+#include "color_core.h"
+
+struct LinearRGB { float r, g, b; };        // 0-1, D65
+struct HSVValue { float h, s, v; };         // degrees, 0-1, 0-1
+struct XYZValue { float x, y, z; };         // D65, Y of white = 1
+struct LabValue { float l, a, b; };         // CIE L*a*b*, L 0-100
+struct LChValue { float l, c, h; };         // polar Lab or OKLab, h in degrees
+struct OKLabValue { float l, a, b; };       // L 0-1
+struct CMYKValue { float c, m, y, k; };     // 0-1, naive (no ICC profile)
+
+// sRGB transfer function
+float SrgbToLinear(uint8_t v);
+uint8_t LinearToSrgb(float v);
+
+// The tables behind them, for vector kernels: 256 decoded values, and the
+// 255 linear values at which encoding rounds up to the next code
+const float* SrgbDecodeTable();
+const float* SrgbEncodeThresholds();
+
+LinearRGB ColorToLinear(Color color);
+Color LinearToColor(const LinearRGB& lin);
+
+HSVValue ColorToHSV(Color color);
+Color HSVToColor(const HSVValue& hsv);
+
+// Inverse of RGBtoHSL with h in degrees and s, l in 0-1
+Color HSLToColor(float h, float s, float l);
+
+XYZValue LinearToXYZ(const LinearRGB& lin);
+LinearRGB XYZToLinear(const XYZValue& xyz);
+LabValue XYZToLab(const XYZValue& xyz);
+XYZValue LabToXYZ(const LabValue& lab);
+LabValue ColorToLab(Color color);
+Color LabToColor(const LabValue& lab);
+
+OKLabValue LinearToOKLab(const LinearRGB& lin);
+LinearRGB OKLabToLinear(const OKLabValue& lab);
+OKLabValue ColorToOKLab(Color color);
+Color OKLabToColor(const OKLabValue& lab);
+
+LChValue LabToLCh(float l, float a, float b);
+void LChToLab(const LChValue& lch, float& l, float& a, float& b);
+
+// Channels outside sRGB are clipped
+Color OKLChToColor(const LChValue& lch);
+
+CMYKValue ColorToCMYK(Color color);
+Color CMYKToColor(const CMYKValue& cmyk);
+
+// Color differences
+float DeltaE76(const LabValue& x, const LabValue& y);
+float DeltaE2000(const LabValue& x, const LabValue& y);
+float OKLabDistance(const OKLabValue& x, const OKLabValue& y);
+
+// Whole-region conversion, row by row, into width * height outputs
+void ViewToLab(const PixelView& view, LabValue* out);
+void ViewToOKLab(const PixelView& view, OKLabValue* out);
+
+// Display formatting for the extra spaces shown in the GUI and CLI
+enum class ColorSpace {
+    HSV,
+    Lab,
+    LCh,
+    OKLab,
+    OKLCh,
+    CMYK
+};
+
+const int kColorSpaceCount = 6;
+const size_t kSpaceBufferSize = 48;
+
+size_t FormatColorSpace(Color color, ColorSpace space, char* out);
+const char* ColorSpaceName(ColorSpace space);
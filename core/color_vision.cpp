@@ -0,0 +1,379 @@
+#include "color_vision.h"
+
+#include <cstring>
+#include <vector>
+
+#include "color_spaces.h"
+#include "parallel.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define COLOR_VISION_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define COLOR_VISION_TARGET(x) __attribute__((target(x)))
+#else
+#define COLOR_VISION_TARGET(x)
+#endif
+
+namespace {
+
+const VisionMatrix kIdentity = {{1, 0, 0, 0, 1, 0, 0, 0, 1}};
+
+// Machado et al. 2009, severity 1.0
+const VisionMatrix kProtanopia = {{
+     0.152286f,  1.052583f, -0.204868f,
+     0.114503f,  0.786281f,  0.099216f,
+    -0.003882f, -0.048116f,  1.051998f}};
+const VisionMatrix kDeuteranopia = {{
+     0.367322f,  0.860646f, -0.227968f,
+     0.280085f,  0.672501f,  0.047413f,
+    -0.011820f,  0.042940f,  0.968881f}};
+const VisionMatrix kTritanopia = {{
+     1.255528f, -0.076749f, -0.178779f,
+    -0.078411f,  0.930809f,  0.147602f,
+     0.004733f,  0.691367f,  0.303900f}};
+const VisionMatrix kAchromatopsia = {{
+    0.2126f, 0.7152f, 0.0722f,
+    0.2126f, 0.7152f, 0.0722f,
+    0.2126f, 0.7152f, 0.0722f}};
+
+// Linear to sRGB without a search. Multiplying by a power of two is exact,
+// so v * kEncodeSteps truncates to the cell holding v, and code[cell] is
+// the sRGB code at the start of the cell. Cells are narrower than the gap
+// between any two rounding thresholds, so at most one more threshold can
+// lie between the cell start and v; one compare settles it.
+const int kEncodeSteps = 4096;
+
+struct EncodeTable {
+    int32_t code[kEncodeSteps + 1];
+    float threshold[256];           // the last entry is never reached
+    
+    EncodeTable() {
+        const float* t = SrgbEncodeThresholds();
+        memcpy(threshold, t, 255 * sizeof(float));
+        threshold[255] = 2.0f;
+        int n = 0;
+        for (int i = 0; i <= kEncodeSteps; i++) {
+            float start = (float)i / kEncodeSteps;
+            while (n < 255 && t[n] <= start) n++;
+            code[i] = n;
+        }
+    }
+};
+
+const EncodeTable g_encode;
+
+inline float Clamp01(float v) {
+    return v < 0 ? 0 : (v > 1 ? 1 : v);
+}
+
+inline int Encode(float v) {
+    v = Clamp01(v);
+    int code = g_encode.code[(int)(v * (float)kEncodeSteps)];
+    return code + (v >= g_encode.threshold[code] ? 1 : 0);
+}
+
+// Pixels are simulated in blocks: decode to planar linear floats, apply the
+// matrix and encode. The sums are (m0 r + m1 g) + m2 b in every kernel,
+// without fused multiply-adds, so all kernels round identically.
+const int kBlockSize = 64;
+
+struct Block {
+    float r[kBlockSize];
+    float g[kBlockSize];
+    float b[kBlockSize];
+    int32_t outR[kBlockSize];
+    int32_t outG[kBlockSize];
+    int32_t outB[kBlockSize];
+    int32_t x[kBlockSize];          // first pixel of the run in the row
+    int32_t run[kBlockSize];        // pixels in the run
+    uint32_t key[kBlockSize];       // their packed RGB value
+};
+
+typedef void (*BlockKernel)(Block& blk, const VisionMatrix& matrix, int n);
+
+void KernelScalar(Block& blk, const VisionMatrix& matrix, int n) {
+    const float* m = matrix.m;
+    for (int i = 0; i < n; i++) {
+        float r = blk.r[i];
+        float g = blk.g[i];
+        float b = blk.b[i];
+        blk.outR[i] = Encode(m[0] * r + m[1] * g + m[2] * b);
+        blk.outG[i] = Encode(m[3] * r + m[4] * g + m[5] * b);
+        blk.outB[i] = Encode(m[6] * r + m[7] * g + m[8] * b);
+    }
+}
+
+#if COLOR_VISION_X86
+
+// n is rounded up to a multiple of the vector width; the padding lanes
+// hold zeros and their output is ignored
+void KernelSSE2(Block& blk, const VisionMatrix& matrix, int n) {
+    const float* m = matrix.m;
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 steps = _mm_set1_ps((float)kEncodeSteps);
+    int32_t* out[3] = {blk.outR, blk.outG, blk.outB};
+    
+    // Table cells go into the output rows first; the encode pass below
+    // needs the clamped values as well
+    alignas(16) float clamped[3][kBlockSize];
+    for (int o = 0; o < n; o += 4) {
+        __m128 r = _mm_loadu_ps(blk.r + o);
+        __m128 g = _mm_loadu_ps(blk.g + o);
+        __m128 b = _mm_loadu_ps(blk.b + o);
+        for (int c = 0; c < 3; c++) {
+            __m128 v = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[c * 3]), r),
+                                             _mm_mul_ps(_mm_set1_ps(m[c * 3 + 1]), g)),
+                                  _mm_mul_ps(_mm_set1_ps(m[c * 3 + 2]), b));
+            v = _mm_min_ps(_mm_max_ps(v, zero), one);
+            _mm_store_ps(clamped[c] + o, v);
+            _mm_storeu_si128((__m128i*)(out[c] + o), _mm_cvttps_epi32(_mm_mul_ps(v, steps)));
+        }
+    }
+    
+    // No gathers before AVX2
+    for (int c = 0; c < 3; c++) {
+        int32_t* o = out[c];
+        for (int i = 0; i < n; i++) {
+            int code = g_encode.code[o[i]];
+            o[i] = code + (clamped[c][i] >= g_encode.threshold[code] ? 1 : 0);
+        }
+    }
+}
+
+COLOR_VISION_TARGET("avx2")
+void KernelAVX2(Block& blk, const VisionMatrix& matrix, int n) {
+    const float* m = matrix.m;
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 steps = _mm256_set1_ps((float)kEncodeSteps);
+    __m256 coef[9];
+    for (int i = 0; i < 9; i++) {
+        coef[i] = _mm256_set1_ps(m[i]);
+    }
+    int32_t* out[3] = {blk.outR, blk.outG, blk.outB};
+    
+    for (int o = 0; o < n; o += 8) {
+        __m256 r = _mm256_loadu_ps(blk.r + o);
+        __m256 g = _mm256_loadu_ps(blk.g + o);
+        __m256 b = _mm256_loadu_ps(blk.b + o);
+        for (int c = 0; c < 3; c++) {
+            __m256 v = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(coef[c * 3], r),
+                                                   _mm256_mul_ps(coef[c * 3 + 1], g)),
+                                     _mm256_mul_ps(coef[c * 3 + 2], b));
+            v = _mm256_min_ps(_mm256_max_ps(v, zero), one);
+            __m256i cell = _mm256_cvttps_epi32(_mm256_mul_ps(v, steps));
+            __m256i code = _mm256_i32gather_epi32(g_encode.code, cell, 4);
+            __m256 threshold = _mm256_i32gather_ps(g_encode.threshold, code, 4);
+            // The compare mask is -1 where v reached the threshold
+            __m256i up = _mm256_castps_si256(_mm256_cmp_ps(v, threshold, _CMP_GE_OQ));
+            _mm256_storeu_si256((__m256i*)(out[c] + o), _mm256_sub_epi32(code, up));
+        }
+    }
+}
+
+#endif
+
+BlockKernel ActiveKernel() {
+    switch (GetSimdLevel()) {
+#if COLOR_VISION_X86
+        case SimdLevel::AVX2: return KernelAVX2;
+        case SimdLevel::SSE2: return KernelSSE2;
+#endif
+        default: return KernelScalar;
+    }
+}
+
+// Screen content repeats colors heavily (flat fills, and the same few
+// anti-aliasing shades around every glyph), so each thread keeps a small
+// direct-mapped cache keyed on the packed RGB value, as Palette::NearestBatch
+// does, and only the misses are decoded and sent through the kernel.
+const int kCacheSize = 4096;
+
+struct ColorCache {
+    std::vector<uint32_t> keys;
+    std::vector<uint32_t> values;
+    
+    ColorCache() : keys(kCacheSize, 0xFFFFFFFFu), values(kCacheSize) {}
+};
+
+inline uint32_t CacheSlot(uint32_t key) {
+    return (key * 2654435761u) >> 20;
+}
+
+// kBytes is 3 for RGB24 and 4 for BGRA32
+template <int kBytes>
+inline void StorePixel(const uint8_t* src, uint8_t* dst, int x, uint32_t value) {
+    const int ri = kBytes == 3 ? 0 : 2;
+    uint8_t* q = dst + (size_t)x * kBytes;
+    q[ri] = (uint8_t)(value >> 16);
+    q[1] = (uint8_t)(value >> 8);
+    q[2 - ri] = (uint8_t)value;
+    // Alpha is left alone in place and copied otherwise
+    if (kBytes == 4) q[3] = src[(size_t)x * 4 + 3];
+}
+
+// Returns the number of pixels that went through the kernel. Without the
+// cache every pixel does, which is faster on photos and noise where
+// lookups mostly miss.
+template <int kBytes, bool kCached>
+int SimulateRow(const uint8_t* src, uint8_t* dst, int width, const VisionMatrix& matrix,
+                BlockKernel kernel, Block& blk, ColorCache& cache) {
+    const int ri = kBytes == 3 ? 0 : 2;
+    const int bi = 2 - ri;
+    const float* decode = SrgbDecodeTable();
+    uint32_t* keys = cache.keys.data();
+    uint32_t* values = cache.values.data();
+    
+    // Most pixels repeat their left neighbour, which skips even the cache.
+    // A run that starts on a miss is extended in the block until it ends.
+    uint32_t runKey = 0xFFFFFFFFu;
+    uint32_t runValue = 0;
+    bool runPending = false;
+    int computed = 0;
+    int x = 0;
+    while (x < width) {
+        // Hits are written straight away; misses fill the block
+        int misses = 0;
+        for (; x < width && misses < kBlockSize; x++) {
+            const uint8_t* p = src + (size_t)x * kBytes;
+            uint32_t key = ((uint32_t)p[ri] << 16) | ((uint32_t)p[1] << 8) | p[bi];
+            if (kCached) {
+                if (key == runKey) {
+                    if (runPending) {
+                        blk.run[misses - 1]++;
+                    } else {
+                        StorePixel<kBytes>(src, dst, x, runValue);
+                    }
+                    continue;
+                }
+                runKey = key;
+                uint32_t slot = CacheSlot(key);
+                if (keys[slot] == key) {
+                    runValue = values[slot];
+                    runPending = false;
+                    StorePixel<kBytes>(src, dst, x, runValue);
+                    continue;
+                }
+                runPending = true;
+            }
+            blk.r[misses] = decode[p[ri]];
+            blk.g[misses] = decode[p[1]];
+            blk.b[misses] = decode[p[bi]];
+            blk.x[misses] = x;
+            blk.run[misses] = 1;
+            blk.key[misses] = key;
+            misses++;
+        }
+        if (misses == 0) continue;
+        
+        int padded = (misses + 7) & ~7;
+        for (int i = misses; i < padded; i++) {
+            blk.r[i] = blk.g[i] = blk.b[i] = 0;
+        }
+        kernel(blk, matrix, padded);
+        computed += misses;
+        
+        for (int i = 0; i < misses; i++) {
+            uint32_t value = ((uint32_t)blk.outR[i] << 16) | ((uint32_t)blk.outG[i] << 8) | (uint32_t)blk.outB[i];
+            if (kCached) {
+                uint32_t slot = CacheSlot(blk.key[i]);
+                keys[slot] = blk.key[i];
+                values[slot] = value;
+            }
+            for (int k = 0; k < blk.run[i]; k++) {
+                StorePixel<kBytes>(src, dst, blk.x[i] + k, value);
+            }
+            runValue = value;
+        }
+        runPending = false;
+    }
+    return computed;
+}
+
+// Rows where most pixels miss switch the cache off for a while
+const int kCacheBypassRows = 16;
+
+template <int kBytes>
+void SimulateRows(const PixelView& src, uint8_t* dst, size_t dstStride, int begin, int end,
+                  const VisionMatrix& matrix, BlockKernel kernel) {
+    Block blk;
+    ColorCache cache;
+    int bypass = 0;
+    for (int y = begin; y < end; y++) {
+        const uint8_t* in = src.data + src.stride * y;
+        uint8_t* out = dst + dstStride * y;
+        if (bypass > 0) {
+            SimulateRow<kBytes, false>(in, out, src.width, matrix, kernel, blk, cache);
+            bypass--;
+        } else if (SimulateRow<kBytes, true>(in, out, src.width, matrix, kernel, blk, cache) * 2 > src.width) {
+            bypass = kCacheBypassRows - 1;
+        }
+    }
+}
+
+} // namespace
+
+VisionMatrix SimulationMatrix(VisionType type, float severity) {
+    const VisionMatrix* full = &kIdentity;
+    switch (type) {
+        case VisionType::Protanopia:    full = &kProtanopia; break;
+        case VisionType::Deuteranopia:  full = &kDeuteranopia; break;
+        case VisionType::Tritanopia:    full = &kTritanopia; break;
+        case VisionType::Achromatopsia: full = &kAchromatopsia; break;
+        default: break;
+    }
+    
+    float s = Clamp01(severity);
+    VisionMatrix matrix;
+    for (int i = 0; i < 9; i++) {
+        matrix.m[i] = kIdentity.m[i] + s * (full->m[i] - kIdentity.m[i]);
+    }
+    return matrix;
+}
+
+Color SimulateColor(Color color, const VisionMatrix& matrix) {
+    const float* m = matrix.m;
+    float r = SrgbToLinear(color.r);
+    float g = SrgbToLinear(color.g);
+    float b = SrgbToLinear(color.b);
+    return MakeColor(Encode(m[0] * r + m[1] * g + m[2] * b),
+                     Encode(m[3] * r + m[4] * g + m[5] * b),
+                     Encode(m[6] * r + m[7] * g + m[8] * b));
+}
+
+void SimulateView(const PixelView& src, const VisionMatrix& matrix, uint8_t* dst, size_t dstStride,
+                  int threads) {
+    BlockKernel kernel = ActiveKernel();
+    ParallelFor(src.height, threads, [&](int begin, int end, int) {
+        if (src.format == PixelFormat::RGB24) {
+            SimulateRows<3>(src, dst, dstStride, begin, end, matrix, kernel);
+        } else {
+            SimulateRows<4>(src, dst, dstStride, begin, end, matrix, kernel);
+        }
+    });
+}
+
+const char* VisionTypeName(VisionType type) {
+    switch (type) {
+        case VisionType::Protanopia: return "protanopia";
+        case VisionType::Deuteranopia: return "deuteranopia";
+        case VisionType::Tritanopia: return "tritanopia";
+        case VisionType::Achromatopsia: return "achromatopsia";
+        default: return "normal";
+    }
+}
+
+bool ParseVisionType(const char* text, VisionType& type) {
+    static const char* const kShortNames[kVisionTypeCount] = {"normal", "protan", "deutan", "tritan", "achroma"};
+    for (int i = 0; i < kVisionTypeCount; i++) {
+        if (strcmp(text, VisionTypeName((VisionType)i)) == 0 || strcmp(text, kShortNames[i]) == 0) {
+            type = (VisionType)i;
+            return true;
+        }
+    }
+    return false;
+}
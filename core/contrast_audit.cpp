@@ -0,0 +1,338 @@
+#include "contrast_audit.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+#include "color_spaces.h"
+#include "parallel.h"
+
+namespace {
+
+// Pixels differing from the background by at least this ratio are ink;
+// compression noise and subpixel fringes stay below it
+const float kInkRatio = 1.25f;
+// A text tile is mostly background, has a few ink pixels, and its ink has
+// at least this many ink/background boundaries per pixel. Strokes one or
+// two pixels wide score 1-2, a filled shape a small fraction of that.
+const float kMinBackgroundShare = 0.35f;
+const int kMinInkPixels = 8;
+const float kMinOutlinePerInk = 0.5f;
+// The outline alone also passes a sliver of a solid shape cut off by the
+// tile edge, so at least this share of the ink must lie in strokes: runs
+// across, or down, of at most kMaxStrokeWidth pixels with background on
+// both sides inside the tile
+const float kMinStrokeShare = 0.5f;
+const int kMaxStrokeWidth = 6;
+// The foreground is the mean of the strongest tenth of the ink, i.e. the
+// core of the strokes rather than their anti-aliased edges
+const float kStrokePercentile = 0.9f;
+// Neighbouring failing tiles merge when every channel of both colors is this close
+const int kMergeTolerance = 12;
+
+// Per-channel luminance contributions, so a pixel costs three lookups and
+// two additions. The 8-bit codes fall on the same side of the WCAG and
+// IEC 61966-2-1 linear-segment thresholds, so both definitions agree.
+struct LuminanceTables {
+    float r[256];
+    float g[256];
+    float b[256];
+};
+
+const LuminanceTables& Tables() {
+    static const LuminanceTables tables = []() {
+        LuminanceTables t;
+        for (int i = 0; i < 256; i++) {
+            float v = SrgbToLinear((uint8_t)i);
+            t.r[i] = 0.2126f * v;
+            t.g[i] = 0.7152f * v;
+            t.b[i] = 0.0722f * v;
+        }
+        return t;
+    }();
+    return tables;
+}
+
+struct TileResult {
+    bool text;
+    bool failing;
+    Color foreground;
+    Color background;
+    float ratio;
+};
+
+// Per-slice buffers, sized once for the largest tile
+struct TileScratch {
+    std::vector<float> luminance;
+    std::vector<float> strength;        // contrast against the background, 0 if not ink
+    std::vector<float> inkStrength;
+    std::vector<uint8_t> stroke;        // 1 if the pixel lies in a stroke
+    std::vector<uint16_t> bins;
+    std::vector<uint16_t> counts;       // 4 bits per channel
+    std::vector<uint16_t> touched;
+
+    explicit TileScratch(int tileSize)
+        : luminance(tileSize * tileSize), strength(tileSize * tileSize), stroke(tileSize * tileSize),
+          bins(tileSize * tileSize), counts(4096, 0) {
+        inkStrength.reserve(tileSize * tileSize);
+        touched.reserve(tileSize * tileSize);
+    }
+};
+
+// Marks the ink runs of one line, `count` pixels `step` apart, that are
+// short and have background at both ends
+void MarkStrokes(const float* strength, int count, int step, uint8_t* stroke) {
+    int start = -1;
+    for (int k = 0; k < count; k++) {
+        if (strength[k * step] > 0) {
+            if (start < 0) start = k;
+            continue;
+        }
+        if (start > 0 && k - start <= kMaxStrokeWidth) {
+            for (int j = start; j < k; j++) {
+                stroke[j * step] = 1;
+            }
+        }
+        start = -1;
+    }
+}
+
+// Ink pixels in a stroke across or down. A run touching the tile edge may
+// be the side of anything, so only runs closed on both ends count.
+int StrokePixels(const float* strength, int w, int h, uint8_t* stroke) {
+    std::fill(stroke, stroke + w * h, 0);
+    for (int y = 0; y < h; y++) {
+        MarkStrokes(strength + y * w, w, 1, stroke + y * w);
+    }
+    for (int x = 0; x < w; x++) {
+        MarkStrokes(strength + x, h, w, stroke + x);
+    }
+    int count = 0;
+    for (int i = 0; i < w * h; i++) {
+        count += stroke[i];
+    }
+    return count;
+}
+
+template <int RI, int GI, int BI, int Step>
+TileResult AnalyseTile(const PixelView& view, int x0, int y0, int w, int h, float minRatio, TileScratch& s) {
+    const LuminanceTables& lut = Tables();
+    TileResult result = {};
+    const int n = w * h;
+
+    // Luminance and the most common 12-bit color
+    int modeBin = 0;
+    int modeCount = 0;
+    s.touched.clear();
+    for (int y = 0, i = 0; y < h; y++) {
+        const uint8_t* p = view.data + view.stride * (y0 + y) + (size_t)x0 * Step;
+        for (int x = 0; x < w; x++, i++, p += Step) {
+            s.luminance[i] = lut.r[p[RI]] + lut.g[p[GI]] + lut.b[p[BI]];
+            int bin = ((p[RI] >> 4) << 8) | ((p[GI] >> 4) << 4) | (p[BI] >> 4);
+            s.bins[i] = (uint16_t)bin;
+            if (s.counts[bin]++ == 0) s.touched.push_back((uint16_t)bin);
+            if (s.counts[bin] > modeCount) {
+                modeCount = s.counts[bin];
+                modeBin = bin;
+            }
+        }
+    }
+    for (uint16_t bin : s.touched) {
+        s.counts[bin] = 0;
+    }
+    if (modeCount < kMinBackgroundShare * n) return result;
+
+    // Background: the mean color of that bin
+    int sum[3] = {0, 0, 0};
+    for (int y = 0, i = 0; y < h; y++) {
+        const uint8_t* p = view.data + view.stride * (y0 + y) + (size_t)x0 * Step;
+        for (int x = 0; x < w; x++, i++, p += Step) {
+            if (s.bins[i] != modeBin) continue;
+            sum[0] += p[RI];
+            sum[1] += p[GI];
+            sum[2] += p[BI];
+        }
+    }
+    result.background = MakeColor((sum[0] + modeCount / 2) / modeCount, (sum[1] + modeCount / 2) / modeCount,
+                                  (sum[2] + modeCount / 2) / modeCount);
+    float background = RelativeLuminance(result.background);
+
+    // Ink and its outline against the background
+    s.inkStrength.clear();
+    for (int i = 0; i < n; i++) {
+        float c = ContrastRatio(s.luminance[i], background);
+        s.strength[i] = c >= kInkRatio ? c : 0;
+        if (s.strength[i] > 0) s.inkStrength.push_back(c);
+    }
+    int ink = (int)s.inkStrength.size();
+    if (ink < kMinInkPixels) return result;
+
+    int outline = 0;
+    for (int y = 0, i = 0; y < h; y++) {
+        for (int x = 0; x < w; x++, i++) {
+            bool inside = s.strength[i] > 0;
+            if (x + 1 < w && inside != (s.strength[i + 1] > 0)) outline++;
+            if (y + 1 < h && inside != (s.strength[i + w] > 0)) outline++;
+        }
+    }
+    if (outline < kMinOutlinePerInk * ink) return result;
+    if (StrokePixels(s.strength.data(), w, h, s.stroke.data()) < kMinStrokeShare * ink) return result;
+    result.text = true;
+
+    // Foreground: the mean color of the stroke cores
+    std::vector<float>::iterator cut = s.inkStrength.begin() + (size_t)(kStrokePercentile * (ink - 1));
+    std::nth_element(s.inkStrength.begin(), cut, s.inkStrength.end());
+    float threshold = *cut;
+    int cores = 0;
+    sum[0] = sum[1] = sum[2] = 0;
+    for (int y = 0, i = 0; y < h; y++) {
+        const uint8_t* p = view.data + view.stride * (y0 + y) + (size_t)x0 * Step;
+        for (int x = 0; x < w; x++, i++, p += Step) {
+            if (s.strength[i] < threshold) continue;
+            sum[0] += p[RI];
+            sum[1] += p[GI];
+            sum[2] += p[BI];
+            cores++;
+        }
+    }
+    result.foreground = MakeColor((sum[0] + cores / 2) / cores, (sum[1] + cores / 2) / cores,
+                                  (sum[2] + cores / 2) / cores);
+    result.ratio = ContrastRatio(RelativeLuminance(result.foreground), background);
+    result.failing = result.ratio < minRatio;
+    return result;
+}
+
+template <int RI, int GI, int BI, int Step>
+void LuminanceRows(const PixelView& view, float* out) {
+    const LuminanceTables& lut = Tables();
+    for (int y = 0; y < view.height; y++) {
+        const uint8_t* p = view.data + view.stride * y;
+        for (int x = 0; x < view.width; x++, p += Step) {
+            *out++ = lut.r[p[RI]] + lut.g[p[GI]] + lut.b[p[BI]];
+        }
+    }
+}
+
+bool SimilarColor(Color a, Color b) {
+    return std::abs(a.r - b.r) <= kMergeTolerance && std::abs(a.g - b.g) <= kMergeTolerance &&
+           std::abs(a.b - b.b) <= kMergeTolerance;
+}
+
+bool Mergeable(const TileResult& a, const TileResult& b) {
+    return a.failing && b.failing && SimilarColor(a.foreground, b.foreground) &&
+           SimilarColor(a.background, b.background);
+}
+
+int FindRoot(std::vector<int>& parent, int i) {
+    while (parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+} // namespace
+
+float RelativeLuminance(Color color) {
+    const LuminanceTables& lut = Tables();
+    return lut.r[color.r] + lut.g[color.g] + lut.b[color.b];
+}
+
+float ContrastRatio(float luminance1, float luminance2) {
+    float lighter = std::max(luminance1, luminance2);
+    float darker = std::min(luminance1, luminance2);
+    return (lighter + 0.05f) / (darker + 0.05f);
+}
+
+void ViewToLuminance(const PixelView& view, float* out) {
+    if (view.format == PixelFormat::BGRA32) {
+        LuminanceRows<2, 1, 0, 4>(view, out);
+    } else {
+        LuminanceRows<0, 1, 2, 3>(view, out);
+    }
+}
+
+void AuditContrast(const PixelView& view, const AuditOptions& options,
+                   std::vector<ContrastIssue>& issues, AuditSummary* summary) {
+    issues.clear();
+    const int tile = std::min(std::max(options.tileSize, kMinAuditTile), kMaxAuditTile);
+    const int cols = (view.width + tile - 1) / tile;
+    const int rows = (view.height + tile - 1) / tile;
+
+    // Tiles are independent, so slices take whole bands of tile rows
+    std::vector<TileResult> tiles((size_t)cols * rows);
+    ParallelFor(rows, options.threads, [&](int begin, int end, int) {
+        TileScratch scratch(tile);
+        for (int ty = begin; ty < end; ty++) {
+            int y0 = ty * tile;
+            int h = std::min(tile, view.height - y0);
+            for (int tx = 0; tx < cols; tx++) {
+                int x0 = tx * tile;
+                int w = std::min(tile, view.width - x0);
+                tiles[(size_t)ty * cols + tx] = view.format == PixelFormat::BGRA32
+                    ? AnalyseTile<2, 1, 0, 4>(view, x0, y0, w, h, options.minRatio, scratch)
+                    : AnalyseTile<0, 1, 2, 3>(view, x0, y0, w, h, options.minRatio, scratch);
+            }
+        }
+    });
+
+    // Union failing neighbours that share their colors
+    std::vector<int> parent(tiles.size());
+    for (size_t i = 0; i < parent.size(); i++) {
+        parent[i] = (int)i;
+    }
+    for (int ty = 0; ty < rows; ty++) {
+        for (int tx = 0; tx < cols; tx++) {
+            int i = ty * cols + tx;
+            if (!tiles[i].failing) continue;
+            if (tx + 1 < cols && Mergeable(tiles[i], tiles[i + 1])) {
+                parent[FindRoot(parent, i + 1)] = FindRoot(parent, i);
+            }
+            if (ty + 1 < rows && Mergeable(tiles[i], tiles[i + cols])) {
+                parent[FindRoot(parent, i + cols)] = FindRoot(parent, i);
+            }
+        }
+    }
+
+    // One issue per group: the bounding box and its worst tile
+    std::vector<int> issueOf(tiles.size(), -1);
+    AuditSummary counts = {cols * rows, 0, 0};
+    for (int ty = 0; ty < rows; ty++) {
+        for (int tx = 0; tx < cols; tx++) {
+            int i = ty * cols + tx;
+            const TileResult& t = tiles[i];
+            if (t.text) counts.textTiles++;
+            if (!t.failing) continue;
+            counts.failingTiles++;
+
+            int x0 = tx * tile;
+            int y0 = ty * tile;
+            int x1 = std::min(x0 + tile, view.width);
+            int y1 = std::min(y0 + tile, view.height);
+            int root = FindRoot(parent, i);
+            if (issueOf[root] < 0) {
+                issueOf[root] = (int)issues.size();
+                ContrastIssue issue = {{x0, y0, x1 - x0, y1 - y0}, t.foreground, t.background, t.ratio};
+                issues.push_back(issue);
+                continue;
+            }
+
+            ContrastIssue& issue = issues[issueOf[root]];
+            int right = std::max(issue.rect.x + issue.rect.width, x1);
+            int bottom = std::max(issue.rect.y + issue.rect.height, y1);
+            issue.rect.x = std::min(issue.rect.x, x0);
+            issue.rect.y = std::min(issue.rect.y, y0);
+            issue.rect.width = right - issue.rect.x;
+            issue.rect.height = bottom - issue.rect.y;
+            if (t.ratio < issue.ratio) {
+                issue.foreground = t.foreground;
+                issue.background = t.background;
+                issue.ratio = t.ratio;
+            }
+        }
+    }
+
+    std::stable_sort(issues.begin(), issues.end(), [](const ContrastIssue& a, const ContrastIssue& b) {
+        return a.ratio < b.ratio;
+    });
+    if (summary) *summary = counts;
+}
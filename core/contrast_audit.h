@@ -0,0 +1,47 @@
+#pragma once
+
+// WCAG 2.x contrast audit for screen regions and image files. The region is
+// cut into square tiles that are analysed in parallel: each tile finds its
+// background (the most common color), segments the pixels that stand out
+// from it, and keeps only tiles whose ink is mostly thin strokes closed
+// by background on both sides, i.e. text rather than photos, gradients or
+// the edges of solid blocks. Failing tiles with the same colors are merged
+// into one issue.
+
+#include <vector>
+
+#include "color_core.h"
+#include "screen_source.h"
+
+struct AuditOptions {
+    float minRatio = 4.5f;          // AA body text; 3 for large text, 7 for AAA
+    int tileSize = 32;              // pixels, 8-256
+    int threads = 0;                // 0 = one per core
+};
+
+struct ContrastIssue {
+    CaptureRect rect;               // bounding box of the merged tiles
+    Color foreground;
+    Color background;
+    float ratio;                    // 1-21, the worst tile in the box
+};
+
+struct AuditSummary {
+    int tiles;
+    int textTiles;                  // tiles that looked like text
+    int failingTiles;
+};
+
+const int kMinAuditTile = 8;
+const int kMaxAuditTile = 256;
+
+// WCAG relative luminance (0-1) and contrast ratio (1-21)
+float RelativeLuminance(Color color);
+float ContrastRatio(float luminance1, float luminance2);
+
+// Relative luminance of every pixel, width * height values row by row
+void ViewToLuminance(const PixelView& view, float* out);
+
+// Fills `issues` with the failing regions, lowest ratio first
+void AuditContrast(const PixelView& view, const AuditOptions& options,
+                   std::vector<ContrastIssue>& issues, AuditSummary* summary = NULL);
@@ -0,0 +1,234 @@
+#include "image_io.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+PixelView Image::View() const {
+    PixelView view = {pixels.data(), width, height, Stride(), format};
+    return view;
+}
+
+void Image::Allocate(int w, int h, PixelFormat fmt) {
+    width = w;
+    height = h;
+    format = fmt;
+    pixels.assign(Stride() * h, 0);
+}
+
+namespace {
+
+bool IsSpace(uint8_t c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// Next header token of a PPM file, skipping whitespace and # comments
+bool ReadPPMToken(const uint8_t* data, size_t size, size_t& pos, int& value) {
+    while (pos < size) {
+        if (data[pos] == '#') {
+            while (pos < size && data[pos] != '\n') pos++;
+        } else if (IsSpace(data[pos])) {
+            pos++;
+        } else {
+            break;
+        }
+    }
+    if (pos >= size || data[pos] < '0' || data[pos] > '9') return false;
+    
+    value = 0;
+    while (pos < size && data[pos] >= '0' && data[pos] <= '9') {
+        if (value > 100000000) return false;
+        value = value * 10 + (data[pos] - '0');
+        pos++;
+    }
+    // Exactly one whitespace byte separates the header from the raster
+    if (pos >= size || !IsSpace(data[pos])) return false;
+    pos++;
+    return true;
+}
+
+uint32_t ReadLE32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+uint16_t ReadLE16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+} // namespace
+
+MappedImage::MappedImage() {
+    m_view.data = NULL;
+    m_view.width = 0;
+    m_view.height = 0;
+    m_view.stride = 0;
+    m_view.format = PixelFormat::RGB24;
+}
+
+void MappedImage::Close() {
+    m_file.Close();
+    m_converted = Image();
+    m_view.data = NULL;
+    m_view.width = 0;
+    m_view.height = 0;
+}
+
+bool MappedImage::Open(const char* path, std::string& error) {
+    Close();
+    if (!m_file.Open(path, error)) return false;
+    
+    const uint8_t* data = m_file.Data();
+    bool ok;
+    if (m_file.Size() >= 2 && data[0] == 'P' && data[1] == '6') {
+        ok = OpenPPM(path, error);
+    } else if (m_file.Size() >= 2 && data[0] == 'B' && data[1] == 'M') {
+        ok = OpenBMP(path, error);
+    } else {
+        error = std::string(path) + ": unsupported format (expected binary PPM or BMP)";
+        ok = false;
+    }
+    
+    if (!ok) {
+        Close();
+    } else if (m_view.data == m_converted.pixels.data()) {
+        m_file.Close();
+    }
+    return ok;
+}
+
+bool MappedImage::OpenPPM(const char* path, std::string& error) {
+    const uint8_t* data = m_file.Data();
+    size_t size = m_file.Size();
+    size_t pos = 2;
+    
+    int width, height, maxVal;
+    bool ok = ReadPPMToken(data, size, pos, width) && ReadPPMToken(data, size, pos, height) &&
+              ReadPPMToken(data, size, pos, maxVal) &&
+              width > 0 && height > 0 && maxVal > 0 && maxVal < 256;
+    if (!ok) {
+        error = std::string(path) + ": not a binary PPM (P6) with 8-bit samples";
+        return false;
+    }
+    
+    uint64_t bytes = (uint64_t)width * height * 3;
+    if (bytes > size - pos) {
+        error = std::string(path) + ": truncated pixel data";
+        return false;
+    }
+    
+    PixelView view = {data + pos, width, height, (size_t)width * 3, PixelFormat::RGB24};
+    if (maxVal == 255) {
+        m_view = view;
+        return true;
+    }
+    
+    m_converted.Allocate(width, height, PixelFormat::RGB24);
+    for (size_t i = 0; i < m_converted.pixels.size(); i++) {
+        m_converted.pixels[i] = (uint8_t)(std::min((int)view.data[i], maxVal) * 255 / maxVal);
+    }
+    m_view = m_converted.View();
+    return true;
+}
+
+bool MappedImage::OpenBMP(const char* path, std::string& error) {
+    const uint8_t* data = m_file.Data();
+    size_t size = m_file.Size();
+    if (size < 54 || ReadLE32(data + 14) < 40) {
+        error = std::string(path) + ": unsupported BMP header";
+        return false;
+    }
+    
+    uint32_t offset = ReadLE32(data + 10);
+    int width = (int)ReadLE32(data + 18);
+    int64_t rawHeight = (int32_t)ReadLE32(data + 22);
+    int bitCount = ReadLE16(data + 28);
+    uint32_t compression = ReadLE32(data + 30);
+    bool topDown = rawHeight < 0;
+    int height = (int)std::min<int64_t>(topDown ? -rawHeight : rawHeight, 2000000);
+    
+    // BI_RGB, or BI_BITFIELDS carrying the standard BGRA masks
+    bool standardMasks = compression == 3 && bitCount == 32 && size >= 66 &&
+                         ReadLE32(data + 54) == 0x00FF0000 && ReadLE32(data + 58) == 0x0000FF00 &&
+                         ReadLE32(data + 62) == 0x000000FF;
+    if ((bitCount != 24 && bitCount != 32) || (compression != 0 && !standardMasks) ||
+        width <= 0 || height <= 0 || width > 1000000 || height > 1000000) {
+        error = std::string(path) + ": only uncompressed 24-bit and 32-bit BMP files are supported";
+        return false;
+    }
+    
+    size_t stride = ((size_t)width * bitCount + 31) / 32 * 4;
+    if (offset > size || (uint64_t)stride * height > size - offset) {
+        error = std::string(path) + ": truncated pixel data";
+        return false;
+    }
+    
+    const uint8_t* raster = data + offset;
+    if (bitCount == 32 && topDown) {
+        PixelView view = {raster, width, height, stride, PixelFormat::BGRA32};
+        m_view = view;
+        return true;
+    }
+    
+    // Flip bottom-up rows, and swizzle 24-bit BGR into RGB24
+    if (bitCount == 32) {
+        m_converted.Allocate(width, height, PixelFormat::BGRA32);
+    } else {
+        m_converted.Allocate(width, height, PixelFormat::RGB24);
+    }
+    size_t dstStride = m_converted.Stride();
+    for (int y = 0; y < height; y++) {
+        const uint8_t* src = raster + stride * (size_t)(topDown ? y : height - 1 - y);
+        uint8_t* dst = m_converted.pixels.data() + dstStride * y;
+        if (bitCount == 32) {
+            memcpy(dst, src, dstStride);
+        } else {
+            for (int x = 0; x < width; x++) {
+                dst[x * 3] = src[x * 3 + 2];
+                dst[x * 3 + 1] = src[x * 3 + 1];
+                dst[x * 3 + 2] = src[x * 3];
+            }
+        }
+    }
+    m_view = m_converted.View();
+    return true;
+}
+
+bool ReadImageFile(const char* path, Image& image, std::string& error) {
+    MappedImage mapped;
+    if (!mapped.Open(path, error)) return false;
+    
+    const PixelView& view = mapped.View();
+    image.Allocate(view.width, view.height, view.format);
+    size_t stride = image.Stride();
+    for (int y = 0; y < view.height; y++) {
+        memcpy(image.pixels.data() + stride * y, view.data + view.stride * y, stride);
+    }
+    return true;
+}
+
+bool WritePPM(const char* path, const PixelView& view, std::string& error) {
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        error = std::string("cannot create ") + path;
+        return false;
+    }
+    
+    bool ok = fprintf(file, "P6\n%d %d\n255\n", view.width, view.height) > 0;
+    std::vector<uint8_t> row((size_t)view.width * 3);
+    for (int y = 0; y < view.height && ok; y++) {
+        const uint8_t* p = view.data + view.stride * y;
+        if (view.format == PixelFormat::RGB24) {
+            memcpy(row.data(), p, row.size());
+        } else {
+            for (int x = 0; x < view.width; x++, p += 4) {
+                row[x * 3] = p[2];
+                row[x * 3 + 1] = p[1];
+                row[x * 3 + 2] = p[0];
+            }
+        }
+        ok = fwrite(row.data(), 1, row.size(), file) == row.size();
+    }
+    if (fclose(file) != 0) ok = false;
+    if (!ok) error = std::string("cannot write ") + path;
+    return ok;
+}
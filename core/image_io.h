@@ -0,0 +1,52 @@
+#pragma once
+
+// In-memory images and image file readers for headless use
+
+#include <string>
+#include <vector>
+
+#include "color_core.h"
+#include "mapped_file.h"
+
+// Owned top-down pixel buffer
+struct Image {
+    int width = 0;
+    int height = 0;
+    PixelFormat format = PixelFormat::RGB24;
+    std::vector<uint8_t> pixels;
+    
+    size_t Stride() const { return (size_t)width * (format == PixelFormat::RGB24 ? 3 : 4); }
+    PixelView View() const;
+    void Allocate(int w, int h, PixelFormat fmt);
+};
+
+// Image file opened through a memory mapping. Binary PPM (P6) with 8-bit
+// samples and top-down 32-bit BMP rasters are viewed in place; other
+// layouts (bottom-up or 24-bit BMP, PPM with maxval below 255) are
+// converted once into an owned buffer and the mapping is released.
+class MappedImage {
+public:
+    MappedImage();
+    
+    bool Open(const char* path, std::string& error);
+    void Close();
+    
+    // Valid until Close or the next Open
+    const PixelView& View() const { return m_view; }
+    bool IsZeroCopy() const { return m_file.Data() != NULL; }
+
+private:
+    bool OpenPPM(const char* path, std::string& error);
+    bool OpenBMP(const char* path, std::string& error);
+    
+    MappedFile m_file;
+    Image m_converted;
+    PixelView m_view;
+};
+
+// Read a binary PPM (P6) or uncompressed 24/32-bit BMP into an owned image.
+// Returns false and sets error on failure.
+bool ReadImageFile(const char* path, Image& image, std::string& error);
+
+// Write a view as binary PPM (P6); BGRA32 views lose their alpha
+bool WritePPM(const char* path, const PixelView& view, std::string& error);
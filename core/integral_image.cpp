@@ -0,0 +1,75 @@
+#include "integral_image.h"
+
+#include <algorithm>
+
+namespace {
+
+template <int RI, int GI, int BI, int Step>
+void BuildRows(const PixelView& view, uint32_t* sums) {
+    const size_t rowSize = ((size_t)view.width + 1) * 3;
+    for (int y = 0; y < view.height; y++) {
+        const uint8_t* p = view.data + view.stride * y;
+        const uint32_t* above = sums + rowSize * y;
+        uint32_t* row = sums + rowSize * (y + 1);
+        uint32_t r = 0, g = 0, b = 0;
+        for (int x = 0; x < view.width; x++, p += Step) {
+            r += p[RI];
+            g += p[GI];
+            b += p[BI];
+            row[(x + 1) * 3] = above[(x + 1) * 3] + r;
+            row[(x + 1) * 3 + 1] = above[(x + 1) * 3 + 1] + g;
+            row[(x + 1) * 3 + 2] = above[(x + 1) * 3 + 2] + b;
+        }
+    }
+}
+
+} // namespace
+
+void IntegralImage::Build(const PixelView& view) {
+    m_width = view.width;
+    m_height = view.height;
+    const size_t rowSize = ((size_t)m_width + 1) * 3;
+    m_sums.resize(rowSize * (m_height + 1));
+    
+    // Row 0 and column 0 stay zero
+    std::fill(m_sums.begin(), m_sums.begin() + rowSize, 0);
+    for (int y = 1; y <= m_height; y++) {
+        uint32_t* row = &m_sums[rowSize * y];
+        row[0] = row[1] = row[2] = 0;
+    }
+    
+    if (view.format == PixelFormat::BGRA32) {
+        BuildRows<2, 1, 0, 4>(view, m_sums.data());
+    } else {
+        BuildRows<0, 1, 2, 3>(view, m_sums.data());
+    }
+}
+
+uint32_t IntegralImage::Sum(int x, int y, int width, int height, uint32_t sum[3]) const {
+    int x0 = std::max(x, 0);
+    int y0 = std::max(y, 0);
+    int x1 = std::min(x + width, m_width);
+    int y1 = std::min(y + height, m_height);
+    if (x1 <= x0 || y1 <= y0) {
+        sum[0] = sum[1] = sum[2] = 0;
+        return 0;
+    }
+    
+    const size_t rowSize = ((size_t)m_width + 1) * 3;
+    const uint32_t* top = &m_sums[rowSize * y0];
+    const uint32_t* bottom = &m_sums[rowSize * y1];
+    for (int c = 0; c < 3; c++) {
+        sum[c] = bottom[x1 * 3 + c] - bottom[x0 * 3 + c] - top[x1 * 3 + c] + top[x0 * 3 + c];
+    }
+    return (uint32_t)(x1 - x0) * (uint32_t)(y1 - y0);
+}
+
+bool IntegralImage::Mean(int x, int y, int width, int height, Color& mean) const {
+    uint32_t sum[3];
+    uint32_t area = Sum(x, y, width, height, sum);
+    if (area == 0) return false;
+    
+    mean = MakeColor((int)(((uint64_t)sum[0] + area / 2) / area), (int)(((uint64_t)sum[1] + area / 2) / area),
+                     (int)(((uint64_t)sum[2] + area / 2) / area));
+    return true;
+}
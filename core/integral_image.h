@@ -0,0 +1,31 @@
+#pragma once
+
+// Summed-area table over an RGB region, giving the sum or mean of any
+// rectangle from four lookups. Sums are kept modulo 2^32 per channel: the
+// four-corner difference is still exact for any rectangle of up to 16.8
+// million pixels, however large the table itself is.
+
+#include <vector>
+
+#include "color_core.h"
+
+class IntegralImage {
+public:
+    IntegralImage() : m_width(0), m_height(0) {}
+    
+    // One pass over the view; the table is reused across calls
+    void Build(const PixelView& view);
+    
+    int Width() const { return m_width; }
+    int Height() const { return m_height; }
+    
+    // Channel sums of a rectangle, clipped to the table; returns its area
+    uint32_t Sum(int x, int y, int width, int height, uint32_t sum[3]) const;
+    // Rounded mean of a rectangle, clipped to the table; false when empty
+    bool Mean(int x, int y, int width, int height, Color& mean) const;
+
+private:
+    int m_width;
+    int m_height;
+    std::vector<uint32_t> m_sums;   // (width + 1) * (height + 1) entries of r, g, b
+};
@@ -0,0 +1,69 @@
+#include "magnifier.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// B, G, R, A bytes as one little-endian word
+inline uint32_t PackBGRA(Color c) {
+    return 0xFF000000u | ((uint32_t)c.r << 16) | ((uint32_t)c.g << 8) | c.b;
+}
+
+inline Color GridShade(Color c) {
+    return MakeColor(c.r * 3 / 4, c.g * 3 / 4, c.b * 3 / 4);
+}
+
+inline uint32_t* Row(uint8_t* dst, size_t stride, int y) {
+    return (uint32_t*)(dst + stride * y);
+}
+
+} // namespace
+
+void RenderLoupe(const PixelView& src, const LoupeStyle& style, uint8_t* dst, size_t dstStride) {
+    const int scale = std::max(1, std::min(style.scale, kMaxLoupeScale));
+    const bool grid = style.grid && scale >= 3;
+    const size_t bpp = src.format == PixelFormat::RGB24 ? 3 : 4;
+    const size_t rowBytes = (size_t)src.width * scale * 4;
+    
+    for (int sy = 0; sy < src.height; sy++) {
+        const uint8_t* in = src.data + src.stride * sy;
+        int top = sy * scale;
+        
+        // Expand one source row into the first body row of its cells, then
+        // replicate that row; per-pixel work is a single fill
+        uint32_t* body = Row(dst, dstStride, top + (grid ? 1 : 0));
+        uint32_t* gridRow = Row(dst, dstStride, top);
+        for (int sx = 0; sx < src.width; sx++, in += bpp) {
+            Color c = bpp == 3 ? MakeColor(in[0], in[1], in[2]) : MakeColor(in[2], in[1], in[0]);
+            uint32_t* cell = body + sx * scale;
+            std::fill(cell, cell + scale, PackBGRA(c));
+            if (grid) {
+                uint32_t shade = PackBGRA(GridShade(c));
+                cell[0] = shade;
+                std::fill(gridRow + sx * scale, gridRow + (sx + 1) * scale, shade);
+            }
+        }
+        for (int r = (grid ? 2 : 1); r < scale; r++) {
+            memcpy(Row(dst, dstStride, top + r), body, rowBytes);
+        }
+    }
+    
+    if (style.crosshair && src.width > 0 && src.height > 0) {
+        // Frame inside the centre cell, contrasting with its color
+        int cx = src.width / 2;
+        int cy = src.height / 2;
+        Color c = PixelAt(src, cx, cy);
+        bool light = c.r * 299 + c.g * 587 + c.b * 114 > 128 * 1000;
+        uint32_t frame = light ? PackBGRA(MakeColor(0, 0, 0)) : PackBGRA(MakeColor(255, 255, 255));
+        
+        int x0 = cx * scale, x1 = x0 + scale - 1;
+        int y0 = cy * scale, y1 = y0 + scale - 1;
+        std::fill(Row(dst, dstStride, y0) + x0, Row(dst, dstStride, y0) + x1 + 1, frame);
+        std::fill(Row(dst, dstStride, y1) + x0, Row(dst, dstStride, y1) + x1 + 1, frame);
+        for (int y = y0 + 1; y < y1; y++) {
+            Row(dst, dstStride, y)[x0] = frame;
+            Row(dst, dstStride, y)[x1] = frame;
+        }
+    }
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+// Nearest-neighbour magnification for the loupe. Output is BGRA32 so the
+// GUI can render straight into a DIB section without conversion.
+
+#include "color_core.h"
+
+struct LoupeStyle {
+    int scale = 8;          // output pixels per source pixel, 1-64
+    bool grid = true;       // darken the top and left edge of every cell
+    bool crosshair = true;  // frame the centre cell in black or white
+};
+
+const int kMaxLoupeScale = 64;
+
+// Renders src magnified into dst, which must hold src.width * scale by
+// src.height * scale BGRA32 pixels with 4-byte aligned rows. No allocation.
+void RenderLoupe(const PixelView& src, const LoupeStyle& style, uint8_t* dst, size_t dstStride);
@@ -0,0 +1,107 @@
+#include "mapped_file.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const char* path, std::string& error) {
+    Close();
+    
+    HANDLE hFile = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                               FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (hFile == INVALID_HANDLE_VALUE) {
+        error = std::string("cannot open ") + path;
+        return false;
+    }
+    
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(hFile, &size) || (uint64_t)size.QuadPart > (uint64_t)SIZE_MAX) {
+        CloseHandle(hFile);
+        error = std::string(path) + ": cannot determine file size";
+        return false;
+    }
+    if (size.QuadPart == 0) {
+        CloseHandle(hFile);
+        return true;
+    }
+    
+    // The mapping keeps its own reference, so the file handle can go now
+    HANDLE hMapping = CreateFileMappingA(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(hFile);
+    if (!hMapping) {
+        error = std::string(path) + ": cannot map file";
+        return false;
+    }
+    
+    void* data = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+    if (!data) {
+        CloseHandle(hMapping);
+        error = std::string(path) + ": cannot map file";
+        return false;
+    }
+    
+    m_handle = hMapping;
+    m_data = (const uint8_t*)data;
+    m_size = (size_t)size.QuadPart;
+    return true;
+}
+
+void MappedFile::Close() {
+    if (m_data) UnmapViewOfFile(m_data);
+    if (m_handle) CloseHandle((HANDLE)m_handle);
+    m_data = NULL;
+    m_size = 0;
+    m_handle = NULL;
+}
+
+#else
+
+bool MappedFile::Open(const char* path, std::string& error) {
+    Close();
+    
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        error = std::string("cannot open ") + path;
+        return false;
+    }
+    
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        error = std::string(path) + ": not a regular file";
+        return false;
+    }
+    if (st.st_size == 0) {
+        close(fd);
+        return true;
+    }
+    
+    // The mapping outlives the descriptor
+    void* data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        error = std::string(path) + ": cannot map file";
+        return false;
+    }
+    
+    m_data = (const uint8_t*)data;
+    m_size = (size_t)st.st_size;
+    return true;
+}
+
+void MappedFile::Close() {
+    if (m_data) munmap((void*)m_data, m_size);
+    m_data = NULL;
+    m_size = 0;
+}
+
+#endif
@@ -0,0 +1,30 @@
+#pragma once
+
+// Read-only memory mapping of a whole file. The only platform-specific
+// code in core/; Windows and POSIX backends are selected at compile time.
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+class MappedFile {
+public:
+    MappedFile() : m_data(NULL), m_size(0), m_handle(NULL) {}
+    ~MappedFile() { Close(); }
+    
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    
+    // Maps the file, replacing any previous mapping. Empty files map to a
+    // zero-length view with no data pointer.
+    bool Open(const char* path, std::string& error);
+    void Close();
+    
+    const uint8_t* Data() const { return m_data; }
+    size_t Size() const { return m_size; }
+
+private:
+    const uint8_t* m_data;
+    size_t m_size;
+    void* m_handle;     // mapping object on Windows, unused elsewhere
+};
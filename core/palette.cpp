@@ -0,0 +1,338 @@
+#include "palette.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+// Fixed-size best-k list, sorted ascending by distance
+struct Neighbours {
+    int k;
+    int count;
+    int indices[PointIndex::kMaxNeighbours];
+    float dist2[PointIndex::kMaxNeighbours];
+    
+    float Worst() const {
+        return count < k ? INFINITY : dist2[count - 1];
+    }
+    
+    float Offer(int index, float d) {
+        if (d >= Worst()) return Worst();
+        int i = count < k ? count++ : count - 1;
+        while (i > 0 && dist2[i - 1] > d) {
+            dist2[i] = dist2[i - 1];
+            indices[i] = indices[i - 1];
+            i--;
+        }
+        dist2[i] = d;
+        indices[i] = index;
+        return Worst();
+    }
+};
+
+} // namespace
+
+void PointIndex::Build(const std::vector<Point>& points) {
+    m_nodes.resize(points.size());
+    for (size_t i = 0; i < points.size(); i++) {
+        m_nodes[i].p = points[i];
+        m_nodes[i].index = (int)i;
+        m_nodes[i].axis = 0;
+    }
+    BuildRange(0, (int)m_nodes.size());
+}
+
+// The median of [lo, hi) along the widest axis becomes the node at the
+// midpoint; each half is built the same way, so no child pointers are needed.
+void PointIndex::BuildRange(int lo, int hi) {
+    if (hi - lo <= 1) return;
+    
+    float minV[3] = {INFINITY, INFINITY, INFINITY};
+    float maxV[3] = {-INFINITY, -INFINITY, -INFINITY};
+    for (int i = lo; i < hi; i++) {
+        for (int a = 0; a < 3; a++) {
+            minV[a] = std::min(minV[a], m_nodes[i].p.v[a]);
+            maxV[a] = std::max(maxV[a], m_nodes[i].p.v[a]);
+        }
+    }
+    int axis = 0;
+    for (int a = 1; a < 3; a++) {
+        if (maxV[a] - minV[a] > maxV[axis] - minV[axis]) axis = a;
+    }
+    
+    int mid = lo + (hi - lo) / 2;
+    std::nth_element(m_nodes.begin() + lo, m_nodes.begin() + mid, m_nodes.begin() + hi,
+                     [axis](const Node& x, const Node& y) { return x.p.v[axis] < y.p.v[axis]; });
+    m_nodes[mid].axis = axis;
+    
+    BuildRange(lo, mid);
+    BuildRange(mid + 1, hi);
+}
+
+int PointIndex::Nearest(const Point& query, int k, int* indices, float* dist2) const {
+    Neighbours best;
+    best.k = std::max(1, std::min(k, (int)kMaxNeighbours));
+    best.count = 0;
+    Search(query, [&best](int index, float d) { return best.Offer(index, d); });
+    
+    for (int i = 0; i < best.count; i++) {
+        indices[i] = best.indices[i];
+        dist2[i] = best.dist2[i];
+    }
+    return best.count;
+}
+
+namespace {
+
+int HexDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Strip whitespace and the quoting/punctuation found around names in CSS,
+// JSON and plain lists
+std::string TrimName(const char* begin, const char* end) {
+    const char* junk = " \t\r\n:;,=\"'{}()";
+    while (begin < end && strchr(junk, *begin)) begin++;
+    while (end > begin && strchr(junk, end[-1])) end--;
+    return std::string(begin, end);
+}
+
+// First #RGB or #RRGGBB on the line; '#' not followed by exactly 3 or 6 hex
+// digits is treated as ordinary text
+bool FindHexColor(const char* line, const char*& start, const char*& end, Color& color) {
+    for (const char* p = strchr(line, '#'); p; p = strchr(p + 1, '#')) {
+        int n = 0;
+        while (HexDigit(p[1 + n]) >= 0) n++;
+        if (n == 6) {
+            int v[6];
+            for (int i = 0; i < 6; i++) v[i] = HexDigit(p[1 + i]);
+            color = MakeColor(v[0] * 16 + v[1], v[2] * 16 + v[3], v[4] * 16 + v[5]);
+        } else if (n == 3) {
+            color = MakeColor(HexDigit(p[1]) * 17, HexDigit(p[2]) * 17, HexDigit(p[3]) * 17);
+        } else {
+            continue;
+        }
+        start = p;
+        end = p + 1 + n;
+        return true;
+    }
+    return false;
+}
+
+// "R G B name" line of a GIMP palette
+bool ParseGimpLine(const char* line, Color& color, std::string& name) {
+    int r, g, b, used = 0;
+    if (sscanf(line, " %d %d %d%n", &r, &g, &b, &used) != 3) return false;
+    if (r < 0 || r > 255 || g < 0 || g > 255 || b < 0 || b > 255) return false;
+    
+    color = MakeColor(r, g, b);
+    name = TrimName(line + used, line + strlen(line));
+    return true;
+}
+
+} // namespace
+
+bool Palette::LoadFile(const char* path, std::string& error) {
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        error = std::string("cannot open ") + path;
+        return false;
+    }
+    
+    char line[1024];
+    bool gimp = false;
+    int lineNumber = 0;
+    size_t added = 0;
+    while (fgets(line, sizeof(line), f)) {
+        lineNumber++;
+        if (lineNumber == 1 && strncmp(line, "GIMP Palette", 12) == 0) {
+            gimp = true;
+            continue;
+        }
+        
+        Color color;
+        std::string name;
+        if (gimp) {
+            if (line[0] == '#' || !ParseGimpLine(line, color, name)) continue;
+        } else {
+            const char* hexStart;
+            const char* hexEnd;
+            if (strncmp(line, "//", 2) == 0 || !FindHexColor(line, hexStart, hexEnd, color)) continue;
+            
+            name = TrimName(line, hexStart);
+            std::string after = TrimName(hexEnd, line + strlen(line));
+            if (!after.empty()) {
+                name += name.empty() ? after : " " + after;
+            }
+        }
+        
+        if (name.empty()) name = ColorToHex(color);
+        Add(name, color);
+        added++;
+    }
+    fclose(f);
+    
+    if (added == 0) {
+        error = std::string(path) + ": no colors found";
+        return false;
+    }
+    return true;
+}
+
+void Palette::Add(const std::string& name, Color color) {
+    PaletteEntry entry = {name, color};
+    m_entries.push_back(entry);
+}
+
+void Palette::Clear() {
+    m_entries.clear();
+    BuildIndex();
+}
+
+void Palette::BuildIndex() {
+    m_oklab.resize(m_entries.size());
+    m_lab.resize(m_entries.size());
+    
+    std::vector<PointIndex::Point> oklabPoints(m_entries.size());
+    std::vector<PointIndex::Point> labPoints(m_entries.size());
+    for (size_t i = 0; i < m_entries.size(); i++) {
+        m_oklab[i] = ColorToOKLab(m_entries[i].color);
+        m_lab[i] = ColorToLab(m_entries[i].color);
+        oklabPoints[i] = {{m_oklab[i].l, m_oklab[i].a, m_oklab[i].b}};
+        labPoints[i] = {{m_lab[i].l, m_lab[i].a, m_lab[i].b}};
+    }
+    m_oklabIndex.Build(oklabPoints);
+    m_labIndex.Build(labPoints);
+}
+
+namespace {
+
+// CIEDE2000 is not Euclidean, but across the sRGB gamut Delta E 1976 never
+// exceeds about 9 times CIEDE2000 (the chroma and hue weights top out near
+// there). Any entry further than this factor times the best CIEDE2000 found
+// so far therefore cannot win, which bounds the Lab tree search.
+const float kDeltaE76PerDeltaE2000 = 10.0f;
+
+// The lightness term alone is |dL| / SL with SL at most 1.75, and the chroma
+// and hue terms never sum below zero, so a wider lightness gap than this
+// factor times the best found rules an entry out without the full formula.
+const float kLightnessPerDeltaE2000 = 1.75f;
+
+} // namespace
+
+int Palette::Nearest(Color color, PaletteMetric metric, float* distance) const {
+    if (m_oklabIndex.Empty()) return -1;
+    
+    if (metric == PaletteMetric::OKLab) {
+        OKLabValue q = ColorToOKLab(color);
+        PointIndex::Point p = {{q.l, q.a, q.b}};
+        int index;
+        float dist2;
+        m_oklabIndex.Nearest(p, 1, &index, &dist2);
+        if (distance) *distance = sqrtf(dist2);
+        return index;
+    }
+    return NearestWithin(color, metric, INFINITY, distance);
+}
+
+int Palette::NearestWithin(Color color, PaletteMetric metric, float maxDistance, float* distance) const {
+    if (m_oklabIndex.Empty()) return -1;
+    
+    int bestIndex = -1;
+    if (metric == PaletteMetric::OKLab) {
+        OKLabValue q = ColorToOKLab(color);
+        PointIndex::Point p = {{q.l, q.a, q.b}};
+        float best2 = maxDistance * maxDistance;
+        m_oklabIndex.Search(p, [&](int index, float dist2) {
+            if (dist2 < best2 || (dist2 == best2 && (bestIndex < 0 || index < bestIndex))) {
+                best2 = dist2;
+                bestIndex = index;
+            }
+            return best2;
+        });
+        if (distance) *distance = bestIndex < 0 ? INFINITY : sqrtf(best2);
+        return bestIndex;
+    }
+    
+    LabValue q = ColorToLab(color);
+    PointIndex::Point p = {{q.l, q.a, q.b}};
+    float bestDistance = maxDistance;
+    m_labIndex.Search(p, [&](int index, float dist2) {
+        float limit = bestDistance * kDeltaE76PerDeltaE2000;
+        if (dist2 <= limit * limit && fabsf(q.l - m_lab[index].l) <= bestDistance * kLightnessPerDeltaE2000) {
+            float d = DeltaE2000(q, m_lab[index]);
+            if (d < bestDistance || (d == bestDistance && (bestIndex < 0 || index < bestIndex))) {
+                bestDistance = d;
+                bestIndex = index;
+                limit = bestDistance * kDeltaE76PerDeltaE2000;
+            }
+        }
+        return limit * limit;
+    });
+    if (distance) *distance = bestIndex < 0 ? INFINITY : bestDistance;
+    return bestIndex;
+}
+
+int Palette::NearestLinear(Color color, PaletteMetric metric, float* distance) const {
+    if (m_entries.empty()) return -1;
+    
+    OKLabValue okq = ColorToOKLab(color);
+    LabValue labq = ColorToLab(color);
+    int bestIndex = 0;
+    float bestDistance = INFINITY;
+    for (size_t i = 0; i < m_entries.size(); i++) {
+        float d = metric == PaletteMetric::OKLab ? OKLabDistance(okq, m_oklab[i])
+                                                 : DeltaE2000(labq, m_lab[i]);
+        if (d < bestDistance) {
+            bestDistance = d;
+            bestIndex = (int)i;
+        }
+    }
+    if (distance) *distance = bestDistance;
+    return bestIndex;
+}
+
+void Palette::NearestBatch(const PixelView& view, PaletteMetric metric, int* out) const {
+    // Screen regions repeat colors heavily, so a small direct-mapped cache
+    // keyed on the packed RGB value absorbs most of the tree queries
+    const int kCacheSize = 4096;
+    std::vector<uint32_t> keys(kCacheSize, 0xFFFFFFFFu);
+    std::vector<int> values(kCacheSize);
+    
+    for (int y = 0; y < view.height; y++) {
+        for (int x = 0; x < view.width; x++) {
+            Color c = PixelAt(view, x, y);
+            uint32_t key = ((uint32_t)c.r << 16) | ((uint32_t)c.g << 8) | c.b;
+            uint32_t slot = (key * 2654435761u) >> 20;
+            if (keys[slot] != key) {
+                keys[slot] = key;
+                values[slot] = Nearest(c, metric);
+            }
+            *out++ = values[slot];
+        }
+    }
+}
+
+const char* PaletteMetricName(PaletteMetric metric) {
+    switch (metric) {
+        case PaletteMetric::OKLab:      return "oklab";
+        case PaletteMetric::DeltaE2000: return "de2000";
+    }
+    return "";
+}
+
+bool ParsePaletteMetric(const char* name, PaletteMetric& metric) {
+    if (strcmp(name, "oklab") == 0) {
+        metric = PaletteMetric::OKLab;
+    } else if (strcmp(name, "de2000") == 0) {
+        metric = PaletteMetric::DeltaE2000;
+    } else {
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+// Named color palettes with a spatial index for nearest-color queries
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "color_core.h"
+#include "color_spaces.h"
+
+enum class PaletteMetric {
+    OKLab,          // Euclidean distance in OKLab, exact
+    DeltaE2000      // CIEDE2000, searched within a bounded Lab radius
+};
+
+struct PaletteEntry {
+    std::string name;
+    Color color;
+};
+
+// Balanced 3-d tree over float points, stored implicitly in one array
+class PointIndex {
+public:
+    struct Point {
+        float v[3];
+    };
+    
+    void Build(const std::vector<Point>& points);
+    bool Empty() const { return m_nodes.empty(); }
+    
+    // Up to k (<= kMaxNeighbours) nearest points by squared Euclidean
+    // distance, closest first. Returns the number found.
+    static const int kMaxNeighbours = 16;
+    int Nearest(const Point& query, int k, int* indices, float* dist2) const;
+    
+    // Calls visit(index, dist2) for candidate points, nearer side first.
+    // visit returns the squared radius that remains of interest, inclusive;
+    // subtrees entirely outside it are skipped.
+    template <typename Visit>
+    void Search(const Point& query, Visit visit) const;
+
+private:
+    struct Node {
+        Point p;
+        int index;
+        int axis;
+    };
+    
+    void BuildRange(int lo, int hi);
+    
+    std::vector<Node> m_nodes;
+};
+
+template <typename Visit>
+void PointIndex::Search(const Point& query, Visit visit) const {
+    // Explicit stack of pending ranges with a lower bound on their distance.
+    // Depth is log2 of the point count, so 64 slots never overflow.
+    struct Range {
+        int lo, hi;
+        float bound;
+    };
+    Range stack[64];
+    int top = 0;
+    stack[top++] = {0, (int)m_nodes.size(), 0.0f};
+    float radius2 = INFINITY;
+    
+    while (top > 0) {
+        Range r = stack[--top];
+        if (r.lo >= r.hi || r.bound > radius2) continue;
+        
+        int mid = r.lo + (r.hi - r.lo) / 2;
+        const Node& node = m_nodes[mid];
+        float d0 = node.p.v[0] - query.v[0];
+        float d1 = node.p.v[1] - query.v[1];
+        float d2 = node.p.v[2] - query.v[2];
+        radius2 = visit(node.index, d0 * d0 + d1 * d1 + d2 * d2);
+        
+        // Push the far side first so the near side is searched first
+        float diff = query.v[node.axis] - node.p.v[node.axis];
+        float farBound = r.bound > diff * diff ? r.bound : diff * diff;
+        Range left = {r.lo, mid, diff < 0 ? r.bound : farBound};
+        Range right = {mid + 1, r.hi, diff < 0 ? farBound : r.bound};
+        stack[top++] = diff < 0 ? right : left;
+        stack[top++] = diff < 0 ? left : right;
+    }
+}
+
+class Palette {
+public:
+    // Append entries from a text file. Accepts GIMP .gpl palettes
+    // ("R G B name") and any line holding a #RGB/#RRGGBB value together with
+    // a name, such as CSS custom properties ("--brand: #6366F1;").
+    bool LoadFile(const char* path, std::string& error);
+    
+    void Add(const std::string& name, Color color);
+    void Clear();
+    
+    size_t Size() const { return m_entries.size(); }
+    const PaletteEntry& Entry(size_t i) const { return m_entries[i]; }
+    
+    // Must be called after adding entries and before querying
+    void BuildIndex();
+    
+    // Index of the closest entry, or -1 for an empty palette
+    int Nearest(Color color, PaletteMetric metric, float* distance = NULL) const;
+    
+    // Closest entry no further than maxDistance, or -1. The search starts at
+    // that radius, so colors with nothing near are rejected almost at once.
+    int NearestWithin(Color color, PaletteMetric metric, float maxDistance, float* distance = NULL) const;
+    
+    // Brute-force reference for the same query
+    int NearestLinear(Color color, PaletteMetric metric, float* distance = NULL) const;
+    
+    // One index per pixel, row by row. Runs of identical pixels share a lookup.
+    void NearestBatch(const PixelView& view, PaletteMetric metric, int* out) const;
+
+private:
+    std::vector<PaletteEntry> m_entries;
+    std::vector<OKLabValue> m_oklab;
+    std::vector<LabValue> m_lab;
+    PointIndex m_oklabIndex;
+    PointIndex m_labIndex;
+};
+
+const char* PaletteMetricName(PaletteMetric metric);
+bool ParsePaletteMetric(const char* name, PaletteMetric& metric);
@@ -0,0 +1,58 @@
+#pragma once
+
+// Fork-join helper for the batch engines. Threads are started per call,
+// which costs tens of microseconds and only pays off for work measured in
+// milliseconds; small inputs should pass a thread count of 1.
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// Threads to use for a requested count; 0 or less means one per core
+inline int ResolveThreadCount(int requested) {
+    if (requested > 0) return requested;
+    unsigned n = std::thread::hardware_concurrency();
+    return n > 0 ? (int)n : 1;
+}
+
+// Splits [0, count) into at most `threads` contiguous slices and calls
+// fn(begin, end, slice) once per slice, the last one on the calling thread.
+// Slice numbers are below ResolveThreadCount(threads), so callers can keep
+// per-slice accumulators without locking. Returns the number of slices.
+template <typename Fn>
+int ParallelFor(int count, int threads, Fn fn) {
+    int slices = ResolveThreadCount(threads);
+    if (slices > count) slices = count;
+    if (slices <= 1) {
+        if (count > 0) fn(0, count, 0);
+        return count > 0 ? 1 : 0;
+    }
+    
+    std::vector<std::thread> pool;
+    pool.reserve(slices - 1);
+    for (int i = 0; i < slices - 1; i++) {
+        int begin = (int)((long long)count * i / slices);
+        int end = (int)((long long)count * (i + 1) / slices);
+        pool.emplace_back([&fn, begin, end, i]() { fn(begin, end, i); });
+    }
+    fn((int)((long long)count * (slices - 1) / slices), count, slices - 1);
+    
+    for (std::thread& t : pool) {
+        t.join();
+    }
+    return slices;
+}
+
+// Calls fn(index, worker) for every index in [0, count) from a pool of
+// threads that each take the next unclaimed index. Suits items of uneven
+// cost, such as files of different sizes. Returns the number of workers.
+template <typename Fn>
+int ParallelForEach(int count, int threads, Fn fn) {
+    std::atomic<int> next(0);
+    auto work = [&](int, int, int worker) {
+        for (int i = next.fetch_add(1); i < count; i = next.fetch_add(1)) {
+            fn(i, worker);
+        }
+    };
+    return ParallelFor(count, threads, work);
+}
@@ -0,0 +1,139 @@
+#include "perf_stats.h"
+
+#include <chrono>
+#include <cstdio>
+
+namespace {
+
+// Index of the highest set bit; v must not be zero
+inline int HighestBit(uint64_t v) {
+#if defined(__GNUC__) || defined(__clang__)
+    return 63 - __builtin_clzll(v);
+#else
+    int e = 0;
+    for (int step = 32; step > 0; step >>= 1) {
+        if (v >> step) {
+            v >>= step;
+            e += step;
+        }
+    }
+    return e;
+#endif
+}
+
+// Values below 16 get a bucket each; above that, bucket (e - 3) * 16 + s
+// covers [(16 + s) << (e - 4), (17 + s) << (e - 4)) where 2^e <= v < 2^(e+1)
+int BucketIndex(uint64_t v) {
+    if (v < (uint64_t)LatencyHistogram::kSubBuckets) return (int)v;
+    int e = HighestBit(v);
+    int sub = (int)((v >> (e - 4)) & 15);
+    return (e - 3) * LatencyHistogram::kSubBuckets + sub;
+}
+
+uint64_t BucketMidpoint(int index) {
+    if (index < LatencyHistogram::kSubBuckets) return (uint64_t)index;
+    int e = index / LatencyHistogram::kSubBuckets + 3;
+    uint64_t sub = (uint64_t)(index % LatencyHistogram::kSubBuckets);
+    uint64_t width = (uint64_t)1 << (e - 4);
+    return (16 + sub) * width + width / 2;
+}
+
+LatencyHistogram g_histograms[kPerfStageCount];
+
+} // namespace
+
+void LatencyHistogram::Record(uint64_t ns) {
+    const uint64_t kLimit = ((uint64_t)1 << kMaxExponent) - 1;
+    if (ns > kLimit) ns = kLimit;
+    m_buckets[BucketIndex(ns)].fetch_add(1, std::memory_order_relaxed);
+    m_sum.fetch_add(ns, std::memory_order_relaxed);
+    
+    uint64_t seen = m_max.load(std::memory_order_relaxed);
+    while (ns > seen && !m_max.compare_exchange_weak(seen, ns, std::memory_order_relaxed)) {
+    }
+}
+
+void LatencyHistogram::Reset() {
+    for (std::atomic<uint64_t>& bucket : m_buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    m_sum.store(0, std::memory_order_relaxed);
+    m_max.store(0, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::Count() const {
+    uint64_t n = 0;
+    for (const std::atomic<uint64_t>& bucket : m_buckets) {
+        n += bucket.load(std::memory_order_relaxed);
+    }
+    return n;
+}
+
+double LatencyHistogram::MeanNs() const {
+    uint64_t n = Count();
+    return n ? (double)m_sum.load(std::memory_order_relaxed) / n : 0.0;
+}
+
+uint64_t LatencyHistogram::PercentileNs(double p) const {
+    uint64_t n = Count();
+    if (n == 0) return 0;
+    
+    // Rank of the sample wanted, 1-based; never past the recorded maximum
+    uint64_t rank = (uint64_t)(p * n + 0.5);
+    if (rank < 1) rank = 1;
+    if (rank > n) rank = n;
+    uint64_t seen = 0;
+    for (int i = 0; i < kBuckets; i++) {
+        seen += m_buckets[i].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            uint64_t mid = BucketMidpoint(i);
+            return mid < MaxNs() ? mid : MaxNs();
+        }
+    }
+    return MaxNs();
+}
+
+LatencyHistogram& PerfHistogram(PerfStage stage) {
+    return g_histograms[(int)stage];
+}
+
+const char* PerfStageName(PerfStage stage) {
+    switch (stage) {
+        case PerfStage::Capture: return "capture";
+        case PerfStage::Hash:    return "hash";
+        case PerfStage::Reduce:  return "reduce";
+        case PerfStage::Queue:   return "queue";
+        case PerfStage::Display: return "display";
+        case PerfStage::Loupe:   return "loupe";
+        case PerfStage::Paint:   return "paint";
+    }
+    return "unknown";
+}
+
+void ResetPerfStats() {
+    for (LatencyHistogram& h : g_histograms) {
+        h.Reset();
+    }
+}
+
+std::string PerfStatsJSON() {
+    std::string json = "{\"unit\": \"us\", \"stages\": [";
+    for (int i = 0; i < kPerfStageCount; i++) {
+        const LatencyHistogram& h = g_histograms[i];
+        char entry[256];
+        snprintf(entry, sizeof(entry),
+                 "%s\n  {\"stage\": \"%s\", \"count\": %llu, \"mean\": %.3f, \"p50\": %.3f, "
+                 "\"p90\": %.3f, \"p99\": %.3f, \"max\": %.3f}",
+                 i ? "," : "", PerfStageName((PerfStage)i), (unsigned long long)h.Count(), h.MeanNs() / 1000.0,
+                 h.PercentileNs(0.50) / 1000.0, h.PercentileNs(0.90) / 1000.0, h.PercentileNs(0.99) / 1000.0,
+                 h.MaxNs() / 1000.0);
+        json += entry;
+    }
+    json += "\n]}\n";
+    return json;
+}
+
+uint64_t PerfNowNs() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+// Latency histograms for the tracking pipeline. Every stage records into a
+// fixed log-linear histogram (16 linear steps per power of two, so a
+// percentile is never more than 1/16 off) with two relaxed atomic adds, so
+// the capture worker and the UI thread record without locks.
+//
+// PERF_SCOPE(stage) times the rest of the enclosing block. Building with
+// XSUKAX_NO_PERF defined compiles every PERF_SCOPE and PERF_RECORD away;
+// the histograms then stay empty.
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+enum class PerfStage {
+    Capture,        // screen region grab
+    Hash,           // change detection over the captured pixels
+    Reduce,         // mean, median or mode of the region
+    Queue,          // worker sample until the UI thread picks it up
+    Display,        // formatting, token lookup and text updates
+    Loupe,          // loupe patch copy and render
+    Paint           // custom painting
+};
+
+const int kPerfStageCount = 7;
+
+class LatencyHistogram {
+public:
+    static const int kSubBuckets = 16;
+    static const int kMaxExponent = 40;     // values clamp at 2^40 ns, about 18 minutes
+    static const int kBuckets = kSubBuckets * (kMaxExponent - 3);
+    
+    LatencyHistogram() { Reset(); }
+    
+    void Record(uint64_t ns);
+    void Reset();
+    
+    uint64_t Count() const;
+    uint64_t MaxNs() const { return m_max.load(std::memory_order_relaxed); }
+    double MeanNs() const;
+    // p in [0, 1]; the midpoint of the bucket holding that rank
+    uint64_t PercentileNs(double p) const;
+
+private:
+    std::atomic<uint64_t> m_buckets[kBuckets];
+    std::atomic<uint64_t> m_sum;
+    std::atomic<uint64_t> m_max;
+};
+
+LatencyHistogram& PerfHistogram(PerfStage stage);
+const char* PerfStageName(PerfStage stage);
+void ResetPerfStats();
+
+// {"unit": "us", "stages": [{"stage", "count", "mean", "p50", "p90",
+// "p99", "max"}, ...]}, stages without samples included
+std::string PerfStatsJSON();
+
+// Steady clock in nanoseconds
+uint64_t PerfNowNs();
+
+class PerfScope {
+public:
+    explicit PerfScope(PerfStage stage) : m_stage(stage), m_start(PerfNowNs()) {}
+    ~PerfScope() { PerfHistogram(m_stage).Record(PerfNowNs() - m_start); }
+    
+    PerfScope(const PerfScope&) = delete;
+    PerfScope& operator=(const PerfScope&) = delete;
+
+private:
+    PerfStage m_stage;
+    uint64_t m_start;
+};
+
+#ifdef XSUKAX_NO_PERF
+#define PERF_SCOPE(stage) ((void)0)
+#define PERF_RECORD(stage, ns) ((void)0)
+#else
+#define PERF_CONCAT_INNER(a, b) a##b
+#define PERF_CONCAT(a, b) PERF_CONCAT_INNER(a, b)
+#define PERF_SCOPE(stage) PerfScope PERF_CONCAT(perfScope, __LINE__)(stage)
+#define PERF_RECORD(stage, ns) PerfHistogram(stage).Record(ns)
+#endif
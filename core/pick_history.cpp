@@ -0,0 +1,224 @@
+#include "pick_history.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+#include "color_spaces.h"
+
+namespace {
+
+// File header; records follow immediately. Fields are little-endian, like
+// the records themselves, which are stored as their in-memory layout.
+struct HistoryHeader {
+    char magic[4];          // "XCPH"
+    uint32_t version;
+    uint32_t recordSize;
+    uint32_t reserved;
+};
+
+static_assert(sizeof(HistoryHeader) == 16, "history header is 16 bytes on disk");
+
+const uint32_t kHistoryVersion = 1;
+
+// Appended records beyond this many are folded into the index by a rebuild
+// instead of being scanned linearly on every query
+const size_t kMaxUnindexed = 4096;
+
+PointIndex::Point RecordPoint(const PickRecord& rec) {
+    OKLabValue lab = ColorToOKLab(RecordColor(rec));
+    PointIndex::Point p = {{lab.l, lab.a, lab.b}};
+    return p;
+}
+
+} // namespace
+
+uint64_t UnixTimeMicros() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+bool PickHistory::Open(const char* path, std::string& error) {
+    Close();
+    
+    // Create the file with just a header if it does not exist yet
+    FILE* probe = fopen(path, "rb");
+    if (probe) {
+        fclose(probe);
+    } else {
+        FILE* f = fopen(path, "wb");
+        HistoryHeader header = {{'X', 'C', 'P', 'H'}, kHistoryVersion, (uint32_t)sizeof(PickRecord), 0};
+        bool ok = f && fwrite(&header, sizeof(header), 1, f) == 1;
+        if (f) ok = fclose(f) == 0 && ok;
+        if (!ok) {
+            error = std::string("cannot create ") + path;
+            return false;
+        }
+    }
+    
+    // Map before opening for writing; Windows refuses a read-only mapping
+    // next to an open write handle that does not share writes
+    if (!Map(path, error)) return false;
+    
+    // Appends start right after the last whole record, overwriting any
+    // partial record left by an interrupted write
+    m_append = fopen(path, "r+b");
+    if (!m_append || fseek(m_append, (long)(sizeof(HistoryHeader) + m_mappedCount * sizeof(PickRecord)),
+                           SEEK_SET) != 0) {
+        Close();
+        error = std::string("cannot open ") + path + " for writing";
+        return false;
+    }
+    return true;
+}
+
+bool PickHistory::OpenReadOnly(const char* path, std::string& error) {
+    Close();
+    return Map(path, error);
+}
+
+bool PickHistory::Map(const char* path, std::string& error) {
+    if (!m_file.Open(path, error)) return false;
+    
+    HistoryHeader header;
+    memset(&header, 0, sizeof(header));
+    if (m_file.Size() >= sizeof(header)) memcpy(&header, m_file.Data(), sizeof(header));
+    if (memcmp(header.magic, "XCPH", 4) != 0 || header.version != kHistoryVersion ||
+        header.recordSize != sizeof(PickRecord)) {
+        m_file.Close();
+        error = std::string(path) + ": not a pick history file";
+        return false;
+    }
+    m_mapped = (const PickRecord*)(m_file.Data() + sizeof(header));
+    m_mappedCount = (m_file.Size() - sizeof(header)) / sizeof(PickRecord);
+    return true;
+}
+
+void PickHistory::Close() {
+    if (m_append) fclose(m_append);
+    m_append = NULL;
+    m_file.Close();
+    m_mapped = NULL;
+    m_mappedCount = 0;
+    m_tail.clear();
+    m_index.Build(std::vector<PointIndex::Point>());
+    m_indexedCount = 0;
+}
+
+const PickRecord& PickHistory::Record(size_t i) const {
+    return i < m_mappedCount ? m_mapped[i] : m_tail[i - m_mappedCount];
+}
+
+bool PickHistory::Append(Color color, int x, int y, uint64_t timestampUs, const char* label,
+                         std::string& error) {
+    if (!m_append) {
+        error = IsOpen() ? "history is open read-only" : "history is not open";
+        return false;
+    }
+    
+    PickRecord rec;
+    memset(&rec, 0, sizeof(rec));
+    uint64_t last = Size() ? Record(Size() - 1).timestampUs : 0;
+    rec.timestampUs = timestampUs > last ? timestampUs : last;
+    rec.x = x;
+    rec.y = y;
+    rec.r = color.r;
+    rec.g = color.g;
+    rec.b = color.b;
+    if (label) strncpy(rec.label, label, sizeof(rec.label) - 1);
+    
+    if (fwrite(&rec, sizeof(rec), 1, m_append) != 1 || fflush(m_append) != 0) {
+        error = "cannot write to pick history";
+        return false;
+    }
+    m_tail.push_back(rec);
+    return true;
+}
+
+void PickHistory::TimeRange(uint64_t first, uint64_t last, size_t& begin, size_t& end) const {
+    // Lower bound of a timestamp over the sorted records
+    auto lowerBound = [this](uint64_t t) {
+        size_t lo = 0, hi = Size();
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            if (Record(mid).timestampUs < t) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        return lo;
+    };
+    begin = lowerBound(first);
+    end = last > first ? lowerBound(last) : begin;
+}
+
+void PickHistory::RebuildIndex() {
+    std::vector<PointIndex::Point> points(Size());
+    for (size_t i = 0; i < points.size(); i++) {
+        points[i] = RecordPoint(Record(i));
+    }
+    m_index.Build(points);
+    m_indexedCount = points.size();
+}
+
+size_t PickHistory::NearestColors(Color color, int k, size_t* indices, float* distances) {
+    k = std::max(1, std::min(k, (int)PointIndex::kMaxNeighbours));
+    if (Size() == 0) return 0;
+    if (m_indexedCount == 0 || Size() - m_indexedCount > kMaxUnindexed) {
+        RebuildIndex();
+    }
+    
+    OKLabValue q = ColorToOKLab(color);
+    PointIndex::Point qp = {{q.l, q.a, q.b}};
+    int treeIndices[PointIndex::kMaxNeighbours];
+    float treeDist2[PointIndex::kMaxNeighbours];
+    int found = m_index.Nearest(qp, k, treeIndices, treeDist2);
+    
+    // Merge the tree results with a scan of records appended since the build
+    std::vector<std::pair<float, size_t>> best;
+    for (int i = 0; i < found; i++) {
+        best.push_back(std::make_pair(treeDist2[i], (size_t)treeIndices[i]));
+    }
+    for (size_t i = m_indexedCount; i < Size(); i++) {
+        PointIndex::Point p = RecordPoint(Record(i));
+        float d0 = p.v[0] - qp.v[0], d1 = p.v[1] - qp.v[1], d2 = p.v[2] - qp.v[2];
+        best.push_back(std::make_pair(d0 * d0 + d1 * d1 + d2 * d2, i));
+    }
+    size_t count = std::min(best.size(), (size_t)k);
+    std::partial_sort(best.begin(), best.begin() + count, best.end());
+    for (size_t i = 0; i < count; i++) {
+        indices[i] = best[i].second;
+        if (distances) distances[i] = sqrtf(best[i].first);
+    }
+    return count;
+}
+
+void PickHistory::DistinctColors(float minDistance, size_t limit, std::vector<size_t>& indices) const {
+    indices.clear();
+    std::vector<OKLabValue> kept;
+    
+    // A color is either kept or rejected the first time it is seen, and the
+    // answer cannot change later, so repeats cost one bit test
+    std::vector<bool> seen((size_t)1 << 24, false);
+    for (size_t i = Size(); i-- > 0 && indices.size() < limit;) {
+        const PickRecord& rec = Record(i);
+        uint32_t packed = ((uint32_t)rec.r << 16) | ((uint32_t)rec.g << 8) | rec.b;
+        if (seen[packed]) continue;
+        seen[packed] = true;
+        
+        OKLabValue lab = ColorToOKLab(RecordColor(rec));
+        bool distinct = true;
+        for (const OKLabValue& other : kept) {
+            if (OKLabDistance(lab, other) <= minDistance) {
+                distinct = false;
+                break;
+            }
+        }
+        if (distinct) {
+            kept.push_back(lab);
+            indices.push_back(i);
+        }
+    }
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+// Persistent pick history: an append-only file of fixed 64-byte records
+// behind a 16-byte header. Existing records are memory-mapped and used in
+// place, so opening a history costs the same for ten entries or a million.
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "color_core.h"
+#include "mapped_file.h"
+#include "palette.h"
+
+struct PickRecord {
+    uint64_t timestampUs;   // Unix time, microseconds; never decreases within a file
+    int32_t x;
+    int32_t y;
+    uint8_t r, g, b;
+    uint8_t reserved;
+    char label[44];         // NUL-terminated, may be empty
+};
+
+static_assert(sizeof(PickRecord) == 64, "history records are 64 bytes on disk");
+
+inline Color RecordColor(const PickRecord& rec) {
+    return MakeColor(rec.r, rec.g, rec.b);
+}
+
+class PickHistory {
+public:
+    PickHistory() : m_mapped(NULL), m_mappedCount(0), m_append(NULL), m_indexedCount(0) {}
+    ~PickHistory() { Close(); }
+    
+    PickHistory(const PickHistory&) = delete;
+    PickHistory& operator=(const PickHistory&) = delete;
+    
+    // Opens or creates a history file. A torn final record from an
+    // interrupted write is ignored and overwritten by the next append.
+    bool Open(const char* path, std::string& error);
+    // Maps an existing history for queries only: no write handle, and a
+    // missing file is an error rather than a new empty history
+    bool OpenReadOnly(const char* path, std::string& error);
+    void Close();
+    bool IsOpen() const { return m_mapped != NULL; }
+    bool IsWritable() const { return m_append != NULL; }
+    
+    // Appends and flushes one record. Timestamps are clamped so they never
+    // go backwards, which keeps time-range queries a binary search.
+    bool Append(Color color, int x, int y, uint64_t timestampUs, const char* label, std::string& error);
+    
+    size_t Size() const { return m_mappedCount + m_tail.size(); }
+    const PickRecord& Record(size_t i) const;
+    
+    // Records with first <= timestamp < last, as an index range [begin, end)
+    void TimeRange(uint64_t first, uint64_t last, size_t& begin, size_t& end) const;
+    
+    // Up to k records closest in OKLab, closest first. Builds a spatial index
+    // over all records on first use and extends it lazily afterwards.
+    size_t NearestColors(Color color, int k, size_t* indices, float* distances);
+    
+    // Newest-first records whose color is more than `minDistance` (OKLab)
+    // away from every record already returned; at most `limit` results
+    void DistinctColors(float minDistance, size_t limit, std::vector<size_t>& indices) const;
+
+private:
+    bool Map(const char* path, std::string& error);
+    void RebuildIndex();
+    
+    MappedFile m_file;
+    const PickRecord* m_mapped;
+    size_t m_mappedCount;
+    std::vector<PickRecord> m_tail;     // appended since Open
+    FILE* m_append;
+    PointIndex m_index;
+    size_t m_indexedCount;
+};
+
+uint64_t UnixTimeMicros();
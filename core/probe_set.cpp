@@ -0,0 +1,139 @@
+#include "probe_set.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "color_sampling.h"
+#include "mapped_file.h"
+
+bool ProbeSet::LoadFile(const char* path, std::string& error) {
+    MappedFile file;
+    if (!file.Open(path, error)) return false;
+    
+    Clear();
+    const char* begin = (const char*)file.Data();
+    const char* end = begin + file.Size();
+    int lineNumber = 0;
+    for (const char* line = begin; line < end;) {
+        const char* eol = (const char*)memchr(line, '\n', end - line);
+        if (!eol) eol = end;
+        std::string text(line, eol);
+        line = eol + 1;
+        lineNumber++;
+        
+        size_t first = text.find_first_not_of(" \t\r");
+        if (first == std::string::npos || text[first] == '#') continue;
+        
+        // NAME, then X Y, X Y THRESHOLD, X Y W H or X Y W H THRESHOLD
+        char name[256];
+        int used = 0;
+        long v[6];
+        int count = 0;
+        bool ok = sscanf(text.c_str(), "%255s%n", name, &used) == 1;
+        const char* p = text.c_str() + used;
+        while (ok && count < 6) {
+            char* stop = NULL;
+            long value = strtol(p, &stop, 10);
+            if (stop == p) break;
+            ok = labs(value) <= 1000000000L;
+            v[count++] = value;
+            p = stop;
+        }
+        ok = ok && count >= 2 && count <= 5 && strspn(p, " \t\r") == strlen(p);
+        
+        CaptureRect rect = {ok ? (int)v[0] : 0, ok ? (int)v[1] : 0, 1, 1};
+        long threshold = kDefaultProbeThreshold;
+        if (ok && count >= 4) {
+            rect.width = (int)v[2];
+            rect.height = (int)v[3];
+        }
+        if (ok && (count == 3 || count == 5)) threshold = v[count - 1];
+        // 4096x4096 keeps area sums within the integral image's 32-bit range
+        ok = ok && rect.width > 0 && rect.height > 0 && rect.width <= 4096 && rect.height <= 4096 &&
+             threshold >= 0 && threshold <= 255;
+        if (!ok) {
+            error = std::string(path) + ":" + std::to_string(lineNumber) + ": expected NAME X Y [WIDTH HEIGHT] [THRESHOLD]";
+            Clear();
+            return false;
+        }
+        Add(name, rect, (int)threshold);
+    }
+    return true;
+}
+
+void ProbeSet::Add(const std::string& name, const CaptureRect& rect, int threshold) {
+    Probe probe = {name, rect, threshold};
+    if (m_probes.empty()) {
+        m_bounds = rect;
+    } else {
+        int right = std::max(m_bounds.x + m_bounds.width, rect.x + rect.width);
+        int bottom = std::max(m_bounds.y + m_bounds.height, rect.y + rect.height);
+        m_bounds.x = std::min(m_bounds.x, rect.x);
+        m_bounds.y = std::min(m_bounds.y, rect.y);
+        m_bounds.width = right - m_bounds.x;
+        m_bounds.height = bottom - m_bounds.y;
+    }
+    if (rect.width > 1 || rect.height > 1) {
+        m_probeArea += (uint64_t)rect.width * rect.height;
+    }
+    m_useIntegral = m_probeArea > (uint64_t)m_bounds.width * m_bounds.height;
+    m_probes.push_back(probe);
+    m_reported.push_back(MakeColor(0, 0, 0));
+    m_primed = false;
+}
+
+void ProbeSet::Clear() {
+    m_probes.clear();
+    m_reported.clear();
+    m_bounds = CaptureRect();
+    m_primed = false;
+    m_probeArea = 0;
+    m_useIntegral = false;
+}
+
+void ProbeSet::Evaluate(const PixelView& view, uint64_t timestamp, std::vector<ProbeEvent>& events) {
+    if (view.width < m_bounds.width || view.height < m_bounds.height) return;
+    
+    // One pass over the whole capture pays off only for heavily overlapping rectangles
+    if (m_useIntegral) m_integral.Build(view);
+    const size_t pixelSize = view.format == PixelFormat::BGRA32 ? 4 : 3;
+    
+    for (size_t i = 0; i < m_probes.size(); i++) {
+        const CaptureRect& rect = m_probes[i].rect;
+        int x = rect.x - m_bounds.x;
+        int y = rect.y - m_bounds.y;
+        Color color;
+        if (rect.width == 1 && rect.height == 1) {
+            color = PixelAt(view, x, y);
+        } else if (m_useIntegral) {
+            if (!m_integral.Mean(x, y, rect.width, rect.height, color)) continue;
+        } else {
+            PixelView area = {view.data + view.stride * y + pixelSize * x, rect.width, rect.height,
+                              view.stride, view.format};
+            color = ReduceRegion(area, SampleReducer::Mean);
+        }
+        
+        Color& reported = m_reported[i];
+        int threshold = m_probes[i].threshold;
+        if (!m_primed) {
+            reported = color;
+        } else if (std::abs(color.r - reported.r) > threshold || std::abs(color.g - reported.g) > threshold ||
+                   std::abs(color.b - reported.b) > threshold) {
+            ProbeEvent event = {(int)i, timestamp, reported, color};
+            events.push_back(event);
+            reported = color;
+        }
+    }
+    m_primed = true;
+}
+
+bool ProbeSet::Tick(ScreenSource& source, uint64_t timestamp, std::vector<ProbeEvent>& events) {
+    if (m_probes.empty()) return false;
+    
+    PixelView view;
+    if (!source.Capture(m_bounds, view)) return false;
+    Evaluate(view, timestamp, events);
+    return true;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+// Probe sets watch many fixed points or rectangles at once, such as the
+// status lights of a dashboard. Each tick captures the bounding region of
+// every probe once, so the capture cost does not grow with the number of
+// probes. Point probes are single lookups. Rectangle probes sum their own
+// pixels, or, when they overlap so much that they cover more pixels than
+// the bounds, are all read from one summed-area table built per tick.
+
+#include <string>
+#include <vector>
+
+#include "color_core.h"
+#include "integral_image.h"
+#include "screen_source.h"
+
+const int kDefaultProbeThreshold = 8;
+
+struct Probe {
+    std::string name;
+    CaptureRect rect;               // 1x1 for a point; rectangles report their mean
+    int threshold;                  // largest per-channel change that is not an event
+};
+
+struct ProbeEvent {
+    int probe;
+    uint64_t timestamp;             // as passed to Evaluate or Tick
+    Color from;                     // color last reported for the probe
+    Color to;
+};
+
+class ProbeSet {
+public:
+    ProbeSet() : m_bounds(), m_primed(false), m_probeArea(0), m_useIntegral(false) {}
+    
+    // One probe per line: NAME X Y [WIDTH HEIGHT] [THRESHOLD]; # starts a comment
+    bool LoadFile(const char* path, std::string& error);
+    
+    void Add(const std::string& name, const CaptureRect& rect, int threshold = kDefaultProbeThreshold);
+    void Clear();
+    size_t Size() const { return m_probes.size(); }
+    const Probe& At(size_t i) const { return m_probes[i]; }
+    
+    // Color last reported for a probe; only moves when an event fires, so
+    // slow drift is reported once it adds up to the threshold
+    Color Value(size_t i) const { return m_reported[i]; }
+    
+    // Bounding rectangle of all probes, the region each tick captures
+    const CaptureRect& Bounds() const { return m_bounds; }
+    
+    // The next tick records a new baseline without raising events
+    void Reset() { m_primed = false; }
+    
+    // Evaluates every probe against a view of Bounds() and appends an event
+    // for each probe whose color moved past its threshold. Views smaller
+    // than Bounds() are ignored.
+    void Evaluate(const PixelView& view, uint64_t timestamp, std::vector<ProbeEvent>& events);
+    // Captures Bounds() from the source, then evaluates
+    bool Tick(ScreenSource& source, uint64_t timestamp, std::vector<ProbeEvent>& events);
+
+private:
+    std::vector<Probe> m_probes;
+    std::vector<Color> m_reported;
+    CaptureRect m_bounds;
+    bool m_primed;
+    uint64_t m_probeArea;           // pixels covered by rectangle probes, with overlaps
+    bool m_useIntegral;
+    IntegralImage m_integral;
+};
@@ -0,0 +1,59 @@
+#pragma once
+
+// Bounded single-producer/single-consumer ring buffer. One thread may call
+// TryPush and one other thread may call TryPop/DrainLatest, without locks.
+
+#include <atomic>
+#include <cstddef>
+
+template <typename T, size_t Capacity>
+class SampleRing {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+
+public:
+    SampleRing() : m_head(0), m_tail(0) {}
+    
+    // Producer side. Returns false when the consumer has fallen a full ring behind.
+    bool TryPush(const T& value) {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        if (head - m_tail.load(std::memory_order_acquire) == Capacity) {
+            return false;
+        }
+        m_items[head & (Capacity - 1)] = value;
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+    
+    // Consumer side
+    bool TryPop(T& value) {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail == m_head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        value = m_items[tail & (Capacity - 1)];
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+    
+    // Consumer side: discard everything but the newest item
+    bool DrainLatest(T& value) {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        size_t head = m_head.load(std::memory_order_acquire);
+        if (tail == head) {
+            return false;
+        }
+        value = m_items[(head - 1) & (Capacity - 1)];
+        m_tail.store(head, std::memory_order_release);
+        return true;
+    }
+    
+    bool Empty() const {
+        return m_tail.load(std::memory_order_acquire) == m_head.load(std::memory_order_acquire);
+    }
+
+private:
+    // Producer and consumer indices live on separate cache lines
+    alignas(64) std::atomic<size_t> m_head;
+    alignas(64) std::atomic<size_t> m_tail;
+    alignas(64) T m_items[Capacity];
+};
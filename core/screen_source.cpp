@@ -0,0 +1,58 @@
+#include "screen_source.h"
+
+namespace {
+
+bool CaptureFromView(const PixelView& full, const CaptureRect& rect, std::vector<uint8_t>& scratch,
+                     PixelView& view) {
+    if (full.width <= 0 || full.height <= 0 || rect.width <= 0 || rect.height <= 0) {
+        return false;
+    }
+    
+    size_t bpp = full.format == PixelFormat::RGB24 ? 3 : 4;
+    
+    if (rect.x >= 0 && rect.y >= 0 &&
+        rect.x + rect.width <= full.width && rect.y + rect.height <= full.height) {
+        view = full;
+        view.data = full.data + (size_t)rect.y * full.stride + (size_t)rect.x * bpp;
+        view.width = rect.width;
+        view.height = rect.height;
+        return true;
+    }
+    
+    // Crosses an edge: assemble a clamped copy
+    size_t stride = (size_t)rect.width * bpp;
+    scratch.resize(stride * rect.height);
+    for (int y = 0; y < rect.height; y++) {
+        uint8_t* dst = scratch.data() + (size_t)y * stride;
+        for (int x = 0; x < rect.width; x++) {
+            Color c = PixelAt(full, rect.x + x, rect.y + y);
+            if (bpp == 3) {
+                dst[x * 3] = c.r;
+                dst[x * 3 + 1] = c.g;
+                dst[x * 3 + 2] = c.b;
+            } else {
+                dst[x * 4] = c.b;
+                dst[x * 4 + 1] = c.g;
+                dst[x * 4 + 2] = c.r;
+                dst[x * 4 + 3] = 255;
+            }
+        }
+    }
+    
+    view.data = scratch.data();
+    view.width = rect.width;
+    view.height = rect.height;
+    view.stride = stride;
+    view.format = full.format;
+    return true;
+}
+
+} // namespace
+
+bool ImageScreenSource::Capture(const CaptureRect& rect, PixelView& view) {
+    return CaptureFromView(m_image.View(), rect, m_scratch, view);
+}
+
+bool ViewScreenSource::Capture(const CaptureRect& rect, PixelView& view) {
+    return CaptureFromView(m_view, rect, m_scratch, view);
+}
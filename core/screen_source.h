@@ -0,0 +1,65 @@
+#pragma once
+
+// Region capture abstraction. The GUI implements it with GDI; headless
+// tools and tests drive the same code from image files or memory.
+
+#include <vector>
+
+#include "color_core.h"
+#include "image_io.h"
+
+// Rectangle in source (screen) coordinates
+struct CaptureRect {
+    int x;
+    int y;
+    int width;
+    int height;
+};
+
+// Rectangle of the given radius centred on a point, e.g. radius 1 is 3x3
+inline CaptureRect RectAround(int x, int y, int radius) {
+    CaptureRect rect = {x - radius, y - radius, radius * 2 + 1, radius * 2 + 1};
+    return rect;
+}
+
+class ScreenSource {
+public:
+    virtual ~ScreenSource() {}
+    
+    // Capture a rectangle in one operation. The view points into a buffer
+    // owned by the source and stays valid until the next Capture call.
+    virtual bool Capture(const CaptureRect& rect, PixelView& view) = 0;
+};
+
+// Source backed by an in-memory image. Rectangles inside the image are
+// returned as zero-copy sub-views; rectangles crossing an edge are copied
+// into a reused buffer with edge pixels clamped.
+class ImageScreenSource : public ScreenSource {
+public:
+    ImageScreenSource() {}
+    explicit ImageScreenSource(const Image& image) : m_image(image) {}
+    
+    void SetImage(const Image& image) { m_image = image; }
+    Image& GetImage() { return m_image; }
+    
+    bool Capture(const CaptureRect& rect, PixelView& view) override;
+
+private:
+    Image m_image;
+    std::vector<uint8_t> m_scratch;
+};
+
+// Same behaviour over a caller-owned view, such as a memory-mapped file.
+// The view must outlive the source.
+class ViewScreenSource : public ScreenSource {
+public:
+    explicit ViewScreenSource(const PixelView& view) : m_view(view) {}
+    
+    void SetView(const PixelView& view) { m_view = view; }
+    
+    bool Capture(const CaptureRect& rect, PixelView& view) override;
+
+private:
+    PixelView m_view;
+    std::vector<uint8_t> m_scratch;
+};
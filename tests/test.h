@@ -0,0 +1,29 @@
+#pragma once
+
+// Self-registering test cases for color_tests. TEST(Name) defines a case;
+// the CHECK macros record a failure with its location and carry on, so one
+// run lists every broken expectation of a case instead of the first.
+
+#include <string>
+
+typedef void (*TestFunction)();
+
+int RegisterTest(const char* name, TestFunction run);
+
+void CheckTrue(const char* file, int line, const char* expr, bool ok);
+void CheckEqual(const char* file, int line, const char* expr, long long a, long long b);
+void CheckString(const char* file, int line, const char* expr, const std::string& a, const std::string& b);
+void CheckNear(const char* file, int line, const char* expr, double a, double b, double tolerance);
+
+#define TEST(name)                                                          \
+    static void Test##name();                                               \
+    static const int g_test##name = RegisterTest(#name, Test##name);        \
+    static void Test##name()
+
+#define CHECK(expr) CheckTrue(__FILE__, __LINE__, #expr, (expr))
+#define CHECK_EQ(a, b) CheckEqual(__FILE__, __LINE__, #a " == " #b, (long long)(a), (long long)(b))
+#define CHECK_STR(a, b) CheckString(__FILE__, __LINE__, #a " == " #b, (a), (b))
+#define CHECK_NEAR(a, b, tolerance) CheckNear(__FILE__, __LINE__, #a " ~ " #b, (a), (b), (tolerance))
+
+// Failures so far, for cases that stop early once something is wrong
+int TestFailures();
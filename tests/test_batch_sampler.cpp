@@ -0,0 +1,250 @@
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "core/batch_sampler.h"
+#include "core/image_io.h"
+#include "test.h"
+
+namespace {
+
+// Pixel (x, y) of image k is (k, x, y), so every row names its source
+void WriteTestImage(const char* path, int k, int width, int height) {
+    Image image;
+    image.Allocate(width, height, PixelFormat::RGB24);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            uint8_t* p = image.pixels.data() + y * image.Stride() + x * 3;
+            p[0] = (uint8_t)k;
+            p[1] = (uint8_t)x;
+            p[2] = (uint8_t)y;
+        }
+    }
+    std::string error;
+    WritePPM(path, image.View(), error);
+}
+
+void WriteText(const char* path, const std::string& text) {
+    FILE* f = fopen(path, "wb");
+    if (!f) return;
+    fwrite(text.data(), 1, text.size(), f);
+    fclose(f);
+}
+
+bool Load(const std::string& text, std::vector<BatchJob>& jobs, std::string& error) {
+    const char* path = "batch_test_jobs.txt";
+    WriteText(path, text);
+    jobs.clear();
+    bool ok = LoadBatchJobs(path, BatchJob(), jobs, error);
+    remove(path);
+    return ok;
+}
+
+std::string ReadAll(FILE* f) {
+    std::string text((size_t)ftell(f), '\0');
+    rewind(f);
+    text.resize(fread(&text[0], 1, text.size(), f));
+    return text;
+}
+
+// Runs the jobs and returns what went to the output and error streams
+std::string Run(const std::vector<BatchJob>& jobs, BatchFormat format, int threads, BatchStats& stats,
+                std::string* errors = NULL) {
+    FILE* out = tmpfile();
+    FILE* err = tmpfile();
+    if (!out || !err) return "";
+    RunBatch(jobs, format, threads, out, err, stats);
+    std::string text = ReadAll(out);
+    if (errors) *errors = ReadAll(err);
+    fclose(out);
+    fclose(err);
+    return text;
+}
+
+} // namespace
+
+TEST(BatchJsonJobs) {
+    std::vector<BatchJob> jobs;
+    std::string error;
+    CHECK(Load("[{\"image\": \"a b.ppm\", \"points\": [[1, 2], [ -3 ,4]], \"radius\": 2, \"reducer\": \"mode\"},\n"
+               " {\"extra\": {\"k\": [1, \"]\"]}, \"image\": \"q\\\"\\u00e9.ppm\", \"points\": []}]",
+               jobs, error));
+    CHECK_EQ(jobs.size(), 2);
+    if (jobs.size() == 2) {
+        CHECK_STR(jobs[0].image, "a b.ppm");
+        CHECK_EQ(jobs[0].points.size(), 2);
+        CHECK_EQ(jobs[0].points[1].x, -3);
+        CHECK_EQ(jobs[0].points[1].y, 4);
+        CHECK_EQ(jobs[0].radius, 2);
+        CHECK(jobs[0].reducer == SampleReducer::Mode);
+        CHECK_STR(jobs[1].image, "q\"\xc3\xa9.ppm");
+        CHECK_EQ(jobs[1].radius, 0);
+        CHECK(jobs[1].points.empty());
+    }
+    
+    CHECK(Load("{\"image\": \"one.ppm\", \"points\": [[0, 0]]}", jobs, error));
+    CHECK_EQ(jobs.size(), 1);
+    
+    // A sign without digits is not a number
+    const char* bad[] = {
+        "[{\"image\": \"t.ppm\", \"points\": [[-, 1]]}]",
+        "[{\"image\": \"t.ppm\", \"points\": [[1, -]]}]",
+        "[{\"image\": \"t.ppm\", \"points\": [[1, 2]], \"radius\": -}]",
+        "[{\"image\": \"t.ppm\", \"points\": [[1, 2]], \"radius\": 99}]",
+        "[{\"points\": [[1, 2]]}]",
+        "[{\"image\": \"t.ppm\", \"points\": [[1, 2]]}",
+        "[{\"image\": \"t.ppm\"}] trailing",
+        "[{\"image\": \"t.ppm\", \"points\": [[99999999999, 2]]}]",
+    };
+    for (const char* text : bad) {
+        CHECK(!Load(text, jobs, error));
+        CHECK(error.find("invalid JSON job") != std::string::npos);
+    }
+}
+
+TEST(BatchCoordinateList) {
+    std::vector<BatchJob> jobs;
+    std::string error;
+    CHECK(Load("# comment\n"
+               "shots/home page.ppm 10 20\r\n"
+               "shots/home page.ppm\t-1   2\n"
+               "\n"
+               "  other.bmp 3 4  \n"
+               "shots/home page.ppm 5 6\n",
+               jobs, error));
+    CHECK_EQ(jobs.size(), 3);
+    if (jobs.size() == 3) {
+        CHECK_STR(jobs[0].image, "shots/home page.ppm");
+        CHECK_EQ(jobs[0].points.size(), 2);
+        CHECK_EQ(jobs[0].points[1].x, -1);
+        CHECK_EQ(jobs[0].points[1].y, 2);
+        CHECK_STR(jobs[1].image, "other.bmp");
+        CHECK_EQ(jobs[1].points[0].x, 3);
+        CHECK_STR(jobs[2].image, "shots/home page.ppm");
+    }
+    
+    CHECK(!Load("a.ppm 1 2\nb.ppm 1\n", jobs, error));
+    CHECK_STR(error, "batch_test_jobs.txt:2: expected IMAGE X Y");
+    CHECK(!Load("a.ppm - 2\n", jobs, error));
+    CHECK(!Load("a.ppm 1 2x\n", jobs, error));
+}
+
+// Rows come out in job order whatever the number of workers, with the
+// sampled colors of the right image and point
+TEST(BatchOrderAcrossThreads) {
+    const int files = 24;
+    std::vector<BatchJob> jobs;
+    for (int k = 0; k < files; k++) {
+        char path[64];
+        snprintf(path, sizeof(path), "batch test %d.ppm", k);
+        WriteTestImage(path, k, 40 + k, 30);
+        BatchJob job;
+        job.image = path;
+        for (int i = 0; i < 50; i++) {
+            job.points.push_back({(i * 7 + k) % (40 + k), (i * 3) % 30});
+        }
+        job.radius = k % 3 == 0 ? 1 : 0;
+        jobs.push_back(job);
+    }
+    
+    BatchStats stats;
+    std::string serial = Run(jobs, BatchFormat::CSV, 1, stats);
+    CHECK_EQ(stats.files, files);
+    CHECK_EQ(stats.samples, files * 50);
+    CHECK_EQ(stats.failedFiles, 0);
+    
+    // Row 1 + 50 * k + i is point i of job k
+    std::vector<std::string> lines;
+    for (size_t at = 0; at < serial.size();) {
+        size_t eol = serial.find('\n', at);
+        lines.push_back(serial.substr(at, eol - at));
+        at = eol + 1;
+    }
+    CHECK_EQ(lines.size(), 1 + files * 50);
+    CHECK_STR(lines[0], "image,x,y,hex,r,g,b,h,s,l");
+    if (lines.size() == 1 + files * 50) {
+        const int ks[3] = {1, 2, 23};
+        for (int k : ks) {
+            const SamplePoint& pt = jobs[k].points[7];
+            char expected[96];
+            snprintf(expected, sizeof(expected), "batch test %d.ppm,%d,%d,#%02X%02X%02X,%d,%d,%d,", k, pt.x, pt.y,
+                     k, pt.x, pt.y, k, pt.x, pt.y);
+            CHECK_STR(lines[1 + 50 * k + 7].substr(0, strlen(expected)), expected);
+        }
+    }
+    
+    const int threads[3] = {2, 5, 0};
+    for (int t : threads) {
+        CHECK(Run(jobs, BatchFormat::CSV, t, stats) == serial);
+        CHECK_EQ(stats.samples, files * 50);
+    }
+    std::string jsonSerial = Run(jobs, BatchFormat::JSONLines, 1, stats);
+    CHECK(Run(jobs, BatchFormat::JSONLines, 4, stats) == jsonSerial);
+    
+    for (int k = 0; k < files; k++) {
+        remove(jobs[k].image.c_str());
+    }
+}
+
+// Points off the image are reported and skipped, never clamped to the edge
+TEST(BatchRejectsPointsOutsideImage) {
+    const char* path = "batch_test_small.ppm";
+    WriteTestImage(path, 9, 4, 3);
+    BatchJob job;
+    job.image = path;
+    job.points = {{100, -5}, {3, 2}, {4, 0}, {0, 3}, {-1, 1}, {0, 0}};
+    std::vector<BatchJob> jobs(1, job);
+    
+    BatchStats stats;
+    std::string errors;
+    std::string rows = Run(jobs, BatchFormat::CSV, 1, stats, &errors);
+    CHECK_EQ(stats.samples, 2);
+    CHECK_EQ(stats.outsidePoints, 4);
+    CHECK_EQ(stats.failedFiles, 0);
+    CHECK_STR(rows, "image,x,y,hex,r,g,b,h,s,l\n"
+                    "batch_test_small.ppm,3,2,#090302,9,3,2,9,64,2\n"
+                    "batch_test_small.ppm,0,0,#090000,9,0,0,0,100,2\n");
+    CHECK(errors.find("batch_test_small.ppm: (100, -5) is outside the 4x3 image\n") == 0);
+    CHECK(errors.find("(-1, 1) is outside") != std::string::npos);
+    
+    // With a radius the window may overhang the edge, but not its centre
+    jobs[0].radius = 2;
+    Run(jobs, BatchFormat::CSV, 1, stats);
+    CHECK_EQ(stats.samples, 2);
+    CHECK_EQ(stats.outsidePoints, 4);
+    
+    jobs[0].image = "batch_test_missing.ppm";
+    Run(jobs, BatchFormat::CSV, 1, stats, &errors);
+    CHECK_EQ(stats.failedFiles, 1);
+    CHECK_EQ(stats.outsidePoints, 0);
+    CHECK(!errors.empty());
+    remove(path);
+}
+
+// Paths with separators, quotes and control characters stay one field
+TEST(BatchEscapesPaths) {
+    const char* names[3] = {"batch, \"quoted\".ppm", "batch\\back.ppm", "batch\ttab.ppm"};
+    std::vector<BatchJob> jobs;
+    for (int k = 0; k < 3; k++) {
+        WriteTestImage(names[k], k, 2, 2);
+        BatchJob job;
+        job.image = names[k];
+        job.points.push_back({1, 1});
+        jobs.push_back(job);
+    }
+    
+    BatchStats stats;
+    std::string csv = Run(jobs, BatchFormat::CSV, 1, stats);
+    CHECK_STR(csv, "image,x,y,hex,r,g,b,h,s,l\n"
+                   "\"batch, \"\"quoted\"\".ppm\",1,1,#000101,0,1,1,180,100,0\n"
+                   "batch\\back.ppm,1,1,#010101,1,1,1,0,0,0\n"
+                   "batch\ttab.ppm,1,1,#020101,2,1,1,0,33,1\n");
+    std::string json = Run(jobs, BatchFormat::JSONLines, 1, stats);
+    CHECK_STR(json, "{\"image\":\"batch, \\\"quoted\\\".ppm\",\"x\":1,\"y\":1,\"hex\":\"#000101\",\"rgb\":[0,1,1],\"hsl\":[180,100,0]}\n"
+                    "{\"image\":\"batch\\\\back.ppm\",\"x\":1,\"y\":1,\"hex\":\"#010101\",\"rgb\":[1,1,1],\"hsl\":[0,0,0]}\n"
+                    "{\"image\":\"batch\\u0009tab.ppm\",\"x\":1,\"y\":1,\"hex\":\"#020101\",\"rgb\":[2,1,1],\"hsl\":[0,33,1]}\n");
+    for (const char* name : names) {
+        remove(name);
+    }
+}
@@ -0,0 +1,313 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "core/capture_worker.h"
+#include "core/image_io.h"
+#include "core/sample_ring.h"
+#include "test.h"
+
+namespace {
+
+// Three copies of one counter; any mix of two pushes shows up as a mismatch
+struct Stamped {
+    uint64_t a;
+    uint64_t b;
+    uint64_t c;
+};
+
+struct FakeCursor {
+    std::atomic<int> ticks;
+    std::atomic<int> notifications;
+    int stopAt;
+};
+
+// Walks one pixel right per tick, then holds still at stopAt
+bool WalkingCursor(void* context, int& x, int& y) {
+    FakeCursor* cursor = (FakeCursor*)context;
+    int tick = cursor->ticks++;
+    x = tick < cursor->stopAt ? tick : cursor->stopAt;
+    y = 0;
+    return true;
+}
+
+void CountNotify(void* context) {
+    ((FakeCursor*)context)->notifications++;
+}
+
+template <typename Fn>
+bool WaitFor(Fn done) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (!done()) {
+        if (std::chrono::steady_clock::now() > deadline) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    return true;
+}
+
+} // namespace
+
+TEST(RingOrderAndCapacity) {
+    SampleRing<int, 8> ring;
+    int value = -1;
+    CHECK(ring.Empty());
+    CHECK(!ring.TryPop(value));
+    
+    // Several laps so the indices wrap the storage
+    for (int lap = 0; lap < 5; lap++) {
+        for (int i = 0; i < 8; i++) {
+            CHECK(ring.TryPush(lap * 8 + i));
+        }
+        CHECK(!ring.TryPush(99));
+        for (int i = 0; i < 8; i++) {
+            CHECK(ring.TryPop(value));
+            CHECK_EQ(value, lap * 8 + i);
+        }
+        CHECK(ring.Empty());
+    }
+}
+
+TEST(RingDrainLatestKeepsNewest) {
+    static SampleRing<int, 4> ring;
+    int value = -1;
+    CHECK(!ring.DrainLatest(value));
+    for (int i = 1; i <= 4; i++) {
+        ring.TryPush(i);
+    }
+    CHECK(ring.DrainLatest(value));
+    CHECK_EQ(value, 4);
+    CHECK(ring.Empty());
+    
+    // Draining frees the whole ring for the producer again
+    for (int i = 5; i <= 8; i++) {
+        CHECK(ring.TryPush(i));
+    }
+    CHECK(ring.TryPop(value));
+    CHECK_EQ(value, 5);
+}
+
+// Producer and consumer on their own threads, the consumer mixing pops and
+// drains: items must arrive whole and in order
+TEST(RingConcurrentReadsAreNeverTorn) {
+    static SampleRing<Stamped, 16> ring;
+    const uint64_t count = 200000;
+    std::thread producer([&] {
+        for (uint64_t i = 1; i <= count;) {
+            Stamped item = {i, i * 3, ~i};
+            if (ring.TryPush(item)) {
+                i++;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    });
+    
+    uint64_t last = 0;
+    int torn = 0;
+    int reordered = 0;
+    while (last < count) {
+        Stamped item;
+        bool got = (last & 7) == 0 ? ring.DrainLatest(item) : ring.TryPop(item);
+        if (!got) {
+            std::this_thread::yield();
+            continue;
+        }
+        torn += item.b != item.a * 3 || item.c != ~item.a;
+        reordered += item.a <= last;
+        last = item.a;
+    }
+    producer.join();
+    CHECK_EQ(torn, 0);
+    CHECK_EQ(reordered, 0);
+    CHECK(ring.Empty());
+}
+
+TEST(TrackerInvalidateForcesRedraw) {
+    ChangeTracker tracker;
+    Color red = MakeColor(255, 0, 0);
+    CHECK(tracker.BeginTick(3, 4, 0));
+    CHECK(tracker.EndCapture(42));
+    CHECK(tracker.NeedsDisplayUpdate(red, 3, 4));
+    
+    // Same place soon after: nothing to capture; same pixels: nothing to reduce or show
+    CHECK(!tracker.BeginTick(3, 4, kFastIntervalMs));
+    CHECK(tracker.BeginTick(3, 4, kStillRefreshMs));
+    CHECK(!tracker.EndCapture(42));
+    CHECK(!tracker.NeedsDisplayUpdate(red, 3, 4));
+    
+    // A dropped sample invalidates, and the same color then goes out again
+    tracker.Invalidate();
+    CHECK(tracker.BeginTick(3, 4, kStillRefreshMs + 1));
+    CHECK(tracker.EndCapture(42));
+    CHECK(tracker.NeedsDisplayUpdate(red, 3, 4));
+    
+    const TrackingCounters& counters = tracker.Counters();
+    CHECK_EQ(counters.captures, 3);
+    CHECK_EQ(counters.capturesSkipped, 1);
+    CHECK_EQ(counters.reductionsSkipped, 1);
+    CHECK_EQ(counters.uiUpdates, 2);
+}
+
+// A UI thread that stops draining fills the ring; the worker must count the
+// drops and, once the UI drains again, still deliver where the cursor stopped
+TEST(WorkerResendsAfterDroppedSamples) {
+    Image image;
+    image.Allocate(256, 1, PixelFormat::BGRA32);
+    for (int x = 0; x < 256; x++) {
+        image.pixels[x * 4] = (uint8_t)x;
+        image.pixels[x * 4 + 3] = 255;
+    }
+    ImageScreenSource source(image);
+    FakeCursor cursor;
+    cursor.ticks = 0;
+    cursor.notifications = 0;
+    cursor.stopAt = 100;
+    
+    CaptureWorker worker(&source, WalkingCursor, CountNotify, &cursor);
+    CHECK(worker.Start());
+    CHECK(WaitFor([&] { return worker.DroppedSamples() > 0; }));
+    // Nothing was drained, so the ring never went empty to non-empty twice
+    CHECK_EQ(cursor.notifications.load(), 1);
+    
+    ColorSample sample;
+    CHECK(worker.LatestSample(sample));
+    uint32_t firstSequence = sample.sequence;
+    CHECK(sample.sequence >= 63);
+    
+    bool arrived = WaitFor([&] {
+        ColorSample next;
+        if (!worker.LatestSample(next)) return false;
+        CHECK(next.sequence > firstSequence);
+        sample = next;
+        return next.x == cursor.stopAt;
+    });
+    CHECK(arrived);
+    worker.Stop();
+    
+    CHECK_EQ(sample.color.b, cursor.stopAt);
+    CHECK(worker.Counters().uiUpdates > 64);
+    CHECK(!worker.IsRunning());
+}
+
+namespace {
+
+// Blue is x and green is y, so every copied pixel names its position
+Image PositionImage(int width, int height) {
+    Image image;
+    image.Allocate(width, height, PixelFormat::BGRA32);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            uint8_t* p = image.pixels.data() + y * image.Stride() + x * 4;
+            p[0] = (uint8_t)x;
+            p[1] = (uint8_t)y;
+            p[2] = 7;
+            p[3] = 255;
+        }
+    }
+    return image;
+}
+
+// Counts patch pixels that are not the clamped source pixel around (cx, cy)
+int PatchMismatches(const SamplePatch& patch, int cx, int cy, int radius, int width, int height) {
+    int bad = patch.width == radius * 2 + 1 && patch.height == radius * 2 + 1 ? 0 : 1;
+    PixelView view = patch.View();
+    for (int j = 0; j < patch.height; j++) {
+        for (int i = 0; i < patch.width; i++) {
+            Color c = PixelAt(view, i, j);
+            int x = std::min(std::max(cx - radius + i, 0), width - 1);
+            int y = std::min(std::max(cy - radius + j, 0), height - 1);
+            bad += c.b != x || c.g != y || c.r != 7;
+        }
+    }
+    return bad;
+}
+
+} // namespace
+
+// The loupe pixels come out of the tracking capture: the patch is the
+// square around the cursor, and the color still reduces only the sampling
+// window inside it
+TEST(TrackingStepCopiesPatch) {
+    Image image = PositionImage(64, 48);
+    ImageScreenSource source(image);
+    ImageScreenSource plainSource(image);
+    const int points[4][2] = {{20, 30}, {0, 0}, {63, 47}, {3, 45}};
+    const int radii[3] = {0, 2, 11};
+    uint32_t now = 0;
+    for (int radius : radii) {
+        ChangeTracker tracker;
+        ChangeTracker plain;
+        for (const auto& pt : points) {
+            now += kFastIntervalMs;
+            SamplePatch patch;
+            Color color = MakeColor(0, 0, 0);
+            Color expected = MakeColor(0, 0, 0);
+            CHECK(TrackingStep(source, tracker, pt[0], pt[1], now, radius, SampleReducer::Median, color,
+                               kMaxPatchRadius, &patch));
+            CHECK(TrackingStep(plainSource, plain, pt[0], pt[1], now, radius, SampleReducer::Median, expected));
+            CHECK(color == expected);
+            CHECK_EQ(PatchMismatches(patch, pt[0], pt[1], kMaxPatchRadius, 64, 48), 0);
+        }
+    }
+    
+    // Patch radius 0 carries no pixels
+    ChangeTracker tracker;
+    SamplePatch patch;
+    Color color;
+    CHECK(TrackingStep(source, tracker, 5, 5, 0, 1, SampleReducer::Mean, color, 0, &patch));
+    CHECK_EQ(patch.width, 0);
+}
+
+// A still cursor with the same sampled color still needs a redraw when
+// the screen changes under the loupe
+TEST(TrackingStepRedrawsForPatchChanges) {
+    Image image = PositionImage(64, 48);
+    ImageScreenSource source(image);
+    ImageScreenSource plainSource(image);
+    ChangeTracker tracker;
+    ChangeTracker plain;
+    SamplePatch patch;
+    Color color;
+    CHECK(TrackingStep(source, tracker, 20, 30, 0, 1, SampleReducer::Mean, color, kMaxPatchRadius, &patch));
+    CHECK(TrackingStep(plainSource, plain, 20, 30, 0, 1, SampleReducer::Mean, color));
+    
+    // Outside the 3x3 window, inside the 15x15 patch
+    uint8_t* p = source.GetImage().pixels.data() + 30 * source.GetImage().Stride() + 25 * 4;
+    p[2] = 200;
+    p = plainSource.GetImage().pixels.data() + 30 * plainSource.GetImage().Stride() + 25 * 4;
+    p[2] = 200;
+    CHECK(TrackingStep(source, tracker, 20, 30, kStillRefreshMs, 1, SampleReducer::Mean, color, kMaxPatchRadius,
+                       &patch));
+    CHECK(!TrackingStep(plainSource, plain, 20, 30, kStillRefreshMs, 1, SampleReducer::Mean, color));
+    CHECK_EQ(PixelAt(patch.View(), 12, 7).r, 200);
+    
+    // And nothing changed since: no redraw
+    CHECK(!TrackingStep(source, tracker, 20, 30, kStillRefreshMs * 2, 1, SampleReducer::Mean, color,
+                        kMaxPatchRadius, &patch));
+}
+
+// The worker hands the UI each sample's patch through the ring
+TEST(WorkerDeliversPatch) {
+    Image image = PositionImage(256, 16);
+    ImageScreenSource source(image);
+    FakeCursor cursor;
+    cursor.ticks = 0;
+    cursor.notifications = 0;
+    cursor.stopAt = 40;
+    
+    CaptureWorker worker(&source, WalkingCursor, CountNotify, &cursor);
+    worker.SetPatchRadius(5);
+    CHECK(worker.Start());
+    ColorSample sample;
+    bool arrived = WaitFor([&] {
+        ColorSample next;
+        if (!worker.LatestSample(next)) return false;
+        CHECK_EQ(PatchMismatches(next.patch, next.x, next.y, 5, 256, 16), 0);
+        sample = next;
+        return next.x == cursor.stopAt;
+    });
+    CHECK(arrived);
+    worker.Stop();
+    CHECK_EQ(PatchMismatches(sample.patch, cursor.stopAt, 0, 5, 256, 16), 0);
+}
@@ -0,0 +1,201 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "core/color_core.h"
+#include "test.h"
+
+namespace {
+
+// round(num / den) with halves up, in plain 64-bit integer division
+long long RoundHalfUp(long long num, long long den) {
+    return (2 * num + den) / (2 * den);
+}
+
+// HSL from the textbook definitions as exact rationals, scaled by kScale:
+// L = (max + min) / 510, S = delta / (255 - |max + min - 255|), and H in
+// sixths of the circle from whichever channel is largest, red first
+void ExactHSL(int r, int g, int b, long long scale, long long& h, long long& s, long long& l) {
+    int maxVal = std::max(std::max(r, g), b);
+    int minVal = std::min(std::min(r, g), b);
+    long long delta = maxVal - minVal;
+    long long sum = maxVal + minVal;
+    l = RoundHalfUp(sum * 100 * scale, 510);
+    if (delta == 0) {
+        h = s = 0;
+        return;
+    }
+    s = RoundHalfUp(delta * 100 * scale, 255 - std::abs(sum - 255));
+    
+    long long sixths;
+    if (maxVal == r) {
+        sixths = g - b < 0 ? g - b + 6 * delta : g - b;
+    } else if (maxVal == g) {
+        sixths = b - r + 2 * delta;
+    } else {
+        sixths = r - g + 4 * delta;
+    }
+    h = RoundHalfUp(60 * scale * sixths, delta) % (360 * scale);
+}
+
+template <int kScale>
+int CountFixedMismatches() {
+    int mismatches = 0;
+    for (int r = 0; r < 256; r++) {
+        for (int g = 0; g < 256; g++) {
+            for (int b = 0; b < 256; b++) {
+                int h, s, l;
+                long long eh, es, el;
+                RGBtoHSLFixed<kScale>(r, g, b, h, s, l);
+                ExactHSL(r, g, b, kScale, eh, es, el);
+                if (h != eh || s != es || l != el) {
+                    if (mismatches++ < 5) {
+                        printf("  #%02X%02X%02X x%d: %d %d %d, exact %lld %lld %lld\n", r, g, b, kScale,
+                               h, s, l, eh, es, el);
+                    }
+                }
+            }
+        }
+    }
+    return mismatches;
+}
+
+} // namespace
+
+TEST(ColorStrings) {
+    Color indigo = MakeColor(99, 102, 241);
+    CHECK_STR(ColorToHex(indigo), "#6366F1");
+    CHECK_STR(ColorToRGB(indigo), "99, 102, 241");
+    CHECK_STR(ColorToHSL(indigo), "239 deg, 84%, 67%");
+    
+    CHECK_STR(ColorToHex(MakeColor(0, 0, 0)), "#000000");
+    CHECK_STR(ColorToHSL(MakeColor(0, 0, 0)), "0 deg, 0%, 0%");
+    CHECK_STR(ColorToHex(MakeColor(255, 255, 255)), "#FFFFFF");
+    CHECK_STR(ColorToRGB(MakeColor(255, 255, 255)), "255, 255, 255");
+    CHECK_STR(ColorToHSL(MakeColor(255, 255, 255)), "0 deg, 0%, 100%");
+    CHECK_STR(ColorToHSL(MakeColor(255, 0, 0)), "0 deg, 100%, 50%");
+    CHECK_STR(ColorToHSL(MakeColor(0, 255, 0)), "120 deg, 100%, 50%");
+    CHECK_STR(ColorToHSL(MakeColor(0, 0, 255)), "240 deg, 100%, 50%");
+}
+
+// Rows padded past the last pixel, as DIB sections and BMP files are
+TEST(PixelAtBothLayoutsClampsToEdges) {
+    const int width = 3;
+    const int height = 2;
+    const size_t rgbStride = 12;
+    const size_t bgraStride = 16;
+    std::vector<uint8_t> rgb(rgbStride * height, 0xEE);
+    std::vector<uint8_t> bgra(bgraStride * height, 0xEE);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            uint8_t r = (uint8_t)(10 * x + 1);
+            uint8_t g = (uint8_t)(100 + y);
+            uint8_t b = (uint8_t)(200 + x + y);
+            uint8_t* p = &rgb[y * rgbStride + x * 3];
+            p[0] = r;
+            p[1] = g;
+            p[2] = b;
+            uint8_t* q = &bgra[y * bgraStride + x * 4];
+            q[0] = b;
+            q[1] = g;
+            q[2] = r;
+            q[3] = 255;
+        }
+    }
+    
+    PixelView views[2] = {{rgb.data(), width, height, rgbStride, PixelFormat::RGB24},
+                          {bgra.data(), width, height, bgraStride, PixelFormat::BGRA32}};
+    for (const PixelView& view : views) {
+        CHECK(PixelAt(view, 0, 0) == MakeColor(1, 100, 200));
+        CHECK(PixelAt(view, 2, 1) == MakeColor(21, 101, 203));
+        CHECK(PixelAt(view, -5, -5) == MakeColor(1, 100, 200));
+        CHECK(PixelAt(view, 9, 0) == MakeColor(21, 100, 202));
+        CHECK(PixelAt(view, 1, 9) == MakeColor(11, 101, 202));
+    }
+}
+
+// Every 24-bit color through every kernel, both layouts and both outputs,
+// against the single-color RGBtoHSL. One red value per 64K-color block.
+TEST(HSLBatchMatchesRGBtoHSLForAllColors) {
+    const size_t block = 1 << 16;
+    std::vector<uint8_t> rgb(block * 3);
+    std::vector<uint8_t> bgra(block * 4);
+    std::vector<HSLValue> packed(block);
+    std::vector<uint16_t> h(block);
+    std::vector<uint8_t> s(block);
+    std::vector<uint8_t> l(block);
+    std::vector<HSLValue> expected(block);
+    
+    const SimdLevel levels[3] = {SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2};
+    SimdLevel original = GetSimdLevel();
+    for (SimdLevel requested : levels) {
+        SimdLevel level = ForceSimdLevel(requested);
+        if (level != requested) continue;       // not on this CPU
+        
+        int mismatches = 0;
+        for (int r = 0; r < 256 && mismatches == 0; r++) {
+            for (size_t i = 0; i < block; i++) {
+                int g = (int)(i >> 8);
+                int b = (int)(i & 255);
+                rgb[i * 3] = (uint8_t)r;
+                rgb[i * 3 + 1] = (uint8_t)g;
+                rgb[i * 3 + 2] = (uint8_t)b;
+                bgra[i * 4] = (uint8_t)b;
+                bgra[i * 4 + 1] = (uint8_t)g;
+                bgra[i * 4 + 2] = (uint8_t)r;
+                bgra[i * 4 + 3] = 255;
+                int eh, es, el;
+                RGBtoHSL(r, g, b, eh, es, el);
+                expected[i] = {(uint16_t)eh, (uint8_t)es, (uint8_t)el};
+            }
+            
+            RGBtoHSLBatch(rgb.data(), block, PixelFormat::RGB24, packed.data());
+            for (size_t i = 0; i < block; i++) {
+                mismatches += packed[i].h != expected[i].h || packed[i].s != expected[i].s ||
+                              packed[i].l != expected[i].l;
+            }
+            RGBtoHSLBatchPlanar(bgra.data(), block, PixelFormat::BGRA32, h.data(), s.data(), l.data());
+            for (size_t i = 0; i < block; i++) {
+                mismatches += h[i] != expected[i].h || s[i] != expected[i].s || l[i] != expected[i].l;
+            }
+        }
+        if (mismatches) printf("  %s kernel\n", SimdLevelName(level));
+        CHECK_EQ(mismatches, 0);
+    }
+    ForceSimdLevel(original);
+}
+
+// Counts that are not a multiple of the vector width end in the scalar tail
+TEST(HSLBatchOddCounts) {
+    std::vector<uint8_t> rgb(3 * 37);
+    for (size_t i = 0; i < rgb.size(); i++) {
+        rgb[i] = (uint8_t)(i * 97 + 13);
+    }
+    for (size_t count = 0; count <= 37; count++) {
+        std::vector<HSLValue> out(count + 1, HSLValue{999, 7, 7});
+        RGBtoHSLBatch(rgb.data(), count, PixelFormat::RGB24, out.data());
+        for (size_t i = 0; i < count; i++) {
+            int h, s, l;
+            RGBtoHSL(rgb[i * 3], rgb[i * 3 + 1], rgb[i * 3 + 2], h, s, l);
+            CHECK(out[i].h == h && out[i].s == s && out[i].l == l);
+        }
+        CHECK_EQ(out[count].h, 999);
+    }
+}
+
+// The reciprocal-multiply divisions against exact integer division for all
+// 2^24 colors, at both precisions
+TEST(HSLFixedMatchesExactRationalForAllColors) {
+    CHECK_EQ(CountFixedMismatches<kHSLWhole>(), 0);
+    CHECK_EQ(CountFixedMismatches<kHSLTenths>(), 0);
+    
+    int h, s, l;
+    RGBtoHSLFixed<kHSLTenths>(99, 102, 241, h, s, l);
+    CHECK_EQ(h, 2387);
+    CHECK_EQ(s, 835);
+    CHECK_EQ(l, 667);
+    // Hues just short of 360 round up to it and wrap
+    RGBtoHSLFixed<kHSLWhole>(255, 0, 1, h, s, l);
+    CHECK_EQ(h, 0);
+}
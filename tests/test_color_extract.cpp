@@ -0,0 +1,159 @@
+#include <algorithm>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "core/color_extract.h"
+#include "core/image_io.h"
+#include "test.h"
+
+namespace {
+
+// Horizontal bands of solid color; heights are percentages of 100 rows
+Image Bands(PixelFormat format, const Color* colors, const int* percent, int count) {
+    Image image;
+    image.Allocate(64, 100, format);
+    int bpp = format == PixelFormat::RGB24 ? 3 : 4;
+    int row = 0;
+    for (int i = 0; i < count; i++) {
+        for (int y = 0; y < percent[i]; y++, row++) {
+            uint8_t* p = image.pixels.data() + (size_t)row * image.Stride();
+            for (int x = 0; x < 64; x++, p += bpp) {
+                p[0] = bpp == 3 ? colors[i].r : colors[i].b;
+                p[1] = colors[i].g;
+                p[2] = bpp == 3 ? colors[i].b : colors[i].r;
+                if (bpp == 4) p[3] = 255;
+            }
+        }
+    }
+    return image;
+}
+
+// Photo-like noise around a few centres, so bins and clusters are many
+Image Noisy(int width, int height, unsigned seed) {
+    std::mt19937 rng(seed);
+    const Color centres[5] = {MakeColor(30, 40, 200), MakeColor(220, 210, 190), MakeColor(20, 120, 40),
+                              MakeColor(250, 90, 20), MakeColor(90, 90, 90)};
+    Image image;
+    image.Allocate(width, height, PixelFormat::BGRA32);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            const Color& c = centres[(x / 40 + y / 30) % 5];
+            uint8_t* p = image.pixels.data() + (size_t)y * image.Stride() + x * 4;
+            p[0] = (uint8_t)std::min(255, std::max(0, c.b + (int)(rng() % 41) - 20));
+            p[1] = (uint8_t)std::min(255, std::max(0, c.g + (int)(rng() % 41) - 20));
+            p[2] = (uint8_t)std::min(255, std::max(0, c.r + (int)(rng() % 41) - 20));
+            p[3] = 255;
+        }
+    }
+    return image;
+}
+
+} // namespace
+
+// Solid areas come back as their exact colors and exact shares, largest
+// first, whatever the method or pixel layout
+TEST(ExtractSolidBands) {
+    const Color colors[4] = {MakeColor(255, 255, 255), MakeColor(99, 102, 241), MakeColor(16, 185, 129),
+                             MakeColor(239, 68, 68)};
+    const int percent[4] = {10, 50, 15, 25};
+    const PixelFormat formats[2] = {PixelFormat::RGB24, PixelFormat::BGRA32};
+    const ExtractMethod methods[2] = {ExtractMethod::MedianCut, ExtractMethod::KMeans};
+    for (PixelFormat format : formats) {
+        Image image = Bands(format, colors, percent, 4);
+        for (ExtractMethod method : methods) {
+            ExtractOptions options;
+            options.method = method;
+            options.count = 8;
+            std::vector<DominantColor> out;
+            ExtractDominantColors(image.View(), options, out);
+            
+            // Only four bins are occupied, so only four colors come back
+            CHECK_EQ(out.size(), 4);
+            if (out.size() != 4) continue;
+            CHECK(out[0].color == colors[1]);
+            CHECK(out[1].color == colors[3]);
+            CHECK(out[2].color == colors[2]);
+            CHECK(out[3].color == colors[0]);
+            CHECK_NEAR(out[0].share, 0.50, 1e-6);
+            CHECK_NEAR(out[1].share, 0.25, 1e-6);
+            CHECK_NEAR(out[2].share, 0.15, 1e-6);
+            CHECK_NEAR(out[3].share, 0.10, 1e-6);
+        }
+    }
+}
+
+TEST(ExtractLimitsAndEdgeCases) {
+    Image image = Noisy(200, 150, 1);
+    std::vector<DominantColor> out;
+    ExtractOptions options;
+    
+    options.count = 1;
+    ExtractDominantColors(image.View(), options, out);
+    CHECK_EQ(out.size(), 1);
+    CHECK_NEAR(out[0].share, 1.0, 1e-6);
+    
+    options.count = 500;
+    options.bits = 6;
+    ExtractDominantColors(image.View(), options, out);
+    CHECK(out.size() <= (size_t)kMaxExtractColors && out.size() > 32);
+    double total = 0;
+    for (size_t i = 0; i < out.size(); i++) {
+        total += out[i].share;
+        if (i > 0) CHECK(out[i].share <= out[i - 1].share);
+        for (size_t j = 0; j < i; j++) CHECK(!(out[i].color == out[j].color));
+    }
+    CHECK_NEAR(total, 1.0, 1e-4);
+    
+    PixelView empty = image.View();
+    empty.height = 0;
+    ExtractDominantColors(empty, options, out);
+    CHECK(out.empty());
+}
+
+// The histogram is exact integer sums, and median cut never looks at the
+// thread count, so its output cannot depend on it. K-means sums its
+// clusters per slice, which may move a center by a rounding step, no more.
+TEST(ExtractIndependentOfThreadCount) {
+    Image image = Noisy(640, 480, 2);
+    ExtractOptions options;
+    options.count = 6;
+    
+    options.method = ExtractMethod::MedianCut;
+    options.threads = 1;
+    std::vector<DominantColor> single;
+    ExtractDominantColors(image.View(), options, single);
+    options.method = ExtractMethod::KMeans;
+    std::vector<DominantColor> singleKMeans;
+    ExtractDominantColors(image.View(), options, singleKMeans);
+    CHECK_EQ(single.size(), 6);
+    
+    const int threadCounts[3] = {2, 3, 8};
+    for (int threads : threadCounts) {
+        options.threads = threads;
+        options.method = ExtractMethod::MedianCut;
+        std::vector<DominantColor> out;
+        ExtractDominantColors(image.View(), options, out);
+        CHECK_EQ(out.size(), single.size());
+        for (size_t i = 0; i < out.size() && i < single.size(); i++) {
+            CHECK(out[i].color == single[i].color && out[i].share == single[i].share);
+        }
+        
+        options.method = ExtractMethod::KMeans;
+        ExtractDominantColors(image.View(), options, out);
+        CHECK_EQ(out.size(), singleKMeans.size());
+        for (size_t i = 0; i < out.size() && i < singleKMeans.size(); i++) {
+            const Color& a = out[i].color;
+            const Color& b = singleKMeans[i].color;
+            CHECK(std::abs(a.r - b.r) <= 1 && std::abs(a.g - b.g) <= 1 && std::abs(a.b - b.b) <= 1);
+            CHECK_NEAR(out[i].share, singleKMeans[i].share, 1e-4);
+        }
+    }
+}
+
+TEST(ExtractMethodNames) {
+    ExtractMethod method;
+    CHECK(ParseExtractMethod("mediancut", method) && method == ExtractMethod::MedianCut);
+    CHECK(ParseExtractMethod(ExtractMethodName(ExtractMethod::KMeans), method) && method == ExtractMethod::KMeans);
+    CHECK(!ParseExtractMethod("octree", method));
+}
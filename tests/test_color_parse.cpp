@@ -0,0 +1,179 @@
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "core/color_parse.h"
+#include "test.h"
+
+namespace {
+
+// The text of every literal the scanner finds, in order
+std::vector<std::string> Scan(const std::string& text) {
+    std::vector<std::string> found;
+    CssColorScanner scanner(text.data(), text.data() + text.size());
+    CssMatch match;
+    while (scanner.Next(match)) {
+        found.push_back(std::string(match.begin, match.end));
+    }
+    return found;
+}
+
+std::string Joined(const std::vector<std::string>& parts) {
+    std::string text;
+    for (const std::string& part : parts) {
+        text += text.empty() ? part : " " + part;
+    }
+    return text;
+}
+
+std::string Convert(const std::string& text, CssSyntax syntax) {
+    FILE* out = tmpfile();
+    if (!out) return "";
+    ConvertCssColors(text.data(), text.data() + text.size(), syntax, out);
+    std::string result((size_t)ftell(out), '\0');
+    rewind(out);
+    size_t n = fread(&result[0], 1, result.size(), out);
+    fclose(out);
+    result.resize(n);
+    return result;
+}
+
+bool Parses(const char* text, Color expected, int alpha = 255) {
+    ParsedColor color;
+    size_t n = ParseCssColor(text, text + strlen(text), color);
+    return n == strlen(text) && color.color == expected && color.alpha == alpha;
+}
+
+} // namespace
+
+TEST(ParseCssLiterals) {
+    CHECK(Parses("#abc", MakeColor(0xAA, 0xBB, 0xCC)));
+    CHECK(Parses("#6366F180", MakeColor(99, 102, 241), 128));
+    CHECK(Parses("rgb(99 102 241)", MakeColor(99, 102, 241)));
+    CHECK(Parses("rgba(99, 102, 241, 0.5)", MakeColor(99, 102, 241), 128));
+    CHECK(Parses("RGB(300 -4 50%)", MakeColor(255, 0, 128)));
+    CHECK(Parses("hsl(0.5turn 100% 50%)", MakeColor(0, 255, 255)));
+    CHECK(Parses("hsla(120, 100%, 50%, 1)", MakeColor(0, 255, 0)));
+    CHECK(Parses("oklch(62.8% 0.258 29.2)", MakeColor(255, 0, 0)));
+    
+    ParsedColor color;
+    const char* bad[] = {"#12", "#12345", "#ggg", "rgb(1 2)", "rgb(1, 2 3)", "hsl(10 20 30", "nope(1 2 3)", ""};
+    for (const char* text : bad) {
+        CHECK_EQ(ParseCssColor(text, text + strlen(text), color), 0);
+    }
+}
+
+// Every syntax writes a literal that parses back to the same color
+TEST(FormatCssRoundTrips) {
+    for (int i = 0; i < 1 << 16; i++) {
+        uint32_t v = (uint32_t)i * 2654435761u;
+        ParsedColor color = {MakeColor(v >> 24, (v >> 16) & 255, (v >> 8) & 255), (uint8_t)(i & 1 ? 255 : v & 255)};
+        for (int s = 0; s < kCssSyntaxCount; s++) {
+            char text[kCssBufferSize];
+            size_t n = FormatCssColor(color, (CssSyntax)s, text);
+            ParsedColor back;
+            if (ParseCssColor(text, text + n, back) != n || !(back.color == color.color) ||
+                back.alpha != color.alpha) {
+                CHECK_STR(text, "a literal that round-trips");
+                return;
+            }
+        }
+    }
+}
+
+// A ':' in a selector is a pseudo-class, not the start of a value, so the
+// id selectors after it stay put
+TEST(CssScannerSkipsSelectors) {
+    CHECK_STR(Joined(Scan(".btn:hover #add .icon { color: #fff; }")), "#fff");
+    CHECK_STR(Joined(Scan("a:focus #bad, a:hover #bed { border: 1px solid #bad; }")), "#bad");
+    CHECK_STR(Joined(Scan("a:not(.x) #cafe > b::before #fed { background: rgb(1 2 3) #abc }")), "rgb(1 2 3) #abc");
+    CHECK_STR(Joined(Scan("#add{color:#add}#bed:hover #bad{fill:#0f0;stroke:#00f}")), "#add #0f0 #00f");
+    CHECK_STR(Convert("li:hover #add { color: #fff }", CssSyntax::RGB), "li:hover #add { color: rgb(255 255 255) }");
+    
+    // Rules inside @media and @supports are still rules
+    CHECK_STR(Joined(Scan("@media (min-width: 600px) { a:hover #bad { color: #123 } }\n"
+                          "@supports (color: oklch(0 0 0)) { p:focus #ace { color: #456 } }\n"
+                          "/* x */ @layer base { #dad:hover #bad { color: #789 } }")),
+              "#123 oklch(0 0 0) #456 #789");
+    // ...while @font-face and @page hold declarations
+    CHECK_STR(Joined(Scan("@page :first { color: #111 } @font-palette-values --p { override-colors: 0 #222 }")),
+              "#111 #222");
+    // A stray '}' does not leave the scanner thinking it is in a block
+    CHECK_STR(Joined(Scan("} } a:hover #bad { color: #333 }")), "#333");
+}
+
+// Without braces the file is a flat token list and every ':' opens a value
+TEST(CssScannerFlatTokens) {
+    CHECK_STR(Joined(Scan("--brand: #6366F1;\n--accent: hsl(160 84% 39%);\nprimary: '#EF4444'\n")),
+              "#6366F1 hsl(160 84% 39%) #EF4444");
+    CHECK_STR(Joined(Scan("{\"primary\": \"#6366F1\", \"nested\": {\"bg\": \"#fff\"}}")), "#6366F1 #fff");
+    CHECK_STR(Joined(Scan("#bad #add\nurl(a.svg#bad)")), "");
+    CHECK_EQ(Scan("").size(), 0);
+}
+
+// Random edits of a stylesheet: whatever the scanner returns lies inside
+// the text, in order, and is a literal that parses to the reported color
+TEST(CssScannerFuzz) {
+    const std::string seed =
+        ":root { --a: #6366f1; --b: rgb(99 102 241 / 50%); }\n"
+        "@media (prefers-color-scheme: dark) { .btn:hover #add { color: hsl(238.7 83.5% 66.7%); } }\n"
+        "a:focus #bad, a:hover #bed { border: 1px solid #bad; background: url(x.svg#id) oklch(58% 0.2 277); }\n";
+    const char pieces[] = "#:;{}()/*,% 0123456789abcdefrgbhslokc.-";
+    uint32_t state = 21;
+    auto next = [&state]() {
+        state = state * 1664525u + 1013904223u;
+        return state >> 8;
+    };
+    
+    int failures = TestFailures();
+    for (int round = 0; round < 20000 && TestFailures() == failures; round++) {
+        std::string text = seed;
+        int edits = 1 + next() % 8;
+        for (int e = 0; e < edits; e++) {
+            size_t at = next() % (text.size() + 1);
+            switch (next() % 3) {
+                case 0: text.insert(at, 1, pieces[next() % (sizeof(pieces) - 1)]); break;
+                case 1: if (at < text.size()) text.erase(at, 1 + next() % 4); break;
+                case 2: if (at < text.size()) text[at] = pieces[next() % (sizeof(pieces) - 1)]; break;
+            }
+        }
+        // Cut the text at a random length, with nothing readable past the end
+        size_t length = next() % (text.size() + 1);
+        std::vector<char> buffer(text.begin(), text.begin() + length);
+        const char* begin = buffer.data();
+        const char* end = begin + length;
+        
+        CssColorScanner scanner(begin, end);
+        CssMatch match;
+        const char* last = begin;
+        size_t count = 0;
+        while (scanner.Next(match)) {
+            CHECK(match.begin >= last && match.end > match.begin && match.end <= end);
+            ParsedColor color;
+            CHECK_EQ(ParseCssColor(match.begin, end, color), match.end - match.begin);
+            CHECK(color.color == match.color.color && color.alpha == match.color.alpha);
+            last = match.end;
+            count++;
+        }
+        CHECK_EQ(ConvertCssColors(begin, end, CssSyntax::Hex, NULL), count);
+    }
+}
+
+// Converting to each syntax and back to hex gives the original hex file
+TEST(CssConvertRoundTrips) {
+    std::string sheet;
+    for (int i = 0; i < 200; i++) {
+        char rule[96];
+        snprintf(rule, sizeof(rule), ".c%d:hover #i%d { color: #%06X; border-color: #%06X80 }\n", i, i,
+                 (unsigned)(i * 83921) & 0xFFFFFF, (unsigned)(i * 1299709) & 0xFFFFFF);
+        sheet += rule;
+    }
+    std::string hex = Convert(sheet, CssSyntax::Hex);
+    CHECK_EQ(Scan(hex).size(), 400);
+    for (int s = 0; s < kCssSyntaxCount; s++) {
+        std::string other = Convert(hex, (CssSyntax)s);
+        CHECK_EQ(Scan(other).size(), 400);
+        CHECK(Convert(other, CssSyntax::Hex) == hex);
+    }
+}
@@ -0,0 +1,302 @@
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "core/color_recorder.h"
+#include "core/image_io.h"
+#include "test.h"
+
+namespace {
+
+const char* kPath = "color_recorder_test.bin";
+
+// Blue is x and green is y
+Image PositionImage(int width, int height) {
+    Image image;
+    image.Allocate(width, height, PixelFormat::BGRA32);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            uint8_t* p = image.pixels.data() + y * image.Stride() + x * 4;
+            p[0] = (uint8_t)x;
+            p[1] = (uint8_t)y;
+            p[2] = 40;
+            p[3] = 255;
+        }
+    }
+    return image;
+}
+
+// The image-backed source, with the red channel of the whole image set to
+// 200 from capture `switchAt` on. Runs on the recorder's capture thread.
+class SwitchingSource : public ImageScreenSource {
+public:
+    SwitchingSource(const Image& image, int switchAt) : ImageScreenSource(image), m_switchAt(switchAt) {}
+    
+    bool Capture(const CaptureRect& rect, PixelView& view) override {
+        if (++m_captures == m_switchAt) {
+            Image& image = GetImage();
+            for (size_t i = 2; i < image.pixels.size(); i += 4) {
+                image.pixels[i] = 200;
+            }
+        }
+        return ImageScreenSource::Capture(rect, view);
+    }
+    
+    int Captures() const { return m_captures; }
+
+private:
+    int m_switchAt;
+    int m_captures = 0;
+};
+
+std::vector<uint8_t> ReadFile(const char* path) {
+    std::vector<uint8_t> bytes;
+    FILE* f = fopen(path, "rb");
+    if (!f) return bytes;
+    uint8_t buffer[65536];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0) {
+        bytes.insert(bytes.end(), buffer, buffer + n);
+    }
+    fclose(f);
+    return bytes;
+}
+
+void WriteFile(const char* path, const std::vector<uint8_t>& bytes, size_t size) {
+    FILE* f = fopen(path, "wb");
+    if (!f) return;
+    fwrite(bytes.data(), 1, size, f);
+    fclose(f);
+}
+
+// Sample counts of the blocks of a recording file, walked by hand from the
+// documented layout: 32-byte header, then 16-byte block headers with the
+// count at offset 4, each followed by 15 bytes per sample
+std::vector<uint32_t> BlockCounts(const std::vector<uint8_t>& bytes) {
+    std::vector<uint32_t> counts;
+    for (size_t offset = 32; offset + 16 <= bytes.size();) {
+        uint32_t count;
+        memcpy(&count, &bytes[offset + 4], 4);
+        counts.push_back(count);
+        offset += 16 + (size_t)count * 15;
+    }
+    return counts;
+}
+
+} // namespace
+
+// Records a still image that turns red part way through, then reads the
+// file back: every column, the timestamps and the change event
+TEST(RecorderRoundTrip) {
+    SwitchingSource source(PositionImage(64, 48), 300);
+    ColorRecorder recorder(&source);
+    RecordOptions options;
+    options.x = 21;
+    options.y = 13;
+    options.radius = 2;
+    options.intervalUs = 200;
+    options.flushMs = 20;
+    std::string error;
+    CHECK(recorder.Start(kPath, options, error));
+    CHECK(recorder.IsRecording());
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (source.Captures() < 1000 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    recorder.Stop();
+    CHECK(!recorder.IsRecording());
+    
+    const RecordCounters& counters = recorder.Counters();
+    CHECK(counters.samples >= 1000);
+    CHECK_EQ(counters.dropped, 0);
+    CHECK_EQ(counters.failedCaptures, 0);
+    CHECK_EQ(counters.writeErrors, 0);
+    CHECK(counters.blocks >= 2);
+    
+    std::vector<uint8_t> bytes = ReadFile(kPath);
+    CHECK_EQ(bytes.size(), counters.bytes);
+    std::vector<uint32_t> blocks = BlockCounts(bytes);
+    CHECK_EQ(blocks.size(), counters.blocks);
+    
+    Recording recording;
+    CHECK(ReadRecording(kPath, recording, error));
+    CHECK_EQ(recording.Size(), counters.samples);
+    CHECK(recording.startUnixUs > 0);
+    int bad = 0;
+    for (size_t i = 0; i < recording.Size(); i++) {
+        // The 5x5 mean around (21, 13) of the position image
+        bad += recording.x[i] != 21 || recording.y[i] != 13;
+        bad += recording.b[i] != 21 || recording.g[i] != 13 || recording.r[i] != (i < 299 ? 40 : 200);
+        // Timestamps increase across blocks too; the schedule does not burst
+        // after a stall, so the mean spacing holds the interval
+        bad += i > 0 && recording.timeUs[i] <= recording.timeUs[i - 1];
+    }
+    CHECK_EQ(bad, 0);
+    CHECK(recording.timeUs.back() - recording.timeUs[0] >= (recording.Size() - 1) * 200 - 200);
+    
+    RecordingStats stats;
+    std::vector<ColorChange> changes;
+    SummariseRecording(recording, 4, stats, &changes);
+    CHECK_EQ(stats.samples, recording.Size());
+    CHECK_EQ(stats.changes, 1);
+    CHECK_EQ(changes.size(), 1);
+    if (changes.size() == 1) {
+        CHECK_EQ(changes[0].index, 299);
+        CHECK_EQ(changes[0].timeUs, recording.timeUs[299]);
+        CHECK(changes[0].from == MakeColor(40, 13, 21));
+        CHECK(changes[0].to == MakeColor(200, 13, 21));
+    }
+    CHECK_EQ(stats.r.min, 40);
+    CHECK_EQ(stats.r.max, 200);
+    CHECK_EQ(stats.g.min, 13);
+    CHECK_EQ(stats.g.max, 13);
+    CHECK_EQ(stats.durationUs, recording.timeUs.back() - recording.timeUs[0]);
+    CHECK(stats.rateHz > 0 && stats.rateHz <= 5000.5);
+    remove(kPath);
+}
+
+// A crash mid-write leaves a torn final block; reading keeps every
+// complete block and drops the rest
+TEST(RecorderIgnoresTornBlock) {
+    ImageScreenSource source(PositionImage(16, 16));
+    ColorRecorder recorder(&source);
+    RecordOptions options;
+    options.intervalUs = 100;
+    options.flushMs = 10;
+    std::string error;
+    CHECK(recorder.Start(kPath, options, error));
+    std::this_thread::sleep_for(std::chrono::milliseconds(120));
+    recorder.Stop();
+    
+    std::vector<uint8_t> bytes = ReadFile(kPath);
+    std::vector<uint32_t> blocks = BlockCounts(bytes);
+    CHECK(blocks.size() >= 2);
+    Recording full;
+    CHECK(ReadRecording(kPath, full, error));
+    if (blocks.size() < 2 || TestFailures() > 0) {
+        remove(kPath);
+        return;
+    }
+    size_t lastBlock = 16 + (size_t)blocks.back() * 15;
+    const char* torn = "color_recorder_torn.bin";
+    
+    // Cut inside the last block's columns, inside its header, and just
+    // after its magic; then garbage in place of the header
+    const size_t cuts[3] = {1, lastBlock - 15, lastBlock - 4};
+    for (size_t cut : cuts) {
+        WriteFile(torn, bytes, bytes.size() - cut);
+        Recording recording;
+        CHECK(ReadRecording(torn, recording, error));
+        CHECK_EQ(recording.Size(), full.Size() - blocks.back());
+        CHECK(std::equal(recording.timeUs.begin(), recording.timeUs.end(), full.timeUs.begin()));
+    }
+    std::vector<uint8_t> garbage(bytes.begin(), bytes.end() - lastBlock);
+    garbage.insert(garbage.end(), {'X', 'C', 'P', 'B', 0xFF, 0xFF, 0, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9});
+    WriteFile(torn, garbage, garbage.size());
+    Recording recording;
+    CHECK(ReadRecording(torn, recording, error));
+    CHECK_EQ(recording.Size(), full.Size() - blocks.back());
+    
+    // Not a recording at all
+    WriteFile(torn, bytes, 20);
+    CHECK(!ReadRecording(torn, recording, error));
+    CHECK(error.find("not a color recording") != std::string::npos);
+    remove(torn);
+    remove(kPath);
+}
+
+// Change events are counted exactly and listed up to the cap
+TEST(RecorderSummariseChanges) {
+    Recording recording;
+    const uint8_t reds[8] = {10, 12, 30, 30, 29, 0, 0, 255};
+    for (int i = 0; i < 8; i++) {
+        recording.timeUs.push_back(1000 + i * 500);
+        recording.x.push_back(1);
+        recording.y.push_back(2);
+        recording.r.push_back(reds[i]);
+        recording.g.push_back(5);
+        recording.b.push_back(i == 3 ? 50 : 5);
+    }
+    RecordingStats stats;
+    std::vector<ColorChange> changes;
+    SummariseRecording(recording, 2, stats, &changes, 3);
+    // Above the threshold: 12->30, b 5->50, b 50->5, 29->0, 0->255
+    CHECK_EQ(stats.changes, 5);
+    CHECK_EQ(changes.size(), 3);
+    CHECK_EQ(changes[0].index, 2);
+    CHECK_EQ(changes[1].index, 3);
+    CHECK(changes[1].to == MakeColor(30, 5, 50));
+    CHECK_EQ(changes[2].timeUs, 3000);
+    CHECK_EQ(stats.durationUs, 3500);
+    CHECK_NEAR(stats.rateHz, 2000.0, 1e-9);
+    CHECK_EQ(stats.r.min, 0);
+    CHECK_EQ(stats.r.max, 255);
+    CHECK_NEAR(stats.r.mean, (10 + 12 + 30 + 30 + 29 + 0 + 0 + 255) / 8.0, 1e-4);
+    
+    SummariseRecording(recording, 255, stats);
+    CHECK_EQ(stats.changes, 0);
+    SummariseRecording(Recording(), 0, stats);
+    CHECK_EQ(stats.samples, 0);
+}
+
+#ifndef _WIN32
+// A disk that stops accepting writes: the recording goes to a pipe nobody
+// reads until the arena has filled, so the capture thread must count the
+// samples it had nowhere to put, and still write everything it kept
+TEST(RecorderCountsDropsWhenArenaFull) {
+    const char* fifo = "color_recorder_test.fifo";
+    remove(fifo);
+    CHECK_EQ(mkfifo(fifo, 0600), 0);
+    int reader = open(fifo, O_RDONLY | O_NONBLOCK);
+    CHECK(reader >= 0);
+    if (reader < 0) return;
+    
+    ImageScreenSource source(PositionImage(8, 8));
+    ColorRecorder recorder(&source);
+    RecordOptions options;
+    options.intervalUs = 0;
+    options.flushMs = 1000;
+    std::string error;
+    CHECK(recorder.Start(fifo, options, error));
+    // Enough for 16 blocks of 4096 samples at any plausible capture speed
+    std::this_thread::sleep_for(std::chrono::milliseconds(1500));
+    
+    fcntl(reader, F_SETFL, 0);
+    std::vector<uint8_t> bytes;
+    std::thread drain([&] {
+        uint8_t buffer[65536];
+        ssize_t n;
+        while ((n = read(reader, buffer, sizeof(buffer))) > 0) {
+            bytes.insert(bytes.end(), buffer, buffer + n);
+        }
+    });
+    recorder.Stop();
+    drain.join();
+    close(reader);
+    remove(fifo);
+    
+    const RecordCounters& counters = recorder.Counters();
+    CHECK(counters.dropped > 0);
+    CHECK_EQ(counters.writeErrors, 0);
+    CHECK_EQ(bytes.size(), counters.bytes);
+    
+    // What was kept is intact and has no gaps inside a block
+    WriteFile(kPath, bytes, bytes.size());
+    Recording recording;
+    CHECK(ReadRecording(kPath, recording, error));
+    CHECK_EQ(recording.Size(), counters.samples);
+    CHECK(counters.samples >= (uint64_t)kRecordArenaBlocks * kRecordBlockSamples);
+    remove(kPath);
+}
+#endif
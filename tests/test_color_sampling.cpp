@@ -0,0 +1,149 @@
+#include <algorithm>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "core/color_sampling.h"
+#include "core/image_io.h"
+#include "core/integral_image.h"
+#include "test.h"
+
+namespace {
+
+// Windows drawn from few colors, so modes and ties actually occur
+Image RandomWindow(std::mt19937& rng, int width, int height, PixelFormat format) {
+    Color palette[4];
+    for (Color& c : palette) {
+        c = MakeColor(rng() % 256, rng() % 256, rng() % 256);
+    }
+    Image image;
+    image.Allocate(width, height, format);
+    int bpp = format == PixelFormat::RGB24 ? 3 : 4;
+    for (int i = 0; i < width * height; i++) {
+        Color c = rng() % 3 ? palette[rng() % 4] : MakeColor(rng() % 256, rng() % 256, rng() % 256);
+        uint8_t* p = image.pixels.data() + i * bpp;
+        p[0] = format == PixelFormat::RGB24 ? c.r : c.b;
+        p[1] = c.g;
+        p[2] = format == PixelFormat::RGB24 ? c.b : c.r;
+        if (bpp == 4) p[3] = 255;
+    }
+    return image;
+}
+
+std::vector<Color> Pixels(const PixelView& view) {
+    std::vector<Color> pixels;
+    for (int y = 0; y < view.height; y++) {
+        for (int x = 0; x < view.width; x++) {
+            pixels.push_back(PixelAt(view, x, y));
+        }
+    }
+    return pixels;
+}
+
+int ChannelOf(Color c, int channel) {
+    return channel == 0 ? c.r : channel == 1 ? c.g : c.b;
+}
+
+} // namespace
+
+// Every radius the GUI offers, against sums, sorts and counts done naively
+TEST(ReducersMatchNaiveReference) {
+    std::mt19937 rng(5);
+    for (int radius = 0; radius <= kMaxSampleRadius; radius++) {
+        for (int format = 0; format < 2; format++) {
+            int side = radius * 2 + 1;
+            Image image = RandomWindow(rng, side, side, format ? PixelFormat::BGRA32 : PixelFormat::RGB24);
+            std::vector<Color> pixels = Pixels(image.View());
+            size_t n = pixels.size();
+            
+            int mean[3];
+            int median[3];
+            for (int c = 0; c < 3; c++) {
+                std::vector<int> values;
+                int sum = 0;
+                for (Color p : pixels) {
+                    values.push_back(ChannelOf(p, c));
+                    sum += ChannelOf(p, c);
+                }
+                std::sort(values.begin(), values.end());
+                mean[c] = (int)((sum + n / 2) / n);
+                median[c] = values[(n - 1) / 2];
+            }
+            CHECK(ReduceRegion(image.View(), SampleReducer::Mean) == MakeColor(mean[0], mean[1], mean[2]));
+            CHECK(ReduceRegion(image.View(), SampleReducer::Median) == MakeColor(median[0], median[1], median[2]));
+            
+            std::map<uint32_t, int> counts;
+            int most = 0;
+            for (Color p : pixels) {
+                most = std::max(most, ++counts[(p.r << 16) | (p.g << 8) | p.b]);
+            }
+            Color mode = ReduceRegion(image.View(), SampleReducer::Mode);
+            CHECK_EQ(counts[(mode.r << 16) | (mode.g << 8) | mode.b], most);
+        }
+    }
+}
+
+// Three colors twice each, one of them the centre's: the centre wins the tie
+TEST(ModeTiePrefersCentre) {
+    Image image;
+    image.Allocate(3, 3, PixelFormat::RGB24);
+    const Color colors[9] = {MakeColor(1, 0, 0), MakeColor(1, 0, 0), MakeColor(2, 0, 0),
+                             MakeColor(2, 0, 0), MakeColor(9, 9, 9), MakeColor(9, 9, 9),
+                             MakeColor(3, 0, 0), MakeColor(4, 0, 0), MakeColor(5, 0, 0)};
+    for (int i = 0; i < 9; i++) {
+        image.pixels[i * 3] = colors[i].r;
+        image.pixels[i * 3 + 1] = colors[i].g;
+        image.pixels[i * 3 + 2] = colors[i].b;
+    }
+    CHECK(ReduceRegion(image.View(), SampleReducer::Mode) == MakeColor(9, 9, 9));
+    
+    // one more red and red has the majority
+    image.pixels[6 * 3] = 1;
+    CHECK(ReduceRegion(image.View(), SampleReducer::Mode) == MakeColor(1, 0, 0));
+}
+
+TEST(ReducerNames) {
+    const SampleReducer all[3] = {SampleReducer::Mean, SampleReducer::Median, SampleReducer::Mode};
+    for (SampleReducer reducer : all) {
+        SampleReducer parsed;
+        CHECK(ParseSampleReducer(SampleReducerName(reducer), parsed) && parsed == reducer);
+    }
+    SampleReducer parsed;
+    CHECK(!ParseSampleReducer("average", parsed));
+}
+
+TEST(IntegralImageSumsAndClipping) {
+    std::mt19937 rng(9);
+    Image image = RandomWindow(rng, 37, 23, PixelFormat::BGRA32);
+    IntegralImage table;
+    table.Build(image.View());
+    CHECK_EQ(table.Width(), 37);
+    CHECK_EQ(table.Height(), 23);
+    
+    for (int i = 0; i < 500; i++) {
+        int x = (int)(rng() % 50) - 6;
+        int y = (int)(rng() % 36) - 6;
+        int w = (int)(rng() % 30);
+        int h = (int)(rng() % 30);
+        uint32_t expected[3] = {0, 0, 0};
+        uint32_t area = 0;
+        for (int py = std::max(y, 0); py < std::min(y + h, 23); py++) {
+            for (int px = std::max(x, 0); px < std::min(x + w, 37); px++) {
+                Color c = PixelAt(image.View(), px, py);
+                expected[0] += c.r;
+                expected[1] += c.g;
+                expected[2] += c.b;
+                area++;
+            }
+        }
+        uint32_t sum[3];
+        CHECK_EQ(table.Sum(x, y, w, h, sum), area);
+        CHECK(sum[0] == expected[0] && sum[1] == expected[1] && sum[2] == expected[2]);
+        Color mean;
+        CHECK_EQ(table.Mean(x, y, w, h, mean), area > 0);
+        if (area > 0) {
+            CHECK(mean == MakeColor((expected[0] + area / 2) / area, (expected[1] + area / 2) / area,
+                                    (expected[2] + area / 2) / area));
+        }
+    }
+}
@@ -0,0 +1,230 @@
+#include <algorithm>
+#include <random>
+#include <tuple>
+#include <vector>
+
+#include "core/color_search.h"
+#include "core/image_io.h"
+#include "test.h"
+
+namespace {
+
+void SetPixel(Image& image, int x, int y, Color c) {
+    uint8_t* p = image.pixels.data() + (size_t)y * image.Stride() + x * (image.format == PixelFormat::RGB24 ? 3 : 4);
+    if (image.format == PixelFormat::RGB24) {
+        p[0] = c.r;
+        p[1] = c.g;
+        p[2] = c.b;
+    } else {
+        p[0] = c.b;
+        p[1] = c.g;
+        p[2] = c.r;
+    }
+}
+
+bool SameColor(Color a, Color b) {
+    return a.r == b.r && a.g == b.g && a.b == b.b;
+}
+
+// 1-based label of each pixel's target, 0 for none: the first equal target
+// for exact searches, the closest by brute force within the tolerance
+// otherwise, reported as the first target of that color
+std::vector<int> ReferenceLabels(const Image& image, const std::vector<Color>& targets, const SearchOptions& options) {
+    Palette palette;
+    for (Color t : targets) palette.Add("", t);
+    palette.BuildIndex();
+    
+    PixelView view = image.View();
+    std::vector<int> labels((size_t)view.width * view.height, 0);
+    for (int y = 0; y < view.height; y++) {
+        for (int x = 0; x < view.width; x++) {
+            Color c = PixelAt(view, x, y);
+            int best = -1;
+            if (options.tolerance == 0) {
+                for (size_t i = 0; i < targets.size() && best < 0; i++) {
+                    if (SameColor(targets[i], c)) best = (int)i;
+                }
+            } else {
+                float distance;
+                int nearest = palette.NearestLinear(c, options.metric, &distance);
+                if (distance <= options.tolerance) {
+                    for (size_t i = 0; i < targets.size() && best < 0; i++) {
+                        if (SameColor(targets[i], targets[nearest])) best = (int)i;
+                    }
+                }
+            }
+            labels[(size_t)y * view.width + x] = best + 1;
+        }
+    }
+    return labels;
+}
+
+// 8-connected flood fill over the labels, one match per region
+std::vector<ColorMatch> ReferenceMatches(int width, int height, const std::vector<int>& labels, int minPixels) {
+    std::vector<ColorMatch> matches;
+    std::vector<char> seen(labels.size(), 0);
+    std::vector<int> stack;
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            int start = y * width + x;
+            if (!labels[start] || seen[start]) continue;
+            
+            int label = labels[start];
+            int x0 = x, x1 = x, y0 = y, y1 = y, pixels = 0;
+            stack.assign(1, start);
+            seen[start] = 1;
+            while (!stack.empty()) {
+                int q = stack.back();
+                stack.pop_back();
+                int qx = q % width;
+                int qy = q / width;
+                pixels++;
+                x0 = std::min(x0, qx);
+                x1 = std::max(x1, qx);
+                y0 = std::min(y0, qy);
+                y1 = std::max(y1, qy);
+                for (int dy = -1; dy <= 1; dy++) {
+                    for (int dx = -1; dx <= 1; dx++) {
+                        int nx = qx + dx;
+                        int ny = qy + dy;
+                        if (nx < 0 || ny < 0 || nx >= width || ny >= height) continue;
+                        int n = ny * width + nx;
+                        if (!seen[n] && labels[n] == label) {
+                            seen[n] = 1;
+                            stack.push_back(n);
+                        }
+                    }
+                }
+            }
+            if (pixels >= minPixels) {
+                ColorMatch match = {{x0, y0, x1 - x0 + 1, y1 - y0 + 1}, label - 1, pixels};
+                matches.push_back(match);
+            }
+        }
+    }
+    return matches;
+}
+
+bool MatchLess(const ColorMatch& a, const ColorMatch& b) {
+    return std::make_tuple(a.rect.y, a.rect.x, a.target, a.rect.width, a.rect.height, a.pixels) <
+           std::make_tuple(b.rect.y, b.rect.x, b.target, b.rect.width, b.rect.height, b.pixels);
+}
+
+bool InReadingOrder(const std::vector<ColorMatch>& matches) {
+    for (size_t i = 1; i < matches.size(); i++) {
+        const CaptureRect& a = matches[i - 1].rect;
+        const CaptureRect& b = matches[i].rect;
+        if (b.y < a.y || (b.y == a.y && b.x < a.x)) return false;
+    }
+    return true;
+}
+
+} // namespace
+
+// Random frames drawn from a few colors with runs and near-miss pixels,
+// searched exactly with up to eight targets (the packed compare), with
+// hundreds (the bit table), and with a tolerance (the palette index), at
+// every SIMD level and several thread counts, against the flood fill
+TEST(SearchMatchesFloodFillReference) {
+    std::mt19937 rng(22);
+    SimdLevel original = GetSimdLevel();
+    int failures = 0;
+    int compared = 0;
+    for (int iter = 0; iter < 150; iter++) {
+        int width = 1 + rng() % 150;
+        int height = 1 + rng() % 120;
+        PixelFormat format = rng() % 2 ? PixelFormat::RGB24 : PixelFormat::BGRA32;
+        Image image;
+        image.Allocate(width, height, format);
+        std::vector<Color> colors;
+        int colorCount = 2 + rng() % 12;
+        for (int i = 0; i < colorCount; i++) colors.push_back(MakeColor(rng() % 256, rng() % 256, rng() % 256));
+        for (size_t i = 0; i < image.pixels.size(); i++) image.pixels[i] = (uint8_t)rng();     // alpha noise
+        Color previous = colors[0];
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                Color c = x > 0 && rng() % 3 == 0 ? previous : colors[rng() % colorCount];
+                if (rng() % 20 == 0) c.r ^= 1;
+                SetPixel(image, x, y, c);
+                previous = c;
+            }
+        }
+        
+        int mode = iter % 3;
+        int targetCount = mode == 0 ? 1 + rng() % 8 : (mode == 1 ? 9 + rng() % 300 : 1 + rng() % 20);
+        std::vector<Color> targets;
+        for (int i = 0; i < targetCount; i++) {
+            targets.push_back(rng() % 2 ? colors[rng() % colorCount] : MakeColor(rng() % 256, rng() % 256, rng() % 256));
+        }
+        SearchOptions options;
+        options.minPixels = 1 + rng() % 4;
+        options.threads = 1 + rng() % 4;
+        if (mode == 2) {
+            options.tolerance = (float)(1 + rng() % 10);
+            options.metric = rng() % 2 ? PaletteMetric::OKLab : PaletteMetric::DeltaE2000;
+            if (options.metric == PaletteMetric::OKLab) options.tolerance /= 100;
+        }
+        
+        std::vector<ColorMatch> expected =
+            ReferenceMatches(width, height, ReferenceLabels(image, targets, options), options.minPixels);
+        std::sort(expected.begin(), expected.end(), MatchLess);
+        const SimdLevel levels[3] = {SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2};
+        for (SimdLevel requested : levels) {
+            if (ForceSimdLevel(requested) != requested) continue;
+            std::vector<ColorMatch> got;
+            CHECK(SearchColors(image.View(), targets, options, got));
+            CHECK(InReadingOrder(got));
+            std::sort(got.begin(), got.end(), MatchLess);
+            bool same = got.size() == expected.size();
+            for (size_t i = 0; same && i < got.size(); i++) {
+                same = !MatchLess(got[i], expected[i]) && !MatchLess(expected[i], got[i]);
+            }
+            failures += !same;
+            compared++;
+        }
+    }
+    ForceSimdLevel(original);
+    CHECK_EQ(failures, 0);
+    CHECK(compared >= 150);
+}
+
+TEST(SearchConnectivityAndSummary) {
+    Image image;
+    image.Allocate(12, 6, PixelFormat::BGRA32);
+    Color red = MakeColor(239, 68, 68);
+    Color blue = MakeColor(59, 130, 246);
+    // A diagonal of red is one region; a lone red pixel is a second, a
+    // blue bar a third
+    for (int i = 0; i < 4; i++) SetPixel(image, i, i, red);
+    SetPixel(image, 10, 0, red);
+    for (int x = 6; x < 11; x++) SetPixel(image, x, 4, blue);
+    
+    std::vector<Color> targets = {red, blue, red};
+    SearchOptions options;
+    std::vector<ColorMatch> matches;
+    SearchSummary summary;
+    CHECK(SearchColors(image.View(), targets, options, matches, &summary));
+    CHECK_EQ(matches.size(), 3);
+    if (matches.size() == 3) {
+        CHECK_EQ(matches[0].rect.x, 0);
+        CHECK_EQ(matches[0].rect.width, 4);
+        CHECK_EQ(matches[0].rect.height, 4);
+        CHECK_EQ(matches[0].pixels, 4);
+        CHECK_EQ(matches[0].target, 0);     // the first of the duplicate targets
+        CHECK_EQ(matches[1].rect.x, 10);
+        CHECK_EQ(matches[2].target, 1);
+        CHECK_EQ(matches[2].pixels, 5);
+    }
+    CHECK_EQ(summary.pixels, 10);
+    CHECK_EQ(summary.runs, 6);
+    CHECK_EQ(summary.regions, 3);
+    
+    // Specks below minPixels go, the summary still counts them
+    options.minPixels = 2;
+    CHECK(SearchColors(image.View(), targets, options, matches, &summary));
+    CHECK_EQ(matches.size(), 2);
+    CHECK_EQ(summary.regions, 3);
+    
+    std::vector<Color> tooMany(kMaxSearchTargets + 1, red);
+    CHECK(!SearchColors(image.View(), tooMany, options, matches));
+}
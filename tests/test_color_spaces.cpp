@@ -0,0 +1,186 @@
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "core/color_spaces.h"
+#include "test.h"
+
+namespace {
+
+double ReferenceDecode(int code) {
+    double v = code / 255.0;
+    return v <= 0.04045 ? v / 12.92 : std::pow((v + 0.055) / 1.055, 2.4);
+}
+
+double ReferenceEncode(double linear) {
+    return linear <= 0.0031308 ? linear * 12.92 : 1.055 * std::pow(linear, 1 / 2.4) - 0.055;
+}
+
+// Unrounded HSL, h in degrees and s, l in 0-1
+void ExactHSL(int r, int g, int b, double& h, double& s, double& l) {
+    int maxV = std::max(r, std::max(g, b));
+    int minV = std::min(r, std::min(g, b));
+    double d = (maxV - minV) / 255.0;
+    l = (maxV + minV) / 510.0;
+    s = d == 0 ? 0 : d / (1 - std::fabs(2 * l - 1));
+    if (d == 0) h = 0;
+    else if (maxV == r) h = 60 * std::fmod((g - b) / 255.0 / d + 6, 6.0);
+    else if (maxV == g) h = 60 * ((b - r) / 255.0 / d + 2);
+    else h = 60 * ((r - g) / 255.0 / d + 4);
+}
+
+std::string Formatted(Color color, ColorSpace space) {
+    char buffer[kSpaceBufferSize];
+    size_t length = FormatColorSpace(color, space, buffer);
+    return std::string(buffer, length);
+}
+
+} // namespace
+
+TEST(SrgbTablesMatchPow) {
+    for (int code = 0; code < 256; code++) {
+        CHECK_NEAR(SrgbToLinear((uint8_t)code), ReferenceDecode(code), 1e-7);
+        CHECK_EQ(LinearToSrgb(SrgbToLinear((uint8_t)code)), code);
+    }
+    
+    // Encoding is round-to-nearest of the exact curve, away from the ties
+    // where float and double may disagree on the side
+    int wrong = 0;
+    for (int i = 0; i <= 100000; i++) {
+        double linear = i / 100000.0;
+        double encoded = ReferenceEncode(linear) * 255;
+        if (std::fabs(encoded - std::floor(encoded) - 0.5) < 1e-4) continue;
+        wrong += LinearToSrgb((float)linear) != (int)(encoded + 0.5);
+    }
+    CHECK_EQ(wrong, 0);
+    
+    // Exactly on and either side of every rounding threshold
+    const float* thresholds = SrgbEncodeThresholds();
+    for (int code = 0; code < 255; code++) {
+        float t = thresholds[code];
+        CHECK_EQ(LinearToSrgb(std::nextafter(t, 0.0f)), code);
+        CHECK_EQ(LinearToSrgb(t), code + 1);
+        CHECK_EQ(LinearToSrgb(std::nextafter(t, 1.0f)), code + 1);
+    }
+    CHECK_EQ(LinearToSrgb(-1.0f), 0);
+    CHECK_EQ(LinearToSrgb(2.0f), 255);
+}
+
+// Every space must give back the exact 8-bit color it was made from. Every
+// third code per channel keeps the run short and still hits 0 and 255.
+TEST(ColorSpaceRoundTrips) {
+    int failures[6] = {0, 0, 0, 0, 0, 0};
+    for (int r = 0; r < 256; r += 3) {
+        for (int g = 0; g < 256; g += 3) {
+            for (int b = 0; b < 256; b += 3) {
+                Color c = MakeColor(r, g, b);
+                failures[0] += !(LinearToColor(ColorToLinear(c)) == c);
+                failures[1] += !(HSVToColor(ColorToHSV(c)) == c);
+                failures[2] += !(LabToColor(ColorToLab(c)) == c);
+                failures[3] += !(OKLabToColor(ColorToOKLab(c)) == c);
+                failures[4] += !(CMYKToColor(ColorToCMYK(c)) == c);
+                
+                OKLabValue ok = ColorToOKLab(c);
+                failures[5] += !(OKLChToColor(LabToLCh(ok.l, ok.a, ok.b)) == c);
+            }
+        }
+    }
+    CHECK_EQ(failures[0], 0);
+    CHECK_EQ(failures[1], 0);
+    CHECK_EQ(failures[2], 0);
+    CHECK_EQ(failures[3], 0);
+    CHECK_EQ(failures[4], 0);
+    CHECK_EQ(failures[5], 0);
+}
+
+TEST(HSLToColorInvertsHSL) {
+    int failures = 0;
+    for (int r = 0; r < 256; r += 5) {
+        for (int g = 0; g < 256; g += 5) {
+            for (int b = 0; b < 256; b += 5) {
+                double h, s, l;
+                ExactHSL(r, g, b, h, s, l);
+                failures += !(HSLToColor((float)h, (float)s, (float)l) == MakeColor(r, g, b));
+            }
+        }
+    }
+    CHECK_EQ(failures, 0);
+}
+
+// Published values for sRGB red and the first pairs of the CIEDE2000 test
+// data from Sharma, Wu and Dalal
+TEST(ColorSpaceReferenceValues) {
+    LabValue lab = ColorToLab(MakeColor(255, 0, 0));
+    CHECK_NEAR(lab.l, 53.2408, 0.001);
+    CHECK_NEAR(lab.a, 80.0925, 0.001);
+    CHECK_NEAR(lab.b, 67.2032, 0.001);
+    
+    OKLabValue ok = ColorToOKLab(MakeColor(255, 0, 0));
+    CHECK_NEAR(ok.l, 0.62796, 0.0001);
+    CHECK_NEAR(ok.a, 0.22486, 0.0001);
+    CHECK_NEAR(ok.b, 0.12585, 0.0001);
+    
+    struct Pair {
+        LabValue x, y;
+        double expected;
+    };
+    const Pair pairs[] = {
+        {{50, 2.6772f, -79.7751f}, {50, 0, -82.7485f}, 2.0425},
+        {{50, 3.1571f, -77.2803f}, {50, 0, -82.7485f}, 2.8615},
+        {{50, 2.8361f, -74.0200f}, {50, 0, -82.7485f}, 3.4412},
+        {{50, 0, 0}, {50, -1, 2}, 2.3669},
+        {{50, 2.5f, 0}, {73, 25, -18}, 27.1492},
+        {{2.0776f, 0.0795f, -1.1350f}, {0.9033f, -0.0636f, -0.5514f}, 0.9082},
+    };
+    for (const Pair& pair : pairs) {
+        CHECK_NEAR(DeltaE2000(pair.x, pair.y), pair.expected, 0.0001);
+        CHECK_NEAR(DeltaE2000(pair.y, pair.x), pair.expected, 0.0001);
+    }
+    CHECK_NEAR(DeltaE76(lab, lab), 0, 0);
+}
+
+TEST(ViewConversionMatchesPerColor) {
+    const int width = 7;
+    const int height = 3;
+    std::vector<uint8_t> pixels((size_t)width * height * 4);
+    for (size_t i = 0; i < pixels.size(); i++) {
+        pixels[i] = (uint8_t)(i * 37 + 11);
+    }
+    const PixelFormat formats[2] = {PixelFormat::RGB24, PixelFormat::BGRA32};
+    for (PixelFormat format : formats) {
+        size_t stride = (size_t)width * (format == PixelFormat::RGB24 ? 3 : 4);
+        PixelView view = {pixels.data(), width, height, stride, format};
+        std::vector<LabValue> lab(width * height);
+        std::vector<OKLabValue> ok(width * height);
+        ViewToLab(view, lab.data());
+        ViewToOKLab(view, ok.data());
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                Color c = PixelAt(view, x, y);
+                const LabValue& l = lab[y * width + x];
+                const OKLabValue& o = ok[y * width + x];
+                CHECK(DeltaE76(l, ColorToLab(c)) == 0);
+                CHECK(OKLabDistance(o, ColorToOKLab(c)) == 0);
+            }
+        }
+    }
+}
+
+TEST(FormatColorSpaces) {
+    Color red = MakeColor(255, 0, 0);
+    CHECK_STR(Formatted(red, ColorSpace::HSV), "0 deg, 100%, 100%");
+    CHECK_STR(Formatted(red, ColorSpace::Lab), "53.24, 80.09, 67.20");
+    CHECK_STR(Formatted(red, ColorSpace::LCh), "53.24, 104.55, 40.0 deg");
+    CHECK_STR(Formatted(red, ColorSpace::OKLab), "0.6280, 0.2249, 0.1258");
+    CHECK_STR(Formatted(red, ColorSpace::OKLCh), "0.6280, 0.2577, 29.2 deg");
+    CHECK_STR(Formatted(red, ColorSpace::CMYK), "0%, 100%, 100%, 0%");
+    
+    // Grays print no stray signs or hues from rounding noise
+    for (int v = 0; v < 256; v += 15) {
+        Color gray = MakeColor(v, v, v);
+        CHECK(Formatted(gray, ColorSpace::LCh).find(", 0.00, 0.0 deg") != std::string::npos);
+        CHECK(Formatted(gray, ColorSpace::OKLCh).find(", 0.0000, 0.0 deg") != std::string::npos);
+        CHECK(Formatted(gray, ColorSpace::Lab).find('-') == std::string::npos);
+    }
+}
@@ -0,0 +1,165 @@
+#include <random>
+#include <vector>
+
+#include "core/color_vision.h"
+#include "test.h"
+
+namespace {
+
+const VisionType kTypes[kVisionTypeCount] = {VisionType::Normal, VisionType::Protanopia, VisionType::Deuteranopia,
+                                             VisionType::Tritanopia, VisionType::Achromatopsia};
+
+// Pixels of the given colors in either layout, alpha set to its index
+std::vector<uint8_t> Pack(const std::vector<Color>& colors, PixelFormat format) {
+    int bpp = format == PixelFormat::RGB24 ? 3 : 4;
+    std::vector<uint8_t> pixels(colors.size() * bpp);
+    for (size_t i = 0; i < colors.size(); i++) {
+        uint8_t* p = pixels.data() + i * bpp;
+        p[0] = bpp == 3 ? colors[i].r : colors[i].b;
+        p[1] = colors[i].g;
+        p[2] = bpp == 3 ? colors[i].b : colors[i].r;
+        if (bpp == 4) p[3] = (uint8_t)i;
+    }
+    return pixels;
+}
+
+// Runs the view through SimulateView and counts pixels that differ from
+// SimulateColor, or whose alpha changed
+int CountMismatches(const std::vector<Color>& colors, int width, PixelFormat format, const VisionMatrix& matrix,
+                    int threads) {
+    int bpp = format == PixelFormat::RGB24 ? 3 : 4;
+    int height = (int)(colors.size() / width);
+    std::vector<uint8_t> src = Pack(colors, format);
+    // Padded output rows, so a kernel writing past the width shows up
+    size_t dstStride = (size_t)width * bpp + 8;
+    std::vector<uint8_t> dst(dstStride * height, 0xEE);
+    PixelView view = {src.data(), width, height, (size_t)width * bpp, format};
+    SimulateView(view, matrix, dst.data(), dstStride, threads);
+    
+    int wrong = 0;
+    for (int y = 0; y < height; y++) {
+        const uint8_t* row = dst.data() + dstStride * y;
+        for (int x = 0; x < width; x++) {
+            size_t i = (size_t)y * width + x;
+            Color expected = SimulateColor(colors[i], matrix);
+            const uint8_t* p = row + x * bpp;
+            Color got = bpp == 3 ? MakeColor(p[0], p[1], p[2]) : MakeColor(p[2], p[1], p[0]);
+            wrong += !(got == expected) || (bpp == 4 && p[3] != (uint8_t)i);
+        }
+        for (int k = 0; k < 8; k++) wrong += row[width * bpp + k] != 0xEE;
+    }
+    return wrong;
+}
+
+} // namespace
+
+// Every kernel against SimulateColor on a third of the cube per channel.
+// Each color appears once, so every pixel misses the cache and goes
+// through the kernel itself.
+TEST(VisionKernelsMatchScalarOnColorCube) {
+    std::vector<Color> cube;
+    for (int r = 0; r < 256; r++) {
+        for (int g = 0; g < 256; g += 3) {
+            for (int b = 0; b < 256; b += 3) cube.push_back(MakeColor(r, g, b));
+        }
+    }
+    SimdLevel original = GetSimdLevel();
+    const SimdLevel levels[3] = {SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2};
+    for (SimdLevel requested : levels) {
+        if (ForceSimdLevel(requested) != requested) continue;
+        for (VisionType type : kTypes) {
+            VisionMatrix matrix = SimulationMatrix(type, type == VisionType::Tritanopia ? 0.6f : 1.0f);
+            CHECK_EQ(CountMismatches(cube, 86 * 86, PixelFormat::BGRA32, matrix, 1), 0);
+        }
+        CHECK_EQ(CountMismatches(cube, 86 * 86, PixelFormat::RGB24, SimulationMatrix(VisionType::Protanopia), 1), 0);
+    }
+    ForceSimdLevel(original);
+}
+
+// Screen-like content: long runs, a few repeated shades and bursts of
+// noise, at an odd width so blocks and runs end mid-row. This is the path
+// through the run and cache shortcuts and the bypass switching between them.
+TEST(VisionCachedPathsMatchScalar) {
+    std::mt19937 rng(19);
+    const int width = 37;
+    const int height = 120;
+    const Color shades[4] = {MakeColor(255, 255, 255), MakeColor(31, 41, 55), MakeColor(99, 102, 241),
+                             MakeColor(140, 140, 150)};
+    std::vector<Color> pixels;
+    for (int y = 0; y < height; y++) {
+        bool noisy = (y / 20) % 2 == 1;
+        for (int x = 0; x < width; x++) {
+            if (noisy && rng() % 4 != 0) {
+                pixels.push_back(MakeColor(rng() % 256, rng() % 256, rng() % 256));
+            } else {
+                pixels.push_back(shades[(x / 5 + y) % 4 * (rng() % 3 != 0)]);
+            }
+        }
+    }
+    SimdLevel original = GetSimdLevel();
+    const SimdLevel levels[3] = {SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2};
+    for (SimdLevel requested : levels) {
+        if (ForceSimdLevel(requested) != requested) continue;
+        for (VisionType type : kTypes) {
+            VisionMatrix matrix = SimulationMatrix(type, 0.75f);
+            CHECK_EQ(CountMismatches(pixels, width, PixelFormat::RGB24, matrix, 1), 0);
+            CHECK_EQ(CountMismatches(pixels, width, PixelFormat::BGRA32, matrix, 3), 0);
+        }
+    }
+    ForceSimdLevel(original);
+}
+
+TEST(VisionInPlace) {
+    std::vector<Color> colors;
+    for (int i = 0; i < 64 * 16; i++) colors.push_back(MakeColor(i * 7, i * 13, i % 256));
+    std::vector<uint8_t> pixels = Pack(colors, PixelFormat::BGRA32);
+    PixelView view = {pixels.data(), 64, 16, 64 * 4, PixelFormat::BGRA32};
+    VisionMatrix matrix = SimulationMatrix(VisionType::Deuteranopia);
+    SimulateView(view, matrix, pixels.data(), view.stride, 2);
+    int wrong = 0;
+    for (int y = 0; y < 16; y++) {
+        for (int x = 0; x < 64; x++) wrong += !(PixelAt(view, x, y) == SimulateColor(colors[y * 64 + x], matrix));
+    }
+    CHECK_EQ(wrong, 0);
+}
+
+// Machado's published severity 1.0 protanopia matrix, and properties that
+// hold for any sensible simulation
+TEST(VisionGoldenValues) {
+    VisionMatrix protan = SimulationMatrix(VisionType::Protanopia);
+    const float expected[9] = {0.152286f, 1.052583f, -0.204868f, 0.114503f, 0.786281f, 0.099216f,
+                               -0.003882f, -0.048116f, 1.051998f};
+    for (int i = 0; i < 9; i++) CHECK_NEAR(protan.m[i], expected[i], 1e-6);
+    
+    // Severity 0 and normal vision change nothing
+    int changed = 0;
+    VisionMatrix none = SimulationMatrix(VisionType::Deuteranopia, 0);
+    VisionMatrix normal = SimulationMatrix(VisionType::Normal);
+    for (int v = 0; v < 256; v++) {
+        Color c = MakeColor(v, 255 - v, v / 2);
+        changed += !(SimulateColor(c, none) == c) + !(SimulateColor(c, normal) == c);
+    }
+    CHECK_EQ(changed, 0);
+    
+    for (VisionType type : kTypes) {
+        VisionMatrix matrix = SimulationMatrix(type);
+        CHECK(SimulateColor(MakeColor(255, 255, 255), matrix) == MakeColor(255, 255, 255));
+        CHECK(SimulateColor(MakeColor(0, 0, 0), matrix) == MakeColor(0, 0, 0));
+    }
+    Color gray = SimulateColor(MakeColor(239, 68, 68), SimulationMatrix(VisionType::Achromatopsia));
+    CHECK(gray.r == gray.g && gray.g == gray.b);
+    
+    // Pure red and a mid green both become olive for a protanope, which is
+    // the confusion the simulation exists to show
+    CHECK(SimulateColor(MakeColor(255, 0, 0), protan) == MakeColor(109, 95, 0));
+    CHECK(SimulateColor(MakeColor(0, 128, 0), protan) == MakeColor(131, 114, 0));
+    CHECK(SimulateColor(MakeColor(255, 0, 0), SimulationMatrix(VisionType::Deuteranopia)) == MakeColor(163, 144, 0));
+    CHECK(SimulateColor(MakeColor(99, 102, 241), SimulationMatrix(VisionType::Tritanopia)) == MakeColor(0, 135, 162));
+}
+
+TEST(VisionTypeNames) {
+    VisionType type;
+    for (VisionType t : kTypes) CHECK(ParseVisionType(VisionTypeName(t), type) && type == t);
+    CHECK(ParseVisionType("deutan", type) && type == VisionType::Deuteranopia);
+    CHECK(!ParseVisionType("colorblind", type));
+}
@@ -0,0 +1,149 @@
+#include <cstdlib>
+#include <vector>
+
+#include "core/contrast_audit.h"
+#include "core/image_io.h"
+#include "test.h"
+
+namespace {
+
+struct Canvas {
+    Image image;
+    
+    Canvas(int width, int height, Color background) {
+        image.Allocate(width, height, PixelFormat::RGB24);
+        Fill(0, 0, width, height, background);
+    }
+    
+    void Blend(int x, int y, Color c, float alpha) {
+        if (x < 0 || y < 0 || x >= image.width || y >= image.height) return;
+        uint8_t* p = image.pixels.data() + (size_t)y * image.Stride() + x * 3;
+        p[0] = (uint8_t)(p[0] + (c.r - p[0]) * alpha);
+        p[1] = (uint8_t)(p[1] + (c.g - p[1]) * alpha);
+        p[2] = (uint8_t)(p[2] + (c.b - p[2]) * alpha);
+    }
+    
+    void Fill(int x0, int y0, int width, int height, Color c) {
+        for (int y = y0; y < y0 + height; y++) {
+            for (int x = x0; x < x0 + width; x++) Blend(x, y, c, 1.0f);
+        }
+    }
+    
+    // Lines of 8x12 glyphs drawn from one-pixel strokes with a partly
+    // covered neighbour on one side, the way hinted, anti-aliased text
+    // rasterises. Which strokes each glyph has is pseudo-random.
+    void Text(int x0, int y0, int chars, int lines, Color c) {
+        unsigned state = (unsigned)(x0 * 7 + y0);
+        for (int line = 0; line < lines; line++) {
+            for (int i = 0; i < chars; i++) {
+                int gx = x0 + i * 9;
+                int gy = y0 + line * 18;
+                state = state * 1103515245u + 12345u;
+                unsigned strokes = (state >> 16) | 1;
+                for (int k = 0; k < 12; k++) {
+                    if (strokes & 1) {
+                        Blend(gx + 1, gy + k, c, 1.0f);
+                        Blend(gx + 2, gy + k, c, 0.4f);
+                    }
+                    if (strokes & 2) {
+                        Blend(gx + 6, gy + k, c, 1.0f);
+                        Blend(gx + 5, gy + k, c, 0.4f);
+                    }
+                }
+                for (int k = 1; k < 7; k++) {
+                    if (strokes & 4) {
+                        Blend(gx + k, gy, c, 1.0f);
+                        Blend(gx + k, gy + 1, c, 0.3f);
+                    }
+                    if (strokes & 8) {
+                        Blend(gx + k, gy + 6, c, 1.0f);
+                        Blend(gx + k, gy + 7, c, 0.3f);
+                    }
+                    if (strokes & 16) Blend(gx + k, gy + 11, c, 1.0f);
+                }
+            }
+        }
+    }
+};
+
+} // namespace
+
+TEST(ContrastRatiosMatchWCAG) {
+    CHECK_NEAR(ContrastRatio(RelativeLuminance(MakeColor(0, 0, 0)), RelativeLuminance(MakeColor(255, 255, 255))),
+               21.0, 1e-4);
+    CHECK_NEAR(ContrastRatio(RelativeLuminance(MakeColor(255, 255, 255)), RelativeLuminance(MakeColor(239, 68, 68))),
+               3.76, 0.005);
+    CHECK_NEAR(ContrastRatio(RelativeLuminance(MakeColor(51, 51, 51)), RelativeLuminance(MakeColor(255, 255, 255))),
+               12.63, 0.005);
+    CHECK_NEAR(RelativeLuminance(MakeColor(128, 128, 128)), 0.2158605, 1e-6);
+}
+
+// Solid shapes are not text, wherever their edges fall across the tiles.
+// Edges one or two pixels into a tile leave thin slivers of ink that used
+// to pass for strokes, reporting the shape's fill against the page.
+TEST(AuditIgnoresSolidShapes) {
+    const int offsets[4] = {0, 1, 2, 5};
+    for (int a : offsets) {
+        for (int b : offsets) {
+            Canvas canvas(256, 192, MakeColor(255, 255, 255));
+            canvas.Fill(32 - a, 32 - b, 130 + a + b, 97 + a + b, MakeColor(239, 68, 68));
+            // A small badge lying wholly inside one tile
+            canvas.Fill(200 + a, 150 + b, 9, 7, MakeColor(239, 68, 68));
+            
+            std::vector<ContrastIssue> issues;
+            AuditSummary summary;
+            AuditContrast(canvas.image.View(), AuditOptions(), issues, &summary);
+            CHECK_EQ(issues.size(), 0);
+            CHECK_EQ(summary.textTiles, 0);
+        }
+    }
+}
+
+// The same colors as text are reported, and merged into one issue
+TEST(AuditReportsLowContrastText) {
+    Canvas canvas(640, 400, MakeColor(255, 255, 255));
+    canvas.Text(20, 20, 60, 4, MakeColor(51, 51, 51));                 // 12.6:1, passes
+    canvas.Fill(0, 100, 640, 150, MakeColor(239, 68, 68));
+    canvas.Text(20, 120, 60, 6, MakeColor(255, 255, 255));              // 3.76:1, fails AA
+    canvas.Text(20, 280, 60, 4, MakeColor(156, 163, 175));              // 2.5:1 on white
+    
+    std::vector<ContrastIssue> issues;
+    AuditSummary summary;
+    AuditContrast(canvas.image.View(), AuditOptions(), issues, &summary);
+    CHECK(summary.textTiles > 40);
+    CHECK_EQ(issues.size(), 2);
+    if (issues.size() == 2) {
+        // Lowest ratio first
+        CHECK(issues[0].foreground == MakeColor(156, 163, 175));
+        CHECK(issues[0].background == MakeColor(255, 255, 255));
+        CHECK_NEAR(issues[0].ratio, 2.54, 0.01);
+        CHECK(issues[1].foreground == MakeColor(255, 255, 255));
+        CHECK(issues[1].background == MakeColor(239, 68, 68));
+        CHECK_NEAR(issues[1].ratio, 3.76, 0.01);
+        CHECK(issues[1].rect.y >= 96 && issues[1].rect.y + issues[1].rect.height <= 256);
+    }
+    
+    // At the large-text threshold the white-on-red passes
+    AuditOptions large;
+    large.minRatio = 3.0f;
+    AuditContrast(canvas.image.View(), large, issues, &summary);
+    CHECK_EQ(issues.size(), 1);
+}
+
+// Noise and gradients are neither text nor a background
+TEST(AuditIgnoresPhotosAndGradients) {
+    Canvas canvas(256, 128, MakeColor(0, 0, 0));
+    srand(15);
+    for (int y = 0; y < 64; y++) {
+        for (int x = 0; x < 256; x++) canvas.Fill(x, y, 1, 1, MakeColor(rand() & 255, (x + y) & 255, rand() % 200));
+    }
+    for (int y = 64; y < 128; y++) {
+        for (int x = 0; x < 256; x++) canvas.Fill(x, y, 1, 1, MakeColor(x, 100, 200));
+    }
+    std::vector<ContrastIssue> issues;
+    AuditSummary summary;
+    AuditContrast(canvas.image.View(), AuditOptions(), issues, &summary);
+    CHECK_EQ(summary.tiles, 32);
+    CHECK_EQ(summary.textTiles, 0);
+    CHECK(issues.empty());
+}
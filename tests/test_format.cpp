@@ -0,0 +1,126 @@
+#include <atomic>
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <new>
+#include <sstream>
+
+#include "core/color_core.h"
+#include "test.h"
+
+// Every operator new in color_tests goes through here, so a case can count
+// what the code under test allocates
+namespace {
+std::atomic<long> g_allocations(0);
+}
+
+void* operator new(size_t size) {
+    g_allocations++;
+    void* p = malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+namespace {
+
+// The stream formatting the formatters replaced, as the reference
+std::string StreamHex(Color c) {
+    std::ostringstream oss;
+    oss << "#" << std::hex << std::uppercase << std::setfill('0')
+        << std::setw(2) << (int)c.r << std::setw(2) << (int)c.g << std::setw(2) << (int)c.b;
+    return oss.str();
+}
+
+std::string StreamHSL(Color c) {
+    int h, s, l;
+    RGBtoHSL(c.r, c.g, c.b, h, s, l);
+    std::ostringstream oss;
+    oss << h << " deg, " << s << "%, " << l << "%";
+    return oss.str();
+}
+
+} // namespace
+
+TEST(FormatOutputs) {
+    char buffer[64];
+    CHECK_EQ(FormatHex(MakeColor(10, 171, 255), buffer), 7);
+    CHECK_STR(buffer, "#0AABFF");
+    CHECK_EQ(FormatRGB(MakeColor(0, 7, 255), buffer), 9);
+    CHECK_STR(buffer, "0, 7, 255");
+    CHECK_EQ(FormatHSL(MakeColor(99, 102, 241), buffer), 17);
+    CHECK_STR(buffer, "239 deg, 84%, 67%");
+    CHECK_EQ(FormatCoords(-12, 3400, buffer), 11);
+    CHECK_STR(buffer, "(-12, 3400)");
+}
+
+// The documented sizes hold the longest outputs, terminator included, and
+// nothing is written past them
+TEST(FormatBufferSizesAreExact) {
+    char buffer[64];
+    memset(buffer, 'x', sizeof(buffer));
+    CHECK_EQ(FormatRGB(MakeColor(255, 255, 255), buffer) + 1, kRGBBufferSize);
+    CHECK_EQ(buffer[kRGBBufferSize], 'x');
+    
+    memset(buffer, 'x', sizeof(buffer));
+    CHECK_EQ(FormatCoords(INT_MIN, INT_MIN, buffer) + 1, kCoordBufferSize);
+    CHECK_EQ(buffer[kCoordBufferSize], 'x');
+    
+    memset(buffer, 'x', sizeof(buffer));
+    CHECK_EQ(FormatHex(MakeColor(1, 2, 3), buffer) + 1, kHexBufferSize);
+    CHECK_EQ(buffer[kHexBufferSize], 'x');
+    
+    // No color reaches "360 deg": hue wraps to 0, so 19 is a bound, not a case
+    size_t longest = 0;
+    for (int r = 0; r < 256; r += 5) {
+        for (int g = 0; g < 256; g += 3) {
+            for (int b = 0; b < 256; b += 7) {
+                longest = std::max(longest, FormatHSL(MakeColor(r, g, b), buffer));
+            }
+        }
+    }
+    CHECK(longest < kHSLBufferSize);
+}
+
+TEST(FormatMatchesStreams) {
+    char buffer[kHSLBufferSize];
+    int mismatches = 0;
+    for (int i = 0; i < (1 << 24); i += 251) {
+        Color c = MakeColor(i >> 16, (i >> 8) & 255, i & 255);
+        FormatHex(c, buffer);
+        mismatches += StreamHex(c) != buffer;
+        FormatHSL(c, buffer);
+        mismatches += StreamHSL(c) != buffer;
+    }
+    CHECK_EQ(mismatches, 0);
+}
+
+// What UpdateColorDisplay formats per tick, without a single allocation
+TEST(FormatDoesNotAllocate) {
+    char hex[kHexBufferSize];
+    char rgb[kRGBBufferSize];
+    char hsl[kHSLBufferSize];
+    char coords[kCoordBufferSize];
+    long before = g_allocations.load();
+    size_t total = 0;
+    for (int i = 0; i < 10000; i++) {
+        Color c = MakeColor(i * 7, i * 13, i * 29);
+        total += FormatHex(c, hex) + FormatRGB(c, rgb) + FormatHSL(c, hsl) + FormatCoords(i, -i, coords);
+    }
+    CHECK_EQ(g_allocations.load() - before, 0);
+    CHECK(total > 0);
+    
+    // and the counter does see allocations
+    before = g_allocations.load();
+    std::string s = ColorToRGB(MakeColor(255, 255, 255)) + " and more than the small string buffer";
+    CHECK(g_allocations.load() > before);
+}
@@ -0,0 +1,103 @@
+#include <vector>
+
+#include "core/magnifier.h"
+#include "test.h"
+
+namespace {
+
+// What the loupe should show at output pixel (x, y), worked out per pixel
+uint32_t ExpectedPixel(const PixelView& src, const LoupeStyle& style, int scale, int x, int y) {
+    int sx = x / scale;
+    int sy = y / scale;
+    Color c = PixelAt(src, sx, sy);
+    
+    int cx = src.width / 2;
+    int cy = src.height / 2;
+    bool edge = x % scale == 0 || x % scale == scale - 1 || y % scale == 0 || y % scale == scale - 1;
+    if (style.crosshair && sx == cx && sy == cy && edge) {
+        bool light = c.r * 299 + c.g * 587 + c.b * 114 > 128 * 1000;
+        return light ? 0xFF000000u : 0xFFFFFFFFu;
+    }
+    if (style.grid && scale >= 3 && (x % scale == 0 || y % scale == 0)) {
+        c = MakeColor(c.r * 3 / 4, c.g * 3 / 4, c.b * 3 / 4);
+    }
+    return 0xFF000000u | ((uint32_t)c.r << 16) | ((uint32_t)c.g << 8) | c.b;
+}
+
+} // namespace
+
+// Every output pixel against the per-pixel definition, for each scale up to
+// 12 and the largest, both layouts and all four style combinations. Output
+// rows are padded to check nothing is written past each row.
+TEST(LoupeMatchesPerPixelReference) {
+    const int width = 5;
+    const int height = 3;
+    std::vector<uint8_t> source(width * height * 4);
+    for (size_t i = 0; i < source.size(); i++) {
+        source[i] = (uint8_t)(i * 53 + 7);
+    }
+    const PixelFormat formats[2] = {PixelFormat::RGB24, PixelFormat::BGRA32};
+    const int scales[13] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, kMaxLoupeScale};
+    
+    for (PixelFormat format : formats) {
+        size_t srcStride = (size_t)width * (format == PixelFormat::RGB24 ? 3 : 4);
+        PixelView src = {source.data(), width, height, srcStride, format};
+        for (int scale : scales) {
+            for (int combo = 0; combo < 4; combo++) {
+                LoupeStyle style;
+                style.scale = scale;
+                style.grid = (combo & 1) != 0;
+                style.crosshair = (combo & 2) != 0;
+                
+                int outWidth = width * scale;
+                int outHeight = height * scale;
+                size_t stride = (size_t)(outWidth + 3) * 4;
+                std::vector<uint8_t> out(stride * outHeight, 0xCD);
+                RenderLoupe(src, style, out.data(), stride);
+                
+                int wrong = 0;
+                int padding = 0;
+                for (int y = 0; y < outHeight; y++) {
+                    const uint32_t* row = (const uint32_t*)(out.data() + stride * y);
+                    for (int x = 0; x < outWidth; x++) {
+                        wrong += row[x] != ExpectedPixel(src, style, scale, x, y);
+                    }
+                    for (int x = outWidth; x < outWidth + 3; x++) {
+                        padding += row[x] != 0xCDCDCDCDu;
+                    }
+                }
+                CHECK_EQ(wrong, 0);
+                CHECK_EQ(padding, 0);
+            }
+        }
+    }
+}
+
+// A hand-checked 1x1 source at scale 4: white cell, darkened grid edges,
+// and the crosshair frame in black since white is light
+TEST(LoupeGoldenSinglePixel) {
+    uint8_t white[3] = {255, 255, 255};
+    PixelView src = {white, 1, 1, 3, PixelFormat::RGB24};
+    uint32_t out[16];
+    
+    LoupeStyle style;
+    style.scale = 4;
+    style.crosshair = false;
+    RenderLoupe(src, style, (uint8_t*)out, 16);
+    const uint32_t g = 0xFFBFBFBFu;
+    const uint32_t w = 0xFFFFFFFFu;
+    const uint32_t expected[16] = {g, g, g, g,
+                                   g, w, w, w,
+                                   g, w, w, w,
+                                   g, w, w, w};
+    for (int i = 0; i < 16; i++) {
+        CHECK_EQ(out[i], expected[i]);
+    }
+    
+    style.crosshair = true;
+    RenderLoupe(src, style, (uint8_t*)out, 16);
+    for (int i = 0; i < 16; i++) {
+        bool inner = i == 5 || i == 6 || i == 9 || i == 10;
+        CHECK_EQ(out[i], inner ? w : 0xFF000000u);
+    }
+}
@@ -0,0 +1,87 @@
+// color_tests: runs every registered case, or those whose name contains
+// the first argument. Exits 1 if any check failed.
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "test.h"
+
+namespace {
+
+struct TestCase {
+    const char* name;
+    TestFunction run;
+};
+
+// Function-local so registration from other files' static initialisers
+// never sees it unconstructed
+std::vector<TestCase>& Registry() {
+    static std::vector<TestCase> cases;
+    return cases;
+}
+
+int g_failures = 0;
+
+void Fail(const char* file, int line) {
+    g_failures++;
+    fprintf(stderr, "  %s:%d: ", file, line);
+}
+
+} // namespace
+
+int RegisterTest(const char* name, TestFunction run) {
+    Registry().push_back({name, run});
+    return (int)Registry().size();
+}
+
+int TestFailures() {
+    return g_failures;
+}
+
+void CheckTrue(const char* file, int line, const char* expr, bool ok) {
+    if (ok) return;
+    Fail(file, line);
+    fprintf(stderr, "%s\n", expr);
+}
+
+void CheckEqual(const char* file, int line, const char* expr, long long a, long long b) {
+    if (a == b) return;
+    Fail(file, line);
+    fprintf(stderr, "%s (%lld vs %lld)\n", expr, a, b);
+}
+
+void CheckString(const char* file, int line, const char* expr, const std::string& a, const std::string& b) {
+    if (a == b) return;
+    Fail(file, line);
+    fprintf(stderr, "%s (\"%s\" vs \"%s\")\n", expr, a.c_str(), b.c_str());
+}
+
+void CheckNear(const char* file, int line, const char* expr, double a, double b, double tolerance) {
+    if (std::fabs(a - b) <= tolerance) return;
+    Fail(file, line);
+    fprintf(stderr, "%s (%g vs %g, tolerance %g)\n", expr, a, b, tolerance);
+}
+
+int main(int argc, char** argv) {
+    const char* filter = argc > 1 ? argv[1] : NULL;
+    int run = 0;
+    int failed = 0;
+    for (const TestCase& test : Registry()) {
+        if (filter && !strstr(test.name, filter)) continue;
+        
+        int before = g_failures;
+        auto start = std::chrono::steady_clock::now();
+        test.run();
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        bool ok = g_failures == before;
+        printf("%-4s %s (%.0f ms)\n", ok ? "ok" : "FAIL", test.name, ms);
+        fflush(stdout);
+        run++;
+        failed += ok ? 0 : 1;
+    }
+    printf("%d tests, %d failed\n", run, failed);
+    return failed == 0 && run > 0 ? 0 : 1;
+}
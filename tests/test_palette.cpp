@@ -0,0 +1,176 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "core/palette.h"
+#include "test.h"
+
+namespace {
+
+Palette RandomPalette(std::mt19937& rng, int size) {
+    Palette palette;
+    for (int i = 0; i < size; i++) {
+        palette.Add("c" + std::to_string(i), MakeColor(rng() % 256, rng() % 256, rng() % 256));
+    }
+    palette.BuildIndex();
+    return palette;
+}
+
+std::string TempPath(const char* name) {
+    return std::string("palette_test_") + name;
+}
+
+bool LoadText(Palette& palette, const char* name, const char* text, std::string& error) {
+    std::string path = TempPath(name);
+    FILE* f = fopen(path.c_str(), "w");
+    if (!f) return false;
+    fputs(text, f);
+    fclose(f);
+    bool ok = palette.LoadFile(path.c_str(), error);
+    remove(path.c_str());
+    return ok;
+}
+
+} // namespace
+
+// The tree and the bounded CIEDE2000 search must find a closest entry: the
+// same distance as the brute-force scan, and the first index on ties
+TEST(PaletteIndexMatchesLinearScan) {
+    std::mt19937 rng(2024);
+    const int sizes[4] = {1, 2, 37, 1500};
+    const PaletteMetric metrics[2] = {PaletteMetric::OKLab, PaletteMetric::DeltaE2000};
+    for (int size : sizes) {
+        Palette palette = RandomPalette(rng, size);
+        for (PaletteMetric metric : metrics) {
+            int mismatches = 0;
+            for (int i = 0; i < 1500; i++) {
+                Color query = MakeColor(rng() % 256, rng() % 256, rng() % 256);
+                float indexed, linear;
+                int a = palette.Nearest(query, metric, &indexed);
+                int b = palette.NearestLinear(query, metric, &linear);
+                mismatches += a != b || indexed != linear;
+            }
+            CHECK_EQ(mismatches, 0);
+        }
+    }
+}
+
+TEST(PaletteNearestWithin) {
+    std::mt19937 rng(7);
+    Palette palette = RandomPalette(rng, 300);
+    const PaletteMetric metrics[2] = {PaletteMetric::OKLab, PaletteMetric::DeltaE2000};
+    const float radii[2] = {0.02f, 3.0f};
+    for (int m = 0; m < 2; m++) {
+        int wrong = 0;
+        int found = 0;
+        for (int i = 0; i < 3000; i++) {
+            Color query = MakeColor(rng() % 256, rng() % 256, rng() % 256);
+            float linear, within;
+            int best = palette.NearestLinear(query, metrics[m], &linear);
+            int index = palette.NearestWithin(query, metrics[m], radii[m], &within);
+            if (linear <= radii[m]) {
+                wrong += index != best || within != linear;
+                found++;
+            } else {
+                wrong += index != -1 || !std::isinf(within);
+            }
+        }
+        CHECK_EQ(wrong, 0);
+        // Both outcomes must actually occur for the check to mean anything
+        CHECK(found > 0 && found < 3000);
+    }
+    
+    // An entry itself is always within zero
+    float distance = -1;
+    CHECK_EQ(palette.NearestWithin(palette.Entry(42).color, PaletteMetric::DeltaE2000, 0, &distance),
+             palette.NearestLinear(palette.Entry(42).color, PaletteMetric::DeltaE2000));
+    CHECK(distance == 0);
+}
+
+TEST(PaletteEmptyAndBatch) {
+    Palette empty;
+    empty.BuildIndex();
+    float distance;
+    CHECK_EQ(empty.Nearest(MakeColor(1, 2, 3), PaletteMetric::OKLab, &distance), -1);
+    CHECK_EQ(empty.NearestWithin(MakeColor(1, 2, 3), PaletteMetric::DeltaE2000, 100, &distance), -1);
+    CHECK_EQ(empty.NearestLinear(MakeColor(1, 2, 3), PaletteMetric::OKLab), -1);
+    
+    std::mt19937 rng(3);
+    Palette palette = RandomPalette(rng, 64);
+    const int width = 40;
+    const int height = 9;
+    std::vector<uint8_t> pixels(width * height * 3);
+    for (size_t i = 0; i < pixels.size(); i++) {
+        // Runs of repeated colors, as on screen, plus some noise
+        pixels[i] = (uint8_t)(i % 3 == 0 && rng() % 4 == 0 ? rng() : (i / 30) * 23);
+    }
+    PixelView view = {pixels.data(), width, height, (size_t)width * 3, PixelFormat::RGB24};
+    std::vector<int> out(width * height);
+    palette.NearestBatch(view, PaletteMetric::DeltaE2000, out.data());
+    int wrong = 0;
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            wrong += out[y * width + x] != palette.Nearest(PixelAt(view, x, y), PaletteMetric::DeltaE2000);
+        }
+    }
+    CHECK_EQ(wrong, 0);
+}
+
+TEST(PointIndexKNearest) {
+    std::mt19937 rng(11);
+    std::vector<PointIndex::Point> points(500);
+    for (PointIndex::Point& p : points) {
+        for (float& v : p.v) v = (float)(rng() % 1000) / 10.0f;
+    }
+    PointIndex index;
+    index.Build(points);
+    
+    for (int q = 0; q < 200; q++) {
+        PointIndex::Point query = {{(float)(rng() % 1000) / 10.0f, (float)(rng() % 1000) / 10.0f,
+                                    (float)(rng() % 1000) / 10.0f}};
+        std::vector<float> all;
+        for (const PointIndex::Point& p : points) {
+            float d0 = p.v[0] - query.v[0];
+            float d1 = p.v[1] - query.v[1];
+            float d2 = p.v[2] - query.v[2];
+            all.push_back(d0 * d0 + d1 * d1 + d2 * d2);
+        }
+        std::sort(all.begin(), all.end());
+        
+        int indices[PointIndex::kMaxNeighbours];
+        float dist2[PointIndex::kMaxNeighbours];
+        int k = 1 + q % PointIndex::kMaxNeighbours;
+        CHECK_EQ(index.Nearest(query, k, indices, dist2), k);
+        for (int i = 0; i < k; i++) {
+            CHECK(dist2[i] == all[i]);
+        }
+    }
+}
+
+TEST(PaletteLoadFormats) {
+    Palette palette;
+    std::string error;
+    CHECK(LoadText(palette, "css", ":root {\n  --brand-primary: #6366F1;\n  --muted: #abc; /* note */\n"
+                                   "  --bad: #12345;\n}\n// #FFFFFF skipped\n#000000\n", error));
+    CHECK_EQ(palette.Size(), 3);
+    CHECK_STR(palette.Entry(0).name, "--brand-primary");
+    CHECK(palette.Entry(0).color == MakeColor(0x63, 0x66, 0xF1));
+    CHECK(palette.Entry(1).color == MakeColor(0xAA, 0xBB, 0xCC));
+    CHECK_STR(palette.Entry(2).name, "#000000");
+    
+    Palette gimp;
+    CHECK(LoadText(gimp, "gpl", "GIMP Palette\nName: test\n#\n255   0  0\tRed\n  0 128 0 Dark Green\n300 0 0 bad\n",
+                   error));
+    CHECK_EQ(gimp.Size(), 2);
+    CHECK_STR(gimp.Entry(1).name, "Dark Green");
+    CHECK(gimp.Entry(1).color == MakeColor(0, 128, 0));
+    
+    Palette none;
+    CHECK(!LoadText(none, "none", "no colors here\n#GGG\n", error));
+    CHECK(error.find("no colors found") != std::string::npos);
+    CHECK(!none.LoadFile("palette_test_missing", error));
+    CHECK(error.find("cannot open") != std::string::npos);
+}
@@ -0,0 +1,105 @@
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "core/perf_stats.h"
+#include "test.h"
+
+// Every reported percentile against the exact rank of the same samples:
+// below 16 ns exact, above within the 1/16 bucket width
+TEST(HistogramPercentilesWithinBucketError) {
+    std::mt19937_64 rng(18);
+    LatencyHistogram histogram;
+    std::vector<uint64_t> samples;
+    for (int i = 0; i < 20000; i++) {
+        // Log-uniform from 1 ns to about 17 s
+        uint64_t v = (uint64_t)std::exp(std::uniform_real_distribution<double>(0, 24)(rng));
+        samples.push_back(v);
+        histogram.Record(v);
+    }
+    std::sort(samples.begin(), samples.end());
+    CHECK_EQ(histogram.Count(), samples.size());
+    CHECK_EQ(histogram.MaxNs(), samples.back());
+    
+    double sum = 0;
+    for (uint64_t v : samples) sum += (double)v;
+    CHECK_NEAR(histogram.MeanNs(), sum / samples.size(), 1e-6 * sum / samples.size());
+    
+    const double ps[7] = {0.0, 0.01, 0.25, 0.5, 0.9, 0.99, 1.0};
+    for (double p : ps) {
+        uint64_t rank = std::max<uint64_t>(1, (uint64_t)(p * samples.size() + 0.5));
+        double exact = (double)samples[rank - 1];
+        double reported = (double)histogram.PercentileNs(p);
+        CHECK_NEAR(reported, exact, exact < 16 ? 0 : exact / 16);
+    }
+}
+
+TEST(HistogramEdges) {
+    LatencyHistogram histogram;
+    CHECK_EQ(histogram.Count(), 0);
+    CHECK_EQ(histogram.PercentileNs(0.5), 0);
+    CHECK(histogram.MeanNs() == 0);
+    
+    // One value: every percentile is that value, never a bucket midpoint past it
+    histogram.Record(1000);
+    CHECK_EQ(histogram.PercentileNs(0.01), 1000);
+    CHECK_EQ(histogram.PercentileNs(0.99), 1000);
+    
+    // Small values are exact, whatever their mix
+    histogram.Reset();
+    for (uint64_t v = 0; v < 16; v++) histogram.Record(v);
+    CHECK_EQ(histogram.PercentileNs(0.5), 7);
+    CHECK_EQ(histogram.PercentileNs(1.0), 15);
+    
+    // Absurd durations clamp instead of overflowing the bucket table
+    histogram.Reset();
+    histogram.Record(~0ULL);
+    CHECK_EQ(histogram.MaxNs(), (1ULL << LatencyHistogram::kMaxExponent) - 1);
+    CHECK(histogram.PercentileNs(0.5) <= histogram.MaxNs());
+    CHECK(histogram.PercentileNs(0.5) >= histogram.MaxNs() - histogram.MaxNs() / 16);
+}
+
+// Two relaxed adds per sample lose nothing when threads record at once
+TEST(HistogramConcurrentRecording) {
+    LatencyHistogram histogram;
+    const int threads = 4;
+    const uint64_t perThread = 50000;
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&histogram, t] {
+            for (uint64_t i = 0; i < perThread; i++) histogram.Record(i % 5000 + t);
+        });
+    }
+    for (std::thread& worker : workers) worker.join();
+    
+    CHECK_EQ(histogram.Count(), threads * perThread);
+    CHECK_EQ(histogram.MaxNs(), 4999 + threads - 1);
+    double expectedMean = 0;
+    for (int t = 0; t < threads; t++) expectedMean += 2499.5 + t;
+    CHECK_NEAR(histogram.MeanNs(), expectedMean / threads, 1e-9);
+}
+
+TEST(PerfStatsJSONAndScopes) {
+    ResetPerfStats();
+    PerfHistogram(PerfStage::Reduce).Record(1500);
+    PerfHistogram(PerfStage::Reduce).Record(2500);
+    std::string json = PerfStatsJSON();
+    CHECK(json.find("{\"stage\": \"reduce\", \"count\": 2, \"mean\": 2.000, \"p50\": 1.504, "
+                    "\"p90\": 2.496, \"p99\": 2.496, \"max\": 2.500}") != std::string::npos);
+    CHECK(json.find("{\"stage\": \"paint\", \"count\": 0, \"mean\": 0.000") != std::string::npos);
+    CHECK_EQ(std::count(json.begin(), json.end(), '{'), 1 + kPerfStageCount);
+    
+    ResetPerfStats();
+    {
+        PERF_SCOPE(PerfStage::Loupe);
+    }
+#ifdef XSUKAX_NO_PERF
+    CHECK_EQ(PerfHistogram(PerfStage::Loupe).Count(), 0);
+#else
+    CHECK_EQ(PerfHistogram(PerfStage::Loupe).Count(), 1);
+#endif
+    ResetPerfStats();
+}
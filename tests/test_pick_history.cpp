@@ -0,0 +1,218 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "core/color_spaces.h"
+#include "core/pick_history.h"
+#include "test.h"
+
+namespace {
+
+const char* kPath = "pick_history_test.bin";
+
+long FileSize(const char* path) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return -1;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fclose(f);
+    return size;
+}
+
+} // namespace
+
+TEST(HistoryPersistsAcrossReopen) {
+    remove(kPath);
+    std::string error;
+    {
+        PickHistory history;
+        CHECK(history.Open(kPath, error));
+        CHECK_EQ(history.Size(), 0);
+        CHECK(history.Append(MakeColor(1, 2, 3), 10, 20, 1000, "first", error));
+        // Earlier timestamps are clamped so the file stays sorted
+        CHECK(history.Append(MakeColor(4, 5, 6), -5, 7, 900, NULL, error));
+        CHECK(history.Append(MakeColor(7, 8, 9), 0, 0, 2000,
+                             "a label that is far too long for the forty-four bytes on disk", error));
+        CHECK_EQ(FileSize(kPath), 16 + 3 * 64);
+    }
+    
+    PickHistory history;
+    CHECK(history.Open(kPath, error));
+    CHECK_EQ(history.Size(), 3);
+    CHECK(RecordColor(history.Record(0)) == MakeColor(1, 2, 3));
+    CHECK_STR(history.Record(0).label, "first");
+    CHECK_EQ(history.Record(1).timestampUs, 1000);
+    CHECK_EQ(history.Record(1).x, -5);
+    CHECK_STR(history.Record(1).label, "");
+    CHECK_EQ(strlen(history.Record(2).label), 43);
+    
+    // Mapped and appended records read the same way
+    CHECK(history.Append(MakeColor(10, 11, 12), 3, 4, 3000, "tail", error));
+    CHECK_EQ(history.Size(), 4);
+    CHECK_STR(history.Record(3).label, "tail");
+    history.Close();
+    remove(kPath);
+}
+
+// An interrupted write leaves part of a record; it is ignored on open and
+// overwritten by the next append
+TEST(HistoryIgnoresTornRecord) {
+    remove(kPath);
+    std::string error;
+    {
+        PickHistory history;
+        CHECK(history.Open(kPath, error));
+        CHECK(history.Append(MakeColor(9, 9, 9), 1, 1, 10, "whole", error));
+    }
+    FILE* f = fopen(kPath, "ab");
+    char partial[30];
+    memset(partial, 0x5A, sizeof(partial));
+    fwrite(partial, sizeof(partial), 1, f);
+    fclose(f);
+    
+    {
+        PickHistory history;
+        CHECK(history.Open(kPath, error));
+        CHECK_EQ(history.Size(), 1);
+        CHECK(history.Append(MakeColor(8, 8, 8), 2, 2, 20, "after", error));
+    }
+    CHECK_EQ(FileSize(kPath), 16 + 2 * 64);
+    
+    PickHistory history;
+    CHECK(history.Open(kPath, error));
+    CHECK_EQ(history.Size(), 2);
+    CHECK_STR(history.Record(1).label, "after");
+    history.Close();
+    remove(kPath);
+}
+
+TEST(HistoryRejectsForeignFiles) {
+    FILE* f = fopen(kPath, "wb");
+    fputs("not a history file at all", f);
+    fclose(f);
+    
+    PickHistory history;
+    std::string error;
+    CHECK(!history.Open(kPath, error));
+    CHECK(error.find("not a pick history file") != std::string::npos);
+    CHECK(!history.IsOpen());
+    CHECK(!history.Append(MakeColor(0, 0, 0), 0, 0, 0, NULL, error));
+    CHECK_STR(error, "history is not open");
+    remove(kPath);
+}
+
+// Query-only opens never create, extend or write the file
+TEST(HistoryOpenReadOnly) {
+    remove(kPath);
+    std::string error;
+    PickHistory history;
+    CHECK(!history.OpenReadOnly(kPath, error));
+    CHECK(!error.empty());
+    CHECK(!history.IsOpen());
+    CHECK_EQ(FileSize(kPath), -1);
+    
+    {
+        PickHistory writer;
+        CHECK(writer.Open(kPath, error));
+        CHECK(writer.IsWritable());
+        CHECK(writer.Append(MakeColor(1, 2, 3), 4, 5, 1000, "one", error));
+        CHECK(writer.Append(MakeColor(6, 7, 8), 9, 10, 2000, "two", error));
+    }
+    // A torn tail stays on disk untouched
+    FILE* f = fopen(kPath, "ab");
+    fputs("partial", f);
+    fclose(f);
+    
+    CHECK(history.OpenReadOnly(kPath, error));
+    CHECK(history.IsOpen());
+    CHECK(!history.IsWritable());
+    CHECK_EQ(history.Size(), 2);
+    CHECK_STR(history.Record(1).label, "two");
+    size_t index = 99;
+    CHECK_EQ(history.NearestColors(MakeColor(6, 7, 9), 1, &index, NULL), 1);
+    CHECK_EQ(index, 1);
+    CHECK(!history.Append(MakeColor(0, 0, 0), 0, 0, 3000, NULL, error));
+    CHECK_STR(error, "history is open read-only");
+    history.Close();
+    CHECK_EQ(FileSize(kPath), 16 + 2 * 64 + 7);
+    
+    f = fopen(kPath, "wb");
+    fputs("not a history file at all", f);
+    fclose(f);
+    CHECK(!history.OpenReadOnly(kPath, error));
+    CHECK(error.find("not a pick history file") != std::string::npos);
+    remove(kPath);
+}
+
+// Queries over a file large enough to use the index, then past the point
+// where appended records force a rebuild, against brute force
+TEST(HistoryQueriesMatchBruteForce) {
+    remove(kPath);
+    std::string error;
+    PickHistory history;
+    CHECK(history.Open(kPath, error));
+    std::mt19937 rng(14);
+    uint64_t time = 0;
+    auto appendMany = [&](int count) {
+        for (int i = 0; i < count; i++) {
+            time += rng() % 3;
+            history.Append(MakeColor(rng() % 256, rng() % 256, rng() % 64), i, i, time, NULL, error);
+        }
+    };
+    auto checkNearest = [&]() {
+        for (int q = 0; q < 50; q++) {
+            Color query = MakeColor(rng() % 256, rng() % 256, rng() % 256);
+            std::vector<float> all;
+            for (size_t i = 0; i < history.Size(); i++) {
+                all.push_back(OKLabDistance(ColorToOKLab(query), ColorToOKLab(RecordColor(history.Record(i)))));
+            }
+            std::sort(all.begin(), all.end());
+            size_t indices[8];
+            float distances[8];
+            CHECK_EQ(history.NearestColors(query, 8, indices, distances), 8);
+            for (int i = 0; i < 8; i++) {
+                CHECK_NEAR(distances[i], all[i], 1e-6);
+                CHECK_NEAR(distances[i], OKLabDistance(ColorToOKLab(query),
+                                                       ColorToOKLab(RecordColor(history.Record(indices[i])))), 1e-6);
+            }
+        }
+    };
+    
+    appendMany(3000);
+    checkNearest();
+    appendMany(100);
+    checkNearest();
+    appendMany(5000);
+    checkNearest();
+    
+    for (int q = 0; q < 100; q++) {
+        uint64_t first = rng() % (time + 10);
+        uint64_t last = first + rng() % 200;
+        size_t begin, end;
+        history.TimeRange(first, last, begin, end);
+        size_t expectedBegin = 0;
+        while (expectedBegin < history.Size() && history.Record(expectedBegin).timestampUs < first) expectedBegin++;
+        size_t expectedEnd = expectedBegin;
+        while (expectedEnd < history.Size() && history.Record(expectedEnd).timestampUs < last) expectedEnd++;
+        CHECK_EQ(begin, expectedBegin);
+        CHECK_EQ(end, expectedEnd);
+    }
+    
+    std::vector<size_t> distinct;
+    history.DistinctColors(0.05f, 40, distinct);
+    CHECK_EQ(distinct.size(), 40);
+    for (size_t i = 0; i < distinct.size(); i++) {
+        if (i > 0) CHECK(distinct[i] < distinct[i - 1]);
+        for (size_t j = 0; j < i; j++) {
+            CHECK(OKLabDistance(ColorToOKLab(RecordColor(history.Record(distinct[i]))),
+                                ColorToOKLab(RecordColor(history.Record(distinct[j])))) > 0.05f);
+        }
+    }
+    // The newest record is always first
+    CHECK_EQ(distinct[0], history.Size() - 1);
+    history.Close();
+    remove(kPath);
+}
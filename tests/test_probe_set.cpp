@@ -0,0 +1,160 @@
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "core/image_io.h"
+#include "core/probe_set.h"
+#include "test.h"
+
+namespace {
+
+void SetPixel(Image& image, int x, int y, Color c) {
+    uint8_t* p = image.pixels.data() + (size_t)y * image.Stride() + x * 4;
+    p[0] = c.b;
+    p[1] = c.g;
+    p[2] = c.r;
+    p[3] = 255;
+}
+
+void FillRect(Image& image, int x, int y, int w, int h, Color c) {
+    for (int py = y; py < y + h; py++) {
+        for (int px = x; px < x + w; px++) SetPixel(image, px, py, c);
+    }
+}
+
+Image Screen(int width, int height, Color background) {
+    Image image;
+    image.Allocate(width, height, PixelFormat::BGRA32);
+    FillRect(image, 0, 0, width, height, background);
+    return image;
+}
+
+} // namespace
+
+// A scripted sequence of frames and the events each one must raise
+TEST(ProbeEventsFromFrameSequence) {
+    ImageScreenSource source(Screen(200, 100, MakeColor(100, 100, 100)));
+    Image& screen = source.GetImage();
+    ProbeSet probes;
+    probes.Add("light", {10, 10, 1, 1});
+    probes.Add("panel", {50, 20, 10, 10});
+    probes.Add("exact", {150, 80, 1, 1}, 0);
+    CHECK_EQ(probes.Bounds().x, 10);
+    CHECK_EQ(probes.Bounds().width, 141);
+    CHECK_EQ(probes.Bounds().height, 71);
+    
+    std::vector<ProbeEvent> events;
+    CHECK(probes.Tick(source, 1, events));
+    CHECK(events.empty());          // the first tick is the baseline
+    
+    // Within the light's threshold; any change at all for the exact probe
+    SetPixel(screen, 10, 10, MakeColor(105, 100, 100));
+    SetPixel(screen, 150, 80, MakeColor(100, 101, 100));
+    probes.Tick(source, 2, events);
+    CHECK_EQ(events.size(), 1);
+    CHECK_EQ(events[0].probe, 2);
+    CHECK_EQ(events[0].timestamp, 2);
+    CHECK(events[0].from == MakeColor(100, 100, 100) && events[0].to == MakeColor(100, 101, 100));
+    
+    // Drift adds up against the last reported color, not the last frame
+    events.clear();
+    SetPixel(screen, 10, 10, MakeColor(109, 100, 100));
+    probes.Tick(source, 3, events);
+    CHECK_EQ(events.size(), 1);
+    CHECK_EQ(events[0].probe, 0);
+    CHECK(events[0].from == MakeColor(100, 100, 100) && events[0].to == MakeColor(109, 100, 100));
+    CHECK(probes.Value(0) == MakeColor(109, 100, 100));
+    
+    // Half the panel turns white: its mean moves to the rounded midpoint
+    events.clear();
+    FillRect(screen, 50, 20, 10, 5, MakeColor(255, 255, 255));
+    probes.Tick(source, 4, events);
+    CHECK_EQ(events.size(), 1);
+    CHECK_EQ(events[0].probe, 1);
+    CHECK(events[0].to == MakeColor(178, 178, 178));
+    
+    // A still frame raises nothing
+    events.clear();
+    probes.Tick(source, 5, events);
+    CHECK(events.empty());
+    
+    // After a reset the next frame is a new baseline
+    FillRect(screen, 0, 0, 200, 100, MakeColor(0, 0, 0));
+    probes.Reset();
+    probes.Tick(source, 6, events);
+    CHECK(events.empty());
+    CHECK(probes.Value(1) == MakeColor(0, 0, 0));
+    
+    // Views smaller than the bounds are ignored
+    PixelView small = screen.View();
+    small.width = 20;
+    FillRect(screen, 0, 0, 200, 100, MakeColor(255, 0, 0));
+    probes.Evaluate(small, 7, events);
+    CHECK(events.empty());
+}
+
+// Heavily overlapping rectangles switch to the summed-area table; every
+// probe must read the same mean either way
+TEST(ProbeIntegralPathMatchesDirect) {
+    ImageScreenSource source(Screen(64, 48, MakeColor(0, 0, 0)));
+    Image& screen = source.GetImage();
+    ProbeSet direct;
+    ProbeSet integral;
+    std::mt19937 rng(17);
+    // Corner points fix the bounds at the whole screen, which twelve
+    // rectangles of at most 12x12 cannot cover on their own
+    direct.Add("corner", {0, 0, 1, 1}, 0);
+    integral.Add("corner", {0, 0, 1, 1}, 0);
+    direct.Add("corner", {63, 47, 1, 1}, 0);
+    integral.Add("corner", {63, 47, 1, 1}, 0);
+    for (int i = 0; i < 12; i++) {
+        CaptureRect rect = {(int)(rng() % 52), (int)(rng() % 36), 1 + (int)(rng() % 12), 1 + (int)(rng() % 12)};
+        direct.Add("p", rect, 0);
+        integral.Add("p", rect, 0);
+    }
+    // Whole-bounds rectangles only in the second set push its area past the bounds
+    for (int i = 0; i < 3; i++) {
+        integral.Add("cover", integral.Bounds(), 0);
+    }
+    
+    std::vector<ProbeEvent> events;
+    for (int frame = 0; frame < 20; frame++) {
+        for (size_t i = 0; i < screen.pixels.size(); i++) {
+            screen.pixels[i] = (uint8_t)rng();
+        }
+        direct.Tick(source, frame, events);
+        integral.Tick(source, frame, events);
+        for (size_t i = 0; i < direct.Size(); i++) {
+            CHECK(direct.Value(i) == integral.Value(i));
+        }
+    }
+}
+
+TEST(ProbeLoadFile) {
+    const char* path = "probe_set_test.txt";
+    FILE* f = fopen(path, "w");
+    fputs("# dashboard\n\nled 10 20\nled_strict 11 20 0\n  panel 5 5 40 30\npanel_loose 5 5 40 30 32\n", f);
+    fclose(f);
+    ProbeSet probes;
+    std::string error;
+    CHECK(probes.LoadFile(path, error));
+    CHECK_EQ(probes.Size(), 4);
+    CHECK_STR(probes.At(0).name, "led");
+    CHECK_EQ(probes.At(0).threshold, kDefaultProbeThreshold);
+    CHECK_EQ(probes.At(1).threshold, 0);
+    CHECK_EQ(probes.At(2).rect.width, 40);
+    CHECK_EQ(probes.At(3).threshold, 32);
+    
+    const char* bad[4] = {"led 10\n", "led 1 2 3 4 5 6\n", "led 1 2 0 5\n", "led 1 2 256\n"};
+    for (const char* text : bad) {
+        f = fopen(path, "w");
+        fputs("ok 1 1\n", f);
+        fputs(text, f);
+        fclose(f);
+        CHECK(!probes.LoadFile(path, error));
+        CHECK(error.find(":2: expected") != std::string::npos);
+        CHECK_EQ(probes.Size(), 0);
+    }
+    remove(path);
+}
@@ -0,0 +1,83 @@
+#include "core/screen_source.h"
+#include "test.h"
+
+namespace {
+
+// Each pixel encodes its own position, so any misplaced read shows
+Image PositionImage(int width, int height, PixelFormat format) {
+    Image image;
+    image.Allocate(width, height, format);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            uint8_t* p = image.pixels.data() + y * image.Stride() + x * (format == PixelFormat::RGB24 ? 3 : 4);
+            Color c = MakeColor(x, y, 7);
+            if (format == PixelFormat::RGB24) {
+                p[0] = c.r;
+                p[1] = c.g;
+                p[2] = c.b;
+            } else {
+                p[0] = c.b;
+                p[1] = c.g;
+                p[2] = c.r;
+                p[3] = 255;
+            }
+        }
+    }
+    return image;
+}
+
+} // namespace
+
+TEST(CaptureInsideIsZeroCopy) {
+    Image image = PositionImage(40, 30, PixelFormat::BGRA32);
+    ImageScreenSource source(image);
+    PixelView view;
+    CHECK(source.Capture({5, 6, 10, 4}, view));
+    CHECK_EQ(view.width, 10);
+    CHECK_EQ(view.height, 4);
+    CHECK_EQ(view.stride, source.GetImage().Stride());
+    CHECK(view.data == source.GetImage().pixels.data() + 6 * view.stride + 5 * 4);
+    CHECK(PixelAt(view, 0, 0) == MakeColor(5, 6, 7));
+    CHECK(PixelAt(view, 9, 3) == MakeColor(14, 9, 7));
+}
+
+// A loupe or sampling window at the screen corner repeats the edge pixels
+TEST(CaptureAcrossEdgesClamps) {
+    Image image = PositionImage(8, 8, PixelFormat::RGB24);
+    ViewScreenSource source(image.View());
+    PixelView view;
+    CHECK(source.Capture(RectAround(0, 7, 2), view));
+    CHECK_EQ(view.width, 5);
+    CHECK_EQ(view.height, 5);
+    CHECK(view.data < image.pixels.data() || view.data >= image.pixels.data() + image.pixels.size());
+    for (int y = 0; y < 5; y++) {
+        for (int x = 0; x < 5; x++) {
+            int sx = x - 2 < 0 ? 0 : x - 2;
+            int sy = 5 + y > 7 ? 7 : 5 + y;
+            CHECK(PixelAt(view, x, y) == MakeColor(sx, sy, 7));
+        }
+    }
+}
+
+TEST(CaptureRejectsEmptyRects) {
+    Image image = PositionImage(4, 4, PixelFormat::BGRA32);
+    ImageScreenSource source(image);
+    PixelView view;
+    CHECK(!source.Capture({0, 0, 0, 3}, view));
+    CHECK(!source.Capture({0, 0, 3, -1}, view));
+    ImageScreenSource empty;
+    CHECK(!empty.Capture({0, 0, 1, 1}, view));
+}
+
+// The view of the previous capture is replaced, not appended to
+TEST(CaptureReusesScratch) {
+    Image image = PositionImage(16, 16, PixelFormat::BGRA32);
+    ImageScreenSource source(image);
+    PixelView first;
+    PixelView second;
+    CHECK(source.Capture(RectAround(0, 0, 3), first));
+    const uint8_t* buffer = first.data;
+    CHECK(source.Capture(RectAround(15, 15, 3), second));
+    CHECK(second.data == buffer);
+    CHECK(PixelAt(second, 6, 6) == MakeColor(15, 15, 7));
+}
@@ -1,9 +1,27 @@
 #include <windows.h>
 #include <commctrl.h>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
 #include <string>
-#include <sstream>
-#include <iomanip>
-#include <algorithm>
+#include <vector>
+
+#include "core/capture_worker.h"
+#include "core/color_core.h"
+#include "core/color_extract.h"
+#include "core/color_parse.h"
+#include "core/color_recorder.h"
+#include "core/color_search.h"
+#include "core/color_sampling.h"
+#include "core/color_spaces.h"
+#include "core/color_vision.h"
+#include "core/contrast_audit.h"
+#include "core/magnifier.h"
+#include "core/palette.h"
+#include "core/perf_stats.h"
+#include "core/pick_history.h"
+#include "core/probe_set.h"
+#include "core/screen_source.h"
 
 #pragma comment(lib, "comctl32.lib")
 #pragma comment(lib, "gdi32.lib")
@@ -21,6 +39,28 @@
 #define ID_COORD_LABEL      1009
 #define ID_STATUS_LABEL     1010
 #define ID_TIMER            1011
+#define ID_SAMPLE_SIZE      1020
+#define ID_SAMPLE_MODE      1021
+#define ID_SPACE_SELECT     1022
+#define ID_SPACE_EDIT       1023
+#define ID_COPY_SPACE       1024
+#define ID_TOKEN_EDIT       1025
+#define ID_COPY_TOKEN       1026
+#define ID_EXTRACT_BUTTON   1027
+#define ID_SWATCH_STRIP     1028
+#define ID_PAINT_STATS_TIMER 1029
+#define ID_HISTORY_SAVE     1030
+#define ID_HISTORY_LIST     1031
+#define ID_PROBE_TIMER      1032
+
+// Posted by the capture worker when a new sample is waiting
+#define WM_APP_SAMPLE       (WM_APP + 1)
+
+// Magnifier loupe: 15x15 screen pixels at 8x, right of the color swatch
+const int kLoupeRadius = 7;
+const int kLoupeCells = kLoupeRadius * 2 + 1;
+const int kLoupeScale = 8;
+const int kLoupeSize = kLoupeCells * kLoupeScale;
 
 // Modern color scheme
 #define COLOR_BG            RGB(248, 249, 250)
@@ -42,6 +82,14 @@ HWND g_hRgbEdit = NULL;
 HWND g_hHslEdit = NULL;
 HWND g_hCoordLabel = NULL;
 HWND g_hStatusLabel = NULL;
+HWND g_hSampleSize = NULL;
+HWND g_hSampleMode = NULL;
+HWND g_hSpaceSelect = NULL;
+HWND g_hSpaceEdit = NULL;
+HWND g_hTokenEdit = NULL;
+HWND g_hSwatchStrip = NULL;
+HWND g_hHistorySave = NULL;
+HWND g_hHistoryList = NULL;
 
 HFONT g_hFontMain = NULL;
 HFONT g_hFontSmall = NULL;
@@ -52,74 +100,31 @@ HBRUSH g_hBrushPrimary = NULL;
 
 bool g_isTracking = false;
 COLORREF g_currentColor = RGB(99, 102, 241);
+HWND g_hTypingField = NULL;        // field the user is typing into, left alone by updates
 POINT g_mousePos = {0, 0};
+ScreenSource* g_pScreenSource = NULL;
+Image g_loupePixels;
+Image g_loupeSimulated;
+VisionType g_visionType = VisionType::Normal;
+VisionMatrix g_visionMatrix = SimulationMatrix(VisionType::Normal);
+int g_sampleRadius = 0;
+SampleReducer g_sampleReducer = SampleReducer::Mean;
+ColorSpace g_colorSpace = ColorSpace::OKLCh;
+CaptureWorker* g_pCaptureWorker = NULL;
+ScreenSource* g_pRecordSource = NULL;
+ColorRecorder* g_pRecorder = NULL;
+ScreenSource* g_pProbeSource = NULL;
+ProbeSet g_probes;
+bool g_probing = false;
+Palette g_palette;
+PickHistory g_history;
+std::vector<size_t> g_historyItems;
+int g_nearestToken = -1;
+std::vector<DominantColor> g_dominantColors;
 
 // Color conversion functions
-void RGBtoHSL(int r, int g, int b, int& h, int& s, int& l) {
-    double dr = r / 255.0;
-    double dg = g / 255.0;
-    double db = b / 255.0;
-    
-    double maxVal = std::max(std::max(dr, dg), db);
-    double minVal = std::min(std::min(dr, dg), db);
-    double delta = maxVal - minVal;
-    
-    // Lightness
-    l = (int)((maxVal + minVal) / 2.0 * 100);
-    
-    if (delta == 0) {
-        h = s = 0; // achromatic
-    } else {
-        // Saturation
-        if (l < 50) {
-            s = (int)(delta / (maxVal + minVal) * 100);
-        } else {
-            s = (int)(delta / (2.0 - maxVal - minVal) * 100);
-        }
-        
-        // Hue
-        if (maxVal == dr) {
-            h = (int)(((dg - db) / delta + (dg < db ? 6 : 0)) * 60);
-        } else if (maxVal == dg) {
-            h = (int)(((db - dr) / delta + 2) * 60);
-        } else {
-            h = (int)(((dr - dg) / delta + 4) * 60);
-        }
-    }
-}
-
-std::string ColorToHex(COLORREF color) {
-    int r = GetRValue(color);
-    int g = GetGValue(color);
-    int b = GetBValue(color);
-    
-    std::ostringstream oss;
-    oss << "#" << std::hex << std::uppercase << std::setfill('0') 
-        << std::setw(2) << r << std::setw(2) << g << std::setw(2) << b;
-    return oss.str();
-}
-
-std::string ColorToRGB(COLORREF color) {
-    int r = GetRValue(color);
-    int g = GetGValue(color);
-    int b = GetBValue(color);
-    
-    std::ostringstream oss;
-    oss << r << ", " << g << ", " << b;
-    return oss.str();
-}
-
-std::string ColorToHSL(COLORREF color) {
-    int r = GetRValue(color);
-    int g = GetGValue(color);
-    int b = GetBValue(color);
-    int h, s, l;
-    
-    RGBtoHSL(r, g, b, h, s, l);
-    
-    std::ostringstream oss;
-    oss << h << " deg, " << s << "%, " << l << "%";
-    return oss.str();
+Color ToColor(COLORREF color) {
+    return MakeColor(GetRValue(color), GetGValue(color), GetBValue(color));
 }
 
 void CopyToClipboard(const std::string& text) {
@@ -140,37 +145,366 @@ void CopyToClipboard(const std::string& text) {
     }
 }
 
-COLORREF GetPixelAtCursor() {
-    POINT pt;
-    GetCursorPos(&pt);
-    g_mousePos = pt;
+// Screen capture through a single BitBlt into a persistent top-down DIB
+// section. The section only ever grows, so steady-state captures do not
+// create or destroy any GDI objects.
+class GdiScreenSource : public ScreenSource {
+public:
+    GdiScreenSource()
+        : m_hScreenDC(GetDC(NULL)), m_hMemDC(NULL), m_hBitmap(NULL), m_hOldBitmap(NULL),
+          m_pBits(NULL), m_capacityWidth(0), m_capacityHeight(0) {
+        m_hMemDC = CreateCompatibleDC(m_hScreenDC);
+    }
+    
+    ~GdiScreenSource() {
+        if (m_hBitmap) {
+            SelectObject(m_hMemDC, m_hOldBitmap);
+            DeleteObject(m_hBitmap);
+        }
+        if (m_hMemDC) DeleteDC(m_hMemDC);
+        if (m_hScreenDC) ReleaseDC(NULL, m_hScreenDC);
+    }
+    
+    bool Capture(const CaptureRect& rect, PixelView& view) override {
+        if (rect.width <= 0 || rect.height <= 0 || !Reserve(rect.width, rect.height)) {
+            return false;
+        }
+        
+        if (!BitBlt(m_hMemDC, 0, 0, rect.width, rect.height, m_hScreenDC, rect.x, rect.y, SRCCOPY)) {
+            return false;
+        }
+        GdiFlush();
+        
+        view.data = (const uint8_t*)m_pBits;
+        view.width = rect.width;
+        view.height = rect.height;
+        view.stride = (size_t)m_capacityWidth * 4;
+        view.format = PixelFormat::BGRA32;
+        return true;
+    }
+    
+private:
+    bool Reserve(int width, int height) {
+        if (m_hBitmap && width <= m_capacityWidth && height <= m_capacityHeight) {
+            return true;
+        }
+        if (!m_hMemDC) return false;
+        
+        if (width < m_capacityWidth) width = m_capacityWidth;
+        if (height < m_capacityHeight) height = m_capacityHeight;
+        
+        BITMAPINFO bmi = {};
+        bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+        bmi.bmiHeader.biWidth = width;
+        bmi.bmiHeader.biHeight = -height; // top-down
+        bmi.bmiHeader.biPlanes = 1;
+        bmi.bmiHeader.biBitCount = 32;
+        bmi.bmiHeader.biCompression = BI_RGB;
+        
+        void* pBits = NULL;
+        HBITMAP hBitmap = CreateDIBSection(m_hScreenDC, &bmi, DIB_RGB_COLORS, &pBits, NULL, 0);
+        if (!hBitmap) return false;
+        
+        HBITMAP hPrev = (HBITMAP)SelectObject(m_hMemDC, hBitmap);
+        if (m_hBitmap) {
+            DeleteObject(m_hBitmap);
+        } else {
+            m_hOldBitmap = hPrev;
+        }
+        
+        m_hBitmap = hBitmap;
+        m_pBits = pBits;
+        m_capacityWidth = width;
+        m_capacityHeight = height;
+        return true;
+    }
+    
+    HDC m_hScreenDC;
+    HDC m_hMemDC;
+    HBITMAP m_hBitmap;
+    HBITMAP m_hOldBitmap;
+    void* m_pBits;
+    int m_capacityWidth;
+    int m_capacityHeight;
+};
+
+// Persistent off-screen DIB section with its own memory DC. Painting
+// composes into it and reaches the window with a single BitBlt; the
+// bitmap is only recreated when the client size changes.
+class BackBuffer {
+public:
+    BackBuffer() : m_hDC(NULL), m_hBitmap(NULL), m_hOldBitmap(NULL), m_pBits(NULL), m_width(0), m_height(0) {}
+    ~BackBuffer() { Release(); }
+    
+    bool Reserve(HDC hdcRef, int width, int height) {
+        if (m_hBitmap && width == m_width && height == m_height) return true;
+        Release();
+        if (width <= 0 || height <= 0) return false;
+        
+        BITMAPINFO bmi = {};
+        bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+        bmi.bmiHeader.biWidth = width;
+        bmi.bmiHeader.biHeight = -height; // top-down
+        bmi.bmiHeader.biPlanes = 1;
+        bmi.bmiHeader.biBitCount = 32;
+        bmi.bmiHeader.biCompression = BI_RGB;
+        
+        m_hDC = CreateCompatibleDC(hdcRef);
+        m_hBitmap = CreateDIBSection(hdcRef, &bmi, DIB_RGB_COLORS, &m_pBits, NULL, 0);
+        if (!m_hDC || !m_hBitmap) {
+            Release();
+            return false;
+        }
+        m_hOldBitmap = (HBITMAP)SelectObject(m_hDC, m_hBitmap);
+        m_width = width;
+        m_height = height;
+        return true;
+    }
+    
+    void Release() {
+        if (m_hDC && m_hOldBitmap) SelectObject(m_hDC, m_hOldBitmap);
+        if (m_hBitmap) DeleteObject(m_hBitmap);
+        if (m_hDC) DeleteDC(m_hDC);
+        m_hDC = NULL;
+        m_hBitmap = NULL;
+        m_hOldBitmap = NULL;
+        m_pBits = NULL;
+        m_width = 0;
+        m_height = 0;
+    }
+    
+    HDC DC() const { return m_hDC; }
+    uint8_t* Bits() const { return (uint8_t*)m_pBits; }
+    size_t Stride() const { return (size_t)m_width * 4; }
+    
+private:
+    HDC m_hDC;
+    HBITMAP m_hBitmap;
+    HBITMAP m_hOldBitmap;
+    void* m_pBits;
+    int m_width;
+    int m_height;
+};
+
+BackBuffer g_colorBuffer;
+BackBuffer g_buttonBuffer;
+
+// Long-lived GDI objects keyed by what they draw. All fixed-color brushes,
+// pens and fonts come from here, so steady-state painting creates no GDI
+// objects; per-frame colors (swatches) go through the DC brush instead.
+// Handles stay valid until Release: some are kept in globals for the
+// window's lifetime (g_hFontMain, g_hBrushBg, ...), so nothing is evicted,
+// and only fixed colors may be cached so the set stays small.
+class GdiCache {
+public:
+    GdiCache() : m_created(0) {}
+    ~GdiCache() { Release(); }
+    
+    HBRUSH Brush(COLORREF color) {
+        HGDIOBJ obj = Find(Key(1, 0, color), NULL);
+        return obj ? (HBRUSH)obj : (HBRUSH)Add(Key(1, 0, color), NULL, CreateSolidBrush(color));
+    }
+    
+    HPEN Pen(int width, COLORREF color) {
+        HGDIOBJ obj = Find(Key(2, width, color), NULL);
+        return obj ? (HPEN)obj : (HPEN)Add(Key(2, width, color), NULL, CreatePen(PS_SOLID, width, color));
+    }
+    
+    HFONT Font(int height, int weight, DWORD pitchAndFamily, const char* face) {
+        uint64_t key = Key(3, height, ((DWORD)weight << 8) | pitchAndFamily);
+        HGDIOBJ obj = Find(key, face);
+        if (obj) return (HFONT)obj;
+        return (HFONT)Add(key, face, CreateFontA(height, 0, 0, 0, weight, FALSE, FALSE, FALSE,
+                                                DEFAULT_CHARSET, OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS,
+                                                CLEARTYPE_QUALITY, pitchAndFamily, face));
+    }
+    
+    void Release() {
+        for (const Entry& e : m_entries) DeleteObject(e.object);
+        m_entries.clear();
+    }
+    
+    // GDI objects created since startup, for the paint statistics
+    unsigned long Created() const { return m_created; }
+    
+private:
+    struct Entry {
+        uint64_t key;
+        std::string face;
+        HGDIOBJ object;
+    };
+    
+    static uint64_t Key(int kind, int size, DWORD value) {
+        return ((uint64_t)kind << 56) | ((uint64_t)(uint16_t)size << 32) | value;
+    }
     
-    HDC hdc = GetDC(NULL);
-    COLORREF color = GetPixel(hdc, pt.x, pt.y);
-    ReleaseDC(NULL, hdc);
+    HGDIOBJ Find(uint64_t key, const char* face) const {
+        for (const Entry& e : m_entries) {
+            if (e.key == key && (!face || e.face == face)) return e.object;
+        }
+        return NULL;
+    }
+    
+    HGDIOBJ Add(uint64_t key, const char* face, HGDIOBJ object) {
+        if (!object) return NULL;
+        Entry e = {key, face ? face : "", object};
+        m_entries.push_back(e);
+        m_created++;
+        return object;
+    }
     
-    return color;
+    std::vector<Entry> m_entries;
+    unsigned long m_created;
+};
+
+GdiCache g_gdi;
+
+// Paint instrumentation: every custom paint is timed, and once a second
+// the totals are summarised with the GDI objects created in that second.
+// F12 toggles an overlay on the color rectangle and logs the summaries.
+struct PaintStats {
+    unsigned long frames;
+    double totalMs;
+    double maxMs;
+    unsigned long gdiCreatedBefore;
+    char summary[160];
+};
+
+PaintStats g_paintStats = {};
+bool g_showPaintStats = false;
+
+class PaintTimer {
+public:
+    PaintTimer() { QueryPerformanceCounter(&m_start); }
+    
+    ~PaintTimer() {
+        LARGE_INTEGER end, freq;
+        QueryPerformanceCounter(&end);
+        QueryPerformanceFrequency(&freq);
+        double ms = (double)(end.QuadPart - m_start.QuadPart) * 1000.0 / (double)freq.QuadPart;
+        PERF_RECORD(PerfStage::Paint, (uint64_t)(ms * 1e6));
+        g_paintStats.frames++;
+        g_paintStats.totalMs += ms;
+        if (ms > g_paintStats.maxMs) g_paintStats.maxMs = ms;
+    }
+    
+private:
+    LARGE_INTEGER m_start;
+};
+
+// Close the current one-second window; called from ID_PAINT_STATS_TIMER
+void RollPaintStats() {
+    PaintStats& st = g_paintStats;
+    unsigned long created = g_gdi.Created() - st.gdiCreatedBefore;
+    DWORD handles = GetGuiResources(GetCurrentProcess(), GR_GDIOBJECTS);
+    snprintf(st.summary, sizeof(st.summary),
+             "%lu paints/s, avg %.3f ms, max %.3f ms\nGDI +%lu/s, %lu handles",
+             st.frames, st.frames ? st.totalMs / st.frames : 0.0, st.maxMs,
+             created, (unsigned long)handles);
+    
+    char line[192];
+    snprintf(line, sizeof(line), "Paint: %s\n", st.summary);
+    for (char* c = line; *c && c[1]; c++) {
+        if (*c == '\n') *c = ' ';
+    }
+    OutputDebugStringA(line);
+    
+    st.frames = 0;
+    st.totalMs = 0;
+    st.maxMs = 0;
+    st.gdiCreatedBefore = g_gdi.Created();
+}
+
+// Keep the pixels the worker copied around a sample; painting magnifies
+// them. The UI thread never captures the screen itself.
+void UpdateLoupe(const SamplePatch& patch) {
+    if (patch.width == 0) return;
+    PixelView view = patch.View();
+    if (g_loupePixels.width != view.width || g_loupePixels.height != view.height ||
+        g_loupePixels.format != view.format) {
+        g_loupePixels.Allocate(view.width, view.height, view.format);
+    }
+    size_t stride = g_loupePixels.Stride();
+    for (int row = 0; row < view.height; row++) {
+        memcpy(g_loupePixels.pixels.data() + stride * row, view.data + view.stride * row, stride);
+    }
+    InvalidateRect(g_hColorRect, NULL, FALSE);
+}
+
+// Capture worker callbacks, called on the worker thread
+bool WorkerCursor(void*, int& x, int& y) {
+    POINT pt;
+    if (!GetCursorPos(&pt)) return false;
+    x = (int)pt.x;
+    y = (int)pt.y;
+    return true;
+}
+
+void WorkerNotify(void*) {
+    PostMessage(g_hMainWnd, WM_APP_SAMPLE, 0, 0);
+}
+
+// Rewriting the field being typed into would move the caret to the start
+void SetFieldText(HWND edit, const char* text) {
+    if (edit != g_hTypingField) {
+        SetWindowTextA(edit, text);
+    }
 }
 
 void UpdateColorDisplay(COLORREF color) {
+    PERF_SCOPE(PerfStage::Display);
     g_currentColor = color;
     
     // Update color rectangle
-    InvalidateRect(g_hColorRect, NULL, TRUE);
+    InvalidateRect(g_hColorRect, NULL, FALSE);
+    
+    // Update text fields (fixed buffers, no heap traffic per tick)
+    char hexStr[kHexBufferSize];
+    char rgbStr[kRGBBufferSize];
+    char hslStr[kHSLBufferSize];
+    FormatHex(ToColor(color), hexStr);
+    FormatRGB(ToColor(color), rgbStr);
+    FormatHSL(ToColor(color), hslStr);
+    
+    SetFieldText(g_hHexEdit, hexStr);
+    SetFieldText(g_hRgbEdit, rgbStr);
+    SetFieldText(g_hHslEdit, hslStr);
     
-    // Update text fields
-    std::string hexStr = ColorToHex(color);
-    std::string rgbStr = ColorToRGB(color);
-    std::string hslStr = ColorToHSL(color);
+    char spaceStr[kSpaceBufferSize];
+    FormatColorSpace(ToColor(color), g_colorSpace, spaceStr);
+    SetWindowTextA(g_hSpaceEdit, spaceStr);
     
-    SetWindowTextA(g_hHexEdit, hexStr.c_str());
-    SetWindowTextA(g_hRgbEdit, rgbStr.c_str());
-    SetWindowTextA(g_hHslEdit, hslStr.c_str());
+    // Nearest design token; the indexed lookup costs about a microsecond
+    float distance;
+    g_nearestToken = g_palette.Nearest(ToColor(color), PaletteMetric::DeltaE2000, &distance);
+    if (g_nearestToken >= 0) {
+        char tokenStr[128];
+        snprintf(tokenStr, sizeof(tokenStr), "%s  (dE %.1f)",
+                 g_palette.Entry(g_nearestToken).name.c_str(), distance);
+        SetWindowTextA(g_hTokenEdit, tokenStr);
+    }
     
     // Update coordinates
-    std::ostringstream coords;
-    coords << "(" << g_mousePos.x << ", " << g_mousePos.y << ")";
-    SetWindowTextA(g_hCoordLabel, coords.str().c_str());
+    char coords[kCoordBufferSize];
+    FormatCoords(g_mousePos.x, g_mousePos.y, coords);
+    SetWindowTextA(g_hCoordLabel, coords);
+}
+
+// Any CSS color is taken in the HEX, RGB and HSL fields, as is the bare
+// form each one displays. Text that does not parse yet is left alone until
+// the user finishes typing.
+void ApplyTypedColor(HWND edit, CssSyntax syntax) {
+    // EN_CHANGE also fires for our own SetWindowText; only typing has focus
+    if (g_isTracking || GetFocus() != edit) return;
+    
+    char buffer[256];
+    GetWindowTextA(edit, buffer, sizeof(buffer));
+    ParsedColor parsed;
+    if (!ParseColorField(buffer, syntax, parsed)) return;
+    
+    g_hTypingField = edit;
+    UpdateColorDisplay(RGB(parsed.color.r, parsed.color.g, parsed.color.b));
+    g_hTypingField = NULL;
 }
 
 void StartTracking() {
@@ -184,8 +518,9 @@ void StartTracking() {
     // Set cursor to crosshair
     SetCursor(LoadCursor(NULL, IDC_CROSS));
     
-    // Start timer for real-time updates
-    SetTimer(g_hMainWnd, ID_TIMER, 33, NULL); // ~30 FPS
+    // Sampling runs on the worker thread; WM_APP_SAMPLE delivers results
+    g_pCaptureWorker->SetSampling(g_sampleRadius, g_sampleReducer);
+    g_pCaptureWorker->Start();
 }
 
 void StopTracking() {
@@ -199,8 +534,156 @@ void StopTracking() {
     // Reset cursor
     SetCursor(LoadCursor(NULL, IDC_ARROW));
     
-    // Stop timer
-    KillTimer(g_hMainWnd, ID_TIMER);
+    // Stop the worker
+    g_pCaptureWorker->Stop();
+    
+    // Report how much work change detection saved
+    const TrackingCounters& c = g_pCaptureWorker->Counters();
+    char report[256];
+    wsprintfA(report, "Tracking: %lu ticks, %lu captures (%lu skipped), %lu reductions skipped, "
+                      "%lu UI updates (%lu skipped), %lu samples dropped\n",
+              (unsigned long)c.ticks, (unsigned long)c.captures, (unsigned long)c.capturesSkipped,
+              (unsigned long)c.reductionsSkipped, (unsigned long)c.uiUpdates, (unsigned long)c.uiUpdatesSkipped,
+              (unsigned long)g_pCaptureWorker->DroppedSamples());
+    OutputDebugStringA(report);
+}
+
+std::string ExecutableDirPath(const char* name) {
+    char exePath[MAX_PATH];
+    DWORD len = GetModuleFileNameA(NULL, exePath, MAX_PATH);
+    std::string exe(exePath, len);
+    return exe.substr(0, exe.find_last_of("\\/") + 1) + name;
+}
+
+// Data file under %LOCALAPPDATA%, or next to the executable without one
+std::string DataFilePath(const char* name) {
+    char dir[MAX_PATH];
+    DWORD len = GetEnvironmentVariableA("LOCALAPPDATA", dir, MAX_PATH);
+    if (len > 0 && len < MAX_PATH) {
+        std::string path = std::string(dir) + "\\xsukax Color Picker";
+        CreateDirectoryA(path.c_str(), NULL);
+        return path + "\\" + name;
+    }
+    return ExecutableDirPath(name);
+}
+
+// Most recent distinct picks, newest first
+void RefreshHistoryList() {
+    SendMessageA(g_hHistoryList, CB_RESETCONTENT, 0, 0);
+    g_history.DistinctColors(0.02f, 20, g_historyItems);
+    for (size_t index : g_historyItems) {
+        const PickRecord& rec = g_history.Record(index);
+        char item[kHexBufferSize + sizeof(rec.label) + 2];
+        size_t n = FormatHex(RecordColor(rec), item);
+        snprintf(item + n, sizeof(item) - n, "  %s", rec.label);
+        SendMessageA(g_hHistoryList, CB_ADDSTRING, 0, (LPARAM)item);
+    }
+}
+
+// Recording is opt-in for every session; nothing is written until enabled
+void SetHistoryEnabled(bool enabled) {
+    if (!enabled) {
+        g_history.Close();
+        g_historyItems.clear();
+        SendMessageA(g_hHistoryList, CB_RESETCONTENT, 0, 0);
+        return;
+    }
+    
+    std::string error;
+    if (!g_history.Open(DataFilePath("history.bin").c_str(), error)) {
+        SendMessageA(g_hHistorySave, BM_SETCHECK, 0, 0);
+        SetWindowTextA(g_hStatusLabel, "Could not open the pick history");
+        return;
+    }
+    RefreshHistoryList();
+}
+
+// F9: record the last picked or tracked point at 1 kHz until pressed again
+void ToggleRecording() {
+    char text[96];
+    if (g_pRecorder->IsRecording()) {
+        g_pRecorder->Stop();
+        const RecordCounters& c = g_pRecorder->Counters();
+        snprintf(text, sizeof(text), "Recorded %llu samples (%llu dropped)",
+                 (unsigned long long)c.samples, (unsigned long long)c.dropped);
+        SetWindowTextA(g_hStatusLabel, text);
+        return;
+    }
+    
+    RecordOptions options;
+    options.x = g_mousePos.x;
+    options.y = g_mousePos.y;
+    options.radius = g_sampleRadius;
+    options.reducer = g_sampleReducer;
+    
+    char name[64];
+    time_t now = time(NULL);
+    strftime(name, sizeof(name), "recording-%Y%m%d-%H%M%S.xcr", localtime(&now));
+    std::string error;
+    if (!g_pRecorder->Start(DataFilePath(name).c_str(), options, error)) {
+        SetWindowTextA(g_hStatusLabel, "Could not start recording");
+        return;
+    }
+    snprintf(text, sizeof(text), "Recording (%d, %d) - F9 to stop", options.x, options.y);
+    SetWindowTextA(g_hStatusLabel, text);
+}
+
+// F8: watch the points listed in probes.txt next to the executable,
+// capturing their bounding region ten times a second
+void ToggleProbing() {
+    if (g_probing) {
+        KillTimer(g_hMainWnd, ID_PROBE_TIMER);
+        g_probing = false;
+        SetWindowTextA(g_hStatusLabel, "Probe monitoring stopped");
+        return;
+    }
+    
+    std::string error;
+    if (!g_probes.LoadFile(ExecutableDirPath("probes.txt").c_str(), error)) {
+        SetWindowTextA(g_hStatusLabel, "No valid probes.txt next to the executable");
+        return;
+    }
+    
+    char text[96];
+    snprintf(text, sizeof(text), "Watching %zu probes - F8 to stop", g_probes.Size());
+    SetWindowTextA(g_hStatusLabel, text);
+    g_probing = true;
+    SetTimer(g_hMainWnd, ID_PROBE_TIMER, 100, NULL);
+}
+
+// F6: preview the swatch and loupe with each color vision deficiency in
+// turn, then back to normal. The values shown stay those of the real color.
+void CycleVisionSimulation() {
+    g_visionType = (VisionType)(((int)g_visionType + 1) % kVisionTypeCount);
+    g_visionMatrix = SimulationMatrix(g_visionType);
+    
+    char text[96];
+    if (g_visionType == VisionType::Normal) {
+        snprintf(text, sizeof(text), "Color vision simulation off");
+    } else {
+        snprintf(text, sizeof(text), "Simulating %s - F6 for the next", VisionTypeName(g_visionType));
+    }
+    SetWindowTextA(g_hStatusLabel, text);
+    InvalidateRect(g_hColorRect, NULL, FALSE);
+}
+
+// One probe tick; every change goes to the debugger output, the last one
+// to the status line
+void TickProbes() {
+    std::vector<ProbeEvent> events;
+    if (!g_probes.Tick(*g_pProbeSource, NowMicros(), events) || events.empty()) return;
+    
+    char line[320];
+    for (const ProbeEvent& event : events) {
+        char from[kHexBufferSize];
+        char to[kHexBufferSize];
+        FormatHex(event.from, from);
+        FormatHex(event.to, to);
+        snprintf(line, sizeof(line), "probe %s: %s -> %s\n", g_probes.At(event.probe).name.c_str(), from, to);
+        OutputDebugStringA(line);
+    }
+    line[strlen(line) - 1] = '\0';
+    SetWindowTextA(g_hStatusLabel, line);
 }
 
 void PickCurrentColor() {
@@ -208,27 +691,120 @@ void PickCurrentColor() {
         StopTracking();
     }
     
+    // Record the pick, labelled with the nearest palette entry if any
+    bool saved = false;
+    if (g_history.IsWritable()) {
+        const char* label = g_nearestToken >= 0 ? g_palette.Entry(g_nearestToken).name.c_str() : "";
+        std::string error;
+        saved = g_history.Append(ToColor(g_currentColor), g_mousePos.x, g_mousePos.y, UnixTimeMicros(),
+                                 label, error);
+        RefreshHistoryList();
+    }
+    
     // Visual feedback
     SetWindowTextA(g_hMainWnd, "xsukax Color Picker - Color Picked!");
-    SetWindowTextA(g_hStatusLabel, "Color successfully picked and saved!");
+    SetWindowTextA(g_hStatusLabel, saved ? "Color successfully picked and saved!" : "Color successfully picked!");
     SetTimer(g_hMainWnd, ID_TIMER + 2, 2500, NULL);
 }
 
+// Dominant colors of the top-level window last pointed at while tracking.
+// Uses its own capture source so the tracking DIB section stays small.
+void ExtractWindowColors() {
+    if (g_isTracking) {
+        StopTracking();
+    }
+    
+    HWND target = WindowFromPoint(g_mousePos);
+    if (target) target = GetAncestor(target, GA_ROOT);
+    RECT rc;
+    if (!target || target == g_hMainWnd || !GetWindowRect(target, &rc)) {
+        SetWindowTextA(g_hStatusLabel, "Track over a window first, then press ESC and Extract");
+        return;
+    }
+    
+    GdiScreenSource source;
+    CaptureRect rect = {(int)rc.left, (int)rc.top, (int)(rc.right - rc.left), (int)(rc.bottom - rc.top)};
+    PixelView view;
+    if (!source.Capture(rect, view)) {
+        SetWindowTextA(g_hStatusLabel, "Could not capture that window");
+        return;
+    }
+    
+    ExtractOptions options;
+    ExtractDominantColors(view, options, g_dominantColors);
+    InvalidateRect(g_hSwatchStrip, NULL, TRUE);
+    
+    // Copy the palette as a space-separated list of hex values
+    std::string list;
+    char hexStr[kHexBufferSize];
+    for (const DominantColor& d : g_dominantColors) {
+        FormatHex(d.color, hexStr);
+        if (!list.empty()) list += ' ';
+        list += hexStr;
+    }
+    CopyToClipboard(list);
+    SetWindowTextA(g_hStatusLabel, "Window palette extracted and copied - click a swatch");
+}
+
+// Every region of exactly the current color in the window last pointed at
+// while tracking; boxes are copied in screen coordinates, one per line
+void FindColorInWindow() {
+    if (g_isTracking) {
+        StopTracking();
+    }
+    
+    HWND target = WindowFromPoint(g_mousePos);
+    if (target) target = GetAncestor(target, GA_ROOT);
+    RECT rc;
+    if (!target || target == g_hMainWnd || !GetWindowRect(target, &rc)) {
+        SetWindowTextA(g_hStatusLabel, "Track over a window first, then press ESC and F5");
+        return;
+    }
+    
+    GdiScreenSource source;
+    CaptureRect rect = {(int)rc.left, (int)rc.top, (int)(rc.right - rc.left), (int)(rc.bottom - rc.top)};
+    PixelView view;
+    if (!source.Capture(rect, view)) {
+        SetWindowTextA(g_hStatusLabel, "Could not capture that window");
+        return;
+    }
+    
+    std::vector<Color> targets(1, ToColor(g_currentColor));
+    std::vector<ColorMatch> matches;
+    SearchColors(view, targets, SearchOptions(), matches);
+    
+    std::string list;
+    char line[64];
+    for (const ColorMatch& m : matches) {
+        snprintf(line, sizeof(line), "%d %d %d %d\r\n", m.rect.x + rect.x, m.rect.y + rect.y,
+                 m.rect.width, m.rect.height);
+        list += line;
+    }
+    if (matches.empty()) {
+        SetWindowTextA(g_hStatusLabel, "Color not found in that window");
+        return;
+    }
+    CopyToClipboard(list);
+    
+    char status[64];
+    snprintf(status, sizeof(status), "Found in %d places - boxes copied", (int)matches.size());
+    SetWindowTextA(g_hStatusLabel, status);
+}
+
 // Custom button drawing
 void DrawModernButton(HDC hdc, RECT* rect, const char* text, bool isPressed, bool isEnabled) {
     // Button background
     HBRUSH hBrush;
     if (!isEnabled) {
-        hBrush = CreateSolidBrush(RGB(233, 236, 239));
+        hBrush = g_gdi.Brush(RGB(233, 236, 239));
     } else if (isPressed) {
-        hBrush = CreateSolidBrush(COLOR_PRIMARY_HOVER);
+        hBrush = g_gdi.Brush(COLOR_PRIMARY_HOVER);
     } else {
-        hBrush = CreateSolidBrush(COLOR_PRIMARY);
+        hBrush = g_gdi.Brush(COLOR_PRIMARY);
     }
     
     // Draw rounded rectangle background
-    HPEN hPen = CreatePen(PS_SOLID, 1, COLOR_BORDER);
-    HPEN hOldPen = (HPEN)SelectObject(hdc, hPen);
+    HPEN hOldPen = (HPEN)SelectObject(hdc, g_gdi.Pen(1, COLOR_BORDER));
     HBRUSH hOldBrush = (HBRUSH)SelectObject(hdc, hBrush);
     
     RoundRect(hdc, rect->left, rect->top, rect->right, rect->bottom, 8, 8);
@@ -236,75 +812,209 @@ void DrawModernButton(HDC hdc, RECT* rect, const char* text, bool isPressed, boo
     // Draw text
     SetBkMode(hdc, TRANSPARENT);
     SetTextColor(hdc, isEnabled ? RGB(255, 255, 255) : RGB(134, 142, 150));
-    SelectObject(hdc, g_hFontMain);
+    HFONT hOldFont = (HFONT)SelectObject(hdc, g_hFontMain);
     DrawTextA(hdc, text, -1, rect, DT_CENTER | DT_VCENTER | DT_SINGLELINE);
     
+    SelectObject(hdc, hOldFont);
     SelectObject(hdc, hOldPen);
     SelectObject(hdc, hOldBrush);
-    DeleteObject(hPen);
-    DeleteObject(hBrush);
 }
 
-// Window procedure for color rectangle
+// Window procedure for color rectangle: swatch on the left, loupe on the
+// right, composed in the back buffer and blitted once per paint
 LRESULT CALLBACK ColorRectProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
     switch (msg) {
+        case WM_ERASEBKGND:
+            return 1; // WM_PAINT covers every pixel
+            
         case WM_PAINT: {
+            PaintTimer timer;
             PAINTSTRUCT ps;
             HDC hdc = BeginPaint(hwnd, &ps);
             
             RECT rect;
             GetClientRect(hwnd, &rect);
+            int width = rect.right - rect.left;
+            int height = rect.bottom - rect.top;
+            if (!g_colorBuffer.Reserve(hdc, width, height)) {
+                EndPaint(hwnd, &ps);
+                return 0;
+            }
+            HDC hdcMem = g_colorBuffer.DC();
+            FillRect(hdcMem, &rect, g_hBrushBg);
             
             // Draw color with modern rounded corners and shadow effect
-            HBRUSH hBrush = CreateSolidBrush(g_currentColor);
-            HPEN hPen = CreatePen(PS_SOLID, 2, COLOR_BORDER);
-            HPEN hOldPen = (HPEN)SelectObject(hdc, hPen);
-            HBRUSH hOldBrush = (HBRUSH)SelectObject(hdc, hBrush);
+            RECT swatch = {rect.left, rect.top, rect.right - kLoupeSize - 10, rect.bottom};
+            HPEN hOldPen = (HPEN)SelectObject(hdcMem, g_gdi.Pen(2, COLOR_BORDER));
             
             // Draw shadow
-            RECT shadowRect = {rect.left + 2, rect.top + 2, rect.right + 2, rect.bottom + 2};
-            HBRUSH hShadowBrush = CreateSolidBrush(RGB(200, 200, 200));
-            SelectObject(hdc, hShadowBrush);
-            RoundRect(hdc, shadowRect.left, shadowRect.top, shadowRect.right, shadowRect.bottom, 12, 12);
-            DeleteObject(hShadowBrush);
+            RECT shadowRect = {swatch.left + 2, swatch.top + 2, swatch.right + 2, swatch.bottom + 2};
+            HBRUSH hOldBrush = (HBRUSH)SelectObject(hdcMem, g_gdi.Brush(RGB(200, 200, 200)));
+            RoundRect(hdcMem, shadowRect.left, shadowRect.top, shadowRect.right, shadowRect.bottom, 12, 12);
+            
+            // Draw main color rectangle with the DC brush, which changes
+            // color without creating a brush per frame
+            bool simulating = g_visionType != VisionType::Normal;
+            Color shown = ToColor(g_currentColor);
+            if (simulating) shown = SimulateColor(shown, g_visionMatrix);
+            SelectObject(hdcMem, GetStockObject(DC_BRUSH));
+            SetDCBrushColor(hdcMem, RGB(shown.r, shown.g, shown.b));
+            RoundRect(hdcMem, swatch.left, swatch.top, swatch.right - 2, swatch.bottom - 2, 12, 12);
+            
+            SelectObject(hdcMem, hOldPen);
+            SelectObject(hdcMem, hOldBrush);
             
-            // Draw main color rectangle
-            SelectObject(hdc, hBrush);
-            RoundRect(hdc, rect.left, rect.top, rect.right - 2, rect.bottom - 2, 12, 12);
+            // Name the simulation in whichever of black or white reads better
+            if (simulating) {
+                RECT label = {swatch.left + 10, swatch.bottom - 26, swatch.right - 10, swatch.bottom - 6};
+                HFONT hOldFont = (HFONT)SelectObject(hdcMem, g_hFontSmall);
+                SetBkMode(hdcMem, TRANSPARENT);
+                SetTextColor(hdcMem, RelativeLuminance(shown) > 0.179f ? COLOR_TEXT : RGB(255, 255, 255));
+                char name[32];
+                snprintf(name, sizeof(name), "%s", VisionTypeName(g_visionType));
+                name[0] = (char)(name[0] - 'a' + 'A');
+                DrawTextA(hdcMem, name, -1, &label, DT_LEFT | DT_BOTTOM | DT_SINGLELINE | DT_NOPREFIX);
+                SelectObject(hdcMem, hOldFont);
+            }
+            
+            // Loupe, written straight into the DIB bits once GDI has finished
+            int loupeX = width - kLoupeSize;
+            int loupeY = (height - kLoupeSize) / 2;
+            if (g_loupePixels.width == kLoupeCells && g_loupePixels.height == kLoupeCells &&
+                loupeX >= 0 && loupeY >= 0) {
+                GdiFlush();
+                LoupeStyle style;
+                style.scale = kLoupeScale;
+                const Image* cells = &g_loupePixels;
+                if (simulating) {
+                    if (g_loupeSimulated.width != kLoupeCells || g_loupeSimulated.format != g_loupePixels.format) {
+                        g_loupeSimulated.Allocate(kLoupeCells, kLoupeCells, g_loupePixels.format);
+                    }
+                    SimulateView(g_loupePixels.View(), g_visionMatrix, g_loupeSimulated.pixels.data(),
+                                 g_loupeSimulated.Stride());
+                    cells = &g_loupeSimulated;
+                }
+                RenderLoupe(cells->View(), style,
+                            g_colorBuffer.Bits() + g_colorBuffer.Stride() * loupeY + (size_t)loupeX * 4,
+                            g_colorBuffer.Stride());
+            } else {
+                RECT loupe = {loupeX, loupeY, loupeX + kLoupeSize, loupeY + kLoupeSize};
+                FillRect(hdcMem, &loupe, g_hBrushCard);
+                FrameRect(hdcMem, &loupe, g_hBrushBg);
+            }
+            
+            // Debug overlay with the last second of paint statistics
+            if (g_showPaintStats) {
+                RECT box = {swatch.left + 6, swatch.top + 6, swatch.right - 8, swatch.top + 40};
+                FillRect(hdcMem, &box, g_gdi.Brush(COLOR_TEXT));
+                HFONT hOldFont = (HFONT)SelectObject(hdcMem, g_hFontSmall);
+                SetBkMode(hdcMem, TRANSPARENT);
+                SetTextColor(hdcMem, RGB(255, 255, 255));
+                InflateRect(&box, -4, -2);
+                DrawTextA(hdcMem, g_paintStats.summary, -1, &box, DT_LEFT | DT_NOPREFIX);
+                SelectObject(hdcMem, hOldFont);
+            }
+            
+            BitBlt(hdc, 0, 0, width, height, hdcMem, 0, 0, SRCCOPY);
+            EndPaint(hwnd, &ps);
+            return 0;
+        }
+    }
+    return DefWindowProc(hwnd, msg, wParam, lParam);
+}
+
+// Swatch strip showing the extracted palette; clicking a swatch selects it
+LRESULT CALLBACK SwatchStripProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
+    switch (msg) {
+        case WM_PAINT: {
+            PaintTimer timer;
+            PAINTSTRUCT ps;
+            HDC hdc = BeginPaint(hwnd, &ps);
             
-            SelectObject(hdc, hOldPen);
-            SelectObject(hdc, hOldBrush);
-            DeleteObject(hPen);
-            DeleteObject(hBrush);
+            RECT rect;
+            GetClientRect(hwnd, &rect);
+            FillRect(hdc, &rect, g_hBrushCard);
+            
+            int count = (int)g_dominantColors.size();
+            for (int i = 0; i < count; i++) {
+                RECT swatch = {rect.left + (rect.right - rect.left) * i / count, rect.top,
+                               rect.left + (rect.right - rect.left) * (i + 1) / count, rect.bottom};
+                Color c = g_dominantColors[i].color;
+                SetDCBrushColor(hdc, RGB(c.r, c.g, c.b));
+                FillRect(hdc, &swatch, (HBRUSH)GetStockObject(DC_BRUSH));
+            }
+            FrameRect(hdc, &rect, g_hBrushBg);
             
             EndPaint(hwnd, &ps);
             return 0;
         }
+        
+        case WM_LBUTTONDOWN: {
+            int count = (int)g_dominantColors.size();
+            RECT rect;
+            GetClientRect(hwnd, &rect);
+            int width = rect.right - rect.left;
+            if (count > 0 && width > 0) {
+                int i = (int)(short)LOWORD(lParam) * count / width;
+                if (i >= 0 && i < count) {
+                    Color c = g_dominantColors[i].color;
+                    UpdateColorDisplay(RGB(c.r, c.g, c.b));
+                }
+            }
+            return 0;
+        }
     }
     return DefWindowProc(hwnd, msg, wParam, lParam);
 }
 
 // Main window procedure
+// Esc and the F-key tools. Checked in the message loop before dispatch, so
+// they work whichever of the app's windows has focus, not just the main one.
+bool HandleHotkey(WPARAM key) {
+    if (key == VK_ESCAPE && g_isTracking) {
+        StopTracking();
+    } else if (key == VK_F12) {
+        g_showPaintStats = !g_showPaintStats;
+        if (g_showPaintStats) {
+            RollPaintStats();
+            SetTimer(g_hMainWnd, ID_PAINT_STATS_TIMER, 1000, NULL);
+        } else {
+            KillTimer(g_hMainWnd, ID_PAINT_STATS_TIMER);
+        }
+        InvalidateRect(g_hColorRect, NULL, FALSE);
+    } else if (key == VK_F5) {
+        FindColorInWindow();
+    } else if (key == VK_F6) {
+        CycleVisionSimulation();
+    } else if (key == VK_F7) {
+        // Per-stage latency percentiles since the last report
+        std::string json = PerfStatsJSON();
+        OutputDebugStringA(json.c_str());
+        CopyToClipboard(json);
+        ResetPerfStats();
+        SetWindowTextA(g_hStatusLabel, "Latency report copied as JSON");
+    } else if (key == VK_F8) {
+        ToggleProbing();
+    } else if (key == VK_F9) {
+        ToggleRecording();
+    } else {
+        return false;
+    }
+    return true;
+}
+
 LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
     switch (msg) {
         case WM_CREATE: {
             // Create modern fonts
-            g_hFontMain = CreateFontA(-14, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE,
-                                     DEFAULT_CHARSET, OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS,
-                                     CLEARTYPE_QUALITY, DEFAULT_PITCH | FF_SWISS, "Segoe UI");
-            
-            g_hFontSmall = CreateFontA(-12, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE,
-                                      DEFAULT_CHARSET, OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS,
-                                      CLEARTYPE_QUALITY, DEFAULT_PITCH | FF_SWISS, "Segoe UI");
-            
-            g_hFontMono = CreateFontA(-12, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE,
-                                     DEFAULT_CHARSET, OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS,
-                                     CLEARTYPE_QUALITY, DEFAULT_PITCH | FF_MODERN, "Consolas");
+            g_hFontMain = g_gdi.Font(-14, FW_NORMAL, DEFAULT_PITCH | FF_SWISS, "Segoe UI");
+            g_hFontSmall = g_gdi.Font(-12, FW_NORMAL, DEFAULT_PITCH | FF_SWISS, "Segoe UI");
+            g_hFontMono = g_gdi.Font(-12, FW_NORMAL, DEFAULT_PITCH | FF_MODERN, "Consolas");
             
             // Create brushes
-            g_hBrushBg = CreateSolidBrush(COLOR_BG);
-            g_hBrushCard = CreateSolidBrush(COLOR_CARD);
-            g_hBrushPrimary = CreateSolidBrush(COLOR_PRIMARY);
+            g_hBrushBg = g_gdi.Brush(COLOR_BG);
+            g_hBrushCard = g_gdi.Brush(COLOR_CARD);
+            g_hBrushPrimary = g_gdi.Brush(COLOR_PRIMARY);
             
             // Initialize common controls with modern theme
             INITCOMMONCONTROLSEX icc;
@@ -320,72 +1030,140 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
             
             // Create color display rectangle
             g_hColorRect = CreateWindowA("ColorRect", "", WS_CHILD | WS_VISIBLE,
-                                        20, 60, 320, 80, hwnd, NULL, GetModuleHandle(NULL), NULL);
+                                        20, 60, 320, 120, hwnd, NULL, GetModuleHandle(NULL), NULL);
             
             // Position and coordinates section
             HWND hPosLabel = CreateWindowA("STATIC", "Cursor Position", WS_CHILD | WS_VISIBLE,
-                                          20, 155, 120, 20, hwnd, NULL, GetModuleHandle(NULL), NULL);
+                                          20, 195, 120, 20, hwnd, NULL, GetModuleHandle(NULL), NULL);
             SendMessage(hPosLabel, WM_SETFONT, (WPARAM)g_hFontSmall, TRUE);
             
             g_hCoordLabel = CreateWindowA("STATIC", "(0, 0)", WS_CHILD | WS_VISIBLE,
-                                         150, 155, 190, 20, hwnd, (HMENU)ID_COORD_LABEL, GetModuleHandle(NULL), NULL);
+                                         150, 195, 190, 20, hwnd, (HMENU)ID_COORD_LABEL, GetModuleHandle(NULL), NULL);
             SendMessage(g_hCoordLabel, WM_SETFONT, (WPARAM)g_hFontMono, TRUE);
             
+            // Sampling window and reducer
+            HWND hSampleLabel = CreateWindowA("STATIC", "Sample Area", WS_CHILD | WS_VISIBLE,
+                                             20, 228, 120, 20, hwnd, NULL, GetModuleHandle(NULL), NULL);
+            SendMessage(hSampleLabel, WM_SETFONT, (WPARAM)g_hFontSmall, TRUE);
+            
+            g_hSampleSize = CreateWindowA("COMBOBOX", "", WS_CHILD | WS_VISIBLE | WS_VSCROLL | CBS_DROPDOWNLIST,
+                                         150, 225, 90, 300, hwnd, (HMENU)ID_SAMPLE_SIZE, GetModuleHandle(NULL), NULL);
+            for (int radius = 0; radius <= kMaxSampleRadius; radius++) {
+                char label[16];
+                int size = radius * 2 + 1;
+                wsprintfA(label, "%d x %d", size, size);
+                SendMessageA(g_hSampleSize, CB_ADDSTRING, 0, (LPARAM)label);
+            }
+            SendMessageA(g_hSampleSize, CB_SETCURSEL, g_sampleRadius, 0);
+            SendMessage(g_hSampleSize, WM_SETFONT, (WPARAM)g_hFontSmall, TRUE);
+            
+            g_hSampleMode = CreateWindowA("COMBOBOX", "", WS_CHILD | WS_VISIBLE | CBS_DROPDOWNLIST,
+                                         250, 225, 90, 200, hwnd, (HMENU)ID_SAMPLE_MODE, GetModuleHandle(NULL), NULL);
+            SendMessageA(g_hSampleMode, CB_ADDSTRING, 0, (LPARAM)"Mean");
+            SendMessageA(g_hSampleMode, CB_ADDSTRING, 0, (LPARAM)"Median");
+            SendMessageA(g_hSampleMode, CB_ADDSTRING, 0, (LPARAM)"Mode");
+            SendMessageA(g_hSampleMode, CB_SETCURSEL, (WPARAM)g_sampleReducer, 0);
+            SendMessage(g_hSampleMode, WM_SETFONT, (WPARAM)g_hFontSmall, TRUE);
+            
             // Control buttons with modern styling
             g_hTrackBtn = CreateWindowA("BUTTON", "Start Tracking", 
                                        WS_CHILD | WS_VISIBLE | BS_PUSHBUTTON | BS_OWNERDRAW,
-                                       20, 185, 150, 40, hwnd, (HMENU)ID_TRACK_BUTTON, GetModuleHandle(NULL), NULL);
+                                       20, 260, 150, 40, hwnd, (HMENU)ID_TRACK_BUTTON, GetModuleHandle(NULL), NULL);
             
             g_hPickBtn = CreateWindowA("BUTTON", "Pick Color", 
                                       WS_CHILD | WS_VISIBLE | BS_PUSHBUTTON | BS_OWNERDRAW,
-                                      190, 185, 150, 40, hwnd, (HMENU)ID_PICK_BUTTON, GetModuleHandle(NULL), NULL);
+                                      190, 260, 150, 40, hwnd, (HMENU)ID_PICK_BUTTON, GetModuleHandle(NULL), NULL);
             
             // Color values section with modern cards
             // HEX section
             CreateWindowA("STATIC", "HEX", WS_CHILD | WS_VISIBLE,
-                         20, 245, 40, 20, hwnd, NULL, GetModuleHandle(NULL), NULL);
+                         20, 320, 40, 20, hwnd, NULL, GetModuleHandle(NULL), NULL);
             
             g_hHexEdit = CreateWindowA("EDIT", "#6366F1", 
-                                      WS_CHILD | WS_VISIBLE | WS_BORDER | ES_READONLY | ES_CENTER,
-                                      70, 243, 140, 26, hwnd, (HMENU)ID_HEX_EDIT, GetModuleHandle(NULL), NULL);
+                                      WS_CHILD | WS_VISIBLE | WS_BORDER | ES_CENTER | ES_AUTOHSCROLL,
+                                      70, 318, 140, 26, hwnd, (HMENU)ID_HEX_EDIT, GetModuleHandle(NULL), NULL);
             SendMessage(g_hHexEdit, WM_SETFONT, (WPARAM)g_hFontMono, TRUE);
             
             CreateWindowA("BUTTON", "Copy", WS_CHILD | WS_VISIBLE | BS_PUSHBUTTON,
-                         220, 243, 65, 26, hwnd, (HMENU)ID_COPY_HEX, GetModuleHandle(NULL), NULL);
+                         220, 318, 65, 26, hwnd, (HMENU)ID_COPY_HEX, GetModuleHandle(NULL), NULL);
             
             // RGB section
             CreateWindowA("STATIC", "RGB", WS_CHILD | WS_VISIBLE,
-                         20, 280, 40, 20, hwnd, NULL, GetModuleHandle(NULL), NULL);
+                         20, 355, 40, 20, hwnd, NULL, GetModuleHandle(NULL), NULL);
             
             g_hRgbEdit = CreateWindowA("EDIT", "99, 102, 241", 
-                                      WS_CHILD | WS_VISIBLE | WS_BORDER | ES_READONLY | ES_CENTER,
-                                      70, 278, 140, 26, hwnd, (HMENU)ID_RGB_EDIT, GetModuleHandle(NULL), NULL);
+                                      WS_CHILD | WS_VISIBLE | WS_BORDER | ES_CENTER | ES_AUTOHSCROLL,
+                                      70, 353, 140, 26, hwnd, (HMENU)ID_RGB_EDIT, GetModuleHandle(NULL), NULL);
             SendMessage(g_hRgbEdit, WM_SETFONT, (WPARAM)g_hFontMono, TRUE);
             
             CreateWindowA("BUTTON", "Copy", WS_CHILD | WS_VISIBLE | BS_PUSHBUTTON,
-                         220, 278, 65, 26, hwnd, (HMENU)ID_COPY_RGB, GetModuleHandle(NULL), NULL);
+                         220, 353, 65, 26, hwnd, (HMENU)ID_COPY_RGB, GetModuleHandle(NULL), NULL);
             
             // HSL section
             CreateWindowA("STATIC", "HSL", WS_CHILD | WS_VISIBLE,
-                         20, 315, 40, 20, hwnd, NULL, GetModuleHandle(NULL), NULL);
+                         20, 390, 40, 20, hwnd, NULL, GetModuleHandle(NULL), NULL);
             
-            g_hHslEdit = CreateWindowA("EDIT", "244 deg, 85%, 67%", 
-                                      WS_CHILD | WS_VISIBLE | WS_BORDER | ES_READONLY | ES_CENTER,
-                                      70, 313, 140, 26, hwnd, (HMENU)ID_HSL_EDIT, GetModuleHandle(NULL), NULL);
+            g_hHslEdit = CreateWindowA("EDIT", "239 deg, 84%, 67%", 
+                                      WS_CHILD | WS_VISIBLE | WS_BORDER | ES_CENTER | ES_AUTOHSCROLL,
+                                      70, 388, 140, 26, hwnd, (HMENU)ID_HSL_EDIT, GetModuleHandle(NULL), NULL);
             SendMessage(g_hHslEdit, WM_SETFONT, (WPARAM)g_hFontMono, TRUE);
             
             CreateWindowA("BUTTON", "Copy", WS_CHILD | WS_VISIBLE | BS_PUSHBUTTON,
-                         220, 313, 65, 26, hwnd, (HMENU)ID_COPY_HSL, GetModuleHandle(NULL), NULL);
+                         220, 388, 65, 26, hwnd, (HMENU)ID_COPY_HSL, GetModuleHandle(NULL), NULL);
+            
+            // Selectable extra color space (HSV, Lab, LCh, OKLab, OKLCh, CMYK)
+            g_hSpaceSelect = CreateWindowA("COMBOBOX", "", WS_CHILD | WS_VISIBLE | CBS_DROPDOWNLIST,
+                                          20, 423, 60, 200, hwnd, (HMENU)ID_SPACE_SELECT, GetModuleHandle(NULL), NULL);
+            for (int i = 0; i < kColorSpaceCount; i++) {
+                SendMessageA(g_hSpaceSelect, CB_ADDSTRING, 0, (LPARAM)ColorSpaceName((ColorSpace)i));
+            }
+            SendMessageA(g_hSpaceSelect, CB_SETCURSEL, (WPARAM)g_colorSpace, 0);
+            SendMessage(g_hSpaceSelect, WM_SETFONT, (WPARAM)g_hFontSmall, TRUE);
+            
+            g_hSpaceEdit = CreateWindowA("EDIT", "",
+                                        WS_CHILD | WS_VISIBLE | WS_BORDER | ES_READONLY | ES_CENTER,
+                                        85, 423, 200, 26, hwnd, (HMENU)ID_SPACE_EDIT, GetModuleHandle(NULL), NULL);
+            SendMessage(g_hSpaceEdit, WM_SETFONT, (WPARAM)g_hFontMono, TRUE);
+            
+            CreateWindowA("BUTTON", "Copy", WS_CHILD | WS_VISIBLE | BS_PUSHBUTTON,
+                         290, 423, 50, 26, hwnd, (HMENU)ID_COPY_SPACE, GetModuleHandle(NULL), NULL);
+            
+            // Nearest named color from the loaded palette
+            CreateWindowA("STATIC", "Token", WS_CHILD | WS_VISIBLE,
+                         20, 463, 45, 20, hwnd, NULL, GetModuleHandle(NULL), NULL);
+            
+            g_hTokenEdit = CreateWindowA("EDIT", g_palette.Size() ? "" : "(no palette loaded)",
+                                        WS_CHILD | WS_VISIBLE | WS_BORDER | ES_READONLY | ES_CENTER | ES_AUTOHSCROLL,
+                                        70, 458, 215, 26, hwnd, (HMENU)ID_TOKEN_EDIT, GetModuleHandle(NULL), NULL);
+            SendMessage(g_hTokenEdit, WM_SETFONT, (WPARAM)g_hFontMono, TRUE);
+            
+            CreateWindowA("BUTTON", "Copy", WS_CHILD | WS_VISIBLE | BS_PUSHBUTTON,
+                         290, 458, 50, 26, hwnd, (HMENU)ID_COPY_TOKEN, GetModuleHandle(NULL), NULL);
+            
+            // Palette extraction from the last window tracked over
+            CreateWindowA("BUTTON", "Extract", WS_CHILD | WS_VISIBLE | BS_PUSHBUTTON,
+                         20, 493, 65, 26, hwnd, (HMENU)ID_EXTRACT_BUTTON, GetModuleHandle(NULL), NULL);
+            
+            g_hSwatchStrip = CreateWindowA("SwatchStrip", "", WS_CHILD | WS_VISIBLE,
+                                          90, 493, 250, 26, hwnd, (HMENU)ID_SWATCH_STRIP, GetModuleHandle(NULL), NULL);
+            
+            // Opt-in pick history and its recent distinct colors
+            g_hHistorySave = CreateWindowA("BUTTON", "Save picks", WS_CHILD | WS_VISIBLE | BS_AUTOCHECKBOX,
+                                          20, 528, 90, 26, hwnd, (HMENU)ID_HISTORY_SAVE, GetModuleHandle(NULL), NULL);
+            
+            g_hHistoryList = CreateWindowA("COMBOBOX", "", WS_CHILD | WS_VISIBLE | WS_VSCROLL | CBS_DROPDOWNLIST,
+                                          115, 528, 225, 300, hwnd, (HMENU)ID_HISTORY_LIST, GetModuleHandle(NULL), NULL);
+            SendMessage(g_hHistoryList, WM_SETFONT, (WPARAM)g_hFontMono, TRUE);
             
             // Status section
             g_hStatusLabel = CreateWindowA("STATIC", "Ready to sample colors from your screen",
                                           WS_CHILD | WS_VISIBLE | SS_CENTER,
-                                          20, 355, 320, 20, hwnd, (HMENU)ID_STATUS_LABEL, GetModuleHandle(NULL), NULL);
+                                          20, 570, 320, 20, hwnd, (HMENU)ID_STATUS_LABEL, GetModuleHandle(NULL), NULL);
             SendMessage(g_hStatusLabel, WM_SETFONT, (WPARAM)g_hFontSmall, TRUE);
             
             // Brand label
             HWND hBrand = CreateWindowA("STATIC", "xsukax Color Picker v2.0", WS_CHILD | WS_VISIBLE | SS_CENTER,
-                                       20, 385, 320, 20, hwnd, NULL, GetModuleHandle(NULL), NULL);
+                                       20, 600, 320, 20, hwnd, NULL, GetModuleHandle(NULL), NULL);
             SendMessage(hBrand, WM_SETFONT, (WPARAM)g_hFontSmall, TRUE);
             
             // Set fonts for all controls
@@ -401,6 +1179,14 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
                 hChild = GetWindow(hChild, GW_HWNDNEXT);
             }
             
+            // Screen capture backend, driven from the worker thread
+            g_pScreenSource = new GdiScreenSource();
+            g_pCaptureWorker = new CaptureWorker(g_pScreenSource, WorkerCursor, WorkerNotify, NULL);
+            g_pCaptureWorker->SetPatchRadius(kLoupeRadius);
+            g_pRecordSource = new GdiScreenSource();
+            g_pRecorder = new ColorRecorder(g_pRecordSource);
+            g_pProbeSource = new GdiScreenSource();
+            
             // Initialize with default color
             UpdateColorDisplay(g_currentColor);
             
@@ -428,7 +1214,20 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
                 GetWindowTextA(dis->hwndItem, text, sizeof(text));
                 bool isPressed = (dis->itemState & ODS_SELECTED) != 0;
                 bool isEnabled = (dis->itemState & ODS_DISABLED) == 0;
-                DrawModernButton(dis->hDC, &dis->rcItem, text, isPressed, isEnabled);
+                
+                // Draw off-screen and copy in one blit, so pressing never
+                // shows a half-painted button
+                PaintTimer timer;
+                RECT& item = dis->rcItem;
+                RECT local = {0, 0, item.right - item.left, item.bottom - item.top};
+                if (g_buttonBuffer.Reserve(dis->hDC, local.right, local.bottom)) {
+                    HDC hdcMem = g_buttonBuffer.DC();
+                    FillRect(hdcMem, &local, g_hBrushBg);
+                    DrawModernButton(hdcMem, &local, text, isPressed, isEnabled);
+                    BitBlt(dis->hDC, item.left, item.top, local.right, local.bottom, hdcMem, 0, 0, SRCCOPY);
+                } else {
+                    DrawModernButton(dis->hDC, &item, text, isPressed, isEnabled);
+                }
                 return TRUE;
             }
             break;
@@ -448,6 +1247,44 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
                     PickCurrentColor();
                     break;
                     
+                case ID_EXTRACT_BUTTON:
+                    ExtractWindowColors();
+                    break;
+                    
+                case ID_SAMPLE_SIZE:
+                    if (HIWORD(wParam) == CBN_SELCHANGE) {
+                        g_sampleRadius = (int)SendMessageA(g_hSampleSize, CB_GETCURSEL, 0, 0);
+                        g_pCaptureWorker->SetSampling(g_sampleRadius, g_sampleReducer);
+                    }
+                    break;
+                    
+                case ID_SAMPLE_MODE:
+                    if (HIWORD(wParam) == CBN_SELCHANGE) {
+                        g_sampleReducer = (SampleReducer)SendMessageA(g_hSampleMode, CB_GETCURSEL, 0, 0);
+                        g_pCaptureWorker->SetSampling(g_sampleRadius, g_sampleReducer);
+                    }
+                    break;
+                    
+                case ID_SPACE_SELECT:
+                    if (HIWORD(wParam) == CBN_SELCHANGE) {
+                        g_colorSpace = (ColorSpace)SendMessageA(g_hSpaceSelect, CB_GETCURSEL, 0, 0);
+                        UpdateColorDisplay(g_currentColor);
+                    }
+                    break;
+                    
+                case ID_HEX_EDIT:
+                case ID_RGB_EDIT:
+                case ID_HSL_EDIT:
+                    if (HIWORD(wParam) == EN_CHANGE) {
+                        CssSyntax syntax = LOWORD(wParam) == ID_HEX_EDIT ? CssSyntax::Hex :
+                                           LOWORD(wParam) == ID_RGB_EDIT ? CssSyntax::RGB : CssSyntax::HSL;
+                        ApplyTypedColor((HWND)lParam, syntax);
+                    } else if (HIWORD(wParam) == EN_KILLFOCUS && !g_isTracking) {
+                        // Show what was typed in each field's own format
+                        UpdateColorDisplay(g_currentColor);
+                    }
+                    break;
+                    
                 case ID_COPY_HEX: {
                     char buffer[256];
                     GetWindowTextA(g_hHexEdit, buffer, sizeof(buffer));
@@ -468,24 +1305,57 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
                     CopyToClipboard(std::string(buffer));
                     break;
                 }
+                
+                case ID_COPY_SPACE: {
+                    char buffer[256];
+                    GetWindowTextA(g_hSpaceEdit, buffer, sizeof(buffer));
+                    CopyToClipboard(std::string(buffer));
+                    break;
+                }
+                
+                case ID_HISTORY_SAVE:
+                    if (HIWORD(wParam) == BN_CLICKED) {
+                        SetHistoryEnabled(SendMessageA(g_hHistorySave, BM_GETCHECK, 0, 0) == BST_CHECKED);
+                    }
+                    break;
+                
+                case ID_HISTORY_LIST:
+                    if (HIWORD(wParam) == CBN_SELCHANGE) {
+                        int item = (int)SendMessageA(g_hHistoryList, CB_GETCURSEL, 0, 0);
+                        if (item >= 0 && item < (int)g_historyItems.size()) {
+                            const PickRecord& rec = g_history.Record(g_historyItems[item]);
+                            UpdateColorDisplay(RGB(rec.r, rec.g, rec.b));
+                        }
+                    }
+                    break;
+                
+                case ID_COPY_TOKEN: {
+                    // Copy the bare token name, without the distance
+                    if (g_nearestToken >= 0) {
+                        CopyToClipboard(g_palette.Entry(g_nearestToken).name);
+                    }
+                    break;
+                }
             }
             return 0;
         }
         
         case WM_TIMER: {
             switch (wParam) {
-                case ID_TIMER:
-                    if (g_isTracking) {
-                        COLORREF color = GetPixelAtCursor();
-                        UpdateColorDisplay(color);
-                    }
-                    break;
-                    
                 case ID_TIMER + 1:
                     SetWindowTextA(g_hMainWnd, "xsukax Color Picker");
                     KillTimer(hwnd, ID_TIMER + 1);
                     break;
                     
+                case ID_PAINT_STATS_TIMER:
+                    RollPaintStats();
+                    InvalidateRect(g_hColorRect, NULL, FALSE);
+                    break;
+                    
+                case ID_PROBE_TIMER:
+                    TickProbes();
+                    break;
+                    
                 case ID_TIMER + 2:
                     SetWindowTextA(g_hMainWnd, "xsukax Color Picker");
                     SetWindowTextA(g_hStatusLabel, "Ready to sample colors from your screen");
@@ -495,9 +1365,15 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
             return 0;
         }
         
-        case WM_KEYDOWN: {
-            if (wParam == VK_ESCAPE && g_isTracking) {
-                StopTracking();
+        case WM_APP_SAMPLE: {
+            // Only the newest sample matters; older ones are dropped unseen
+            ColorSample sample;
+            if (g_isTracking && g_pCaptureWorker->LatestSample(sample)) {
+                PERF_RECORD(PerfStage::Queue, (NowMicros() - sample.timestampUs) * 1000);
+                g_mousePos.x = sample.x;
+                g_mousePos.y = sample.y;
+                UpdateColorDisplay(RGB(sample.color.r, sample.color.g, sample.color.b));
+                UpdateLoupe(sample.patch);
             }
             return 0;
         }
@@ -509,12 +1385,24 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
             
         case WM_DESTROY:
             // Cleanup resources
-            if (g_hFontMain) DeleteObject(g_hFontMain);
-            if (g_hFontSmall) DeleteObject(g_hFontSmall);
-            if (g_hFontMono) DeleteObject(g_hFontMono);
-            if (g_hBrushBg) DeleteObject(g_hBrushBg);
-            if (g_hBrushCard) DeleteObject(g_hBrushCard);
-            if (g_hBrushPrimary) DeleteObject(g_hBrushPrimary);
+            KillTimer(hwnd, ID_PAINT_STATS_TIMER);
+            KillTimer(hwnd, ID_PROBE_TIMER);
+            g_history.Close();
+            g_colorBuffer.Release();
+            g_buttonBuffer.Release();
+            g_gdi.Release();
+            g_hFontMain = g_hFontSmall = g_hFontMono = NULL;
+            g_hBrushBg = g_hBrushCard = g_hBrushPrimary = NULL;
+            delete g_pCaptureWorker;
+            g_pCaptureWorker = NULL;
+            delete g_pScreenSource;
+            g_pScreenSource = NULL;
+            delete g_pRecorder;
+            g_pRecorder = NULL;
+            delete g_pRecordSource;
+            g_pRecordSource = NULL;
+            delete g_pProbeSource;
+            g_pProbeSource = NULL;
             PostQuitMessage(0);
             return 0;
     }
@@ -529,6 +1417,23 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
         ShowWindow(consoleWnd, SW_HIDE);
     }
     
+    // Optional palette: a path on the command line, otherwise palette.txt
+    // next to the executable
+    std::string palettePath(lpCmdLine ? lpCmdLine : "");
+    if (palettePath.size() >= 2 && palettePath[0] == '"') {
+        palettePath = palettePath.substr(1, palettePath.find('"', 1) - 1);
+    }
+    bool explicitPalette = !palettePath.empty();
+    if (!explicitPalette) {
+        palettePath = ExecutableDirPath("palette.txt");
+    }
+    std::string paletteError;
+    if (g_palette.LoadFile(palettePath.c_str(), paletteError)) {
+        g_palette.BuildIndex();
+    } else if (explicitPalette) {
+        MessageBoxA(NULL, paletteError.c_str(), "Palette not loaded", MB_ICONWARNING);
+    }
+    
     // Register color rectangle window class
     WNDCLASSA colorWc = {};
     colorWc.lpfnWndProc = ColorRectProc;
@@ -538,6 +1443,14 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
     colorWc.hCursor = LoadCursor(NULL, IDC_ARROW);
     RegisterClassA(&colorWc);
     
+    // Register swatch strip window class
+    WNDCLASSA swatchWc = {};
+    swatchWc.lpfnWndProc = SwatchStripProc;
+    swatchWc.hInstance = hInstance;
+    swatchWc.lpszClassName = "SwatchStrip";
+    swatchWc.hCursor = LoadCursor(NULL, IDC_HAND);
+    RegisterClassA(&swatchWc);
+    
     // Register main window class
     WNDCLASSA wc = {};
     wc.lpfnWndProc = WndProc;
@@ -551,7 +1464,7 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
     // Create main window with modern styling
     g_hMainWnd = CreateWindowA("ModernColorPicker", "xsukax Color Picker",
                               WS_OVERLAPPED | WS_CAPTION | WS_SYSMENU | WS_MINIMIZEBOX,
-                              CW_USEDEFAULT, CW_USEDEFAULT, 380, 450,
+                              CW_USEDEFAULT, CW_USEDEFAULT, 380, 665,
                               NULL, NULL, hInstance, NULL);
     
     if (!g_hMainWnd) {
@@ -565,6 +1478,9 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
     // Message loop
     MSG msg;
     while (GetMessage(&msg, NULL, 0, 0)) {
+        if (msg.message == WM_KEYDOWN && HandleHotkey(msg.wParam)) {
+            continue;
+        }
         TranslateMessage(&msg);
         DispatchMessage(&msg);
     }
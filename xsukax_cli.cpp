@@ -0,0 +1,1014 @@
+// Headless front end for the portable color core. Builds on any platform
+// with a C++17 compiler; see README.md for the command lines.
+
+#include <chrono>
+#include <cstdio>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "core/batch_sampler.h"
+#include "core/capture_worker.h"
+#include "core/color_core.h"
+#include "core/color_extract.h"
+#include "core/color_parse.h"
+#include "core/color_recorder.h"
+#include "core/color_search.h"
+#include "core/color_sampling.h"
+#include "core/color_spaces.h"
+#include "core/color_vision.h"
+#include "core/contrast_audit.h"
+#include "core/image_io.h"
+#include "core/magnifier.h"
+#include "core/mapped_file.h"
+#include "core/palette.h"
+#include "core/parallel.h"
+#include "core/perf_stats.h"
+#include "core/pick_history.h"
+#include "core/probe_set.h"
+#include "core/screen_source.h"
+
+// Parse an 8-bit channel value, rejecting anything outside 0-255
+bool ParseChannel(const char* text, int& value) {
+    char* end = NULL;
+    long v = strtol(text, &end, 10);
+    if (end == text || *end != '\0' || v < 0 || v > 255) {
+        return false;
+    }
+    value = (int)v;
+    return true;
+}
+
+// Every supported representation, one per line
+void PrintColor(Color color) {
+    printf("HEX %s\n", ColorToHex(color).c_str());
+    printf("RGB %s\n", ColorToRGB(color).c_str());
+    printf("HSL %s\n", ColorToHSL(color).c_str());
+    
+    char buffer[kSpaceBufferSize];
+    for (int i = 0; i < kColorSpaceCount; i++) {
+        FormatColorSpace(color, (ColorSpace)i, buffer);
+        printf("%s %s\n", ColorSpaceName((ColorSpace)i), buffer);
+    }
+}
+
+int CmdConvert(int argc, char** argv) {
+    int r, g, b;
+    if (argc != 3 || !ParseChannel(argv[0], r) || !ParseChannel(argv[1], g) || !ParseChannel(argv[2], b)) {
+        fprintf(stderr, "usage: xsukax_cli convert R G B\n");
+        return 1;
+    }
+    
+    PrintColor(MakeColor(r, g, b));
+    return 0;
+}
+
+// Parse a signed integer argument
+bool ParseInt(const char* text, int& value) {
+    char* end = NULL;
+    long v = strtol(text, &end, 10);
+    if (end == text || *end != '\0' || v < -1000000000L || v > 1000000000L) {
+        return false;
+    }
+    value = (int)v;
+    return true;
+}
+
+int CmdSample(int argc, char** argv) {
+    int x, y;
+    int radius = 0;
+    SampleReducer reducer = SampleReducer::Mean;
+    if (argc < 3 || argc > 5 || !ParseInt(argv[1], x) || !ParseInt(argv[2], y) ||
+        (argc > 3 && (!ParseInt(argv[3], radius) || radius < 0 || radius > kMaxSampleRadius)) ||
+        (argc > 4 && !ParseSampleReducer(argv[4], reducer))) {
+        fprintf(stderr, "usage: xsukax_cli sample IMAGE X Y [RADIUS 0-%d] [mean|median|mode]\n", kMaxSampleRadius);
+        return 1;
+    }
+    
+    Image image;
+    std::string error;
+    if (!ReadImageFile(argv[0], image, error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    
+    ImageScreenSource source(image);
+    PixelView view;
+    if (!source.Capture(RectAround(x, y, radius), view)) {
+        fprintf(stderr, "capture failed\n");
+        return 1;
+    }
+    
+    PrintColor(ReduceRegion(view, reducer));
+    return 0;
+}
+
+bool LoadPalette(const char* path, Palette& palette) {
+    std::string error;
+    if (!palette.LoadFile(path, error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return false;
+    }
+    palette.BuildIndex();
+    return true;
+}
+
+int CmdNearest(int argc, char** argv) {
+    int r, g, b;
+    PaletteMetric metric = PaletteMetric::DeltaE2000;
+    if (argc < 4 || argc > 5 || !ParseChannel(argv[1], r) || !ParseChannel(argv[2], g) || !ParseChannel(argv[3], b) ||
+        (argc > 4 && !ParsePaletteMetric(argv[4], metric))) {
+        fprintf(stderr, "usage: xsukax_cli nearest PALETTE R G B [oklab|de2000]\n");
+        return 1;
+    }
+    
+    Palette palette;
+    if (!LoadPalette(argv[0], palette)) return 1;
+    
+    float distance;
+    const PaletteEntry& entry = palette.Entry(palette.Nearest(MakeColor(r, g, b), metric, &distance));
+    printf("%s %s %s %.2f\n", entry.name.c_str(), ColorToHex(entry.color).c_str(),
+           PaletteMetricName(metric), distance);
+    return 0;
+}
+
+int CmdTokens(int argc, char** argv) {
+    int x, y, radius;
+    PaletteMetric metric = PaletteMetric::DeltaE2000;
+    if (argc < 5 || argc > 6 || !ParseInt(argv[2], x) || !ParseInt(argv[3], y) ||
+        !ParseInt(argv[4], radius) || radius < 0 || radius > 1000 ||
+        (argc > 5 && !ParsePaletteMetric(argv[5], metric))) {
+        fprintf(stderr, "usage: xsukax_cli tokens PALETTE IMAGE X Y RADIUS [oklab|de2000]\n");
+        return 1;
+    }
+    
+    Palette palette;
+    if (!LoadPalette(argv[0], palette)) return 1;
+    
+    Image image;
+    std::string error;
+    if (!ReadImageFile(argv[1], image, error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    
+    ImageScreenSource source(image);
+    PixelView view;
+    if (!source.Capture(RectAround(x, y, radius), view)) {
+        fprintf(stderr, "capture failed\n");
+        return 1;
+    }
+    
+    // Map every pixel to its nearest entry, then report entries by coverage
+    std::vector<int> nearest((size_t)view.width * view.height);
+    palette.NearestBatch(view, metric, nearest.data());
+    std::vector<size_t> counts(palette.Size(), 0);
+    for (int index : nearest) counts[index]++;
+    
+    for (size_t i = 0; i < counts.size(); i++) {
+        if (counts[i] == 0) continue;
+        printf("%zu %.1f%% %s %s\n", counts[i], 100.0 * counts[i] / nearest.size(),
+               palette.Entry(i).name.c_str(), ColorToHex(palette.Entry(i).color).c_str());
+    }
+    return 0;
+}
+
+int CmdExtract(int argc, char** argv) {
+    ExtractOptions options;
+    if (argc < 1 || argc > 4 ||
+        (argc > 1 && (!ParseInt(argv[1], options.count) || options.count < 1 || options.count > kMaxExtractColors)) ||
+        (argc > 2 && !ParseExtractMethod(argv[2], options.method)) ||
+        (argc > 3 && (!ParseInt(argv[3], options.threads) || options.threads < 0))) {
+        fprintf(stderr, "usage: xsukax_cli extract IMAGE [COUNT 1-%d] [kmeans|mediancut] [THREADS]\n",
+                kMaxExtractColors);
+        return 1;
+    }
+    
+    Image image;
+    std::string error;
+    if (!ReadImageFile(argv[0], image, error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    
+    std::vector<DominantColor> colors;
+    ExtractDominantColors(image.View(), options, colors);
+    for (const DominantColor& d : colors) {
+        printf("%s %.1f%%\n", ColorToHex(d.color).c_str(), 100.0f * d.share);
+    }
+    return 0;
+}
+
+int CmdBatch(int argc, char** argv) {
+    BatchJob defaults;
+    BatchFormat format = BatchFormat::CSV;
+    int threads = 0;
+    bool showStats = false;
+    const char* jobFile = NULL;
+    bool ok = true;
+    for (int i = 0; i < argc && ok; i++) {
+        const char* arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (strcmp(arg, "--format") == 0) {
+            ok = hasValue && ParseBatchFormat(argv[++i], format);
+        } else if (strcmp(arg, "--threads") == 0) {
+            ok = hasValue && ParseInt(argv[++i], threads) && threads >= 0;
+        } else if (strcmp(arg, "--radius") == 0) {
+            ok = hasValue && ParseInt(argv[++i], defaults.radius) &&
+                 defaults.radius >= 0 && defaults.radius <= kMaxSampleRadius;
+        } else if (strcmp(arg, "--reducer") == 0) {
+            ok = hasValue && ParseSampleReducer(argv[++i], defaults.reducer);
+        } else if (strcmp(arg, "--stats") == 0) {
+            showStats = true;
+        } else if (!jobFile && arg[0] != '-') {
+            jobFile = arg;
+        } else {
+            ok = false;
+        }
+    }
+    if (!ok || !jobFile) {
+        fprintf(stderr, "usage: xsukax_cli batch JOBFILE [--format csv|jsonl] [--threads N]\n"
+                        "                  [--radius 0-%d] [--reducer mean|median|mode] [--stats]\n",
+                kMaxSampleRadius);
+        return 1;
+    }
+    
+    std::vector<BatchJob> jobs;
+    std::string error;
+    if (!LoadBatchJobs(jobFile, defaults, jobs, error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    
+    BatchStats stats;
+    RunBatch(jobs, format, threads, stdout, stderr, stats);
+    if (showStats) {
+        double seconds = stats.seconds > 0 ? stats.seconds : 1e-9;
+        fprintf(stderr, "%zu files (%zu failed), %zu samples (%zu outside) in %.3f s: %.0f files/s, %.0f samples/s\n",
+                stats.files, stats.failedFiles, stats.samples, stats.outsidePoints, stats.seconds,
+                stats.files / seconds, stats.samples / seconds);
+    }
+    return stats.failedFiles == 0 && stats.outsidePoints == 0 ? 0 : 1;
+}
+
+int CmdAudit(int argc, char** argv) {
+    AuditOptions options;
+    bool showStats = false;
+    const char* imageFile = NULL;
+    bool ok = true;
+    for (int i = 0; i < argc && ok; i++) {
+        const char* arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (strcmp(arg, "--min-ratio") == 0) {
+            char* end = NULL;
+            options.minRatio = hasValue ? (float)strtod(argv[++i], &end) : 0;
+            ok = hasValue && *end == '\0' && options.minRatio >= 1 && options.minRatio <= 21;
+        } else if (strcmp(arg, "--tile") == 0) {
+            ok = hasValue && ParseInt(argv[++i], options.tileSize) &&
+                 options.tileSize >= kMinAuditTile && options.tileSize <= kMaxAuditTile;
+        } else if (strcmp(arg, "--threads") == 0) {
+            ok = hasValue && ParseInt(argv[++i], options.threads) && options.threads >= 0;
+        } else if (strcmp(arg, "--stats") == 0) {
+            showStats = true;
+        } else if (!imageFile && arg[0] != '-') {
+            imageFile = arg;
+        } else {
+            ok = false;
+        }
+    }
+    if (!ok || !imageFile) {
+        fprintf(stderr, "usage: xsukax_cli audit IMAGE [--min-ratio 1-21] [--tile %d-%d] [--threads N] [--stats]\n",
+                kMinAuditTile, kMaxAuditTile);
+        return 1;
+    }
+    
+    MappedImage image;
+    std::string error;
+    if (!image.Open(imageFile, error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    
+    std::vector<ContrastIssue> issues;
+    AuditSummary summary;
+    auto start = std::chrono::steady_clock::now();
+    AuditContrast(image.View(), options, issues, &summary);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    
+    // x y width height foreground background ratio, worst first
+    for (const ContrastIssue& issue : issues) {
+        printf("%d %d %d %d %s %s %.2f\n", issue.rect.x, issue.rect.y, issue.rect.width, issue.rect.height,
+               ColorToHex(issue.foreground).c_str(), ColorToHex(issue.background).c_str(), issue.ratio);
+    }
+    if (showStats) {
+        double megapixels = (double)image.View().width * image.View().height / 1e6;
+        fprintf(stderr, "%d tiles, %d text, %d failing; %.2f ms, %.2f ms/MP\n", summary.tiles,
+                summary.textTiles, summary.failingTiles, ms, megapixels > 0 ? ms / megapixels : 0.0);
+    }
+    return issues.empty() ? 0 : 2;
+}
+
+int CmdProbe(int argc, char** argv) {
+    bool showStats = false;
+    std::vector<const char*> files;
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "--stats") == 0) {
+            showStats = true;
+        } else {
+            files.push_back(argv[i]);
+        }
+    }
+    if (files.size() < 2) {
+        fprintf(stderr, "usage: xsukax_cli probe PROBEFILE FRAME... [--stats]\n");
+        return 1;
+    }
+    
+    ProbeSet probes;
+    std::string error;
+    if (!probes.LoadFile(files[0], error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    
+    // Frames are ticks: the first sets the baseline, later ones report changes
+    std::vector<ProbeEvent> events;
+    MappedImage image;
+    double ms = 0;
+    int failed = 0;
+    for (size_t frame = 1; frame < files.size(); frame++) {
+        if (!image.Open(files[frame], error)) {
+            fprintf(stderr, "%s\n", error.c_str());
+            failed++;
+            continue;
+        }
+        
+        ViewScreenSource source(image.View());
+        events.clear();
+        auto start = std::chrono::steady_clock::now();
+        probes.Tick(source, frame - 1, events);
+        ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        for (const ProbeEvent& event : events) {
+            printf("%llu %s %s %s\n", (unsigned long long)event.timestamp, probes.At(event.probe).name.c_str(),
+                   ColorToHex(event.from).c_str(), ColorToHex(event.to).c_str());
+        }
+    }
+    
+    if (showStats) {
+        double evaluated = (double)probes.Size() * (files.size() - 1 - failed);
+        fprintf(stderr, "%zu probes over %dx%d, %zu frames in %.3f ms: %.0f probes/ms\n", probes.Size(),
+                probes.Bounds().width, probes.Bounds().height, files.size() - 1 - failed, ms,
+                ms > 0 ? evaluated / ms : 0.0);
+    }
+    return failed == 0 ? 0 : 1;
+}
+
+// One history record per line: Unix seconds, position, color and label
+void PrintRecord(const PickRecord& rec) {
+    printf("%llu.%06llu %d %d %s %s\n", (unsigned long long)(rec.timestampUs / 1000000),
+           (unsigned long long)(rec.timestampUs % 1000000), rec.x, rec.y,
+           ColorToHex(RecordColor(rec)).c_str(), rec.label);
+}
+
+int CmdHistory(int argc, char** argv) {
+    const char* usage = "usage: xsukax_cli history FILE [list [N] | range FROM TO | nearest R G B [K] |\n"
+                        "                                 distinct DELTA [N]]\n"
+                        "FROM and TO are Unix seconds, DELTA an OKLab distance\n";
+    if (argc < 1) {
+        fputs(usage, stderr);
+        return 1;
+    }
+    
+    PickHistory history;
+    std::string error;
+    if (!history.OpenReadOnly(argv[0], error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    
+    const char* query = argc > 1 ? argv[1] : "list";
+    int nargs = argc - 2;
+    char** args = argv + 2;
+    if (strcmp(query, "list") == 0) {
+        int count = 20;
+        if (nargs > 1 || (nargs == 1 && (!ParseInt(args[0], count) || count < 0))) {
+            fputs(usage, stderr);
+            return 1;
+        }
+        size_t first = history.Size() > (size_t)count ? history.Size() - count : 0;
+        for (size_t i = first; i < history.Size(); i++) {
+            PrintRecord(history.Record(i));
+        }
+    } else if (strcmp(query, "range") == 0) {
+        char* end0 = NULL;
+        char* end1 = NULL;
+        double from = nargs == 2 ? strtod(args[0], &end0) : 0;
+        double to = nargs == 2 ? strtod(args[1], &end1) : 0;
+        if (nargs != 2 || *end0 != '\0' || *end1 != '\0' || from < 0 || to < from) {
+            fputs(usage, stderr);
+            return 1;
+        }
+        size_t begin, end;
+        history.TimeRange((uint64_t)(from * 1e6), (uint64_t)(to * 1e6), begin, end);
+        for (size_t i = begin; i < end; i++) {
+            PrintRecord(history.Record(i));
+        }
+    } else if (strcmp(query, "nearest") == 0) {
+        int r, g, b;
+        int k = 5;
+        if (nargs < 3 || nargs > 4 || !ParseChannel(args[0], r) || !ParseChannel(args[1], g) ||
+            !ParseChannel(args[2], b) ||
+            (nargs > 3 && (!ParseInt(args[3], k) || k < 1 || k > PointIndex::kMaxNeighbours))) {
+            fputs(usage, stderr);
+            return 1;
+        }
+        size_t indices[PointIndex::kMaxNeighbours];
+        float distances[PointIndex::kMaxNeighbours];
+        size_t found = history.NearestColors(MakeColor(r, g, b), k, indices, distances);
+        for (size_t i = 0; i < found; i++) {
+            printf("%.4f ", distances[i]);
+            PrintRecord(history.Record(indices[i]));
+        }
+    } else if (strcmp(query, "distinct") == 0) {
+        char* end = NULL;
+        double delta = nargs >= 1 ? strtod(args[0], &end) : 0;
+        int count = 20;
+        if (nargs < 1 || nargs > 2 || *end != '\0' || delta < 0 ||
+            (nargs > 1 && (!ParseInt(args[1], count) || count < 0))) {
+            fputs(usage, stderr);
+            return 1;
+        }
+        std::vector<size_t> indices;
+        history.DistinctColors((float)delta, count, indices);
+        for (size_t index : indices) {
+            PrintRecord(history.Record(index));
+        }
+    } else {
+        fputs(usage, stderr);
+        return 1;
+    }
+    return 0;
+}
+
+int CmdRecording(int argc, char** argv) {
+    int threshold = 0;
+    int maxChanges = 20;
+    bool csv = false;
+    const char* file = NULL;
+    bool ok = true;
+    for (int i = 0; i < argc && ok; i++) {
+        const char* arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (strcmp(arg, "--threshold") == 0) {
+            ok = hasValue && ParseInt(argv[++i], threshold) && threshold >= 0 && threshold <= 255;
+        } else if (strcmp(arg, "--changes") == 0) {
+            ok = hasValue && ParseInt(argv[++i], maxChanges) && maxChanges >= 0;
+        } else if (strcmp(arg, "--csv") == 0) {
+            csv = true;
+        } else if (!file && arg[0] != '-') {
+            file = arg;
+        } else {
+            ok = false;
+        }
+    }
+    if (!ok || !file) {
+        fprintf(stderr, "usage: xsukax_cli recording FILE [--threshold 0-255] [--changes N] [--csv]\n");
+        return 1;
+    }
+    
+    Recording recording;
+    std::string error;
+    if (!ReadRecording(file, recording, error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    
+    // Every sample, for plotting easing curves elsewhere
+    if (csv) {
+        printf("time_us,x,y,hex,r,g,b\n");
+        for (size_t i = 0; i < recording.Size(); i++) {
+            printf("%llu,%d,%d,%s,%d,%d,%d\n", (unsigned long long)recording.timeUs[i], recording.x[i],
+                   recording.y[i], ColorToHex(recording.ColorAt(i)).c_str(), recording.r[i], recording.g[i],
+                   recording.b[i]);
+        }
+        return 0;
+    }
+    
+    RecordingStats stats;
+    std::vector<ColorChange> changes;
+    SummariseRecording(recording, threshold, stats, &changes, maxChanges);
+    printf("samples %zu over %.3f s (%.1f Hz)\n", stats.samples, stats.durationUs / 1e6, stats.rateHz);
+    const char* names[3] = {"R", "G", "B"};
+    const ChannelStats* channels[3] = {&stats.r, &stats.g, &stats.b};
+    for (int c = 0; c < 3; c++) {
+        printf("%s min %d max %d mean %.2f\n", names[c], channels[c]->min, channels[c]->max, channels[c]->mean);
+    }
+    printf("changes %zu\n", stats.changes);
+    for (const ColorChange& change : changes) {
+        printf("%.6f %s -> %s\n", change.timeUs / 1e6, ColorToHex(change.from).c_str(),
+               ColorToHex(change.to).c_str());
+    }
+    return 0;
+}
+
+int CmdReplay(int argc, char** argv) {
+    int ticks = 10000;
+    int radius = 0;
+    int budgetUs = 0;
+    SampleReducer reducer = SampleReducer::Mean;
+    bool json = false;
+    const char* imageFile = NULL;
+    const char* paletteFile = NULL;
+    bool ok = true;
+    for (int i = 0; i < argc && ok; i++) {
+        const char* arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (strcmp(arg, "--ticks") == 0) {
+            ok = hasValue && ParseInt(argv[++i], ticks) && ticks > 0;
+        } else if (strcmp(arg, "--radius") == 0) {
+            ok = hasValue && ParseInt(argv[++i], radius) && radius >= 0 && radius <= kMaxSampleRadius;
+        } else if (strcmp(arg, "--reducer") == 0) {
+            ok = hasValue && ParseSampleReducer(argv[++i], reducer);
+        } else if (strcmp(arg, "--palette") == 0) {
+            ok = hasValue;
+            paletteFile = ok ? argv[++i] : NULL;
+        } else if (strcmp(arg, "--budget-us") == 0) {
+            ok = hasValue && ParseInt(argv[++i], budgetUs) && budgetUs > 0;
+        } else if (strcmp(arg, "--json") == 0) {
+            json = true;
+        } else if (!imageFile && arg[0] != '-') {
+            imageFile = arg;
+        } else {
+            ok = false;
+        }
+    }
+    if (!ok || !imageFile) {
+        fprintf(stderr, "usage: xsukax_cli replay IMAGE [--ticks N] [--radius 0-%d] [--reducer mean|median|mode]\n"
+                        "                         [--palette FILE] [--budget-us N] [--json]\n",
+                kMaxSampleRadius);
+        return 1;
+    }
+    
+    Image image;
+    std::string error;
+    if (!ReadImageFile(imageFile, image, error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    Palette palette;
+    if (paletteFile && !LoadPalette(paletteFile, palette)) return 1;
+    
+    // The GUI's tracking path with the screen replaced by the image: the
+    // worker's TrackingStep, then the display formatting and the loupe
+    ImageScreenSource source(image);
+    ChangeTracker tracker;
+    SamplePatch patch;
+    LoupeStyle style;
+    const int loupeSize = kMaxPatchCells * style.scale;
+    std::vector<uint8_t> loupe((size_t)loupeSize * loupeSize * 4);
+    Color color = MakeColor(0, 0, 0);
+    ResetPerfStats();
+    
+    for (int t = 0; t < ticks; t++) {
+        // Lissajous sweep over the image, resting for 16 ticks out of every 64
+        int phase = t - (t / 64) * 16 - (t % 64 > 48 ? t % 64 - 48 : 0);
+        int x = (int)(image.width * (0.5 + 0.45 * std::sin(phase * 0.013)));
+        int y = (int)(image.height * (0.5 + 0.45 * std::sin(phase * 0.017)));
+        if (!TrackingStep(source, tracker, x, y, (uint32_t)t * kFastIntervalMs, radius, reducer, color,
+                          kMaxPatchRadius, &patch)) {
+            continue;
+        }
+        
+        {
+            PERF_SCOPE(PerfStage::Display);
+            char hex[kHexBufferSize];
+            char rgb[kRGBBufferSize];
+            char hsl[kHSLBufferSize];
+            char space[kSpaceBufferSize];
+            FormatHex(color, hex);
+            FormatRGB(color, rgb);
+            FormatHSL(color, hsl);
+            FormatColorSpace(color, ColorSpace::OKLCh, space);
+            if (palette.Size() > 0) palette.Nearest(color, PaletteMetric::DeltaE2000);
+        }
+        {
+            PERF_SCOPE(PerfStage::Loupe);
+            RenderLoupe(patch.View(), style, loupe.data(), (size_t)loupeSize * 4);
+        }
+    }
+    
+    if (json) {
+        fputs(PerfStatsJSON().c_str(), stdout);
+    } else {
+        printf("%-8s %8s %10s %10s %10s %10s\n", "stage", "count", "p50 us", "p90 us", "p99 us", "max us");
+        for (int i = 0; i < kPerfStageCount; i++) {
+            const LatencyHistogram& h = PerfHistogram((PerfStage)i);
+            if (h.Count() == 0) continue;
+            printf("%-8s %8llu %10.3f %10.3f %10.3f %10.3f\n", PerfStageName((PerfStage)i),
+                   (unsigned long long)h.Count(), h.PercentileNs(0.50) / 1000.0, h.PercentileNs(0.90) / 1000.0,
+                   h.PercentileNs(0.99) / 1000.0, h.MaxNs() / 1000.0);
+        }
+    }
+    
+    // Regression gate: any stage whose p99 exceeds the budget fails the run
+    int over = 0;
+    for (int i = 0; i < kPerfStageCount && budgetUs > 0; i++) {
+        if (PerfHistogram((PerfStage)i).PercentileNs(0.99) > (uint64_t)budgetUs * 1000) {
+            fprintf(stderr, "%s p99 over budget\n", PerfStageName((PerfStage)i));
+            over++;
+        }
+    }
+    return over == 0 ? 0 : 2;
+}
+
+bool ParseSimdLevel(const char* text, SimdLevel& level) {
+    if (strcmp(text, "scalar") == 0) {
+        level = SimdLevel::Scalar;
+    } else if (strcmp(text, "sse2") == 0) {
+        level = SimdLevel::SSE2;
+    } else if (strcmp(text, "avx2") == 0) {
+        level = SimdLevel::AVX2;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+int CmdSimulate(int argc, char** argv) {
+    float severity = 1.0f;
+    int threads = 0;
+    int repeat = 1;
+    bool showStats = false;
+    bool forceSimd = false;
+    SimdLevel simd = SimdLevel::Scalar;
+    const char* outFile = NULL;
+    const char* positional[2] = {NULL, NULL};
+    int positionalCount = 0;
+    bool ok = true;
+    for (int i = 0; i < argc && ok; i++) {
+        const char* arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (strcmp(arg, "--severity") == 0) {
+            char* end = NULL;
+            severity = hasValue ? (float)strtod(argv[++i], &end) : -1;
+            ok = hasValue && *end == '\0' && severity >= 0 && severity <= 1;
+        } else if (strcmp(arg, "--out") == 0) {
+            ok = hasValue;
+            outFile = ok ? argv[++i] : NULL;
+        } else if (strcmp(arg, "--threads") == 0) {
+            ok = hasValue && ParseInt(argv[++i], threads) && threads >= 0;
+        } else if (strcmp(arg, "--repeat") == 0) {
+            ok = hasValue && ParseInt(argv[++i], repeat) && repeat > 0;
+        } else if (strcmp(arg, "--simd") == 0) {
+            ok = hasValue && ParseSimdLevel(argv[++i], simd);
+            forceSimd = true;
+        } else if (strcmp(arg, "--stats") == 0) {
+            showStats = true;
+        } else if (positionalCount < 2 && arg[0] != '-') {
+            positional[positionalCount++] = arg;
+        } else {
+            ok = false;
+        }
+    }
+    VisionType type;
+    if (!ok || positionalCount != 2 || !ParseVisionType(positional[1], type)) {
+        fprintf(stderr, "usage: xsukax_cli simulate IMAGE protan|deutan|tritan|achroma [--severity 0-1] [--out FILE]\n"
+                        "                           [--threads N] [--repeat N] [--simd scalar|sse2|avx2] [--stats]\n");
+        return 1;
+    }
+    if (forceSimd) simd = ForceSimdLevel(simd);
+    
+    MappedImage image;
+    std::string error;
+    if (!image.Open(positional[0], error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    
+    // Source and output share a layout, so the output is a plain image
+    const PixelView& view = image.View();
+    Image output;
+    output.Allocate(view.width, view.height, view.format);
+    VisionMatrix matrix = SimulationMatrix(type, severity);
+    double best = 0;
+    double total = 0;
+    for (int i = 0; i < repeat; i++) {
+        auto start = std::chrono::steady_clock::now();
+        SimulateView(view, matrix, output.pixels.data(), output.Stride(), threads);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        best = i == 0 || ms < best ? ms : best;
+        total += ms;
+    }
+    
+    if (outFile && !WritePPM(outFile, output.View(), error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    if (showStats) {
+        double megapixels = (double)view.width * view.height / 1e6;
+        fprintf(stderr, "%s kernel, threads %d: %.2f ms mean, %.2f ms best, %.2f ms/MP\n", SimdLevelName(GetSimdLevel()),
+                ResolveThreadCount(threads), total / repeat, best, megapixels > 0 ? best / megapixels : 0.0);
+    }
+    return 0;
+}
+
+// Each color as seen with every vision type. With several colors, the
+// closest pair (CIEDE2000) shows whether they stay distinguishable.
+int CmdVision(int argc, char** argv) {
+    std::vector<Color> colors;
+    bool ok = argc >= 3 && argc % 3 == 0;
+    for (int i = 0; ok && i < argc; i += 3) {
+        int r = 0, g = 0, b = 0;
+        ok = ParseChannel(argv[i], r) && ParseChannel(argv[i + 1], g) && ParseChannel(argv[i + 2], b);
+        colors.push_back(MakeColor(r, g, b));
+    }
+    if (!ok) {
+        fprintf(stderr, "usage: xsukax_cli vision R G B [R G B]...\n");
+        return 1;
+    }
+    
+    for (int t = 0; t < kVisionTypeCount; t++) {
+        VisionMatrix matrix = SimulationMatrix((VisionType)t);
+        std::vector<LabValue> lab;
+        printf("%-14s", VisionTypeName((VisionType)t));
+        for (Color color : colors) {
+            Color seen = SimulateColor(color, matrix);
+            lab.push_back(ColorToLab(seen));
+            printf(" %s", ColorToHex(seen).c_str());
+        }
+        if (colors.size() > 1) {
+            float closest = -1;
+            for (size_t i = 0; i < lab.size(); i++) {
+                for (size_t j = i + 1; j < lab.size(); j++) {
+                    float d = DeltaE2000(lab[i], lab[j]);
+                    closest = closest < 0 || d < closest ? d : closest;
+                }
+            }
+            printf("  dE %.1f", closest);
+        }
+        printf("\n");
+    }
+    return 0;
+}
+
+// Each argument is any CSS color literal or a bare hex value
+int CmdParse(int argc, char** argv) {
+    if (argc < 1) {
+        fprintf(stderr, "usage: xsukax_cli parse COLOR...\n");
+        return 1;
+    }
+    
+    int failed = 0;
+    for (int i = 0; i < argc; i++) {
+        ParsedColor parsed;
+        if (!ParseColorField(argv[i], CssSyntax::Hex, parsed)) {
+            fprintf(stderr, "not a color: %s\n", argv[i]);
+            failed++;
+            continue;
+        }
+        if (i > 0) printf("\n");
+        PrintColor(parsed.color);
+        if (parsed.alpha < 255) {
+            printf("Alpha %.3f\n", parsed.alpha / 255.0);
+        }
+    }
+    return failed == 0 ? 0 : 1;
+}
+
+// Rewrites every color literal of a stylesheet or token file. The timed
+// passes for --stats only scan and parse; the rewrite is written once.
+int CmdCss(int argc, char** argv) {
+    CssSyntax syntax = CssSyntax::Hex;
+    int repeat = 1;
+    bool showStats = false;
+    const char* outFile = NULL;
+    const char* inFile = NULL;
+    bool ok = true;
+    for (int i = 0; i < argc && ok; i++) {
+        const char* arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (strcmp(arg, "--to") == 0) {
+            ok = hasValue && ParseCssSyntax(argv[++i], syntax);
+        } else if (strcmp(arg, "--out") == 0) {
+            ok = hasValue;
+            outFile = ok ? argv[++i] : NULL;
+        } else if (strcmp(arg, "--repeat") == 0) {
+            ok = hasValue && ParseInt(argv[++i], repeat) && repeat > 0;
+        } else if (strcmp(arg, "--stats") == 0) {
+            showStats = true;
+        } else if (!inFile && arg[0] != '-') {
+            inFile = arg;
+        } else {
+            ok = false;
+        }
+    }
+    if (!ok || !inFile) {
+        fprintf(stderr, "usage: xsukax_cli css FILE [--to hex|rgb|hsl|oklch] [--out FILE] [--repeat N] [--stats]\n");
+        return 1;
+    }
+    
+    MappedFile file;
+    std::string error;
+    if (!file.Open(inFile, error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    const char* begin = (const char*)file.Data();
+    const char* end = begin + file.Size();
+    
+    double best = 0;
+    size_t count = 0;
+    for (int i = 0; showStats && i < repeat; i++) {
+        auto start = std::chrono::steady_clock::now();
+        count = ConvertCssColors(begin, end, syntax, NULL);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        best = i == 0 || ms < best ? ms : best;
+    }
+    
+    FILE* out = outFile ? fopen(outFile, "wb") : stdout;
+    if (!out) {
+        fprintf(stderr, "cannot open %s\n", outFile);
+        return 1;
+    }
+    ConvertCssColors(begin, end, syntax, out);
+    if (outFile) fclose(out);
+    
+    if (showStats) {
+        double seconds = best > 0 ? best / 1000.0 : 1e-9;
+        fprintf(stderr, "%zu colors in %.2f MB: %.2f ms best, %.2f M colors/s, %.0f MB/s\n", count,
+                file.Size() / 1e6, best, count / seconds / 1e6, file.Size() / seconds / 1e6);
+    }
+    return 0;
+}
+
+// Every region of one or more colors in an image. Targets are hex colors
+// on the command line and the entries of a palette file, in that order.
+int CmdFind(int argc, char** argv) {
+    SearchOptions options;
+    int repeat = 1;
+    bool showStats = false;
+    bool forceSimd = false;
+    SimdLevel simd = SimdLevel::Scalar;
+    const char* imageFile = NULL;
+    const char* paletteFile = NULL;
+    std::vector<Color> targets;
+    std::vector<std::string> names;
+    bool ok = true;
+    for (int i = 0; i < argc && ok; i++) {
+        const char* arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        ParsedColor parsed;
+        if (strcmp(arg, "--palette") == 0) {
+            ok = hasValue;
+            paletteFile = ok ? argv[++i] : NULL;
+        } else if (strcmp(arg, "--tolerance") == 0) {
+            char* end = NULL;
+            options.tolerance = hasValue ? (float)strtod(argv[++i], &end) : -1;
+            ok = hasValue && *end == '\0' && options.tolerance >= 0 && options.tolerance <= 100;
+        } else if (strcmp(arg, "--metric") == 0) {
+            ok = hasValue && ParsePaletteMetric(argv[++i], options.metric);
+        } else if (strcmp(arg, "--min-pixels") == 0) {
+            ok = hasValue && ParseInt(argv[++i], options.minPixels) && options.minPixels > 0;
+        } else if (strcmp(arg, "--threads") == 0) {
+            ok = hasValue && ParseInt(argv[++i], options.threads) && options.threads >= 0;
+        } else if (strcmp(arg, "--repeat") == 0) {
+            ok = hasValue && ParseInt(argv[++i], repeat) && repeat > 0;
+        } else if (strcmp(arg, "--simd") == 0) {
+            ok = hasValue && ParseSimdLevel(argv[++i], simd);
+            forceSimd = true;
+        } else if (strcmp(arg, "--stats") == 0) {
+            showStats = true;
+        } else if (!imageFile && arg[0] != '-') {
+            imageFile = arg;
+        } else if (arg[0] != '-' && ParseColorField(arg, CssSyntax::Hex, parsed)) {
+            targets.push_back(parsed.color);
+            names.push_back("");
+        } else {
+            ok = false;
+        }
+    }
+    if (!ok || !imageFile || (targets.empty() && !paletteFile)) {
+        fprintf(stderr, "usage: xsukax_cli find IMAGE [COLOR...] [--palette FILE] [--tolerance D] [--metric oklab|de2000]\n"
+                        "                       [--min-pixels N] [--threads N] [--repeat N] [--simd scalar|sse2|avx2] [--stats]\n");
+        return 1;
+    }
+    if (forceSimd) simd = ForceSimdLevel(simd);
+    
+    if (paletteFile) {
+        Palette palette;
+        if (!LoadPalette(paletteFile, palette)) return 1;
+        for (size_t i = 0; i < palette.Size(); i++) {
+            targets.push_back(palette.Entry(i).color);
+            names.push_back(palette.Entry(i).name);
+        }
+    }
+    if (targets.size() > (size_t)kMaxSearchTargets) {
+        fprintf(stderr, "at most %d colors can be searched for at once\n", kMaxSearchTargets);
+        return 1;
+    }
+    
+    MappedImage image;
+    std::string error;
+    if (!image.Open(imageFile, error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    
+    std::vector<ColorMatch> matches;
+    SearchSummary summary;
+    double best = 0;
+    double total = 0;
+    for (int i = 0; i < repeat; i++) {
+        auto start = std::chrono::steady_clock::now();
+        SearchColors(image.View(), targets, options, matches, &summary);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        best = i == 0 || ms < best ? ms : best;
+        total += ms;
+    }
+    
+    // x y width height color pixels [name], top to bottom
+    for (const ColorMatch& m : matches) {
+        const std::string& name = names[m.target];
+        printf("%d %d %d %d %s %d%s%s\n", m.rect.x, m.rect.y, m.rect.width, m.rect.height,
+               ColorToHex(targets[m.target]).c_str(), m.pixels, name.empty() ? "" : " ", name.c_str());
+    }
+    if (showStats) {
+        double megapixels = (double)image.View().width * image.View().height / 1e6;
+        fprintf(stderr, "%zu colors, %lld pixels in %d runs, %d regions, %zu reported\n", targets.size(),
+                summary.pixels, summary.runs, summary.regions, matches.size());
+        fprintf(stderr, "%s kernel, threads %d: %.2f ms mean, %.2f ms best, %.2f ms/MP\n", SimdLevelName(GetSimdLevel()),
+                ResolveThreadCount(options.threads), total / repeat, best, megapixels > 0 ? best / megapixels : 0.0);
+    }
+    return matches.empty() ? 2 : 0;
+}
+
+int CmdInfo(int, char**) {
+    printf("simd %s\n", SimdLevelName(GetSimdLevel()));
+    return 0;
+}
+
+struct Command {
+    const char* name;
+    int (*run)(int argc, char** argv);
+    const char* help;
+};
+
+const Command g_commands[] = {
+    {"convert", CmdConvert, "convert R G B        print a color in every supported format"},
+    {"sample",  CmdSample,  "sample IMAGE X Y [RADIUS] [REDUCER]\n"
+                                             "                       print the picked color at a point of a PPM or BMP image"},
+    {"nearest", CmdNearest, "nearest PALETTE R G B [METRIC]\n"
+                                             "                       print the closest named color of a palette file"},
+    {"tokens",  CmdTokens,  "tokens PALETTE IMAGE X Y RADIUS [METRIC]\n"
+                                             "                       print palette entries covering a square of a PPM or BMP image"},
+    {"extract", CmdExtract, "extract IMAGE [COUNT] [METHOD] [THREADS]\n"
+                                             "                       print the dominant colors of a PPM or BMP image"},
+    {"batch",   CmdBatch,   "batch JOBFILE [OPTIONS]\n"
+                                             "                       sample point lists over many images as CSV or JSON Lines"},
+    {"audit",   CmdAudit,   "audit IMAGE [OPTIONS]\n"
+                                             "                       report text regions below a WCAG contrast ratio"},
+    {"probe",   CmdProbe,   "probe PROBEFILE FRAME... [--stats]\n"
+                                             "                       report probe color changes across a sequence of frames"},
+    {"history", CmdHistory, "history FILE [QUERY]\n"
+                                             "                       list, time-range, nearest-color or distinct queries on a pick history"},
+    {"recording", CmdRecording, "recording FILE [OPTIONS]\n"
+                                             "                       summarise or dump a color time-series recording"},
+    {"replay",  CmdReplay,  "replay IMAGE [OPTIONS]\n"
+                                             "                       time each tracking stage along a synthetic cursor path"},
+    {"simulate", CmdSimulate, "simulate IMAGE TYPE [OPTIONS]\n"
+                                             "                       render an image as seen with a color vision deficiency"},
+    {"vision",  CmdVision,  "vision R G B [R G B]...\n"
+                                             "                       print colors as seen with each color vision deficiency"},
+    {"parse",   CmdParse,   "parse COLOR...\n"
+                                             "                       print hex, rgb(), hsl() or oklch() colors in every supported format"},
+    {"css",     CmdCss,     "css FILE [OPTIONS]\n"
+                                             "                       rewrite every color of a stylesheet or token file in one syntax"},
+    {"find",    CmdFind,    "find IMAGE [COLOR...] [OPTIONS]\n"
+                                             "                       print the bounding box of every region of the given colors"},
+    {"info",    CmdInfo,    "info                 print the selected SIMD kernel"},
+};
+
+void PrintUsage() {
+    fprintf(stderr, "usage: xsukax_cli <command> [args]\n\ncommands:\n");
+    for (const Command& cmd : g_commands) {
+        fprintf(stderr, "  %s\n", cmd.help);
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        PrintUsage();
+        return 1;
+    }
+    
+    for (const Command& cmd : g_commands) {
+        if (strcmp(argv[1], cmd.name) == 0) {
+            return cmd.run(argc - 2, argv + 2);
+        }
+    }
+    
+    fprintf(stderr, "unknown command: %s\n\n", argv[1]);
+    PrintUsage();
+    return 1;
+}